@@ -2,24 +2,27 @@
 #define AMPLIFIERS_H
 
 #include "rfcomponent.h"
-#include <array>
 
 class Amplifiers : public RFcomponent
 {
-    static const uint16_t noAmplifiers = 12; //!< Number of amplifiers used at Solaris.
-    static const uint16_t noDiagNodes = 15; //!< Number of nodes to read in order to get full diagnostics done.
-
 public:
     /**
-     * @brief Amplifiers Amplifiers component. Usually there is more than 1.
+     * @brief Amplifiers Amplifiers component. Any number of amplifiers is supported.
      * @param indexList Indices of the amplifiers in the RF transmitter.
      * @param snmp Connection used for reading.
      */
     Amplifiers(const std::vector<uint16_t>& indexList, const std::shared_ptr<SNMPconnector> snmp);
+
+    /**
+     * @brief Amplifiers Amplifiers component as described by the topology.
+     * @param topology Transmitter topology.
+     * @param snmp Connection used for reading.
+     */
+    Amplifiers(const TransmitterTopology& topology, const std::shared_ptr<SNMPconnector> snmp);
     ~Amplifiers();
 
     void diagnose(const std::vector<std::string>& summaryValues);
-    void updateReadParameters();
+    SNMPerror tryUpdateReadParameters();
 
     /**
      * @brief getAmpON Returns the output state of specific amplifier.
@@ -28,10 +31,23 @@ public:
      */
     bool getAmpON(const uint16_t index);
 
+    /**
+     * @brief getNumberOfAmplifiers Returns the number of amplifiers in the system.
+     * @return Number of amplifiers.
+     */
+    inline size_t getNumberOfAmplifiers() { return ampOn.size(); }
+
 private:
-    std::array<std::atomic<int32_t>, noAmplifiers> ampOn; //!< Array of amp switch states.
+    /// Per amplifier data is kept in contiguous buffers (structure of arrays) sized once at construction. ///
+    std::vector<std::atomic<int32_t> > ampOn; //!< Amp switch states. Read without locks.
+    std::vector<int32_t> parseFailed; //!< 1 if the summary of the amplifier could not be parsed.
+    std::vector<int32_t> needsDiagnostics; //!< 1 if the amplifier reports a problem other than OFF.
+    std::vector<std::string> diagRequestNames; //!< Name of the diagnostics request of each amplifier.
+    std::vector<std::string> diagNodes; //!< Names of the nodes read for diagnostics.
     static const std::string upadateParamsName; //!< Name of the SNMP update parameters request.
     static const std::string diagRequestName; //!< Name of the SNMP requests for diagnostics.
+
+    void init(const TransmitterTopology& topology); /// Sizes the buffers and registers diagnostics and update requests. Called by every constructor.
 };
 
 #endif // AMPLIFIERS_H
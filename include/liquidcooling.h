@@ -2,12 +2,9 @@
 #define LIQUIDCOOLING_H
 
 #include "rfcomponent.h"
-#include <array>
 
 class LiquidCooling : public RFcomponent
 {
-    static const uint16_t numberOfLiquidDevices = 2; //!< Number of liquid cooling devices.
-    static const uint16_t noDiagNodes = 4; //!< Number of nodes to read in order to get full diagnostics done.
 public:
 
     /**
@@ -16,30 +13,48 @@ public:
      * @param snmp Connection used for reading.
      */
     LiquidCooling(const std::vector<uint16_t>& indexList, const std::shared_ptr<SNMPconnector> snmp);
+
+    /**
+     * @brief LiquidCooling Liquid cooling component as described by the topology.
+     * @param topology Transmitter topology.
+     * @param snmp Connection used for reading.
+     */
+    LiquidCooling(const TransmitterTopology& topology, const std::shared_ptr<SNMPconnector> snmp);
     ~LiquidCooling();
 
     void diagnose(const std::vector<std::string>& summaryValues);
-    void updateReadParameters();
+    SNMPerror tryUpdateReadParameters();
 
     /**
      * @brief getInTemps Returns the inlet temperatures.
-     * @return Array of inlet temperatures. In our case 2 values.
+     * @return Inlet temperatures. One value per device.
      */
-    inline const std::array<std::atomic<int32_t>, numberOfLiquidDevices>& getInTemps() { return inTemp; }
+    inline const std::vector<std::atomic<int32_t> >& getInTemps() { return inTemp; }
 
     /**
      * @brief getOutTemps Returns the outlet temperatures.
-     * @return Array of outlet temperatures. In our case 2 values.
+     * @return Outlet temperatures. One value per device.
      */
-    inline const std::array<std::atomic<int32_t>, numberOfLiquidDevices>& getOutTemps() { return outTemp; }
+    inline const std::vector<std::atomic<int32_t> >& getOutTemps() { return outTemp; }
+
+    /**
+     * @brief getNumberOfDevices Returns the number of liquid cooling devices.
+     * @return Number of devices.
+     */
+    inline size_t getNumberOfDevices() { return inTemp.size(); }
 
 private:    
-    std::array<std::string, numberOfLiquidDevices> diagRequestName; //!< Name of the SNMP requests for diagnostics for each component.
+    std::vector<std::string> diagRequestName; //!< Name of the SNMP requests for diagnostics for each component.
     std::string upadateParamsName; //!< Name of the SNMP update parameters request.
+    std::vector<std::string> diagNodes; //!< Names of the nodes read for diagnostics.
 
+    /// Per device data is kept in contiguous buffers (structure of arrays) sized once at construction. ///
     /// No locks needed for updating and reading component parameters. ///
-    std::array<std::atomic<int32_t>, numberOfLiquidDevices> inTemp; //!< Holder for inlet temperatures.
-    std::array<std::atomic<int32_t>, numberOfLiquidDevices> outTemp; //!< Holder for outlet temperatures.
+    std::vector<std::atomic<int32_t> > inTemp; //!< Holder for inlet temperatures.
+    std::vector<std::atomic<int32_t> > outTemp; //!< Holder for outlet temperatures.
+    std::vector<int32_t> states; //!< Parsed summary state of each device.
+
+    void init(const TransmitterTopology& topology); /// Sizes the buffers and registers diagnostics and update requests. Called by every constructor.
 };
 
 #endif // LIQUIDCOOLING_H
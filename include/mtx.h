@@ -11,21 +11,23 @@ public:
      * @brief MTx MultiTxTransmitter component.
      * @param snmp Connection used for reading.
      * @param snmpW Connection used for writting.
+     * @param topology Transmitter topology. Solaris by default.
      */
-    MTx(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW);
+    MTx(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology = TransmitterTopology());
     ~MTx() {}
 
     void diagnose(const std::vector<std::string>& summaryValues);
-    inline void updateReadParameters() { /* Nothing to do here. */ }
+    inline SNMPerror tryUpdateReadParameters() { return SNMPerror(); /* Nothing to do here. */ }
     void updateStateAndStatus();
 
     /**
      * @brief reset Resets the MTx.
      */
-    inline void reset() { snmpW->setValue(oids[OIDS::MTX_RESET], resetValue); }
+    inline void reset() { snmpW->setValue(resetOid, resetValue); }
 
 private:
-    const std::shared_ptr<SNMPconnector> snmpW; //!< Write connection.    
+    const std::shared_ptr<SNMPconnector> snmpW; //!< Write connection.
+    const std::string resetOid; //!< OID written to reset the MTx.
 };
 
 #endif // MTX_H
@@ -10,8 +10,9 @@ public:
      * @brief OutStage Output stage component. Overview of all amplifiers and cooling.
      * @param snmp Connection used for reading.
      * @param snmpW Connection used for writting.
+     * @param topology Transmitter topology. Solaris by default.
      */
-    OutStage(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW);
+    OutStage(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology = TransmitterTopology());
     ~OutStage();
 
     inline void diagnose(const std::vector<std::string>& summaryValues)
@@ -20,14 +21,14 @@ public:
         throw RfComponentException("Diagnose on output stage is not possible.");
     }
 
-    void updateReadParameters();
+    SNMPerror tryUpdateReadParameters();
     void updateStateAndStatus();
 
     /**
      * @brief setPower Set the output stage power.
      * @param value Desired power.
      */
-    inline void setPower(const uint32_t value) { snmpW->setValue(oids[OIDS::OUT_POWER], value); }
+    inline void setPower(const uint32_t value) { snmpW->setValue(powerOid, value); }
 
     /**
      * @brief getPower Readback of the output stage power.
@@ -38,6 +39,7 @@ public:
 private:    
     const std::shared_ptr<SNMPconnector> snmpW; //!< Write connection.
     static const std::string upadateParamsName; //!< Name of the command to update parameters.
+    const std::string powerOid; //!< OID of the output stage power.
 
     /// No locks needed for updating and reading component parameters. ///
     std::atomic<uint32_t> power; //!< Output stage power.
@@ -5,8 +5,14 @@
 #include <mutex>
 #include "snmpconnector.h"
 #include "snmpoids.h"
+#include "rftopology.h"
+#include "rftrace.h"
+#include "statefilter.h"
 #include <sstream>
 #include <cstdatomic>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
 
 class RfComponentException : public std::runtime_error
 {
@@ -29,6 +35,53 @@ template<typename T> T convertToValue(const std::string& value)
     return converted;
 }
 
+/**
+ *  Integer conversions run for every polled value, so they parse in place instead of through a stream. Same results as
+ *  the stream: leading white space is skipped, parsing stops at the first non digit, unsigned values wrap negatives.
+ */
+template<> inline int64_t convertToValue<int64_t>(const std::string& value)
+{
+    const char* begin = value.c_str();
+    char* end;
+    errno = 0;
+    long long converted = std::strtoll(begin, &end, 10);
+    if(end == begin || errno == ERANGE)
+    {
+        throw SNMPconnectorException("Failed to parse SNMP values.");
+    }
+    return converted;
+}
+
+template<> inline int32_t convertToValue<int32_t>(const std::string& value)
+{
+    int64_t converted = convertToValue<int64_t>(value);
+    if(converted < INT32_MIN || converted > INT32_MAX)
+    {
+        throw SNMPconnectorException("Failed to parse SNMP values.");
+    }
+    return static_cast<int32_t>(converted);
+}
+
+template<> inline uint32_t convertToValue<uint32_t>(const std::string& value)
+{
+    int64_t converted = convertToValue<int64_t>(value);
+    if(converted < -static_cast<int64_t>(UINT32_MAX) || converted > static_cast<int64_t>(UINT32_MAX))
+    {
+        throw SNMPconnectorException("Failed to parse SNMP values.");
+    }
+    return static_cast<uint32_t>(converted);
+}
+
+/**
+ *  Helper function to append a number to a string without a stream.
+ */
+inline void appendNumber(std::string& out, const int64_t value)
+{
+    char digits[24];
+    int length = std::snprintf(digits, sizeof(digits), "%lld", static_cast<long long>(value));
+    out.append(digits, length);
+}
+
 /**
  * @brief The States enum Possible states returned from SNMP agent.
  */
@@ -58,6 +111,36 @@ static const std::string StatesText[States::END_OF_STATE + 1] = //!< Helper to t
 
 static const std::string dataAcquisitionFailed = "SNMP data acquisition failed."; //!< Unified message for SNMP error.
 
+class RFcomponent;
+
+/**
+ * @brief The ComponentListener class Observer of component parameter samples and state transitions.
+ * Called synchronously from the polling thread, so implementations must be fast and must not call back into the component.
+ */
+class ComponentListener
+{
+public:
+    virtual ~ComponentListener() {}
+
+    /**
+     * @brief parametersUpdated Called after updateReadParameters published new values.
+     * @param component Component that was updated.
+     * @param time Receive time of the sample in ns since the epoch, kernel timestamp where the transport has one.
+     * @param values New values in the order of RFcomponent::getParameterNames.
+     */
+    virtual void parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values) = 0;
+
+    /**
+     * @brief stateChanged Called when the state of the component changes.
+     * @param component Component that changed.
+     * @param time Receive time of the summaries that caused the transition in ns since the epoch. Wall clock time if the read failed.
+     * @param oldState Previous state.
+     * @param newState New state.
+     * @param status New status message.
+     */
+    virtual void stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status) = 0;
+};
+
 class RFcomponent
 {    
 
@@ -87,6 +170,14 @@ public:
      */
     RFcomponent(const std::string& summaryNode, const std::string& componentName, const std::shared_ptr<SNMPconnector> snmp);
 
+    /**
+     * @brief RFcomponent Constructor for components described by the topology.
+     * @param topology Transmitter topology.
+     * @param type Which component of the topology this is.
+     * @param snmp SNMP connection used for reading.
+     */
+    RFcomponent(const TransmitterTopology& topology, const ComponentTypes type, const std::shared_ptr<SNMPconnector> snmp);
+
     virtual ~RFcomponent();
     /**
      * @brief diagnose Used to diagnose non OK states.
@@ -96,8 +187,16 @@ public:
 
     /**
      * @brief updateReadParameters Reads and updates component parameters.
+     * @throws SNMPconnectorException If the parameters could not be read.
      */
-    virtual void updateReadParameters() = 0;
+    virtual void updateReadParameters();
+
+    /**
+     * @brief tryUpdateReadParameters Reads and updates component parameters without throwing, e.g. for polling loops that
+     * keep running while the agent is unreachable.
+     * @return Why the read failed. Its status is SNMP_CLASS_SUCCESS if at least one parameter was updated.
+     */
+    virtual SNMPerror tryUpdateReadParameters() = 0;
 
     /**
      * @brief updateStateAndStatus Default function to update state and status or trigger diagnose.
@@ -136,6 +235,84 @@ public:
      */
     inline bool getDataValid() { return dataValid; }
 
+    /**
+     * @brief isParameterValid Checks if the last read of a parameter succeeded. Invalid parameters keep their last value.
+     * @param index Index in getParameterNames.
+     * @return True if the value is current.
+     */
+    inline bool isParameterValid(const size_t index) const { return index < parameterValid.size() && parameterValid[index]; }
+
+    /**
+     * @brief getName Returns the name of the component without copying.
+     * @return Name of the component.
+     */
+    inline const std::string& getName() const { return componentName; }
+
+    /**
+     * @brief getStateTime Returns when the summaries of the last successful state read were received.
+     * @return Time in ns since the epoch, 0 before the first read and after a failed one.
+     */
+    inline uint64_t getStateTime() const { return stateTime.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getParametersTime Returns when the last parameter sample was received.
+     * @return Time in ns since the epoch, 0 before the first read.
+     */
+    inline uint64_t getParametersTime() const { return parametersTime.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getParameterNames Returns the names of the parameters reported to listeners.
+     * @return Parameter names. Empty if the component has no parameters.
+     */
+    inline const std::vector<std::string>& getParameterNames() const { return parameterNames; }
+
+    /**
+     * @brief getParameterValues Returns the last published parameters without copying. The vector keeps its size and
+     * address for the life of the component, its values change with every updateReadParameters.
+     * @return Parameter values in the order of getParameterNames.
+     */
+    inline const std::vector<int64_t>& getParameterValues() const { return parameterValues; }
+
+    /**
+     * @brief addListener Registers a listener for parameter samples and state transitions.
+     * @param listener Listener to add.
+     */
+    void addListener(const std::shared_ptr<ComponentListener>& listener);
+
+    /**
+     * @brief removeListener Unregisters the listener.
+     * @param listener Listener to remove.
+     */
+    void removeListener(const std::shared_ptr<ComponentListener>& listener);
+
+    /**
+     * @brief getListenerFailures Returns how many listener calls threw. The exceptions are dropped, the other listeners
+     * are still called.
+     * @return Number of failed listener calls.
+     */
+    inline uint64_t getListenerFailures() const { return listenerFailures.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief setStateFilter Debounces state changes: a new state is taken when N of the last M reads agree on a change and
+     * the current state was held for the minimum dwell time. Suppressed reads keep the state and skip the diagnosis.
+     * @param required N, number of reads that must differ from the current state.
+     * @param window M, number of last reads looked at. At most StateFilter::maxWindow.
+     * @param minDwell Minimum time in ms between two state changes.
+     */
+    void setStateFilter(const uint16_t required, const uint16_t window, const uint32_t minDwell = 0);
+
+    /**
+     * @brief getSuppressedTransitions Returns how many reads were suppressed by the state filter.
+     * @return Number of suppressed reads.
+     */
+    uint64_t getSuppressedTransitions();
+
+    /**
+     * @brief wallClock Returns the time used for listener notifications when no receive time is known.
+     * @return Wall clock time in ns since the epoch.
+     */
+    static uint64_t wallClock();
+
 protected:
     std::string componentName; //!< Name of the component.
     std::shared_ptr<SNMPconnector> snmp; //!< Connection used for reading.
@@ -143,9 +320,108 @@ protected:
     States state; //!< Current state.
     std::mutex lock; //!< Mutex for parameters reading and updating.
     uint16_t numberOfSummaries; //!< Number of summary nodes used.
-    std::atomic<bool> dataValid; //!< Is the internal parameter data valid.
+    std::vector<int32_t> summaryStates; //!< Parsed summary values. Contiguous so the check can be vectorized.
+    std::atomic<bool> dataValid; //!< Is the internal parameter data valid. Only set if all parameters are valid.
+    std::atomic<uint64_t> stateTime; //!< Receive time of the summaries being evaluated. 0 if the read failed.
+    std::atomic<uint64_t> parametersTime; //!< Receive time of the last parameter sample.
+
+    std::vector<std::string> parameterNames; //!< Names of the parameters reported to listeners.
+    std::vector<int64_t> parameterValues; //!< Last published parameters. Filled by updateReadParameters before notifyParameters.
+    std::vector<std::atomic<bool> > parameterValid; //!< Validity of each parameter. Read without locks.
+    std::string statusBuffer; //!< Diagnose builds the status here. Keeps its capacity so repeated diagnoses do not allocate.
 
     void setStateAndStatus(const States newState, const std::string& newStatus);
+    void setStateAndStatus(const States newState, const char* newStatus);
+
+    /**
+     * @brief readState Reads the summaries of the component and keeps their receive time for the state notifications.
+     * @return The summaries or why the read failed.
+     */
+    SNMPexpected<SNMPresult> readState();
+
+    /**
+     * @brief filterState Passes a freshly read state through the state filter.
+     * @param newState State derived from the summaries.
+     * @return True if the state should be applied (and diagnosed), false if it was suppressed.
+     */
+    bool filterState(const States newState);
+
+    /**
+     * @brief setParameterNames Sets the parameter names and sizes the parameter values.
+     * @param names Parameter names.
+     */
+    void setParameterNames(const std::vector<std::string>& names);
+
+    /**
+     * @brief parseParameters Parses a read with one value per parameter into parameterValues. Values that are invalid or can
+     * not be parsed keep their last value and are marked invalid, the others are updated. Sets dataValid if all are valid
+     * and takes the receive time of the read as the time of the sample.
+     * @param result Read result.
+     * @return Number of valid parameters.
+     */
+    template<typename T> size_t parseParameters(const SNMPresult& result)
+    {
+        size_t valid = 0;
+        parametersTime.store(result.receivedTime, std::memory_order_relaxed);
+        for(size_t i = 0; i < parameterValues.size(); i++)
+        {
+            bool parsed = result.isValid(i);
+            if(parsed)
+            {
+                try
+                {
+                    parameterValues[i] = convertToValue<T>(result.values[i]);
+                    valid++;
+                }
+                catch(const SNMPconnectorException&)
+                {
+                    parsed = false;
+                }
+            }
+            parameterValid[i].store(parsed, std::memory_order_relaxed);
+        }
+
+        dataValid = (valid == parameterValues.size());
+        return valid;
+    }
+
+    /**
+     * @brief readParameters Reads a request with one value per parameter and parses it with parseParameters. Does not throw
+     * on SNMP failures.
+     * @param requestName Name of the request.
+     * @return Why the read failed or that no value was valid. All parameters are marked invalid if the read failed.
+     */
+    template<typename T> SNMPerror readParameters(const std::string& requestName)
+    {
+        SNMPexpected<SNMPresult> read = snmp->tryReadResult(requestName);
+        if(!read.hasValue())
+        {
+            dataValid = false;
+            for(size_t i = 0; i < parameterValid.size(); i++)
+            {
+                parameterValid[i].store(false, std::memory_order_relaxed);
+            }
+            return read.getError();
+        }
+
+        if(parseParameters<T>(read.value()) == 0)
+        {
+            return SNMPerror(SNMP_CLASS_ERROR, dataAcquisitionFailed.c_str());
+        }
+        return SNMPerror();
+    }
+
+    /**
+     * @brief notifyParameters Reports parameterValues to all listeners. Cheap if there are none.
+     */
+    void notifyParameters();
+
+private:
+    std::mutex listenersLock; //!< Guards the listeners.
+    std::vector<std::shared_ptr<ComponentListener> > listeners; //!< Registered listeners.
+    std::atomic<bool> hasListeners; //!< Fast check to skip notifications.
+    std::atomic<uint64_t> listenerFailures; //!< Listener calls that threw.
+    StateFilter stateFilter; //!< Debounces state changes. Guarded by lock.
 };
 
 
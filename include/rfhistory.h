@@ -0,0 +1,132 @@
+#ifndef RFHISTORY_H
+#define RFHISTORY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "rfcomponent.h"
+
+/**
+ * @brief The HistoryTier struct Resolution and length of one rollup tier.
+ */
+struct HistoryTier
+{
+    uint64_t resolution; //!< Time covered by one point in ns.
+    uint32_t points; //!< Number of points kept. The tier covers resolution * points.
+};
+
+/**
+ * @brief The HistoryPoint struct Rollup of the samples of one parameter within one resolution interval.
+ */
+struct HistoryPoint
+{
+    uint64_t time; //!< Start of the interval in ns since the epoch.
+    int64_t min; //!< Smallest sample.
+    int64_t max; //!< Largest sample.
+    int64_t last; //!< Latest sample.
+    double mean; //!< Mean of the samples.
+    uint32_t samples; //!< Number of samples.
+};
+
+/**
+ * @brief The RFhistory class Keeps downsampled history of component parameters in rollup tiers, by default 1 s for an
+ * hour, 1 min for a day and 1 h for 30 days. Register it as a listener on the components to be kept.
+ *
+ * Every sample updates min, max, sum and last of the current point of every tier, so nothing is computed when the history
+ * is read. Each tier is a ring of points per parameter that is allocated with the first sample of a component, so the
+ * memory is fixed: 40 bytes per point and parameter. Invalid parameters are not sampled.
+ */
+class RFhistory : public ComponentListener
+{
+public:
+    /**
+     * @brief RFhistory Constructor with the default tiers.
+     */
+    RFhistory();
+
+    /**
+     * @brief RFhistory Constructor.
+     * @param tiers Tiers from the finest to the coarsest resolution.
+     */
+    explicit RFhistory(const std::vector<HistoryTier>& tiers);
+
+    void parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values);
+    void stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status);
+
+    /**
+     * @brief query Copies the points of a parameter from the finest tier that still covers the start of the range.
+     * @param componentName Name of the component.
+     * @param parameterName Name of the parameter.
+     * @param from Start of the range in ns since the epoch.
+     * @param to End of the range in ns since the epoch.
+     * @param points Filled with the points that have samples, oldest first. Keeps its capacity.
+     * @return Index of the tier used, -1 if the component or parameter has no history.
+     */
+    int32_t query(const std::string& componentName, const std::string& parameterName, const uint64_t from, const uint64_t to,
+                  std::vector<HistoryPoint>& points);
+
+    /**
+     * @brief query Copies the points of a parameter from a given tier.
+     * @param componentName Name of the component.
+     * @param parameterName Name of the parameter.
+     * @param tier Index of the tier.
+     * @param from Start of the range in ns since the epoch.
+     * @param to End of the range in ns since the epoch.
+     * @param points Filled with the points that have samples, oldest first. Keeps its capacity.
+     * @return False if the component or parameter has no history.
+     */
+    bool query(const std::string& componentName, const std::string& parameterName, const size_t tier, const uint64_t from,
+               const uint64_t to, std::vector<HistoryPoint>& points);
+
+    /**
+     * @brief getTiers Returns the tiers.
+     * @return Tiers from the finest to the coarsest resolution.
+     */
+    inline const std::vector<HistoryTier>& getTiers() const { return tiers; }
+
+private:
+    /**
+     * @brief The Rollup struct Aggregate of one parameter within one interval.
+     */
+    struct Rollup
+    {
+        int64_t min; //!< Smallest sample.
+        int64_t max; //!< Largest sample.
+        int64_t last; //!< Latest sample.
+        double sum; //!< Sum of the samples.
+        uint32_t samples; //!< Number of samples. 0 if the interval has none.
+    };
+
+    /**
+     * @brief The Ring struct Points of one tier of all parameters of a component.
+     */
+    struct Ring
+    {
+        std::vector<uint64_t> starts; //!< Start of the interval held by each slot.
+        std::vector<Rollup> rollups; //!< Slot-major, the parameters of one slot are contiguous.
+    };
+
+    /**
+     * @brief The Series struct History of one component.
+     */
+    struct Series
+    {
+        std::string componentName; //!< Name of the component.
+        std::vector<std::string> parameterNames; //!< Names of the parameters.
+        std::vector<Ring> rings; //!< One ring per tier.
+        uint64_t latest; //!< Time of the newest sample.
+    };
+
+    const std::vector<HistoryTier> tiers; //!< Tiers from the finest to the coarsest resolution.
+    std::mutex lock; //!< Guards the series.
+    std::unordered_map<const RFcomponent*, Series> series; //!< Series keyed by component.
+
+    Series& getSeries(const RFcomponent& component); /// Returns the series, allocating the rings on the first sample.
+    const Series* findSeries(const std::string& componentName, const std::string& parameterName, size_t& parameter) const; /// Series by name. Caller holds the lock.
+    void copyPoints(const Series& series, const size_t parameter, const size_t tier, const uint64_t from, const uint64_t to,
+                    std::vector<HistoryPoint>& points) const; /// Copies the points in range. Caller holds the lock.
+};
+
+#endif // RFHISTORY_H
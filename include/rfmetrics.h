@@ -0,0 +1,86 @@
+#ifndef RFMETRICS_H
+#define RFMETRICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "rfcomponent.h"
+
+/**
+ * @brief The DerivedMetrics struct Metrics derived from the parameters of one component.
+ */
+struct DerivedMetrics
+{
+    DerivedMetrics() : time(0), samples(0) {}
+
+    std::vector<std::string> names; //!< Metric names. Same order as values.
+    std::vector<double> values; //!< Metric values. NaN while a metric is undefined, e.g. reflection without forward power
+                                //!< or with an invalid input. EWMAs keep their value while their input is invalid.
+    uint64_t time; //!< Wall clock time of the sample the values were derived from, in ns since the epoch.
+    uint64_t samples; //!< Number of samples the values were derived from.
+};
+
+/**
+ * @brief The RFmetrics class Derives metrics from parameter samples once per sample, so clients read them instead of
+ * recomputing them from the raw values. Register it as a listener on the components to be derived.
+ *
+ * Components with forwardPower/reflectedPower parameters (the transmitter) get the reflection coefficient
+ * |Γ| = sqrt(Pr/Pf), VSWR = (1+|Γ|)/(1-|Γ|), return loss in dB and EWMAs of the powers (and of paEfficiency).
+ * The forwardSt/reflectedSt parameters of the RF sensor are states, not powers, and get no metrics.
+ * Components with inTempN/outTempN parameters get ΔT = out - in per device, its EWMA and the largest ΔT.
+ * Other components are ignored. Parameters the component marks invalid are not used: metrics derived from them are NaN
+ * and their EWMAs are not updated.
+ */
+class RFmetrics : public ComponentListener
+{
+public:
+    /**
+     * @brief RFmetrics Constructor.
+     * @param smoothing EWMA weight of a new sample, 0 < smoothing <= 1.
+     */
+    explicit RFmetrics(const double smoothing = 0.1);
+
+    void parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values);
+    void stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status);
+
+    /**
+     * @brief get Returns the metrics of a component.
+     * @param componentName Name of the component.
+     * @return Copy of the metrics. Empty if the component had no samples or nothing to derive.
+     */
+    DerivedMetrics get(const std::string& componentName);
+
+    /**
+     * @brief getAll Returns the metrics of all components.
+     * @return Copies of the metrics keyed by component name.
+     */
+    std::map<std::string, DerivedMetrics> getAll();
+
+private:
+    /**
+     * @brief The Stage struct Where the inputs of one component are and where its metrics go.
+     */
+    struct Stage
+    {
+        Stage() : forward(-1), reflected(-1), efficiency(-1) {}
+
+        std::string componentName; //!< Name of the component.
+        int32_t forward; //!< Index of the forward power. -1 if there is none.
+        int32_t reflected; //!< Index of the reflected power. -1 if there is none.
+        int32_t efficiency; //!< Index of the PA efficiency. -1 if there is none.
+        std::vector<std::pair<size_t, size_t> > temperatures; //!< Indexes of inlet and outlet temperature per device.
+        DerivedMetrics metrics; //!< Published metrics.
+    };
+
+    const double smoothing; //!< EWMA weight of a new sample.
+    std::mutex lock; //!< Guards the stages.
+    std::unordered_map<const RFcomponent*, Stage> stages; //!< Stages keyed by component.
+
+    Stage& getStage(const RFcomponent& component); /// Returns the stage, creating it from the parameter names on the first sample.
+    double ewma(const double previous, const double sample) const; /// Next EWMA value. The first valid sample seeds it.
+};
+
+#endif // RFMETRICS_H
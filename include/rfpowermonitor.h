@@ -0,0 +1,153 @@
+#ifndef RFPOWERMONITOR_H
+#define RFPOWERMONITOR_H
+
+#include "snmptransport.h"
+#include "snmpstatistics.h"
+#include "rftopology.h"
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <cstdatomic>
+
+/**
+ * @brief The PowerTripReasons enum Why the monitor tripped.
+ */
+enum PowerTripReasons
+{
+    REFLECTED_POWER_HIGH = 1, //!< Reflected power above the absolute limit.
+    REFLECTION_RATIO_HIGH, //!< Reflected to forward power ratio above the limit.
+    RF_LINK_DOWN, //!< RF link summary is not OK.
+    NO_RESPONSE //!< The agent did not answer several cycles in a row.
+};
+
+/**
+ * @brief The PowerTrip struct What the monitor saw when it tripped.
+ */
+struct PowerTrip
+{
+    PowerTripReasons reason; //!< Why it tripped.
+    uint32_t forwardPower; //!< Last forward power. 0 for NO_RESPONSE.
+    uint32_t reflectedPower; //!< Last reflected power. 0 for NO_RESPONSE.
+    int32_t link; //!< Last RF link summary. UNKNOWN for NO_RESPONSE.
+    uint64_t received; //!< Monotonic time in ns when the response (or the last timeout) was received.
+};
+
+/**
+ * @brief The PowerTripHandler class Called from the monitor thread when a trip is detected. Must be short and must not
+ * block, e.g. drive an output or set a flag; it delays the next check.
+ */
+class PowerTripHandler
+{
+public:
+    virtual ~PowerTripHandler() {}
+
+    /**
+     * @brief tripped Called once per trip. The monitor re-arms after a cycle with all values within the limits.
+     * @param trip Trip details.
+     */
+    virtual void tripped(const PowerTrip& trip) = 0;
+};
+
+/**
+ * @brief The PowerMonitorSettings struct Limits and scheduling of the monitor.
+ */
+struct PowerMonitorSettings
+{
+    PowerMonitorSettings() : maxReflectedPower(0), maxReflectionRatio(0.0), period(1000), missedResponses(3), cpu(-1), priority(80) {}
+
+    uint32_t maxReflectedPower; //!< Absolute reflected power limit. 0 disables the check.
+    double maxReflectionRatio; //!< Reflected / forward power limit, e.g. 0.1 for VSWR 1.92. 0 disables the check.
+    uint32_t period; //!< Cycle period in us.
+    uint16_t missedResponses; //!< Cycles without an answer that trip with NO_RESPONSE. 0 disables the check.
+    int32_t cpu; //!< CPU the thread is pinned to. -1 leaves it unpinned.
+    int32_t priority; //!< SCHED_FIFO priority. 0 keeps the normal scheduler.
+};
+
+/**
+ * @brief The RFpowerMonitor class High rate interlock check of reflected power. Polls only TRANS_FP, TRANS_RP and RF_LINK
+ * with one request prepared up front, checks the limits right after the response is decoded and calls the handler on
+ * the same thread. Runs on its own thread, optionally pinned and with real-time priority, independent of the device
+ * server loop. Use a transport of its own (e.g. SNMPudpTransport) so it does not queue behind the regular polling.
+ */
+class RFpowerMonitor
+{
+public:
+    /**
+     * @brief RFpowerMonitor Prepares the request. Call start to begin monitoring.
+     * @param transport Transport to the transmitter.
+     * @param topology Transmitter topology, for the OIDs.
+     * @param settings Limits and scheduling.
+     * @param handler Called on trips.
+     */
+    RFpowerMonitor(const std::shared_ptr<SNMPtransport>& transport, const TransmitterTopology& topology,
+                   const PowerMonitorSettings& settings, const std::shared_ptr<PowerTripHandler>& handler);
+    ~RFpowerMonitor();
+
+    /**
+     * @brief start Starts the monitor thread.
+     */
+    void start();
+
+    /**
+     * @brief stop Stops the monitor thread. Returns after the current cycle.
+     */
+    void stop();
+
+    /**
+     * @brief isRealtime Checks if the thread got the requested real-time priority and CPU.
+     * @return False if it runs with normal scheduling, e.g. without CAP_SYS_NICE.
+     */
+    inline bool isRealtime() const { return realtime; }
+
+    /**
+     * @brief isTripped Checks if the monitor is tripped and not re-armed yet.
+     * @return True while tripped.
+     */
+    inline bool isTripped() const { return tripped; }
+
+    /**
+     * @brief getCycles Returns the number of executed cycles.
+     * @return Number of cycles.
+     */
+    inline uint64_t getCycles() const { return cycles; }
+
+    /**
+     * @brief getTrips Returns the number of trips.
+     * @return Number of handler calls.
+     */
+    inline uint64_t getTrips() const { return trips; }
+
+    /**
+     * @brief getRoundTrip Returns the request round trip times.
+     * @return Histogram in us.
+     */
+    inline LatencyHistogram::Snapshot getRoundTrip() const { return roundTrip.snapshot(); }
+
+    /**
+     * @brief getReaction Returns the times from receiving the response to calling the handler.
+     * @return Histogram in ns.
+     */
+    inline LatencyHistogram::Snapshot getReaction() const { return reaction.snapshot(); }
+
+private:
+    std::shared_ptr<SNMPtransport> transport; //!< Transport to the transmitter.
+    std::shared_ptr<SNMPpreparedRequest> request; //!< GET of forward power, reflected power and RF link.
+    const PowerMonitorSettings settings; //!< Limits and scheduling.
+    std::shared_ptr<PowerTripHandler> handler; //!< Called on trips.
+    std::thread thread; //!< Monitor thread.
+    std::atomic<bool> running; //!< Keeps the thread running.
+    std::atomic<bool> realtime; //!< Real-time scheduling was applied.
+    std::atomic<bool> tripped; //!< Tripped and not re-armed.
+    std::atomic<uint64_t> cycles; //!< Executed cycles.
+    std::atomic<uint64_t> trips; //!< Handler calls.
+    LatencyHistogram roundTrip; //!< Request round trip in us.
+    LatencyHistogram reaction; //!< Response to handler call in ns.
+
+    static void run(RFpowerMonitor* monitor); /// Monitor loop.
+    bool setupThread(); /// Applies CPU and priority to the calling thread.
+    void check(const int32_t status, const SNMPresponse& response, const uint64_t received, uint16_t& missed); /// Checks one cycle and trips.
+    void trip(PowerTrip& event); /// Calls the handler once per trip.
+};
+
+#endif // RFPOWERMONITOR_H
@@ -0,0 +1,229 @@
+#ifndef RFRECORDER_H
+#define RFRECORDER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+#include <stdexcept>
+#include "rfcomponent.h"
+
+class RfRecorderException : public std::runtime_error
+{
+public:
+    RfRecorderException(const std::string& description) : std::runtime_error(description) {}
+};
+
+/**
+ * @brief The RecordTypes enum What a record holds.
+ */
+enum RecordTypes
+{
+    PARAMETER_SAMPLE = 1, //!< Value is the parameter value, previous is unused.
+    STATE_TRANSITION //!< Value is the new state, previous the old state.
+};
+
+/**
+ * @brief The Record struct Fixed-size record as stored on disk.
+ */
+struct Record
+{
+    uint64_t time; //!< Wall clock time in ns since the epoch. Never decreases within a recording.
+    uint32_t channel; //!< Index into the channel table of the segment.
+    uint32_t type; //!< RecordTypes.
+    int64_t value; //!< Parameter value or new state.
+    int64_t previous; //!< Old state for transitions.
+};
+
+/**
+ * @brief The RecordSegmentHeader struct Header at the start of every segment file.
+ * A segment is laid out as: header, channel table, index block, records. The index holds the time of every
+ * indexInterval-th record so a time can be found with a binary search over the index and then over one block.
+ */
+struct RecordSegmentHeader
+{
+    char magic[8]; //!< "RFREC01".
+    uint32_t recordSize; //!< sizeof(Record).
+    uint32_t channelNameLength; //!< Size of one channel table entry.
+    uint64_t capacity; //!< Number of records the segment can hold.
+    uint64_t indexInterval; //!< Records per index entry.
+    uint64_t maxChannels; //!< Entries in the channel table.
+    uint64_t channels; //!< Used entries in the channel table.
+    uint64_t count; //!< Number of committed records. Written last.
+    uint64_t firstTime; //!< Time of the first record.
+    uint64_t lastTime; //!< Time of the last committed record.
+};
+
+/**
+ * @brief The RFrecorder class Append-only binary recorder of parameter samples and state transitions.
+ * Records are written to memory-mapped segment files prefix.NNNNNN.rfrec. A new segment is started when the current
+ * one is full; existing segments are never modified. Register it as a listener on every component to be recorded.
+ * Parameters whose last read failed are not recorded, so a gap in a channel means the value was unknown.
+ */
+class RFrecorder : public ComponentListener
+{
+public:
+    static const uint64_t defaultRecordsPerSegment = 1 << 20; //!< 32 MiB of records per segment.
+    static const uint64_t indexInterval = 256; //!< Records per index entry.
+    static const uint64_t maxChannels = 1024; //!< Channels per recording.
+    static const uint32_t channelNameLength = 48; //!< Max channel name length including terminator.
+
+    /**
+     * @brief RFrecorder Starts a recording. Numbering continues after the segments already on disk.
+     * @param prefix Path and name prefix of the segment files.
+     * @param recordsPerSegment Capacity of one segment.
+     */
+    explicit RFrecorder(const std::string& prefix, const uint64_t recordsPerSegment = defaultRecordsPerSegment);
+    ~RFrecorder();
+
+    void parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values);
+    void stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status);
+
+    /**
+     * @brief channel Returns the channel with the given name and creates it if needed.
+     * @param name Channel name, e.g. "AMPs.ampOn3". Truncated to channelNameLength - 1.
+     * @return Channel index.
+     */
+    uint32_t channel(const std::string& name);
+
+    /**
+     * @brief append Appends one record.
+     * @param channel Channel index.
+     * @param time Time of the record in ns. Clamped so that time never decreases.
+     * @param type Record type.
+     * @param value Value or new state.
+     * @param previous Old state for transitions.
+     */
+    void append(const uint32_t channel, const uint64_t time, const RecordTypes type, const int64_t value, const int64_t previous = 0);
+
+    /**
+     * @brief flush Schedules the written records for writing to disk.
+     */
+    void flush();
+
+    /**
+     * @brief getDropped Returns the number of records dropped because the next segment could not be created.
+     * @return Dropped records.
+     */
+    uint64_t getDropped();
+
+    /**
+     * @brief segmentName Returns the file name of a segment.
+     * @param prefix Recording prefix.
+     * @param sequence Segment number.
+     * @return File name.
+     */
+    static std::string segmentName(const std::string& prefix, const uint32_t sequence);
+
+private:
+    RFrecorder(const RFrecorder&);
+    RFrecorder& operator=(const RFrecorder&);
+
+    /**
+     * @brief The ComponentChannels struct Channels of one component. State first, then the parameters.
+     */
+    struct ComponentChannels
+    {
+        uint32_t state; //!< Channel of the state transitions.
+        uint32_t parameters; //!< Channel of the first parameter.
+    };
+
+    const std::string prefix; //!< Path and name prefix of the segment files.
+    const uint64_t capacity; //!< Records per segment.
+    std::mutex lock; //!< Guards everything below.
+    uint32_t sequence; //!< Number of the current segment.
+    char* segment; //!< Mapping of the current segment.
+    size_t segmentSize; //!< Size of the mapping.
+    RecordSegmentHeader* header; //!< Header of the current segment.
+    uint64_t* index; //!< Index block of the current segment.
+    Record* records; //!< Records of the current segment.
+    uint64_t lastTime; //!< Time of the last record.
+    std::vector<std::string> channelNames; //!< All channels of the recording.
+    std::map<const RFcomponent*, ComponentChannels> components; //!< Channels of the components seen.
+    uint64_t dropped; //!< Records dropped while no segment could be created.
+
+    void openSegment(const uint32_t number); /// Creates and maps a segment, then unmaps the current one. Lock must be held.
+    void closeSegment(); /// Syncs and unmaps the current segment. Lock must be held.
+    uint32_t addChannel(const std::string& name); /// Adds a channel. Lock must be held.
+    void write(const uint32_t channel, const uint64_t time, const RecordTypes type, const int64_t value, const int64_t previous); /// Appends a record. Lock must be held.
+    const ComponentChannels& componentChannels(const RFcomponent& component); /// Channels of the component. Lock must be held.
+};
+
+/**
+ * @brief The RFrecordReader class Reads a recording made by RFrecorder. Segments written later are not seen.
+ */
+class RFrecordReader
+{
+public:
+    /**
+     * @brief The Sample struct Record with the channel name resolved.
+     */
+    struct Sample
+    {
+        uint64_t time; //!< Time in ns since the epoch.
+        std::string channel; //!< Channel name.
+        RecordTypes type; //!< Record type.
+        int64_t value; //!< Value or new state.
+        int64_t previous; //!< Old state for transitions.
+    };
+
+    /**
+     * @brief RFrecordReader Maps all segments of the recording.
+     * @param prefix Path and name prefix of the segment files.
+     */
+    explicit RFrecordReader(const std::string& prefix);
+    ~RFrecordReader();
+
+    /**
+     * @brief size Returns the number of records.
+     * @return Number of committed records of all segments.
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief seek Finds the first record at or after the time in O(log n).
+     * @param time Time in ns.
+     * @return Position of the record, size() if there is none.
+     */
+    uint64_t seek(const uint64_t time) const;
+
+    /**
+     * @brief at Returns the record at the position.
+     * @param position Position of the record.
+     * @return The record.
+     */
+    Sample at(const uint64_t position) const;
+
+    /**
+     * @brief read Returns all records in the time range [from, to).
+     * @param from Start time in ns.
+     * @param to End time in ns.
+     * @return Records in time order.
+     */
+    std::vector<Sample> read(const uint64_t from, const uint64_t to) const;
+
+private:
+    RFrecordReader(const RFrecordReader&);
+    RFrecordReader& operator=(const RFrecordReader&);
+
+    /**
+     * @brief The Segment struct One mapped segment.
+     */
+    struct Segment
+    {
+        char* map; //!< Mapping of the file.
+        size_t length; //!< Size of the mapping.
+        const RecordSegmentHeader* header; //!< Segment header.
+        const char* channels; //!< Channel table.
+        const uint64_t* index; //!< Index block.
+        const Record* records; //!< Records.
+        uint64_t count; //!< Committed records when the segment was opened.
+        uint64_t first; //!< Position of the first record in the recording.
+    };
+
+    std::vector<Segment> segments; //!< Segments with at least one record, in order.
+    uint64_t total; //!< Number of records.
+};
+
+#endif // RFRECORDER_H
@@ -0,0 +1,135 @@
+#ifndef RFRECOVERY_H
+#define RFRECOVERY_H
+
+#include "transmitter.h"
+#include "mtx.h"
+#include "outstage.h"
+#include "snmpstatistics.h"
+#include <string>
+#include <cstdint>
+#include <cstdatomic>
+
+/**
+ * @brief The RecoverySteps enum Steps of the trip recovery, in the order they are executed.
+ */
+enum RecoverySteps
+{
+    RECOVERY_IDLE = 0, //!< Not started.
+    RECOVERY_RESET_MTX, //!< MTx reset, until its state is OK.
+    RECOVERY_RESET_TRANSMITTER, //!< Transmitter reset, until it reports no fault.
+    RECOVERY_SWITCH_ON, //!< Power switch on, until the transmitter reports it is on.
+    RECOVERY_NOMINAL_POWER, //!< Nominal power set to the target, until it reads back.
+    RECOVERY_RAMP, //!< Output stage power ramped up in steps, each until the forward power follows.
+    RECOVERY_DONE, //!< Running at the target power.
+    RECOVERY_ABORTED, //!< Stopped by an abort condition, a timeout or abort().
+    RECOVERY_STEPS //!< Number of steps.
+};
+
+/**
+ * @brief The RecoverySettings struct Target, ramp and abort conditions of the recovery.
+ */
+struct RecoverySettings
+{
+    RecoverySettings() : targetPower(0), powerStep(0), tolerance(0.05), maxReflectedPower(0), maxReflectionRatio(0.0),
+                         period(2000), stepTimeout(10000), resetMtx(true) {}
+
+    uint32_t targetPower; //!< Power to ramp up to. Written as nominal power and as the last output stage power.
+    uint32_t powerStep; //!< Output stage power added per ramp step. 0 goes to the target in one step.
+    double tolerance; //!< Relative deviation of the forward power from the step power that completes a step.
+    uint32_t maxReflectedPower; //!< Absolute reflected power that aborts the ramp. 0 disables the check.
+    double maxReflectionRatio; //!< Reflected / forward power that aborts the ramp. 0 disables the check.
+    uint32_t period; //!< Verification read period in us.
+    uint32_t stepTimeout; //!< Time a step may take, in ms.
+    bool resetMtx; //!< Start with an MTx reset.
+};
+
+/**
+ * @brief The RecoveryResult struct Outcome of one recovery run.
+ */
+struct RecoveryResult
+{
+    RecoveryResult() : step(RECOVERY_IDLE), power(0), duration(0), reads(0)
+    {
+        for(size_t i = 0; i < RECOVERY_STEPS; i++)
+        {
+            stepDuration[i] = 0;
+        }
+    }
+
+    RecoverySteps step; //!< RECOVERY_DONE, or the step that was aborted.
+    std::string reason; //!< Why it was aborted. Empty if done.
+    uint32_t power; //!< Last output stage power that was verified.
+    uint64_t duration; //!< Time from start to done or abort in us.
+    uint64_t stepDuration[RECOVERY_STEPS]; //!< Time spent in each step in us. The ramp counts all its steps.
+    uint32_t reads; //!< Verification cycles.
+};
+
+/**
+ * @brief The RFrecoverySequencer class Brings the transmitter back to power after a trip: MTx reset, transmitter reset,
+ * power switch, nominal power and an output stage power ramp. Each write is sent on its own thread while the relevant
+ * summaries and parameters are read every period, so a step completes with the first read after the write was
+ * acknowledged that shows its effect, and abort conditions are seen while a write is still in flight.
+ *
+ * From the power switch on it aborts on reflected power above the limits and on a FAULT of the transmitter or the output stage. A step
+ * that does not complete within the step timeout aborts too.
+ *
+ * After an abort from the power switch on, the output stage power is set to 0 and the power is switched off. The nominal
+ * power keeps the last written value. An abort during the resets writes nothing, the transmitter stays off or faulty as
+ * the trip left it and the MTx may be reset already. The sequencer reads through the components, so pause the regular
+ * polling of these three components while it runs, or give it components on connectors of their own.
+ */
+class RFrecoverySequencer
+{
+public:
+    /**
+     * @brief RFrecoverySequencer Constructor. The components must outlive the sequencer.
+     * @param transmitter Transmitter.
+     * @param mtx MTx.
+     * @param outStage Output stage.
+     * @param settings Target, ramp and abort conditions.
+     */
+    RFrecoverySequencer(Transmitter& transmitter, MTx& mtx, OutStage& outStage, const RecoverySettings& settings);
+
+    /**
+     * @brief run Runs the recovery. Blocks until done or aborted.
+     * @return Outcome.
+     */
+    RecoveryResult run();
+
+    /**
+     * @brief abort Stops a running recovery after the current verification cycle. Can be called from any thread.
+     */
+    inline void abort() { aborted = true; }
+
+    /**
+     * @brief getStep Returns the step that is executed right now.
+     * @return Current step.
+     */
+    inline RecoverySteps getStep() const { return static_cast<RecoverySteps>(step.load()); }
+
+    /**
+     * @brief getStepTimes Returns how long the steps took, ramp steps counted one by one.
+     * @return Histogram in us.
+     */
+    inline LatencyHistogram::Snapshot getStepTimes() const { return stepTimes.snapshot(); }
+
+private:
+    Transmitter& transmitter; //!< Transmitter.
+    MTx& mtx; //!< MTx.
+    OutStage& outStage; //!< Output stage.
+    const RecoverySettings settings; //!< Target, ramp and abort conditions.
+    std::atomic<int32_t> step; //!< Current step.
+    std::atomic<bool> aborted; //!< Set by abort.
+    std::atomic<bool> writeDone; //!< The write of the current step returned.
+    std::string writeError; //!< Why the write failed. Written by the write thread before writeDone.
+    uint32_t writeValue; //!< Value written by the current step.
+    LatencyHistogram stepTimes; //!< Duration of every step.
+
+    bool execute(const RecoverySteps current, const uint32_t value, RecoveryResult& result); /// Writes and verifies one step.
+    bool verify(const RecoverySteps current, const uint32_t value, std::string& reason); /// One verification cycle. Sets reason to abort.
+    bool reflectionTooHigh(std::string& reason); /// Checks the reflected power limits on the last transmitter read.
+    void safeState(RecoveryResult& result); /// Output stage power to 0 and power off after an abort. Failures go to the reason.
+    static void write(RFrecoverySequencer* sequencer); /// Write thread of a step.
+};
+
+#endif // RFRECOVERY_H
@@ -6,17 +6,17 @@
 
 class RFsensor : public RFcomponent
 {
-    static const uint16_t noDiagNodes = 1; //!< Number of nodes to read for diagnostics. Only sensor calibrated node available.
 public:
     /**
      * @brief RFsensor RF sensor component.
      * @param snmp Connection used for reading.
+     * @param topology Transmitter topology. Solaris by default.
      */
-    RFsensor(const std::shared_ptr<SNMPconnector> snmp);
+    RFsensor(const std::shared_ptr<SNMPconnector> snmp, const TransmitterTopology& topology = TransmitterTopology());
     ~RFsensor();
 
     void diagnose(const std::vector<std::string>& summaryValues);
-    void updateReadParameters();
+    SNMPerror tryUpdateReadParameters();
 
     /**
      * @brief getForwardSt Gets the forward power state.
@@ -33,6 +33,7 @@ public:
 private:
     std::atomic<uint32_t> forwardSt; //!< Forward power state.
     std::atomic<uint32_t> reflectedSt; //!< Reflected power state.
+    std::vector<std::string> diagNodes; //!< Names of the nodes read for diagnostics.
     static const std::string diagRequestName; //!< Name of the SNMP requests for diagnostics.
     static const std::string upadateParamsName; //!< Name of the command to update parameters.
 };
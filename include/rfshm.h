@@ -0,0 +1,165 @@
+#ifndef RFSHM_H
+#define RFSHM_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <stdexcept>
+#include "rfcomponent.h"
+
+class RfShmException : public std::runtime_error
+{
+public:
+    RfShmException(const std::string& description) : std::runtime_error(description) {}
+};
+
+/**
+ * @brief The ShmHeader struct Header at the start of the shared memory segment.
+ * The segment is laid out as: header, maxComponents slots of slotSize bytes.
+ */
+struct ShmHeader
+{
+    char magic[8]; //!< "RFSHM02". Written last when the segment is set up.
+    uint32_t slotSize; //!< sizeof(ShmSlot).
+    uint32_t maxComponents; //!< Number of slots.
+    int32_t writerPid; //!< Process that polls the transmitter.
+    uint32_t components; //!< Number of used slots. Only grows.
+};
+
+/**
+ * @brief The ShmSlot struct Latest snapshot of one component, guarded by a sequence lock.
+ * The writer makes sequence odd, updates the slot and makes it even again. Readers copy the slot and retry if sequence
+ * was odd or changed meanwhile, so they never block the writer and never enter the kernel.
+ */
+struct ShmSlot
+{
+    static const uint32_t nameLength = 48; //!< Max component and parameter name length including terminator.
+    static const uint32_t statusLength = 4096; //!< Max status length including terminator. Longer ones are truncated.
+    static const uint32_t maxParameters = 64; //!< Max parameters per component.
+
+    volatile uint64_t sequence; //!< Odd while the slot is written.
+    uint64_t stateTime; //!< Wall clock time of the last state change in ns since the epoch.
+    uint64_t parametersTime; //!< Wall clock time of the last parameter sample in ns since the epoch.
+    int32_t state; //!< Current state.
+    uint32_t parameters; //!< Number of parameters.
+    char name[nameLength]; //!< Component name.
+    char status[statusLength]; //!< Current status.
+    char parameterNames[maxParameters][nameLength]; //!< Parameter names.
+    int64_t values[maxParameters]; //!< Latest parameter values.
+    uint64_t valid; //!< Bit i is set if the last read of parameter i succeeded. Invalid parameters keep their last value.
+};
+
+/**
+ * @brief The ComponentSnapshot struct Consistent copy of one slot.
+ */
+struct ComponentSnapshot
+{
+    std::string name; //!< Component name.
+    States state; //!< Current state.
+    std::string status; //!< Current status as reported to listeners, without the component name.
+    uint64_t stateTime; //!< Time of the last state change in ns since the epoch.
+    uint64_t parametersTime; //!< Time of the last parameter sample in ns since the epoch.
+    std::vector<std::string> parameterNames; //!< Parameter names.
+    std::vector<int64_t> values; //!< Latest parameter values.
+    std::vector<bool> valid; //!< True if the last read of the parameter succeeded.
+};
+
+/**
+ * @brief The RFshmPublisher class Publishes the latest state, status and parameters of components into a POSIX shared
+ * memory segment, so one process polls the transmitter and any number of local processes read it with RFshmReader.
+ * Register it as a listener on every component to be published. Link with -lrt on older glibc.
+ */
+class RFshmPublisher : public ComponentListener
+{
+public:
+    static const uint32_t maxComponents = 32; //!< Slots in the segment.
+
+    /**
+     * @brief RFshmPublisher Creates the segment, or takes over one left behind by a previous writer.
+     * @param name POSIX shared memory name, e.g. "/rftransmitter".
+     */
+    explicit RFshmPublisher(const std::string& name);
+
+    /**
+     * @brief ~RFshmPublisher Unmaps and removes the segment. Readers that have it mapped keep the last snapshots.
+     */
+    ~RFshmPublisher();
+
+    void parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values);
+    void stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status);
+
+    /**
+     * @brief publish Publishes the current state and status of the component, e.g. right after registering it.
+     * @param component Component to publish.
+     */
+    void publish(RFcomponent& component);
+
+private:
+    std::string name; //!< Shared memory name.
+    char* segment; //!< Mapped segment.
+    size_t segmentSize; //!< Size of the mapping.
+    ShmHeader* header; //!< Header of the segment.
+    ShmSlot* slots; //!< Slots of the segment.
+    std::mutex lock; //!< Serializes writers, components may be polled by different threads.
+    std::unordered_map<const RFcomponent*, ShmSlot*> assigned; //!< Slot of each component.
+
+    ShmSlot* getSlot(const RFcomponent& component); /// Returns the slot of the component, assigning a new one on first use.
+    void writeState(ShmSlot& slot, const uint64_t time, const States state, const std::string& status); /// Writes state and status. Caller holds the slot.
+};
+
+/**
+ * @brief The RFshmReader class Reads snapshots published by an RFshmPublisher. Reading does no system calls.
+ */
+class RFshmReader
+{
+public:
+    /**
+     * @brief RFshmReader Maps the segment read-only.
+     * @param name POSIX shared memory name used by the publisher.
+     */
+    explicit RFshmReader(const std::string& name);
+    ~RFshmReader();
+
+    /**
+     * @brief getComponents Returns the number of published components.
+     * @return Number of slots in use.
+     */
+    size_t getComponents() const;
+
+    /**
+     * @brief getWriterPid Returns the process that publishes.
+     * @return PID of the writer.
+     */
+    int32_t getWriterPid() const;
+
+    /**
+     * @brief read Copies the snapshot of a component.
+     * @param index Slot index, 0 to getComponents() - 1.
+     * @param snapshot Filled with the snapshot.
+     * @return False if the index is not in use or the writer kept the slot busy, e.g. because it died while writing.
+     */
+    bool read(const size_t index, ComponentSnapshot& snapshot);
+
+    /**
+     * @brief read Copies the snapshot of a component.
+     * @param componentName Name of the component.
+     * @param snapshot Filled with the snapshot.
+     * @return False if the component is not published or the slot was busy.
+     */
+    bool read(const std::string& componentName, ComponentSnapshot& snapshot);
+
+private:
+    static const uint32_t maxAttempts = 1000; //!< Reads of a busy slot before giving up.
+
+    const char* segment; //!< Mapped segment.
+    size_t segmentSize; //!< Size of the mapping.
+    const ShmHeader* header; //!< Header of the segment.
+    const ShmSlot* slots; //!< Slots of the segment.
+    ShmSlot copy; //!< Private copy of the slot being read.
+
+    bool copySlot(const size_t index); /// Copies a slot consistently into copy.
+};
+
+#endif // RFSHM_H
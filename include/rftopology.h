@@ -0,0 +1,129 @@
+#ifndef RFTOPOLOGY_H
+#define RFTOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "snmpoids.h"
+
+class RfTopologyException : public std::runtime_error
+{
+public:
+    RfTopologyException(const std::string& description) : std::runtime_error(description) {}
+};
+
+/**
+ * @brief The ComponentTypes enum Components that can be described in the topology.
+ */
+enum ComponentTypes
+{
+    AMPLIFIERS = 0,
+    LIQUID_COOLING,
+    TRANSMITTER,
+    RF_SENSOR,
+    OUT_STAGE,
+    MTX,
+    COMPONENT_TYPES_LENGTH
+};
+
+/**
+ * @brief The ComponentTopology struct Description of one component.
+ */
+struct ComponentTopology
+{
+    std::string name; //!< Name of the component. Also used as the name of the summary request.
+    OIDS summary; //!< OID (template) of the summary node(s).
+    std::vector<uint16_t> indices; //!< Device indices that replace X in OID templates. Empty for single device components.
+    std::vector<std::string> diagNodes; //!< Names of the nodes returned by the diagnostics bulk read, in order.
+};
+
+/**
+ * @brief The TransmitterTopology class Data-driven description of a transmitter: OID table, components, device indices and diagnostics nodes.
+ * Default constructed topology describes the Solaris transmitter. Other plants can be loaded from a JSON file, e.g.:
+ *
+ * {
+ *     "oids": { "TRANS_SUMMARY": "1.3.6.1.4.1.2566.127.1.2.216.3.1.1.1.1.6.1.1" },
+ *     "components": {
+ *         "amplifiers": { "name": "AMPs", "indices": [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12], "diagNodes": ["txAmpRfPowerFail", "txAmpReflection"] },
+ *         "liquidCooling": { "indices": [1, 2] }
+ *     }
+ * }
+ *
+ * Everything that is not given keeps the built-in value. See config/solaris.json for the complete description.
+ */
+class TransmitterTopology
+{
+public:
+    static const std::string componentKeys[COMPONENT_TYPES_LENGTH]; //!< Keys of the components in topology files.
+
+    /**
+     * @brief TransmitterTopology Constructs the built-in Solaris topology.
+     */
+    TransmitterTopology();
+
+    /**
+     * @brief load Loads the topology from a JSON file.
+     * @param fileName Path to the file.
+     * @return Loaded topology.
+     */
+    static TransmitterTopology load(const std::string& fileName);
+
+    /**
+     * @brief parse Parses the topology from JSON text.
+     * @param json Topology description.
+     * @return Parsed topology.
+     */
+    static TransmitterTopology parse(const std::string& json);
+
+    /**
+     * @brief getOid Returns the OID (template) from the OID table.
+     * @param oid Index of the OID.
+     * @return OID in string format.
+     */
+    inline const std::string& getOid(const OIDS oid) const { return oidTable.at(oid); }
+
+    /**
+     * @brief setOid Replaces the OID in the OID table.
+     * @param oid Index of the OID.
+     * @param value New OID. Templates for indexed components need an X.
+     */
+    void setOid(const OIDS oid, const std::string& value);
+
+    /**
+     * @brief getComponent Returns the description of the component.
+     * @param type Component type.
+     * @return Component description.
+     */
+    inline const ComponentTopology& getComponent(const ComponentTypes type) const { return components.at(type); }
+
+    /**
+     * @brief setIndices Sets the device indices of the component.
+     * @param type Component type.
+     * @param indices Device indices.
+     */
+    void setIndices(const ComponentTypes type, const std::vector<uint16_t>& indices);
+
+    /**
+     * @brief expand Expands the OID template with the device indices of the component.
+     * @param oid Index of the OID.
+     * @param type Component type whose indices are used.
+     * @return One OID per device, or the OID itself if the component has no indices.
+     */
+    std::vector<std::string> expand(const OIDS oid, const ComponentTypes type) const;
+
+    /**
+     * @brief getSummaryOids Returns the expanded summary OIDs of the component.
+     * @param type Component type.
+     * @return Summary OIDs.
+     */
+    inline std::vector<std::string> getSummaryOids(const ComponentTypes type) const { return expand(getComponent(type).summary, type); }
+
+private:
+    std::vector<std::string> oidTable; //!< OIDs indexed by OIDS.
+    std::vector<ComponentTopology> components; //!< Components indexed by ComponentTypes.
+
+    void validate() const; /// Checks that the OID templates match the components.
+};
+
+#endif // RFTOPOLOGY_H
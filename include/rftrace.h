@@ -0,0 +1,120 @@
+#ifndef RFTRACE_H
+#define RFTRACE_H
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <cstdatomic>
+
+/**
+ * @brief The RFtrace class Optional tracing of the polling path. Spans are stored in preallocated per-thread ring buffers
+ * and can be dumped in Chrome trace-event JSON format (chrome://tracing, ui.perfetto.dev).
+ * When tracing is disabled a span costs one relaxed atomic load. Compile with -DRF_NO_TRACE to remove spans completely.
+ */
+class RFtrace
+{
+public:
+    static const size_t defaultEventsPerThread = 65536; //!< Default size of the per-thread buffer.
+    static const size_t detailLength = 32; //!< Max length of the span detail (component or request name) including terminator.
+
+    /**
+     * @brief The Event struct One finished span.
+     */
+    struct Event
+    {
+        const char* name; //!< Span name. Must be a string literal.
+        char detail[detailLength]; //!< Copy of the component or request name.
+        uint64_t start; //!< Start of the span in ns of the monotonic clock.
+        uint64_t duration; //!< Duration of the span in ns.
+    };
+
+    /**
+     * @brief enable Starts recording. Already recorded events are dropped.
+     * @param eventsPerThread Number of events kept per thread. Oldest events are overwritten.
+     */
+    static void enable(const size_t eventsPerThread = defaultEventsPerThread);
+
+    /**
+     * @brief disable Stops recording. Recorded events are kept for dumping.
+     */
+    static void disable();
+
+    /**
+     * @brief isEnabled Is tracing turned on?
+     * @return Yes or No.
+     */
+    static inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief writeChromeTrace Writes all recorded events in Chrome trace-event JSON format.
+     * @param out Stream to write to.
+     */
+    static void writeChromeTrace(std::ostream& out);
+
+    /**
+     * @brief writeChromeTrace Writes all recorded events in Chrome trace-event JSON format.
+     * @param fileName File to write to.
+     */
+    static void writeChromeTrace(const std::string& fileName);
+
+    /**
+     * @brief record Stores a finished span in the buffer of the calling thread.
+     * @param name Span name. Must be a string literal.
+     * @param detail Component or request name. Copied and truncated. Can be NULL.
+     * @param start Start time in ns.
+     * @param end End time in ns.
+     */
+    static void record(const char* name, const std::string* detail, const uint64_t start, const uint64_t end);
+
+    /**
+     * @brief now Returns the monotonic clock time used for spans.
+     * @return Time in ns.
+     */
+    static uint64_t now();
+
+private:
+    static std::atomic<bool> enabled; //!< Is tracing turned on.
+};
+
+/**
+ * @brief The TraceSpan class Scoped span. Records the time between construction and destruction if tracing is enabled.
+ */
+class TraceSpan
+{
+public:
+    /**
+     * @brief TraceSpan Starts the span.
+     * @param name Span name. Must be a string literal.
+     * @param detail Component or request name. Must outlive the span.
+     */
+    explicit TraceSpan(const char* name, const std::string* detail = 0)
+        : name(name), detail(detail), start(RFtrace::isEnabled() ? RFtrace::now() : 0) {}
+
+    ~TraceSpan()
+    {
+        if(start != 0)
+        {
+            RFtrace::record(name, detail, start, RFtrace::now());
+        }
+    }
+
+private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+    const char* name; //!< Span name.
+    const std::string* detail; //!< Component or request name.
+    uint64_t start; //!< Start time. 0 if tracing was disabled.
+};
+
+#define RF_TRACE_JOIN2(a, b) a##b
+#define RF_TRACE_JOIN(a, b) RF_TRACE_JOIN2(a, b)
+
+#ifdef RF_NO_TRACE
+#define RF_TRACE_SPAN(...) do {} while(0)
+#else
+/// Traces the rest of the current scope. Arguments are the same as for TraceSpan.
+#define RF_TRACE_SPAN(...) TraceSpan RF_TRACE_JOIN(traceSpan, __LINE__)(__VA_ARGS__)
+#endif
+
+#endif // RFTRACE_H
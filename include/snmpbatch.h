@@ -0,0 +1,128 @@
+#ifndef SNMPBATCH_H
+#define SNMPBATCH_H
+
+#include "snmptransport.h"
+#include "snmpber.h"
+#include "snmpudp.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/**
+ * @brief The SNMPudpBatch class SNMPv2c to many agents over one UDP socket. All queued requests, for any number of
+ * agents, are sent with one sendmmsg call and the responses are drained with recvmmsg and matched by request ID, so the
+ * system calls per poll cycle do not grow with the number of agents. Responses carry their kernel receive timestamps
+ * like those of SNMPudpTransport. Linux only, IPv4 agents.
+ *
+ * Either queue requests and call exchange from a poll loop, or give every connector the transport of its agent
+ * (addTarget). Connectors that execute at the same time then share one exchange: whoever comes first sends everything
+ * queued so far, the others wait for it and go with the next one if they arrived too late.
+ */
+class SNMPudpBatch
+{
+public:
+    /**
+     * @brief SNMPudpBatch Opens the socket.
+     * @param timeout How long an exchange waits for the responses, in ms.
+     */
+    explicit SNMPudpBatch(const uint16_t timeout = 1000);
+    ~SNMPudpBatch();
+
+    /**
+     * @brief addTarget Creates the transport of one agent. Keeps the batch alive.
+     * @param batch This batch.
+     * @param ip IPv4 address of the agent.
+     * @param community READ and WRITE community to use.
+     * @param port Port number.
+     * @return Transport whose requests are sent through the batch.
+     */
+    static std::shared_ptr<SNMPtransport> addTarget(const std::shared_ptr<SNMPudpBatch>& batch, const std::string& ip,
+                                                    const std::string& community = "public", const uint16_t port = 161);
+
+    /**
+     * @brief queue Adds a request to the next exchange.
+     * @param request Request prepared by a transport of this batch.
+     * @param response Filled by exchange.
+     * @param status Set by exchange to the SNMP++ status, SNMP_CLASS_TIMEOUT if no response arrived.
+     */
+    void queue(SNMPpreparedRequest& request, SNMPresponse& response, int32_t& status);
+
+    /**
+     * @brief exchange Sends all queued requests and waits until all are answered or the timeout expired. Waits for a
+     * running exchange of the transports first.
+     * @return Number of answered requests.
+     */
+    size_t exchange();
+
+    /**
+     * @brief getSendCalls Returns the number of sendmmsg calls.
+     * @return Number of calls.
+     */
+    inline uint64_t getSendCalls() const { return sendCalls; }
+
+    /**
+     * @brief getReceiveCalls Returns the number of recvmmsg calls that returned datagrams.
+     * @return Number of calls.
+     */
+    inline uint64_t getReceiveCalls() const { return receiveCalls; }
+
+    /**
+     * @brief getDatagrams Returns the number of sent requests.
+     * @return Number of datagrams.
+     */
+    inline uint64_t getDatagrams() const { return datagrams; }
+
+private:
+    static const size_t receiveBatch = 16; //!< Datagrams received per recvmmsg call.
+
+    /**
+     * @brief The Pending struct Queued request.
+     */
+    struct Pending
+    {
+        SNMPpreparedRequest* request; //!< Request of a transport of this batch.
+        SNMPresponse* response; //!< Where the response goes.
+        int32_t* status; //!< Where the status goes.
+        bool* done; //!< Set after the exchange for transports waiting on it, 0 for queue.
+        int32_t requestId; //!< ID of the sent message.
+        bool answered; //!< Response received.
+    };
+
+    const uint16_t timeout; //!< Timeout in ms.
+    int socketFd; //!< Unconnected UDP socket shared by all agents.
+    int32_t requestId; //!< Last used request ID.
+    uint64_t sendCalls; //!< sendmmsg calls.
+    uint64_t receiveCalls; //!< recvmmsg calls that returned datagrams.
+    uint64_t datagrams; //!< Sent requests.
+
+    std::vector<Pending> queued; //!< Requests for the next exchange.
+    std::vector<Pending> sending; //!< Requests of the running exchange.
+    std::unordered_map<int32_t, size_t> byRequestId; //!< Index in sending by request ID.
+    std::vector<std::string> messages; //!< Encoded message per sent request.
+    std::vector<mmsghdr> sendHeaders; //!< One header per sent request.
+    std::vector<iovec> sendVectors; //!< One buffer per sent request.
+    std::vector<std::vector<uint8_t> > receiveBuffers; //!< One buffer per received datagram.
+    std::vector<mmsghdr> receiveHeaders; //!< Headers of the received datagrams.
+    std::vector<iovec> receiveVectors; //!< Buffers of the received datagrams.
+    std::vector<sockaddr_in> receiveAddresses; //!< Senders of the received datagrams.
+    char receiveControl[receiveBatch][SNMPudpTransport::controlSize]; //!< Kernel timestamps of the received datagrams.
+    SNMPmessage decoded; //!< Decoded response.
+
+    std::mutex lock; //!< Guards queued, exchanging and round.
+    std::condition_variable exchanged; //!< Signalled after every exchange.
+    bool exchanging; //!< An exchange is running.
+
+    friend class SNMPbatchTransport;
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response); /// Joins the next exchange and waits for it.
+    size_t lead(std::unique_lock<std::mutex>& l); /// Runs one exchange of everything queued. Caller holds the lock.
+    void send(); /// Encodes and sends all of sending.
+    size_t receive(); /// Collects the responses to sending until all arrived or the timeout expired.
+    bool dispatch(const uint8_t* data, const size_t length, const sockaddr_in& from, const uint64_t time); /// Matches one received datagram.
+};
+
+#endif // SNMPBATCH_H
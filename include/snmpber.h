@@ -0,0 +1,72 @@
+#ifndef SNMPBER_H
+#define SNMPBER_H
+
+#include "snmptransport.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief The SNMPmessage struct Decoded SNMPv1/v2c message.
+ */
+struct SNMPmessage
+{
+    int32_t version; //!< 0 for v1, 1 for v2c.
+    std::string community; //!< Community string.
+    uint8_t pduType; //!< PDU tag, e.g. sNMP_PDU_GET.
+    int32_t requestId; //!< Request ID.
+    int32_t errorStatus; //!< Error status, non-repeaters for GETBULK.
+    int32_t errorIndex; //!< Error index, max-repetitions for GETBULK.
+    std::vector<SNMPvarbind> varbinds; //!< Variable bindings with printable values.
+};
+
+/**
+ * @brief The SNMPber class Minimal BER codec for SNMPv1/v2c messages. Only what the raw UDP transport and the local agent need.
+ * Values are exchanged in the same printable format as SNMPvarbind uses everywhere else: decimal numbers, dotted OIDs
+ * and IP addresses, raw octets. Encoding into a reused buffer does not allocate once the buffer has grown.
+ */
+class SNMPber
+{
+public:
+    static const int32_t version2c = 1; //!< Version field of SNMPv2c messages.
+
+    /**
+     * @brief encodeVarbinds Encodes the varbind list including its SEQUENCE header.
+     * @param varbinds Varbinds. Values are encoded according to their syntax.
+     * @param out Buffer to append to.
+     */
+    static void encodeVarbinds(const std::vector<SNMPvarbind>& varbinds, std::string& out);
+
+    /**
+     * @brief encodeMessage Encodes a complete message around an already encoded varbind list.
+     * @param version Version field.
+     * @param community Community string.
+     * @param pduType PDU tag.
+     * @param requestId Request ID.
+     * @param errorStatus Error status or non-repeaters.
+     * @param errorIndex Error index or max-repetitions.
+     * @param varbinds Encoded varbind list from encodeVarbinds.
+     * @param out Buffer to write to. Cleared first.
+     */
+    static void encodeMessage(const int32_t version, const std::string& community, const uint8_t pduType, const int32_t requestId,
+                              const int32_t errorStatus, const int32_t errorIndex, const std::string& varbinds, std::string& out);
+
+    /**
+     * @brief decodeMessage Decodes a message.
+     * @param data Received datagram.
+     * @param length Length of the datagram.
+     * @param message Filled with the decoded message. Varbind strings keep their capacity.
+     * @return False if the datagram is not a valid SNMPv1/v2c message.
+     */
+    static bool decodeMessage(const uint8_t* data, const size_t length, SNMPmessage& message);
+
+    /**
+     * @brief encodeOid Encodes the OID content octets (without tag and length).
+     * @param oid OID in dotted format.
+     * @param out Buffer to append to.
+     * @return False if the OID is not valid.
+     */
+    static bool encodeOid(const std::string& oid, std::string& out);
+};
+
+#endif // SNMPBER_H
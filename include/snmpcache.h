@@ -0,0 +1,76 @@
+#ifndef SNMPCACHE_H
+#define SNMPCACHE_H
+
+#include "snmptransport.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+
+/**
+ * @brief The SNMPcachingTransport class Transport decorator with a read-through value cache keyed by OID. Share one
+ * instance between all connectors of the same agent.
+ *
+ * GETs are answered from values younger than the freshness window. The OIDs that are missing or stale are merged into
+ * one GET of only those OIDs. A bulk read is answered from the cache if every object it returned last time is fresh.
+ * Writes go to the agent and drop the written OIDs from the cache. Exception values (noSuchObject, ...) are not cached.
+ * Responses carry the send and receive times of their oldest value, so the result shows how old it really is.
+ */
+class SNMPcachingTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPcachingTransport Constructor.
+     * @param transport Transport that talks to the agent.
+     * @param freshness How long a value may be reused, in ms. 0 disables the cache.
+     */
+    SNMPcachingTransport(const std::shared_ptr<SNMPtransport>& transport, const uint32_t freshness);
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+
+    /**
+     * @brief invalidate Drops all cached values.
+     */
+    void invalidate();
+
+    /**
+     * @brief getHits Returns the number of varbinds answered from the cache.
+     * @return Number of varbinds.
+     */
+    uint64_t getHits();
+
+    /**
+     * @brief getMisses Returns the number of varbinds read from the agent.
+     * @return Number of varbinds.
+     */
+    uint64_t getMisses();
+
+private:
+    /**
+     * @brief The Entry struct Cached value of one OID.
+     */
+    struct Entry
+    {
+        std::string value; //!< Value in printable format.
+        int32_t syntax; //!< SNMP syntax.
+        uint64_t time; //!< When it was received, monotonic us.
+        uint64_t sentTime; //!< Send time of the request that read it, wall clock ns.
+        uint64_t receivedTime; //!< Receive time of the response, wall clock ns.
+    };
+
+    std::shared_ptr<SNMPtransport> transport; //!< Transport that talks to the agent.
+    const uint64_t freshness; //!< Freshness window in us.
+    std::mutex lock; //!< Guards the cache and counters. Not held while talking to the agent.
+    std::unordered_map<std::string, Entry> cache; //!< Values by OID.
+    uint64_t hits; //!< Varbinds answered from the cache.
+    uint64_t misses; //!< Varbinds read from the agent.
+
+    bool lookup(const std::string& oid, const uint64_t now, SNMPvarbind& out, SNMPresponse& response); /// Copies a fresh value and ages the response. Caller holds the lock.
+    void store(const std::vector<SNMPvarbind>& varbinds, const uint64_t now, const SNMPresponse& times); /// Caches the values of a response.
+    static void stamp(SNMPresponse& response, const uint64_t sent); /// Fills the times a transport did not set.
+    static void age(SNMPresponse& response, const uint64_t sentTime, const uint64_t receivedTime); /// Keeps the older times.
+};
+
+#endif // SNMPCACHE_H
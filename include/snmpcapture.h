@@ -0,0 +1,119 @@
+#ifndef SNMPCAPTURE_H
+#define SNMPCAPTURE_H
+
+#include "snmptransport.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+
+/**
+ * @brief The SNMPexchange struct One recorded request/response pair.
+ */
+struct SNMPexchange
+{
+    uint64_t time; //!< Start of the exchange in us since the start of the capture.
+    SNMPoperations operation; //!< Operation.
+    uint16_t maxRepetitions; //!< Number of elements for bulk requests.
+    int32_t status; //!< SNMP++ status code returned by the transport.
+    uint64_t requestSize; //!< Size of the request in bytes.
+    uint64_t responseSize; //!< Size of the response in bytes.
+    std::vector<SNMPvarbind> request; //!< Sent varbinds.
+    std::vector<SNMPvarbind> response; //!< Received varbinds.
+};
+
+/**
+ * @brief The SNMPcaptureTransport class Transport decorator that writes every exchange with the wrapped transport to a capture file.
+ * The file is line based text:
+ *
+ * RFCAP 1
+ * X <time us> <operation> <max repetitions> <status> <request size> <response size> <request varbinds> <response varbinds>
+ * Q <syntax> <oid> <value>
+ * R <syntax> <oid> <value>
+ *
+ * Values are the rest of the line with backslash, CR and LF escaped.
+ */
+class SNMPcaptureTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPcaptureTransport Starts a capture.
+     * @param transport Transport that talks to the agent.
+     * @param fileName File to write to. Overwritten.
+     */
+    SNMPcaptureTransport(const std::shared_ptr<SNMPtransport>& transport, const std::string& fileName);
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+
+    /**
+     * @brief writeExchange Writes the exchange in capture format.
+     * @param out Stream to write to.
+     * @param exchange Exchange to write.
+     */
+    static void writeExchange(std::ostream& out, const SNMPexchange& exchange);
+
+    /**
+     * @brief readCapture Reads all exchanges of a capture.
+     * @param fileName Capture file.
+     * @return Exchanges in recorded order.
+     */
+    static std::vector<SNMPexchange> readCapture(const std::string& fileName);
+
+private:
+    std::shared_ptr<SNMPtransport> transport; //!< Wrapped transport.
+    std::mutex lock; //!< Guards the file.
+    std::ofstream out; //!< Capture file.
+    uint64_t start; //!< Start of the capture in us.
+};
+
+/**
+ * @brief The SNMPreplayTransport class Transport that answers from a capture file. Each request gets the recorded responses
+ * of the same operation and OIDs in recorded order, so component logic runs exactly as during the capture.
+ * Requests that were never recorded time out.
+ */
+class SNMPreplayTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPreplayTransport Loads the capture.
+     * @param fileName Capture file.
+     * @param speed Replay speed relative to the capture, e.g. 1000 for 1000x. 0 replays as fast as possible.
+     * @param loop Start from the beginning when the recorded responses of a request run out. Otherwise it times out.
+     */
+    SNMPreplayTransport(const std::string& fileName, const double speed = 1.0, const bool loop = false);
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+
+    /**
+     * @brief getReplayed Returns the number of exchanges replayed.
+     * @return Number of exchanges.
+     */
+    uint64_t getReplayed();
+
+private:
+    /**
+     * @brief The Channel struct Recorded exchanges of one request.
+     */
+    struct Channel
+    {
+        std::vector<size_t> exchanges; //!< Positions in the capture.
+        size_t next; //!< Next exchange to replay.
+        uint64_t loops; //!< How many times the channel wrapped around.
+    };
+
+    std::vector<SNMPexchange> capture; //!< All recorded exchanges.
+    std::map<std::string, Channel> channels; //!< Exchanges by request key.
+    const double speed; //!< Replay speed.
+    const bool loop; //!< Wrap around at the end.
+    uint64_t duration; //!< Length of the capture in us.
+    uint64_t start; //!< Start of the replay in us.
+    uint64_t replayed; //!< Number of exchanges replayed.
+    std::mutex lock; //!< Guards the channels.
+
+    static std::string key(const SNMPoperations operation, const std::vector<SNMPvarbind>& varbinds); /// Identifies the request.
+};
+
+#endif // SNMPCAPTURE_H
@@ -2,6 +2,10 @@
 #define SNMPCONNECTOR_H
 
 #include "snmp_pp/snmp_pp.h"
+#include "snmptransport.h"
+#include "snmpstatistics.h"
+#include "snmpratelimiter.h"
+#include "rftrace.h"
 #include <string>
 #include <cstdint>
 #include <memory>
@@ -9,6 +13,8 @@
 #include <vector>
 #include <stdexcept>
 #include <utility>
+#include <map>
+#include <mutex>
 
 
 /**
@@ -21,7 +27,106 @@ public:
 };
 
 /**
- * @brief The SNMPconnector class Wrapper around SNMP++ library. Exposing functions needed for sync reading and writting. Not thread safe.
+ * @brief The SNMPvarbindStatus enum Outcome of one varbind of a read.
+ */
+enum SNMPvarbindStatus
+{
+    SNMP_VARBIND_OK = 0, //!< Value is valid.
+    SNMP_VARBIND_NO_SUCH_OBJECT, //!< Agent does not know the object.
+    SNMP_VARBIND_NO_SUCH_INSTANCE, //!< Agent does not know the instance.
+    SNMP_VARBIND_END_OF_MIB_VIEW, //!< Bulk read ran past the end of the MIB.
+    SNMP_VARBIND_MISSING //!< Agent returned fewer varbinds than requested.
+};
+
+/**
+ * @brief The SNMPresult struct Values of a read with the status of each varbind, so valid values can be used even if
+ * others failed.
+ */
+struct SNMPresult
+{
+    SNMPresult() : invalid(0), sentTime(0), receivedTime(0) {}
+
+    std::vector<std::string> values; //!< Values in the order as registered, one per requested OID or bulk repetition.
+    std::vector<SNMPvarbindStatus> status; //!< Status of each value.
+    size_t invalid; //!< Number of values that are not SNMP_VARBIND_OK.
+    uint64_t sentTime; //!< When the answered request was sent, wall clock ns since the epoch.
+    uint64_t receivedTime; //!< When its response was received, ns since the epoch. The acquisition time of the values.
+
+    /**
+     * @brief isValid Checks if a value can be used.
+     * @param index Index of the value.
+     * @return True if the agent returned the value.
+     */
+    inline bool isValid(const size_t index) const { return index < status.size() && status[index] == SNMP_VARBIND_OK; }
+
+    /**
+     * @brief roundTrip Returns the time between sending the request and receiving the response.
+     * @return Round trip time in ns.
+     */
+    inline uint64_t roundTrip() const { return (receivedTime > sentTime) ? receivedTime - sentTime : 0; }
+};
+
+/**
+ * @brief The SNMPerror struct Why an operation failed. Cheap to copy and never allocates, the message is a static string.
+ */
+struct SNMPerror
+{
+    SNMPerror() : status(SNMP_CLASS_SUCCESS), message("") {}
+    SNMPerror(const int32_t status, const char* message) : status(status), message(message) {}
+
+    int32_t status; //!< SNMP++ status code. SNMP_CLASS_SUCCESS if nothing failed.
+    const char* message; //!< Description. Points to a string that lives until exit.
+
+    /**
+     * @brief failed Checks if this is an error.
+     * @return False for SNMP_CLASS_SUCCESS.
+     */
+    inline bool failed() const { return status != SNMP_CLASS_SUCCESS; }
+};
+
+/**
+ * @brief The SNMPexpected class Either a value or an SNMPerror, so failures can be handled without exceptions on the
+ * polling path. Refers to the value, which stays owned by whoever returned it.
+ */
+template<typename T> class SNMPexpected
+{
+public:
+    SNMPexpected(const T& value) : pointer(&value) {}
+    SNMPexpected(const SNMPerror& error) : pointer(0), error(error) {}
+
+    /**
+     * @brief hasValue Checks if the operation succeeded.
+     * @return True if there is a value.
+     */
+    inline bool hasValue() const { return pointer != 0; }
+
+    /**
+     * @brief value Returns the value.
+     * @return Value.
+     * @throws SNMPconnectorException With the error message if there is no value.
+     */
+    inline const T& value() const
+    {
+        if(pointer == 0)
+        {
+            throw SNMPconnectorException(error.message);
+        }
+        return *pointer;
+    }
+
+    /**
+     * @brief getError Returns the error.
+     * @return Error. Its status is SNMP_CLASS_SUCCESS if there is a value.
+     */
+    inline const SNMPerror& getError() const { return error; }
+
+private:
+    const T* pointer; //!< Value. 0 on error.
+    SNMPerror error; //!< Error if there is no value.
+};
+
+/**
+ * @brief The SNMPconnector class Named SNMP requests on top of a transport (SNMP++ by default). Exposing functions needed for sync reading and writting. Not thread safe.
  */
 class SNMPconnector
 {
@@ -35,33 +140,72 @@ public:
      * @param retries Number of read retries to do before failing.
      */
     SNMPconnector(const std::string& ip, const std::string& community = "public", const uint16_t port = 161, const uint16_t timeout = 1000, const uint16_t retries = 1);
+
+    /**
+     * @brief SNMPconnector Constructor for SNMPv3 agents.
+     * @param ip IP to connect to.
+     * @param credentials USM user. authPriv with HMAC-SHA and AES128 by default.
+     * @param port Port number.
+     * @param timeout Timeout in ms. It will be rounded to 10ms precission.
+     * @param retries Number of read retries to do before failing.
+     */
+    SNMPconnector(const std::string& ip, const SNMPv3credentials& credentials, const uint16_t port = 161, const uint16_t timeout = 1000, const uint16_t retries = 1);
+
+    /**
+     * @brief SNMPconnector Constructor for other transports, e.g. capture or replay.
+     * @param transport Transport used to reach the agent.
+     * @param retries Number of read retries to do before failing.
+     */
+    explicit SNMPconnector(const std::shared_ptr<SNMPtransport>& transport, const uint16_t retries = 1);
     ~SNMPconnector();
 
     /**
      * @brief createRequest Create a normal SNMP GET request.
      * @param name Name of the request. Used to execute the read method.
      * @param oids Collection of OIDs to read with SNMP GET command.
+     * @param priority Lane of the request if the transport is an SNMPlaneTransport.
      */
-    void createRequest(const std::string& name, const std::vector<std::string>& oids);
+    void createRequest(const std::string& name, const std::vector<std::string>& oids, const SNMPpriorities priority = SNMP_PRIORITY_PARAMETERS);
 
     /**
      * @brief createBulkRequest Creates a bulk request (reads SNMP data with GETNEXT command).
      * @param name Name of the request. Used to execute the read method.
      * @param oid OID where the request starts.
      * @param elements Number of elements to read.
+     * @param priority Lane of the request if the transport is an SNMPlaneTransport.
      */
-    void createBulkRequest(const std::string& name, const std::string& oid, const uint16_t elements);
+    void createBulkRequest(const std::string& name, const std::string& oid, const uint16_t elements, const SNMPpriorities priority = SNMP_PRIORITY_DIAGNOSTICS);
 
     /**
      * @brief readRequest It reads the values that were registered as a request and returns them in a vector of strings in order as registered.
+     * The vector is a buffer of the request that keeps its capacity, so polling does not allocate once the values have been read.
+     * It only holds the values the agent returned, so a short response gives a shorter vector.
      * @param name Name of the request.
      * @param ignoreSyntaxErrors Trows if SNMP syntax errors are detected.
-     * @return Values in a string format.
+     * @return Values in a string format. Valid until the same request is read again or removed.
+     */
+    const std::vector<std::string>& readRequest(const std::string& name, const bool ignoreSyntaxErrors = true);
+
+    /**
+     * @brief readResult Reads the request like readRequest, but reports invalid varbinds per value instead of failing the
+     * whole read. Short responses are padded with SNMP_VARBIND_MISSING values.
+     * @param name Name of the request.
+     * @return Values and their status. Valid until the same request is read again or removed.
+     * @throws SNMPconnectorException Only if the request itself failed, e.g. timed out.
      */
-    std::vector<std::string> readRequest(const std::string& name, const bool ignoreSyntaxErrors = true);
+    const SNMPresult& readResult(const std::string& name);
 
     /**
-     * @brief Sets a value to the given OID.
+     * @brief tryReadResult Reads the request like readResult, but reports failures of the request as error instead of
+     * throwing. Does not allocate on failure, so polling an unreachable agent stays cheap.
+     * @param name Name of the request.
+     * @return Values and their status, or why the request failed.
+     */
+    SNMPexpected<SNMPresult> tryReadResult(const std::string& name);
+
+    /**
+     * @brief Sets a value to the given OID. Writes use the SNMP_PRIORITY_WRITE lane. The SET is prepared with the first
+     * write of the OID and value type and reused by later writes if the transport can update its value.
      * @param oid OID to set value to.
      * @param value Desired value. It can be const char*, int32_t or uint32_t type.
      */
@@ -73,18 +217,68 @@ public:
      */
     void removeRequest(const std::string& name);
 
+    /**
+     * @brief setRateLimiter Limits the requests sent by this connector, including retries. Share the limiter between all
+     * connectors of the same agent.
+     * @param limiter Limiter of the agent. Empty pointer removes the limit.
+     */
+    void setRateLimiter(const std::shared_ptr<SNMPrateLimiter>& limiter);
+
+    /**
+     * @brief getStatistics Returns latency histograms and error counters of all requests. Writes are reported per OID with "set:" prefix.
+     * Safe to call from any thread, e.g. to publish the values as device server attributes.
+     * @return Statistics snapshots keyed by request name.
+     */
+    std::map<std::string, RequestStatisticsSnapshot> getStatistics();
+
+    /**
+     * @brief resetStatistics Clears statistics of all requests.
+     */
+    void resetStatistics();
+
 
 private:
 
-    static const Snmp_pp::snmp_version version = Snmp_pp::version2c; //!< SNMPv2c
-    static const uint16_t maxSize = 1500; //!< Max size of the UDP packet.
+    /**
+     * @brief The Request struct Registered request.
+     */
+    struct Request
+    {
+        SNMPrequestSpec spec; //!< What to prepare. Released once prepared.
+        std::shared_ptr<SNMPpreparedRequest> prepared; //!< Request prepared by the transport on first read.
+        std::shared_ptr<RequestStatistics> statistics; //!< Statistics of the request. Shared with the statistics map.
+        SNMPresponse response; //!< Response buffer reused on every read.
+        SNMPresult result; //!< Values returned by the last read. Reused on every read.
+    };
+
+    /**
+     * @brief The PreparedSet struct Write prepared once per OID and syntax, later writes only replace its value.
+     */
+    struct PreparedSet
+    {
+        std::string name; //!< Name of the write in the statistics and traces.
+        int32_t syntax; //!< Syntax of the written value.
+        std::shared_ptr<SNMPpreparedRequest> request; //!< Prepared SET.
+        std::shared_ptr<RequestStatistics> statistics; //!< Statistics of the writes to the OID.
+    };
+
+    std::shared_ptr<SNMPtransport> transport; //!< Transport used to reach the agent.
+    std::unordered_map<std::string, Request> requests; //!< Map of all registered requests that the user can execute.
+    uint16_t retries; //!< Number of resends on timeout.
+    std::shared_ptr<SNMPrateLimiter> limiter; //!< Rate limit of the agent. Empty if not limited.
 
-    std::unique_ptr<Snmp_pp::CTarget> cTarget; //!< Target for SNMPv2c messages.
-    std::unique_ptr<Snmp_pp::Snmp> snmpSession; //!< SNMP session.
-    std::unordered_map<std::string, std::pair<std::shared_ptr<Snmp_pp::Pdu>, uint16_t> > requests; //!< Map of all registered requests that the user can execute.
+    std::mutex statisticsLock; //!< Guards the statistics map. Counters themselves are lock-free.
+    std::unordered_map<std::string, std::shared_ptr<RequestStatistics> > statistics; //!< Statistics of all requests and writes.
+    std::mutex setLock; //!< Guards the prepared writes, so writes from several threads stay safe.
+    std::unordered_map<std::string, std::vector<PreparedSet> > sets; //!< Prepared writes keyed by OID.
 
-    void addToMap(const std::string& name, const uint16_t noElements = 0); /// Helper function for adding new requests to the map.
-    std::vector<std::string> extractData(const int32_t status, const Snmp_pp::Pdu& pdu, const bool ignoreSyntaxErrors);
+    void addToMap(const std::string& name, const SNMPrequestSpec& spec); /// Helper function for adding new requests to the map.
+    SNMPerror read(const std::string& name, const bool pad, Request*& request); /// Executes the request and extracts the result, padded to the requested size if pad is set.
+    void extractData(const std::string& name, const SNMPresponse& response, const size_t expected, RequestStatistics& stats,
+                     SNMPresult& result); /// Copies the values of a successful response.
+    static SNMPvarbindStatus toStatus(const SNMPvarbind& varbind); /// Maps the exception syntaxes to a varbind status.
+    int32_t execute(const std::string& name, SNMPpreparedRequest& request, SNMPresponse& response, RequestStatistics& stats); /// Sends the request with retries and updates statistics.
+    std::shared_ptr<RequestStatistics> getStatisticsEntry(const std::string& name); /// Returns existing or new statistics entry.
 };
 
 #endif // SNMPCONNECTOR_H
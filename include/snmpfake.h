@@ -0,0 +1,79 @@
+#ifndef SNMPFAKE_H
+#define SNMPFAKE_H
+
+#include "snmptransport.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+/**
+ * @brief The SNMPfakeTransport class In-process agent. Answers from a MIB held in memory, ordered like a real agent walks it,
+ * so GET, GETBULK and SET behave as on the wire without a network or an external agent. Thread safe.
+ */
+class SNMPfakeTransport : public SNMPtransport
+{
+public:
+    SNMPfakeTransport();
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+
+    /**
+     * @brief set Adds or replaces a MIB object.
+     * @param oid OID in dotted format.
+     * @param value Value in printable format.
+     * @param syntax SNMP syntax of the value.
+     */
+    void set(const std::string& oid, const std::string& value, const int32_t syntax = sNMP_SYNTAX_INT);
+
+    /**
+     * @brief get Returns the current value of a MIB object, e.g. to check what was written.
+     * @param oid OID in dotted format.
+     * @return Value in printable format. Empty if the object does not exist.
+     */
+    std::string get(const std::string& oid);
+
+    /**
+     * @brief remove Removes a MIB object. Reads of it return noSuchObject.
+     * @param oid OID in dotted format.
+     */
+    void remove(const std::string& oid);
+
+    /**
+     * @brief setOffline Simulates an unreachable agent. Every request times out immediately.
+     * @param offline True to stop answering.
+     */
+    void setOffline(const bool offline);
+
+    /**
+     * @brief setLatency Sets the time every request takes.
+     * @param latency Latency in us.
+     */
+    void setLatency(const uint32_t latency);
+
+    /**
+     * @brief getRequests Returns the number of executed requests, including the ones that timed out.
+     * @return Number of requests.
+     */
+    uint64_t getRequests();
+
+    /**
+     * @brief parseOid Parses an OID in dotted format.
+     * @param oid OID in dotted format, optionally with a leading dot.
+     * @param arcs Filled with the arcs.
+     * @return False if the OID is not valid.
+     */
+    static bool parseOid(const std::string& oid, std::vector<uint32_t>& arcs);
+
+private:
+    std::map<std::vector<uint32_t>, SNMPvarbind> mib; //!< MIB objects in lexicographic OID order.
+    std::mutex lock; //!< Guards the MIB and the settings.
+    bool offline; //!< Time out every request.
+    uint32_t latency; //!< Time of every request in us.
+    uint64_t requests; //!< Number of executed requests.
+
+    static std::vector<uint32_t> toArcs(const std::string& oid); /// Parses the OID or throws.
+};
+
+#endif // SNMPFAKE_H
@@ -0,0 +1,85 @@
+#ifndef SNMPLANES_H
+#define SNMPLANES_H
+
+#include "snmptransport.h"
+#include "snmpstatistics.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief The SNMPlaneLimits struct How many requests may be in flight to one agent, in total and per lane.
+ * Keep the sum of the lanes below SNMP_PRIORITY_STATE smaller than maxInFlight, so state reads always find a free slot.
+ */
+struct SNMPlaneLimits
+{
+    SNMPlaneLimits() : maxInFlight(4)
+    {
+        lanes[SNMP_PRIORITY_STATE] = 4;
+        lanes[SNMP_PRIORITY_WRITE] = 1;
+        lanes[SNMP_PRIORITY_PARAMETERS] = 1;
+        lanes[SNMP_PRIORITY_DIAGNOSTICS] = 1;
+    }
+
+    uint16_t maxInFlight; //!< Requests in flight to the agent over all lanes.
+    uint16_t lanes[SNMP_PRIORITIES]; //!< Requests in flight per lane.
+};
+
+/**
+ * @brief The SNMPlaneTransport class Transport decorator that queues requests in priority lanes (SNMPrequestSpec::priority).
+ * Share one instance between all connectors of the same agent. A request waits while its lane or the agent is at the
+ * in-flight limit, or while a more important lane has a request waiting that could run. So a burst of diagnostic bulk
+ * reads gets deferred between its requests, and between the retries of one request, as soon as a state read is queued.
+ * Requests already on the wire are not aborted.
+ */
+class SNMPlaneTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPlaneTransport Constructor.
+     * @param transport Transport that talks to the agent. Must allow concurrent execute calls if more than one request may be in flight.
+     * @param limits In-flight limits.
+     */
+    SNMPlaneTransport(const std::shared_ptr<SNMPtransport>& transport, const SNMPlaneLimits& limits = SNMPlaneLimits());
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+
+    /**
+     * @brief getQueueDelay Returns how long requests of a lane waited for a slot.
+     * @param priority Lane.
+     * @return Histogram in us.
+     */
+    LatencyHistogram::Snapshot getQueueDelay(const SNMPpriorities priority) const;
+
+    /**
+     * @brief getDeferred Returns how many requests of a lane had to wait.
+     * @param priority Lane.
+     * @return Number of requests.
+     */
+    uint64_t getDeferred(const SNMPpriorities priority);
+
+    /**
+     * @brief getInFlight Returns the number of requests currently executed by the agent transport.
+     * @return Number of requests.
+     */
+    uint16_t getInFlight();
+
+private:
+    std::shared_ptr<SNMPtransport> transport; //!< Transport that talks to the agent.
+    const SNMPlaneLimits limits; //!< In-flight limits.
+    std::mutex lock; //!< Guards the counters below.
+    std::condition_variable released; //!< Signalled when a slot is released.
+    uint16_t inFlight; //!< Requests in flight over all lanes.
+    uint16_t laneInFlight[SNMP_PRIORITIES]; //!< Requests in flight per lane.
+    uint32_t waiting[SNMP_PRIORITIES]; //!< Requests waiting per lane.
+    uint64_t deferred[SNMP_PRIORITIES]; //!< Requests that had to wait per lane.
+    LatencyHistogram queueDelay[SNMP_PRIORITIES]; //!< Waiting time per lane.
+
+    bool canRun(const SNMPpriorities priority) const; /// Checks if a request of the lane may start now. Caller holds the lock.
+    void acquire(const SNMPpriorities priority); /// Waits for a slot.
+    void release(const SNMPpriorities priority); /// Frees a slot and wakes the waiting requests.
+};
+
+#endif // SNMPLANES_H
@@ -1,7 +1,7 @@
 #ifndef SNMPOIDS_H
 #define SNMPOIDS_H
 
-#endif // SNMPOIDS_H
+#include <string>
 
 /**
  * @brief The OIDS enum Index of OID in oids array.
@@ -55,3 +55,31 @@ static const std::string oids[OIDS_LENGTH] =
     "1.3.6.1.4.1.2566.127.1.2.216.100.1.1.2.1.2.X", // X will be replaced by the lq index.
     "1.3.6.1.4.1.2566.127.1.2.216.100.1.1.2.1.5.X" // X will be replaced by the lq index.
 };
+
+/**
+ * @brief The oidNames array Names of the OIDs in the oids array. Used as keys in topology files.
+ */
+static const std::string oidNames[OIDS_LENGTH] =
+{
+    "AMP_SUMMARY",
+    "LQC_SUMMARY",
+    "TRANS_SUMMARY",
+    "MTX_SUMMARY",
+    "OSTAGE_SUMMARY",
+    "RF_LINK",
+    "TRANS_RESET",
+    "MTX_RESET",
+    "NOMINAL_POWER",
+    "TRANS_FP",
+    "TRANS_RP",
+    "TRANS_PAE",
+    "OUT_POWER",
+    "RFS_FORWARD",
+    "RFS_REFLECTED",
+    "TRANS_ON",
+    "AMP_ON",
+    "LQ_TIN",
+    "LQ_TOUT"
+};
+
+#endif // SNMPOIDS_H
@@ -0,0 +1,83 @@
+#ifndef SNMPRATELIMITER_H
+#define SNMPRATELIMITER_H
+
+#include "snmpstatistics.h"
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief The SNMPrateLimiter class Token buckets for requests/s and varbinds/s sent to one agent. Share one instance
+ * between all connectors of the agent (SNMPconnector::setRateLimiter).
+ *
+ * A request that finds too few tokens reserves them anyway and sleeps until they are refilled, so waiting requests are
+ * served in arrival order and each one sleeps exactly once. A request larger than a full bucket waits for a full bucket
+ * and leaves it in debt.
+ */
+class SNMPrateLimiter
+{
+public:
+    /**
+     * @brief SNMPrateLimiter Constructor.
+     * @param requestRate Requests per second. 0 does not limit requests.
+     * @param varbindRate Varbinds per second, counted as requested OIDs or bulk repetitions. 0 does not limit varbinds.
+     * @param burst Bucket size in seconds of the rates, i.e. how much can be sent at once after an idle period.
+     */
+    SNMPrateLimiter(const double requestRate, const double varbindRate, const double burst = 0.1);
+
+    /**
+     * @brief acquire Takes tokens for one request, sleeping if the agent is at its rate.
+     * @param varbinds Varbinds of the request.
+     * @return Time waited in us.
+     */
+    uint64_t acquire(const uint32_t varbinds);
+
+    /**
+     * @brief getRequests Returns the number of requests that passed the limiter.
+     * @return Number of requests.
+     */
+    uint64_t getRequests();
+
+    /**
+     * @brief getDelayed Returns the number of requests that had to wait.
+     * @return Number of requests.
+     */
+    uint64_t getDelayed();
+
+    /**
+     * @brief getQueued Returns the number of requests waiting right now.
+     * @return Number of requests.
+     */
+    uint32_t getQueued();
+
+    /**
+     * @brief getWait Returns the waiting times of delayed requests.
+     * @return Histogram in us.
+     */
+    inline LatencyHistogram::Snapshot getWait() const { return wait.snapshot(); }
+
+private:
+    /**
+     * @brief The Bucket struct One token bucket.
+     */
+    struct Bucket
+    {
+        double rate; //!< Tokens per us. 0 if unlimited.
+        double size; //!< Maximum number of tokens.
+        double tokens; //!< Available tokens. Negative while reserved by waiting requests.
+    };
+
+    std::mutex lock; //!< Guards the buckets and counters.
+    Bucket requestBucket; //!< Requests.
+    Bucket varbindBucket; //!< Varbinds.
+    uint64_t refilled; //!< When the buckets were last refilled, monotonic us.
+    uint64_t requests; //!< Requests that passed.
+    uint64_t delayed; //!< Requests that waited.
+    uint32_t queued; //!< Requests waiting now.
+    LatencyHistogram wait; //!< Waiting time of delayed requests.
+
+    static void setup(Bucket& bucket, const double rate, const double burst); /// Sets rate and size, starts full.
+    static void refill(Bucket& bucket, const uint64_t elapsed); /// Adds the tokens of the elapsed time.
+    static uint64_t take(Bucket& bucket, const double tokens); /// Takes tokens and returns the time until they are refilled.
+};
+
+#endif // SNMPRATELIMITER_H
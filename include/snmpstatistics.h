@@ -0,0 +1,166 @@
+#ifndef SNMPSTATISTICS_H
+#define SNMPSTATISTICS_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <cstdatomic>
+
+/**
+ * @brief The LatencyHistogram class HDR style log-linear histogram of request latencies in microseconds.
+ * Every power of two range is split into 8 linear sub-buckets, so the reported values are within 12.5% of the real ones.
+ * Recording is lock-free and can be left on in production.
+ */
+class LatencyHistogram
+{
+public:
+    static const uint16_t subBucketBits = 3; //!< 2^3 = 8 linear sub-buckets per power of two.
+    static const uint16_t subBuckets = 1 << subBucketBits; //!< Number of linear sub-buckets per power of two.
+    static const uint16_t maxMagnitude = 31; //!< Highest power of two tracked. Everything above ~35 minutes goes to the last bucket.
+    static const uint16_t noBuckets = subBuckets + (maxMagnitude - subBucketBits + 1) * subBuckets; //!< Total number of buckets.
+
+    /**
+     * @brief The Snapshot struct Consistent enough copy of the histogram that can be freely queried.
+     */
+    struct Snapshot
+    {
+        std::vector<uint64_t> counts; //!< Number of samples in each bucket.
+        uint64_t count; //!< Number of all samples.
+        uint64_t sum; //!< Sum of all samples in microseconds.
+        uint64_t min; //!< Smallest sample in microseconds.
+        uint64_t max; //!< Largest sample in microseconds.
+
+        /**
+         * @brief percentile Returns the upper bound of the bucket holding the given percentile.
+         * @param percent Percentile to return (0 - 100).
+         * @return Latency in microseconds. 0 if there are no samples.
+         */
+        uint64_t percentile(const double percent) const;
+
+        /**
+         * @brief mean Returns the average latency.
+         * @return Latency in microseconds. 0 if there are no samples.
+         */
+        double mean() const;
+    };
+
+    LatencyHistogram();
+
+    /**
+     * @brief record Adds one sample to the histogram.
+     * @param microseconds Measured latency.
+     */
+    void record(const uint64_t microseconds);
+
+    /**
+     * @brief snapshot Copies the current histogram values.
+     * @return Snapshot of the histogram.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief reset Clears all the samples.
+     */
+    void reset();
+
+    /**
+     * @brief bucketIndex Returns the index of the bucket for the given value.
+     */
+    static uint16_t bucketIndex(const uint64_t microseconds);
+
+    /**
+     * @brief bucketUpperBound Returns the largest value that still falls into the given bucket.
+     */
+    static uint64_t bucketUpperBound(const uint16_t index);
+
+private:
+    std::atomic<uint64_t> buckets[noBuckets]; //!< Sample counters.
+    std::atomic<uint64_t> count; //!< Number of all samples.
+    std::atomic<uint64_t> sum; //!< Sum of all samples.
+    std::atomic<uint64_t> min; //!< Smallest sample.
+    std::atomic<uint64_t> max; //!< Largest sample.
+};
+
+/**
+ * @brief The RequestStatisticsSnapshot struct Copy of the statistics of one request. Used for publishing.
+ */
+struct RequestStatisticsSnapshot
+{
+    std::string name; //!< Name of the request.
+    uint64_t requests; //!< Number of executed requests.
+    uint64_t timeouts; //!< Requests that timed out after all retries.
+    uint64_t retries; //!< Number of resends caused by timeouts.
+    uint64_t errorStatus; //!< Responses with agent error-status set.
+    uint64_t transportErrors; //!< Failures other than timeouts reported by SNMP++.
+    uint64_t syntaxErrors; //!< Varbinds returned as noSuchObject, noSuchInstance or endOfMibView.
+    uint64_t bytesSent; //!< Encoded size of all sent messages.
+    uint64_t bytesReceived; //!< Encoded size of all received messages.
+    uint64_t rateLimited; //!< Sends delayed by the rate limiter.
+    uint64_t rateLimitWait; //!< Time spent waiting for the rate limiter in microseconds.
+    LatencyHistogram::Snapshot latency; //!< Latency of the complete request including retries and rate limiting.
+    LatencyHistogram::Snapshot roundTrip; //!< Send to receive time of the answered attempt, from the response timestamps.
+};
+
+/**
+ * @brief The RequestStatistics class Counters of one SNMP request. Lock-free, one instance per request so each polling thread updates its own counters.
+ */
+class RequestStatistics
+{
+public:
+    RequestStatistics();
+
+    /**
+     * @brief add Relaxed increment of one of the counters.
+     * @param counter Counter to increment.
+     * @param value Value to add.
+     */
+    static inline void add(std::atomic<uint64_t>& counter, const uint64_t value)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief snapshot Copies the current values.
+     * @param name Name of the request the statistics belong to.
+     * @return Snapshot of the statistics.
+     */
+    RequestStatisticsSnapshot snapshot(const std::string& name) const;
+
+    /**
+     * @brief reset Clears all counters.
+     */
+    void reset();
+
+    std::atomic<uint64_t> requests; //!< Number of executed requests.
+    std::atomic<uint64_t> timeouts; //!< Requests that timed out after all retries.
+    std::atomic<uint64_t> retries; //!< Number of resends caused by timeouts.
+    std::atomic<uint64_t> errorStatus; //!< Responses with agent error-status set.
+    std::atomic<uint64_t> transportErrors; //!< Failures other than timeouts reported by SNMP++.
+    std::atomic<uint64_t> syntaxErrors; //!< Varbinds returned with exception syntax.
+    std::atomic<uint64_t> bytesSent; //!< Encoded size of all sent messages.
+    std::atomic<uint64_t> bytesReceived; //!< Encoded size of all received messages.
+    std::atomic<uint64_t> rateLimited; //!< Sends delayed by the rate limiter.
+    std::atomic<uint64_t> rateLimitWait; //!< Time spent waiting for the rate limiter.
+    LatencyHistogram latency; //!< Request latency.
+    LatencyHistogram roundTrip; //!< Round trip time of answered requests.
+};
+
+/**
+ * @brief monotonicMicroseconds Returns the time from the monotonic clock.
+ * @return Time in microseconds.
+ */
+uint64_t monotonicMicroseconds();
+
+/**
+ * @brief monotonicNanoseconds Returns the time from the monotonic clock.
+ * @return Time in nanoseconds.
+ */
+uint64_t monotonicNanoseconds();
+
+/**
+ * @brief wallClockNanoseconds Returns the time from the realtime clock, the clock of kernel receive timestamps.
+ * @return Time in nanoseconds since the epoch.
+ */
+uint64_t wallClockNanoseconds();
+
+#endif // SNMPSTATISTICS_H
@@ -0,0 +1,188 @@
+#ifndef SNMPTRANSPORT_H
+#define SNMPTRANSPORT_H
+
+#include "snmp_pp/snmp_pp.h"
+#include "snmpusm.h"
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The SNMPoperations enum SNMP operations issued by the connector.
+ */
+enum SNMPoperations
+{
+    SNMP_GET = 0,
+    SNMP_GETBULK,
+    SNMP_SET
+};
+
+/**
+ * @brief The SNMPpriorities enum Lanes of SNMPlaneTransport, from the most to the least important.
+ */
+enum SNMPpriorities
+{
+    SNMP_PRIORITY_STATE = 0, //!< Interlock and state reads, e.g. summaries and reflected power.
+    SNMP_PRIORITY_WRITE, //!< Writes.
+    SNMP_PRIORITY_PARAMETERS, //!< Periodic parameter reads.
+    SNMP_PRIORITY_DIAGNOSTICS, //!< Diagnostic reads after a fault.
+    SNMP_PRIORITIES //!< Number of lanes.
+};
+
+/**
+ * @brief The SNMPvarbind struct Transport independent variable binding.
+ */
+struct SNMPvarbind
+{
+    std::string oid; //!< OID in dotted format.
+    std::string value; //!< Value in printable format. Empty for reads.
+    int32_t syntax; //!< SNMP syntax (sNMP_SYNTAX_*). sNMP_SYNTAX_NULL for reads.
+};
+
+/**
+ * @brief The SNMPrequestSpec struct Everything a transport needs to build a request.
+ */
+struct SNMPrequestSpec
+{
+    SNMPrequestSpec() : operation(SNMP_GET), maxRepetitions(0), priority(SNMP_PRIORITY_PARAMETERS) {}
+
+    SNMPoperations operation; //!< Operation to execute.
+    std::vector<SNMPvarbind> varbinds; //!< OIDs to read or values to write.
+    uint16_t maxRepetitions; //!< Number of elements to read for bulk requests. 0 otherwise.
+    SNMPpriorities priority; //!< Lane of the request. Only used by SNMPlaneTransport.
+};
+
+/**
+ * @brief The SNMPresponse struct Result of one exchange with the agent. Reused between calls so the buffers keep their capacity.
+ */
+struct SNMPresponse
+{
+    std::vector<SNMPvarbind> varbinds; //!< Returned variable bindings.
+    uint64_t requestSize; //!< Size of the sent message in bytes. SNMPppTransport estimates it once as SNMPv2c message.
+    uint64_t responseSize; //!< Size of the received message in bytes. 0 if nothing was received. SNMPppTransport estimates
+                           //!< it once as SNMPv2c message without the returned values and the SNMPv3 security header.
+    uint64_t sentTime; //!< When the request was sent, wall clock ns since the epoch. 0 if the transport does not know.
+    uint64_t receivedTime; //!< When the response was received, kernel timestamp where available. 0 if the transport does not know.
+};
+
+/**
+ * @brief The SNMPpreparedRequest class Request prepared by a transport. Transports derive from it to keep encoded or parsed data.
+ */
+class SNMPpreparedRequest
+{
+public:
+    explicit SNMPpreparedRequest(const SNMPrequestSpec& spec) : spec(spec) {}
+    virtual ~SNMPpreparedRequest() {}
+
+    const SNMPrequestSpec spec; //!< What the request does.
+};
+
+/**
+ * @brief The SNMPtransport class Backend that moves requests to the agent and back. Status codes are SNMP++ codes:
+ * SNMP_CLASS_SUCCESS, SNMP_CLASS_TIMEOUT, other negative codes for local errors and positive codes for the agent error-status.
+ * Transports do not retry, that is done by the connector.
+ */
+class SNMPtransport
+{
+public:
+    virtual ~SNMPtransport() {}
+
+    /**
+     * @brief prepare Builds a request once so it can be executed many times.
+     * @param spec Request description.
+     * @return Prepared request.
+     */
+    virtual std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec) = 0;
+
+    /**
+     * @brief execute Sends the request and waits for the response.
+     * @param request Request returned by prepare of the same transport.
+     * @param response Filled with the response.
+     * @return SNMP++ status code.
+     */
+    virtual int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response) = 0;
+
+    /**
+     * @brief updateValues Replaces the values of a prepared SET, so repeated writes of the same OIDs do not build a new
+     * request. The spec of the request keeps the values it was prepared with.
+     * @param request SET returned by prepare of the same transport.
+     * @param varbinds New values. Same OIDs and syntaxes as the prepared ones.
+     * @return False if the transport can not do it. The caller prepares a new request then.
+     */
+    virtual bool updateValues(SNMPpreparedRequest& request, const std::vector<SNMPvarbind>& varbinds) { return false; }
+};
+
+/**
+ * @brief The SNMPoidPool class Process wide pool of parsed SNMP++ OIDs. Each distinct OID is parsed once and then copied
+ * from the pool by every transport and connector. Entries are never removed since the OIDs of a plant are a fixed set.
+ */
+class SNMPoidPool
+{
+public:
+    /**
+     * @brief get Returns the parsed OID. Parses it on the first call.
+     * @param oid OID in dotted format.
+     * @return Parsed OID. Stays valid until exit.
+     */
+    static const Snmp_pp::Oid& get(const std::string& oid);
+
+    /**
+     * @brief size Returns the number of distinct OIDs parsed so far.
+     * @return Number of OIDs.
+     */
+    static size_t size();
+};
+
+/**
+ * @brief The SNMPppTransport class Transport using the SNMP++ library with SNMPv2c or SNMPv3.
+ */
+class SNMPppTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPppTransport Constructor for SNMPv2c.
+     * @param ip IP to connect to.
+     * @param community READ and WRITE community to use.
+     * @param port Port number.
+     * @param timeout Timeout in ms. It will be rounded to 10ms precission.
+     */
+    SNMPppTransport(const std::string& ip, const std::string& community = "public", const uint16_t port = 161, const uint16_t timeout = 1000);
+
+    /**
+     * @brief SNMPppTransport Constructor for SNMPv3. The engine ID of the agent is discovered with the first request and
+     * the keys of the user are localized for it once (see SNMPusm).
+     * @param ip IP to connect to.
+     * @param credentials USM user.
+     * @param port Port number.
+     * @param timeout Timeout in ms. It will be rounded to 10ms precission.
+     */
+    SNMPppTransport(const std::string& ip, const SNMPv3credentials& credentials, const uint16_t port = 161, const uint16_t timeout = 1000);
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+    bool updateValues(SNMPpreparedRequest& request, const std::vector<SNMPvarbind>& varbinds);
+
+    /**
+     * @brief getEngineId Returns the engine ID of the agent.
+     * @return Engine ID in printable hex format. Empty for SNMPv2c or before the discovery.
+     */
+    std::string getEngineId();
+
+private:
+    Snmp_pp::snmp_version version; //!< SNMPv2c or SNMPv3.
+    const bool v3; //!< SNMPv3 with USM.
+    Snmp_pp::UdpAddress address; //!< Address of the agent.
+    const uint16_t timeout; //!< Timeout in ms.
+    std::unique_ptr<Snmp_pp::SnmpTarget> target; //!< CTarget for SNMPv2c, UTarget for SNMPv3.
+    std::unique_ptr<Snmp_pp::Snmp> snmpSession; //!< SNMP session.
+    Snmp_pp::OctetStr community; //!< Community used for encoding statistics.
+    SNMPv3credentials credentials; //!< USM user for SNMPv3.
+    Snmp_pp::OctetStr engineId; //!< Discovered engine ID of the agent.
+
+    void openSession(const std::string& ip, const uint16_t port); /// Creates the session. Also sets the address.
+    int32_t discoverEngine(); /// Discovers the engine ID and localizes the keys for it.
+    uint64_t encodedSize(const Snmp_pp::Pdu& pdu, const int32_t pduType); /// Size of the PDU encoded as SNMPv2c message.
+};
+
+#endif // SNMPTRANSPORT_H
@@ -0,0 +1,61 @@
+#ifndef SNMPUDP_H
+#define SNMPUDP_H
+
+#include "snmptransport.h"
+#include "snmpber.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <sys/socket.h>
+
+/**
+ * @brief The SNMPudpTransport class SNMPv2c straight over a connected UDP socket. The varbind list is encoded once when
+ * the request is prepared, each exchange only wraps it with a new request ID. Buffers are reused, so there is no
+ * allocation per exchange once they have grown. Exchanges are serialized. Responses carry the receive time the kernel
+ * stamped on the datagram (SO_TIMESTAMPNS), so scheduling delays after the arrival do not shift the acquisition time.
+ */
+class SNMPudpTransport : public SNMPtransport
+{
+public:
+    /**
+     * @brief SNMPudpTransport Constructor.
+     * @param ip IP to connect to.
+     * @param community READ and WRITE community to use.
+     * @param port Port number.
+     * @param timeout Timeout in ms.
+     */
+    SNMPudpTransport(const std::string& ip, const std::string& community = "public", const uint16_t port = 161, const uint16_t timeout = 1000);
+    ~SNMPudpTransport();
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec);
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response);
+    bool updateValues(SNMPpreparedRequest& request, const std::vector<SNMPvarbind>& varbinds);
+
+    /**
+     * @brief enableTimestamps Asks the kernel to stamp received datagrams with their arrival time.
+     * @param socketFd UDP socket.
+     */
+    static void enableTimestamps(const int socketFd);
+
+    /**
+     * @brief receiveTime Returns the arrival time of a datagram received with recvmsg or recvmmsg.
+     * @param message Header with the control messages of the datagram.
+     * @return Wall clock time in ns since the epoch, 0 if the kernel did not stamp it.
+     */
+    static uint64_t receiveTime(const msghdr& message);
+
+    static const size_t controlSize = 64; //!< Control buffer that holds a SCM_TIMESTAMPNS message.
+
+private:
+    const std::string community; //!< Community string.
+    const uint16_t timeout; //!< Timeout in ms.
+    int socketFd; //!< Connected UDP socket.
+    int32_t requestId; //!< Last used request ID.
+    std::mutex lock; //!< One exchange at a time.
+    std::string message; //!< Send buffer.
+    std::vector<uint8_t> datagram; //!< Receive buffer.
+    char control[controlSize]; //!< Receives the timestamp of the datagram.
+    SNMPmessage decoded; //!< Decoded response.
+};
+
+#endif // SNMPUDP_H
@@ -0,0 +1,98 @@
+#ifndef SNMPUSM_H
+#define SNMPUSM_H
+
+#include "snmp_pp/snmp_pp.h"
+#include <string>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+/**
+ * @brief The SNMPv3authProtocols enum Authentication protocols. Same values as SNMP_AUTHPROTOCOL_* of SNMP++.
+ */
+enum SNMPv3authProtocols
+{
+    SNMPv3_AUTH_NONE = 1,
+    SNMPv3_AUTH_MD5 = 2,
+    SNMPv3_AUTH_SHA = 3
+};
+
+/**
+ * @brief The SNMPv3privProtocols enum Privacy protocols. Same values as SNMP_PRIVPROTOCOL_* of SNMP++.
+ */
+enum SNMPv3privProtocols
+{
+    SNMPv3_PRIV_NONE = 1,
+    SNMPv3_PRIV_DES = 2,
+    SNMPv3_PRIV_AES128 = 4
+};
+
+/**
+ * @brief The SNMPv3credentials struct USM user used to talk to an SNMPv3 agent. Defaults to authPriv with HMAC-SHA and AES128.
+ */
+struct SNMPv3credentials
+{
+    SNMPv3credentials() : authProtocol(SNMPv3_AUTH_SHA), privProtocol(SNMPv3_PRIV_AES128) {}
+
+    std::string securityName; //!< USM user name.
+    SNMPv3authProtocols authProtocol; //!< Authentication protocol.
+    std::string authPassword; //!< Authentication password.
+    SNMPv3privProtocols privProtocol; //!< Privacy protocol.
+    std::string privPassword; //!< Privacy password.
+
+    /**
+     * @brief securityLevel Returns the security level the protocols allow.
+     * @return SNMP_SECURITY_LEVEL_* of SNMP++. 0 if SNMP++ was built without SNMPv3.
+     */
+    int32_t securityLevel() const;
+};
+
+/**
+ * @brief The SNMPusm class Process wide SNMPv3 state. SNMP++ allows one message processing model per process, so it is
+ * created here once and shared by all transports.
+ *
+ * Turning a password into a localized key hashes 1MB per key, which is far more than a poll cycle may spend. Keys are
+ * therefore localized once per engine ID and user and handed to the USM as localized users, so SNMP++ never derives keys
+ * while requests are being sent. Engine boots and time are learned by SNMP++ with the first request and reused after that.
+ */
+class SNMPusm
+{
+public:
+    /**
+     * @brief instance Returns the process wide instance. Creates the message processing model on the first call.
+     * @return USM state.
+     */
+    static SNMPusm& instance();
+
+    /**
+     * @brief localize Makes sure the USM has keys of the user localized for the engine. Keys are cached by engine ID and
+     * user and localized again when the protocols or a password change.
+     * @param credentials User to add.
+     * @param engineId Authoritative engine ID of the agent.
+     * @return True if the keys had to be localized, false if they were cached.
+     */
+    bool localize(const SNMPv3credentials& credentials, const Snmp_pp::OctetStr& engineId);
+
+    /**
+     * @brief getLocalizations Returns how many times keys were localized.
+     * @return Number of localizations.
+     */
+    uint64_t getLocalizations();
+
+    /**
+     * @brief isSupported Checks if SNMP++ was built with SNMPv3 support.
+     * @return True if SNMPv3 can be used.
+     */
+    static bool isSupported();
+
+private:
+    SNMPusm();
+    SNMPusm(const SNMPusm&);
+    SNMPusm& operator=(const SNMPusm&);
+
+    std::mutex lock; //!< Guards the cache.
+    std::map<std::string, std::string> localized; //!< Protocols and password hash of the keys in the USM by engine ID and user. Passwords are not kept.
+    uint64_t localizations; //!< Number of localizations done.
+};
+
+#endif // SNMPUSM_H
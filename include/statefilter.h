@@ -0,0 +1,72 @@
+#ifndef STATEFILTER_H
+#define STATEFILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The StateFilter class Debounces state transitions of a component. A new state is accepted when at least N of
+ * the last M samples differ from the current state and the current state was held for the minimum dwell time. Samples
+ * that are not accepted leave the component as it is, so a glitch does not trigger a diagnosis and two events.
+ * The filtered state is the state the component took, which a diagnosis may have derived differently from the sample.
+ * The default of 1 of 1 without dwell time accepts every sample. Not thread safe.
+ */
+class StateFilter
+{
+public:
+    static const size_t maxWindow = 32; //!< Largest supported M.
+
+    StateFilter();
+
+    /**
+     * @brief configure Sets the filter up and forgets the samples seen so far.
+     * @param required N, number of differing samples needed for a transition.
+     * @param window M, number of last samples looked at.
+     * @param minDwell Minimum time in ms a state is held before it may change again.
+     * @return False if the values are out of range (0 < N <= M <= maxWindow). The filter is left unchanged then.
+     */
+    bool configure(const uint16_t required, const uint16_t window, const uint32_t minDwell);
+
+    /**
+     * @brief accept Adds a sample and decides if the component should take it.
+     * @param state Raw state as read from the agent.
+     * @param now Monotonic time in us.
+     * @return True if the state is the filtered state now, false if the sample was suppressed.
+     */
+    bool accept(const int32_t state, const uint64_t now);
+
+    /**
+     * @brief applied Sets the state the component took after an accepted sample, e.g. a diagnosis found a different one.
+     * Further samples are compared to this state; the sample it was taken from keeps being accepted.
+     * @param state State of the component.
+     * @param now Monotonic time in us.
+     */
+    void applied(const int32_t state, const uint64_t now);
+
+    /**
+     * @brief getState Returns the filtered state.
+     * @return State of the component. -1 before the first sample.
+     */
+    inline int32_t getState() const { return state; }
+
+    /**
+     * @brief getSuppressed Returns how many samples were suppressed.
+     * @return Number of samples that differed from the filtered state and were not accepted.
+     */
+    inline uint64_t getSuppressed() const { return suppressed; }
+
+private:
+    uint16_t required; //!< N.
+    uint16_t window; //!< M.
+    uint64_t minDwell; //!< Minimum dwell time in us.
+    std::vector<int32_t> samples; //!< Ring of the last M samples. Sized once so accept does not allocate.
+    size_t next; //!< Ring position of the next sample.
+    size_t count; //!< Number of samples in the ring.
+    int32_t state; //!< Filtered state.
+    int32_t sample; //!< Last accepted sample that changed the state. The state was taken from it.
+    uint64_t since; //!< Time of the last transition in us.
+    uint64_t suppressed; //!< Number of suppressed samples.
+};
+
+#endif // STATEFILTER_H
@@ -0,0 +1,50 @@
+#ifndef SUMMARYEVALUATOR_H
+#define SUMMARYEVALUATOR_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief The SummaryEvaluation struct Result of one pass over packed summary states.
+ */
+struct SummaryEvaluation
+{
+    bool anyNotOk; //!< At least one state is neither OK nor NOT_POSSIBLE. Same rule as value % OK != 0 for valid states.
+    int32_t worstState; //!< Lowest (worst) of all states. END_OF_STATE if there are none.
+    int32_t worstProblem; //!< Lowest of the states that are below OK and not OFF (faults). END_OF_STATE if there are none.
+};
+
+/**
+ * @brief The SummaryEvaluator class Evaluates packed int32_t summary states in one SIMD pass.
+ * The instruction set is selected at compile time: AVX2 if built with -mavx2 (or -march=native), otherwise SSE2
+ * on x86 and a scalar loop everywhere else. All implementations give identical results.
+ */
+class SummaryEvaluator
+{
+public:
+    /**
+     * @brief evaluate Runs any-non-OK detection, worst-state reduction and the OFF-vs-fault mask in one pass.
+     * @param states Summary states, one per device.
+     * @param count Number of states.
+     * @param problemMask Optional output. Set to 1 for states that are below OK and not OFF (need diagnostics), 0 otherwise. Can be NULL.
+     * @return Evaluation of all states.
+     */
+    static SummaryEvaluation evaluate(const int32_t* states, const size_t count, int32_t* problemMask = 0);
+
+    /**
+     * @brief evaluateScalar Reference implementation without SIMD. Used as fallback and for tail elements.
+     * @param states Summary states, one per device.
+     * @param count Number of states.
+     * @param problemMask Optional output, see evaluate. Can be NULL.
+     * @return Evaluation of all states.
+     */
+    static SummaryEvaluation evaluateScalar(const int32_t* states, const size_t count, int32_t* problemMask = 0);
+
+    /**
+     * @brief implementation Returns the name of the compiled-in implementation.
+     * @return "AVX2", "SSE2" or "scalar".
+     */
+    static const char* implementation();
+};
+
+#endif // SUMMARYEVALUATOR_H
@@ -5,36 +5,36 @@
 
 class Transmitter : public RFcomponent
 {
-    static const uint16_t noDiagNodes = 4; //!< Number of nodes to read in order to get full diagnostics done.
     static const int32_t resetValue = 2; //!< Walue to write to trigger reset command.
 public:
     /**
      * @brief Transmitter Transmitter component.
      * @param snmp Connection used for reading.
      * @param snmpW Connection used for writting.
+     * @param topology Transmitter topology. Solaris by default.
      */
-    Transmitter(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW);
+    Transmitter(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology = TransmitterTopology());
     ~Transmitter();
 
     void diagnose(const std::vector<std::string>& summaryValues);
-    void updateReadParameters();
+    SNMPerror tryUpdateReadParameters();
 
     /**
      * @brief reset Resets the transmitter.
      */
-    inline void reset() { snmpW->setValue(oids[OIDS::TRANS_RESET], resetValue); }
+    inline void reset() { snmpW->setValue(resetOid, resetValue); }
 
     /**
      * @brief powerSwitch Power switch for the transmitter.
      * @param value ON or OFF as integer.
      */
-    inline void powerSwitch(const int32_t value) { snmpW->setValue(oids[OIDS::TRANS_ON], value); } /// TODO: Test which value to write for what.
+    inline void powerSwitch(const int32_t value) { snmpW->setValue(powerSwitchOid, value); } /// TODO: Test which value to write for what.
 
     /**
      * @brief setNominalPower Sets the desired nominal power.
      * @param nominalPower Desired nominal power.
      */
-    inline void setNominalPower(const uint32_t nominalPower) { snmpW->setValue(oids[OIDS::NOMINAL_POWER], nominalPower); }
+    inline void setNominalPower(const uint32_t nominalPower) { snmpW->setValue(nominalPowerOid, nominalPower); }
 
     /**
      * @brief getNominalPower Reads the desired nominal power.
@@ -76,6 +76,10 @@ private:
     const std::shared_ptr<SNMPconnector> snmpW; //!< Write connection.
     static const std::string diagRequestName; //!< Name of the SNMP requests for diagnostics.
     static const std::string upadateParamsName; //!< Name of the command to update parameters.
+    const std::string resetOid; //!< OID written to reset the transmitter.
+    const std::string powerSwitchOid; //!< OID of the power switch.
+    const std::string nominalPowerOid; //!< OID of the nominal power.
+    std::vector<std::string> diagNodes; //!< Names of the nodes read for diagnostics.
 
     /// No locks needed for updating and reading component parameters. ///
     std::atomic<uint32_t> nominalPower; //!< Holder for nominal power.
@@ -0,0 +1,264 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include "RFinclude.h"
+#include "rfhistory.h"
+#include "rfmetrics.h"
+#include "snmpudp.h"
+#include "snmpfake.h"
+
+// Python bindings, built with "make python". Everything that talks to the agent releases the GIL, so Python threads
+// can poll different components in parallel. Parameters and histories are NumPy arrays over the C++ buffers.
+
+namespace py = pybind11;
+
+namespace
+{
+    /// Read-only view of the last published parameters. Keeps the component alive, sees every later update.
+    py::array parameterView(py::object self)
+    {
+        const RFcomponent& component = self.cast<const RFcomponent&>();
+        const std::vector<int64_t>& values = component.getParameterValues();
+
+        py::array_t<int64_t> view(values.size(), values.data(), self);
+        view.attr("setflags")(py::arg("write") = false);
+        return view;
+    }
+
+    /// Validity of each parameter. A copy, the flags are atomics.
+    std::vector<bool> parameterValidity(const RFcomponent& component)
+    {
+        std::vector<bool> valid(component.getParameterNames().size());
+        for(size_t i = 0; i < valid.size(); i++)
+        {
+            valid[i] = component.isParameterValid(i);
+        }
+        return valid;
+    }
+
+    /// Structured array of HistoryPoint that owns the queried points without copying them again.
+    py::array historyArray(std::vector<HistoryPoint>* points)
+    {
+        py::capsule owner(points, [](void* data) { delete static_cast<std::vector<HistoryPoint>*>(data); });
+        return py::array_t<HistoryPoint>(points->size(), points->data(), owner);
+    }
+
+    py::tuple queryHistory(RFhistory& history, const std::string& componentName, const std::string& parameterName,
+                           const uint64_t from, const uint64_t to)
+    {
+        std::vector<HistoryPoint>* points = new std::vector<HistoryPoint>();
+        int32_t tier;
+        {
+            py::gil_scoped_release release;
+            tier = history.query(componentName, parameterName, from, to, *points);
+        }
+        return py::make_tuple(tier, historyArray(points));
+    }
+
+    /// One poll cycle of all components with the GIL released once.
+    void cycle(const std::vector<RFcomponent*>& components)
+    {
+        py::gil_scoped_release release;
+        for(size_t i = 0; i < components.size(); i++)
+        {
+            components[i]->updateStateAndStatus();
+            components[i]->tryUpdateReadParameters();
+        }
+    }
+
+    /// Integers are written as INTEGER if they fit, otherwise as Gauge32.
+    void setInteger(SNMPconnector& connector, const std::string& oid, const int64_t value)
+    {
+        if(value < INT32_MIN || value > UINT32_MAX)
+        {
+            throw SNMPconnectorException("Value does not fit into INTEGER or Gauge32.");
+        }
+
+        py::gil_scoped_release release;
+        if(value <= INT32_MAX)
+        {
+            connector.setValue<int32_t>(oid, static_cast<int32_t>(value));
+        }
+        else
+        {
+            connector.setValue<uint32_t>(oid, static_cast<uint32_t>(value));
+        }
+    }
+
+    void setString(SNMPconnector& connector, const std::string& oid, const std::string& value)
+    {
+        py::gil_scoped_release release;
+        connector.setValue<const char*>(oid, value.c_str());
+    }
+}
+
+PYBIND11_MODULE(rftransmitter, m)
+{
+    m.doc() = "SNMP access to RF transmitters.";
+
+    py::register_exception<SNMPconnectorException>(m, "SNMPError");
+    py::register_exception<RfComponentException>(m, "ComponentError");
+    py::register_exception<RfTopologyException>(m, "TopologyError");
+
+    py::enum_<States>(m, "States")
+        .value("NOT_POSSIBLE", NOT_POSSIBLE)
+        .value("UNKNOWN", UNKNOWN)
+        .value("OFF", OFF)
+        .value("FAULT", FAULT)
+        .value("WARNING", WARNING)
+        .value("OK", OK);
+
+    py::enum_<SNMPpriorities>(m, "Priority")
+        .value("STATE", SNMP_PRIORITY_STATE)
+        .value("WRITE", SNMP_PRIORITY_WRITE)
+        .value("PARAMETERS", SNMP_PRIORITY_PARAMETERS)
+        .value("DIAGNOSTICS", SNMP_PRIORITY_DIAGNOSTICS);
+
+    py::enum_<SNMPvarbindStatus>(m, "VarbindStatus")
+        .value("OK", SNMP_VARBIND_OK)
+        .value("NO_SUCH_OBJECT", SNMP_VARBIND_NO_SUCH_OBJECT)
+        .value("NO_SUCH_INSTANCE", SNMP_VARBIND_NO_SUCH_INSTANCE)
+        .value("END_OF_MIB_VIEW", SNMP_VARBIND_END_OF_MIB_VIEW)
+        .value("MISSING", SNMP_VARBIND_MISSING);
+
+    // Transports.
+    py::class_<SNMPtransport, std::shared_ptr<SNMPtransport> >(m, "SNMPtransport");
+
+    py::class_<SNMPudpTransport, SNMPtransport, std::shared_ptr<SNMPudpTransport> >(m, "SNMPudpTransport")
+        .def(py::init<const std::string&, const std::string&, const uint16_t, const uint16_t>(),
+             py::arg("ip"), py::arg("community") = "public", py::arg("port") = 161, py::arg("timeout") = 1000);
+
+    py::class_<SNMPfakeTransport, SNMPtransport, std::shared_ptr<SNMPfakeTransport> >(m, "SNMPfakeTransport")
+        .def(py::init<>())
+        .def("set", &SNMPfakeTransport::set, py::arg("oid"), py::arg("value"), py::arg("syntax") = static_cast<int32_t>(sNMP_SYNTAX_INT))
+        .def("get", &SNMPfakeTransport::get)
+        .def("remove", &SNMPfakeTransport::remove)
+        .def("setOffline", &SNMPfakeTransport::setOffline);
+
+    // Connector.
+    py::class_<SNMPresult>(m, "SNMPresult")
+        .def_readonly("values", &SNMPresult::values)
+        .def_readonly("status", &SNMPresult::status)
+        .def_readonly("invalid", &SNMPresult::invalid)
+        .def_readonly("sentTime", &SNMPresult::sentTime)
+        .def_readonly("receivedTime", &SNMPresult::receivedTime)
+        .def("isValid", &SNMPresult::isValid)
+        .def("roundTrip", &SNMPresult::roundTrip);
+
+    py::class_<SNMPconnector, std::shared_ptr<SNMPconnector> >(m, "SNMPconnector")
+        .def(py::init<const std::string&, const std::string&, const uint16_t, const uint16_t, const uint16_t>(),
+             py::arg("ip"), py::arg("community") = "public", py::arg("port") = 161, py::arg("timeout") = 1000, py::arg("retries") = 1)
+        .def(py::init<const std::shared_ptr<SNMPtransport>&, const uint16_t>(), py::arg("transport"), py::arg("retries") = 1)
+        .def("createRequest", &SNMPconnector::createRequest, py::arg("name"), py::arg("oids"), py::arg("priority") = SNMP_PRIORITY_PARAMETERS)
+        .def("createBulkRequest", &SNMPconnector::createBulkRequest, py::arg("name"), py::arg("oid"), py::arg("elements"),
+             py::arg("priority") = SNMP_PRIORITY_DIAGNOSTICS)
+        .def("removeRequest", &SNMPconnector::removeRequest)
+        .def("readRequest", &SNMPconnector::readRequest, py::arg("name"), py::arg("ignoreSyntaxErrors") = true,
+             py::return_value_policy::copy, py::call_guard<py::gil_scoped_release>())
+        .def("readResult", &SNMPconnector::readResult, py::return_value_policy::copy, py::call_guard<py::gil_scoped_release>())
+        .def("setValue", &setInteger)
+        .def("setValue", &setString)
+        .def("resetStatistics", &SNMPconnector::resetStatistics);
+
+    // Listeners.
+    py::class_<ComponentListener, std::shared_ptr<ComponentListener> >(m, "ComponentListener");
+
+    py::class_<HistoryTier>(m, "HistoryTier")
+        .def(py::init<>())
+        .def_readwrite("resolution", &HistoryTier::resolution)
+        .def_readwrite("points", &HistoryTier::points);
+
+    // Registers the record layout with NumPy, so it has to run while the module is imported.
+    PYBIND11_NUMPY_DTYPE(HistoryPoint, time, min, max, last, mean, samples);
+
+    py::class_<RFhistory, ComponentListener, std::shared_ptr<RFhistory> >(m, "RFhistory")
+        .def(py::init<>())
+        .def(py::init<const std::vector<HistoryTier>&>())
+        .def("query", &queryHistory, py::arg("componentName"), py::arg("parameterName"), py::arg("start"), py::arg("end"),
+             "Returns the tier used and a structured array with time, min, max, last, mean and samples per point.")
+        .def("getTiers", &RFhistory::getTiers);
+
+    py::class_<DerivedMetrics>(m, "DerivedMetrics")
+        .def_readonly("names", &DerivedMetrics::names)
+        .def_readonly("values", &DerivedMetrics::values)
+        .def_readonly("time", &DerivedMetrics::time)
+        .def_readonly("samples", &DerivedMetrics::samples);
+
+    py::class_<RFmetrics, ComponentListener, std::shared_ptr<RFmetrics> >(m, "RFmetrics")
+        .def(py::init<const double>(), py::arg("smoothing") = 0.1)
+        .def("get", &RFmetrics::get)
+        .def("getAll", &RFmetrics::getAll);
+
+    // Components.
+    py::class_<TransmitterTopology>(m, "TransmitterTopology")
+        .def(py::init<>())
+        .def_static("load", &TransmitterTopology::load)
+        .def_static("parse", &TransmitterTopology::parse);
+
+    py::class_<RFcomponent>(m, "RFcomponent")
+        .def("updateStateAndStatus", &RFcomponent::updateStateAndStatus, py::call_guard<py::gil_scoped_release>())
+        .def("updateReadParameters", &RFcomponent::updateReadParameters, py::call_guard<py::gil_scoped_release>())
+        .def("tryUpdateReadParameters", [](RFcomponent& component)
+             {
+                 SNMPerror error;
+                 {
+                     py::gil_scoped_release release;
+                     error = component.tryUpdateReadParameters();
+                 }
+                 return py::make_tuple(error.status, error.message);
+             }, "Returns the SNMP++ status and message, (0, '') on success.")
+        .def("getState", &RFcomponent::getState)
+        .def("getStatus", &RFcomponent::getStatus)
+        .def("getName", &RFcomponent::getName)
+        .def("getDataValid", &RFcomponent::getDataValid)
+        .def("getStateTime", &RFcomponent::getStateTime)
+        .def("getParametersTime", &RFcomponent::getParametersTime)
+        .def("getParameterNames", &RFcomponent::getParameterNames)
+        .def("getParameterValid", &parameterValidity)
+        .def_property_readonly("parameters", &parameterView, "Live read-only view of the parameters. Copy it for a consistent sample.")
+        .def("setStateFilter", &RFcomponent::setStateFilter, py::arg("required"), py::arg("window"), py::arg("minDwell") = 0)
+        .def("addListener", &RFcomponent::addListener)
+        .def("removeListener", &RFcomponent::removeListener);
+
+    py::class_<Transmitter, RFcomponent>(m, "Transmitter")
+        .def(py::init<const std::shared_ptr<SNMPconnector>, const std::shared_ptr<SNMPconnector>, const TransmitterTopology&>(),
+             py::arg("snmp"), py::arg("snmpW"), py::arg("topology") = TransmitterTopology())
+        .def("reset", &Transmitter::reset, py::call_guard<py::gil_scoped_release>())
+        .def("powerSwitch", &Transmitter::powerSwitch, py::call_guard<py::gil_scoped_release>())
+        .def("setNominalPower", &Transmitter::setNominalPower, py::call_guard<py::gil_scoped_release>())
+        .def("getNominalPower", &Transmitter::getNominalPower)
+        .def("getSwitchOn", &Transmitter::getSwitchOn)
+        .def("getForwardPower", &Transmitter::getForwardPower)
+        .def("getReflectedPower", &Transmitter::getReflectedPower)
+        .def("getPaEfficiency", &Transmitter::getPaEfficiency);
+
+    py::class_<Amplifiers, RFcomponent>(m, "Amplifiers")
+        .def(py::init<const TransmitterTopology&, const std::shared_ptr<SNMPconnector> >(), py::arg("topology"), py::arg("snmp"))
+        .def(py::init<const std::vector<uint16_t>&, const std::shared_ptr<SNMPconnector> >(), py::arg("indexList"), py::arg("snmp"))
+        .def("getAmpON", &Amplifiers::getAmpON)
+        .def("getNumberOfAmplifiers", &Amplifiers::getNumberOfAmplifiers);
+
+    py::class_<LiquidCooling, RFcomponent>(m, "LiquidCooling")
+        .def(py::init<const TransmitterTopology&, const std::shared_ptr<SNMPconnector> >(), py::arg("topology"), py::arg("snmp"))
+        .def(py::init<const std::vector<uint16_t>&, const std::shared_ptr<SNMPconnector> >(), py::arg("indexList"), py::arg("snmp"))
+        .def("getNumberOfDevices", &LiquidCooling::getNumberOfDevices);
+
+    py::class_<RFsensor, RFcomponent>(m, "RFsensor")
+        .def(py::init<const std::shared_ptr<SNMPconnector>, const TransmitterTopology&>(), py::arg("snmp"), py::arg("topology") = TransmitterTopology())
+        .def("getForwardSt", &RFsensor::getForwardSt)
+        .def("getReflectedSt", &RFsensor::getReflectedSt);
+
+    py::class_<OutStage, RFcomponent>(m, "OutStage")
+        .def(py::init<const std::shared_ptr<SNMPconnector>, const std::shared_ptr<SNMPconnector>, const TransmitterTopology&>(),
+             py::arg("snmp"), py::arg("snmpW"), py::arg("topology") = TransmitterTopology())
+        .def("setPower", &OutStage::setPower, py::call_guard<py::gil_scoped_release>())
+        .def("getPower", &OutStage::getPower);
+
+    py::class_<MTx, RFcomponent>(m, "MTx")
+        .def(py::init<const std::shared_ptr<SNMPconnector>, const std::shared_ptr<SNMPconnector>, const TransmitterTopology&>(),
+             py::arg("snmp"), py::arg("snmpW"), py::arg("topology") = TransmitterTopology())
+        .def("reset", &MTx::reset, py::call_guard<py::gil_scoped_release>());
+
+    m.def("cycle", &cycle, "Updates state and parameters of all components with the GIL released once.");
+    m.def("wallClock", &RFcomponent::wallClock, "Wall clock time in ns since the epoch, the clock of all timestamps.");
+}
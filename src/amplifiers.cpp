@@ -1,18 +1,53 @@
 #include "amplifiers.h"
+#include "summaryevaluator.h"
 #include <sstream>
 
 const std::string Amplifiers::upadateParamsName = "AMPupdate";
 const std::string Amplifiers::diagRequestName = "rectangle";
 
-Amplifiers::Amplifiers(const std::vector<uint16_t>& indexList, const std::shared_ptr<SNMPconnector> snmp) :
-    RFcomponent(transformToOids(oids[OIDS::AMP_SUMMARY], indexList), "AMPs", snmp)
+namespace
 {
-    if(indexList.size() != noAmplifiers)
+    /// Solaris topology with the given amplifier indices.
+    TransmitterTopology withIndices(const std::vector<uint16_t>& indexList)
     {
-        throw RfComponentException("Incorrect number of amplifier indices provided.");
-    }    
+        TransmitterTopology topology;
+        topology.setIndices(AMPLIFIERS, indexList);
+        return topology;
+    }
+}
+
+Amplifiers::Amplifiers(const std::vector<uint16_t>& indexList, const std::shared_ptr<SNMPconnector> snmp) :
+    RFcomponent(withIndices(indexList), AMPLIFIERS, snmp)
+{
+    init(withIndices(indexList));
+}
+
+Amplifiers::Amplifiers(const TransmitterTopology& topology, const std::shared_ptr<SNMPconnector> snmp) :
+    RFcomponent(topology, AMPLIFIERS, snmp)
+{
+    init(topology);
+}
+
+void Amplifiers::init(const TransmitterTopology& topology)
+{
+    diagNodes = topology.getComponent(AMPLIFIERS).diagNodes;
+    std::vector<std::string> baseOids = topology.getSummaryOids(AMPLIFIERS);
 
-    std::vector<std::string> baseOids = transformToOids(oids[OIDS::AMP_SUMMARY], indexList);
+    // Size all per amplifier buffers once.
+    size_t noAmplifiers = baseOids.size();
+    std::vector<std::atomic<int32_t> >(noAmplifiers).swap(ampOn);
+    parseFailed.resize(noAmplifiers);
+    needsDiagnostics.resize(noAmplifiers);
+
+    // Parameters reported to listeners.
+    std::vector<std::string> names;
+    for(size_t i = 0; i < noAmplifiers; i++)
+    {
+        std::stringstream name;
+        name << "ampOn" << i + 1;
+        names.push_back(name.str());
+    }
+    setParameterNames(names);
 
     // Register diagnose requests. Each amp will have its own request.
     for(size_t i = 0; i < baseOids.size(); i++)
@@ -20,133 +55,150 @@ Amplifiers::Amplifiers(const std::vector<uint16_t>& indexList, const std::shared
         // Create a name.
         std::stringstream name;
         name << diagRequestName << i;
-        snmp->createBulkRequest(name.str(), baseOids[i], noDiagNodes);
+        diagRequestNames.push_back(name.str());
+        snmp->createBulkRequest(diagRequestNames[i], baseOids[i], diagNodes.size());
     }
 
     // Register updateVariables request.
-    snmp->createRequest(upadateParamsName, transformToOids(oids[OIDS::AMP_ON], indexList));
+    snmp->createRequest(upadateParamsName, topology.expand(OIDS::AMP_ON, AMPLIFIERS));
 }
 
 Amplifiers::~Amplifiers()
 {
     snmp->removeRequest(upadateParamsName);
 
-    for(size_t i = 0; i < noAmplifiers; i++)
+    for(size_t i = 0; i < diagRequestNames.size(); i++)
     {
-        std::stringstream name;
-        name << diagRequestName << i;
-        snmp->removeRequest(name.str());
+        snmp->removeRequest(diagRequestNames[i]);
     }
 }
 
 void Amplifiers::diagnose(const std::vector<std::string>& summaryValues)
 {
-    States tempState = States::END_OF_STATE; // Needs to be updated.
-    std::stringstream tempStatus;
+    RF_TRACE_SPAN("diagnose", &componentName);
+
+    if(summaryValues.size() != summaryStates.size())
+    {
+        setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        return;
+    }
+
+    const size_t noAmplifiers = summaryStates.size();
+    statusBuffer.clear();
 
-    for(size_t i = 0; i < summaryValues.size(); i++)
+    // Parse all summaries first. Unparsable ones are reported as UNKNOWN.
+    for(size_t i = 0; i < noAmplifiers; i++)
     {
         try
         {
-            States convertedValue = static_cast<States>(convertToValue<int32_t>(summaryValues[i]));
+            summaryStates[i] = convertToValue<int32_t>(summaryValues[i]);
+            parseFailed[i] = 0;
+        }
+        catch(const SNMPconnectorException&)
+        {
+            summaryStates[i] = States::UNKNOWN;
+            parseFailed[i] = 1;
+        }
+    }
+
+    // One SIMD pass over the packed states. Worst problem state wins (UNKNOWN < FAULT < WARN), OFF amplifiers are masked out.
+    int32_t worstState = SummaryEvaluator::evaluate(summaryStates.data(), noAmplifiers, needsDiagnostics.data()).worstProblem;
+
+    // Detailed status. Only amplifiers with problems are read.
+    for(size_t i = 0; i < noAmplifiers; i++)
+    {
+        if(parseFailed[i])
+        {
+            statusBuffer += '\n';
+            appendNumber(statusBuffer, i + 1);
+            statusBuffer += ": Failed to parse SNMP values.\n";
+        }
+        else if(needsDiagnostics[i])
+        {
+            // Detail is only kept if the whole of it could be built.
+            const size_t detailStart = statusBuffer.size();
 
-            // Check state of component.
-            if(convertedValue < States::OK)
+            try
             {
-                // Problematic component.
+                // Read data.
+                const std::vector<std::string>& values = snmp->readRequest(diagRequestNames[i]);
 
-                // Are we OFF or actual problem?
-                if(convertedValue != States::OFF)
+                if(values.size() != diagNodes.size())
                 {
-                    // Actual problem. We update the state only if it is worse than previous. WARN < FAULT < UNKNOWN
-                    tempState = static_cast<States>(~(tempState <= convertedValue) & convertedValue);
-
-                    // Name of request.
-                    std::stringstream name;
-                    name << diagRequestName << i;
-
-                    // Read data.
-                    std::vector<std::string> values = snmp->readRequest(name.str());
-
-                    if(values.size() != noDiagNodes)
-                    {
-                        throw SNMPconnectorException(dataAcquisitionFailed);
-                    }
-                    // Get detailed status.
-
-                    tempStatus << std::endl << i + 1 << " detailed status: " << std::endl
-                               << "txAmpRfPowerFail: " << StatesText[convertToValue<int32_t>(values[0])] << std::endl
-                               << "txAmpReflection: " << StatesText[convertToValue<int32_t>(values[1])] << std::endl
-                               << "txAmpSupplyFail: " << StatesText[convertToValue<int32_t>(values[2])] << std::endl
-                               << "txAmpRfInFail: " << StatesText[convertToValue<int32_t>(values[3])] << std::endl
-                               << "txAmpMute: " << StatesText[convertToValue<int32_t>(values[4])] << std::endl
-                               << "txAmpTemperatureFail: " << StatesText[convertToValue<int32_t>(values[5])] << std::endl
-                               << "txAmpTransistorFail: " << StatesText[convertToValue<int32_t>(values[6])] << std::endl
-                               << "txAmpRegulationFail: " << StatesText[convertToValue<int32_t>(values[7])] << std::endl
-                               << "txAmpAcFail: " << StatesText[convertToValue<int32_t>(values[8])] << std::endl
-                               << "txAmpDcFail: " << StatesText[convertToValue<int32_t>(values[9])] << std::endl
-                               << "txAmpLink: " << StatesText[convertToValue<int32_t>(values[10])] << std::endl
-                               << "txAmpBiasFail: " << StatesText[convertToValue<int32_t>(values[11])] << std::endl
-                               << "txAmpInitFail: " << StatesText[convertToValue<int32_t>(values[12])] << std::endl
-                               << "txAmpAbsorberFail: " << StatesText[convertToValue<int32_t>(values[13])] << std::endl
-                               << "txAmpOn: " << StatesText[convertToValue<int32_t>(values[14])] << std::endl;
+                    throw SNMPconnectorException(dataAcquisitionFailed);
                 }
-                else
+
+                // Get detailed status.
+                RF_TRACE_SPAN("format status", &componentName);
+                statusBuffer += '\n';
+                appendNumber(statusBuffer, i + 1);
+                statusBuffer += " detailed status: \n";
+                for(size_t j = 0; j < diagNodes.size(); j++)
                 {
-                    // Device is OFF.
-                    tempStatus << i + 1 << ": OFF" << std::endl;
+                    statusBuffer += diagNodes[j];
+                    statusBuffer += ": ";
+                    statusBuffer += StatesText[convertToValue<int32_t>(values[j])];
+                    statusBuffer += '\n';
                 }
             }
-            else
+            catch(const SNMPconnectorException& e)
             {
-                // Device is ON.
-                tempStatus << i + 1 << ": ON" << std::endl;
+                worstState = States::UNKNOWN;
+                statusBuffer.resize(detailStart);
+                statusBuffer += '\n';
+                appendNumber(statusBuffer, i + 1);
+                statusBuffer += ": ";
+                statusBuffer += e.what();
+                statusBuffer += '\n';
             }
         }
-        catch(const SNMPconnectorException& e)
+        else if(summaryStates[i] == States::OFF)
+        {
+            // Device is OFF.
+            appendNumber(statusBuffer, i + 1);
+            statusBuffer += ": OFF\n";
+        }
+        else
         {
-            tempState = States::UNKNOWN;
-            tempStatus << std::endl << i + 1 << ": " << e.what() << std::endl;
+            // Device is ON.
+            appendNumber(statusBuffer, i + 1);
+            statusBuffer += ": ON\n";
         }
     }
+
     // In case state is still at END it means the worst state is OFF.
-    if(tempState == States::END_OF_STATE)
+    if(worstState == States::END_OF_STATE)
     {
-        tempState = States::OFF;
+        worstState = States::OFF;
     }
 
     // Update status and state.
-    setStateAndStatus(tempState, tempStatus.str());
+    setStateAndStatus(static_cast<States>(worstState), statusBuffer);
 }
 
-void Amplifiers::updateReadParameters()
+SNMPerror Amplifiers::tryUpdateReadParameters()
 {
-    try
-    {
-        std::vector<std::string> values = snmp->readRequest(upadateParamsName);
-
-        if(values.size() != ampOn.size())
-        {
-            throw SNMPconnectorException(dataAcquisitionFailed);
-        }
+    RF_TRACE_SPAN("updateReadParameters", &componentName);
 
-        // Convert to appropriate type and update.
-        for(size_t i = 0; i < values.size(); i++)
-        {
-            ampOn[i] = convertToValue<int32_t>(values[i]);
-        }
-        dataValid = true;
+    // One missing amplifier does not blank out the others.
+    SNMPerror error = readParameters<int32_t>(upadateParamsName);
+    if(error.failed())
+    {
+        return error;
     }
-    catch(const SNMPconnectorException& e)
+
+    // Publish.
+    for(size_t i = 0; i < ampOn.size(); i++)
     {
-        dataValid = false;
-        throw e;
+        ampOn[i].store(static_cast<int32_t>(parameterValues[i]), std::memory_order_relaxed);
     }
+    notifyParameters();
+    return error;
 }
 
 bool Amplifiers::getAmpON(const uint16_t index)
 {
-    if(index >= noAmplifiers)
+    if(index >= ampOn.size())
     {
         throw RfComponentException("Not that many amplifiers in the system.");
     }
@@ -1,116 +1,173 @@
 #include "liquidcooling.h"
+#include "summaryevaluator.h"
 #include <sstream>
 
+namespace
+{
+    /// Solaris topology with the given liquid cooling indices.
+    TransmitterTopology withIndices(const std::vector<uint16_t>& indexList)
+    {
+        TransmitterTopology topology;
+        topology.setIndices(LIQUID_COOLING, indexList);
+        return topology;
+    }
+}
+
 LiquidCooling::LiquidCooling(const std::vector<uint16_t>& indexList, const std::shared_ptr<SNMPconnector> snmp)
-    : RFcomponent(transformToOids(oids[OIDS::LQC_SUMMARY], indexList), "LiquidCooling", snmp)
+    : RFcomponent(withIndices(indexList), LIQUID_COOLING, snmp)
 {
-    std::vector<std::string> nodes = transformToOids(oids[OIDS::LQC_SUMMARY], indexList);
+    init(withIndices(indexList));
+}
 
+LiquidCooling::LiquidCooling(const TransmitterTopology& topology, const std::shared_ptr<SNMPconnector> snmp)
+    : RFcomponent(topology, LIQUID_COOLING, snmp)
+{
+    init(topology);
+}
+
+void LiquidCooling::init(const TransmitterTopology& topology)
+{
+    std::vector<std::string> nodes = topology.getSummaryOids(LIQUID_COOLING);
+
+    diagNodes = topology.getComponent(LIQUID_COOLING).diagNodes;
     upadateParamsName = "LQupdate";
-    diagRequestName[0] = "LQdiag1";
-    diagRequestName[1] = "LQdiag2";
-    // Create diag request. There are 2 since we have 2 LQs in the system.
-    snmp->createBulkRequest(diagRequestName[0], nodes.at(0), noDiagNodes);
-    snmp->createBulkRequest(diagRequestName[1], nodes.at(1), noDiagNodes);
 
-    // Register updateVariables request.
-    // Create a vector with all oids.
-    std::vector<std::string> nodesIn = transformToOids(oids[OIDS::LQ_TIN], indexList);
-    std::vector<std::string> nodesOut = transformToOids(oids[OIDS::LQ_TOUT], indexList);
-    std::vector<std::string> variablesOids;
+    // Size all per device buffers once.
+    size_t noDevices = nodes.size();
+    std::vector<std::atomic<int32_t> >(noDevices).swap(inTemp);
+    std::vector<std::atomic<int32_t> >(noDevices).swap(outTemp);
+    states.resize(noDevices);
+
+    // Parameters reported to listeners. Same layout as the update request.
+    std::vector<std::string> names;
+    for(size_t i = 0; i < 2 * noDevices; i++)
+    {
+        std::stringstream name;
+        name << ((i < noDevices) ? "inTemp" : "outTemp") << i % noDevices + 1;
+        names.push_back(name.str());
+    }
+    setParameterNames(names);
 
-    variablesOids.push_back(nodesIn.at(0));
-    variablesOids.push_back(nodesIn.at(1));
-    variablesOids.push_back(nodesOut.at(0));
-    variablesOids.push_back(nodesOut.at(1));
+    // Create diag request for each LQ in the system.
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        std::stringstream name;
+        name << "LQdiag" << i + 1;
+        diagRequestName.push_back(name.str());
+        snmp->createBulkRequest(diagRequestName[i], nodes[i], diagNodes.size());
+    }
+
+    // Register updateVariables request.
+    // Create a vector with all oids. First all inlet then all outlet temperatures.
+    std::vector<std::string> variablesOids = topology.expand(OIDS::LQ_TIN, LIQUID_COOLING);
+    std::vector<std::string> nodesOut = topology.expand(OIDS::LQ_TOUT, LIQUID_COOLING);
+    variablesOids.insert(variablesOids.end(), nodesOut.begin(), nodesOut.end());
 
     snmp->createRequest(upadateParamsName, variablesOids);
 }
 
 LiquidCooling::~LiquidCooling()
 {
-    snmp->removeRequest(diagRequestName[0]);
-    snmp->removeRequest(diagRequestName[1]);
+    for(size_t i = 0; i < diagRequestName.size(); i++)
+    {
+        snmp->removeRequest(diagRequestName[i]);
+    }
     snmp->removeRequest(upadateParamsName);
 }
 
 void LiquidCooling::diagnose(const std::vector<std::string>& summaryValues)
 {
-    std::array<int32_t, 2> states;
+    RF_TRACE_SPAN("diagnose", &componentName);
 
-    try
+    if(summaryValues.size() != states.size())
     {
-        states[0] = convertToValue<int32_t>(summaryValues[0]);
-	states[1] = convertToValue<int32_t>(summaryValues[1]);
-    }
-    catch(const SNMPconnectorException& e)
-    {
-        setStateAndStatus(States::UNKNOWN, e.what());
+        setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        return;
     }
 
     // Create status msg.
-    std::stringstream statusMsg;
+    statusBuffer.clear();
     for(size_t i = 0; i < states.size(); i++)
     {
-        statusMsg << std::endl << i;
+        statusBuffer += '\n';
+        appendNumber(statusBuffer, i);
+
+        try
+        {
+            states[i] = convertToValue<int32_t>(summaryValues[i]);
+        }
+        catch(const SNMPconnectorException& e)
+        {
+            states[i] = static_cast<int32_t>(States::UNKNOWN);
+            statusBuffer += " :";
+            statusBuffer += e.what();
+            statusBuffer += '\n';
+            continue;
+        }
 
         if(static_cast<States>(states[i]) != States::OK)
         {
             try
             {
-                std::vector<std::string> values = snmp->readRequest(diagRequestName[i]);
-                if(values.size() != noDiagNodes)
+                const std::vector<std::string>& values = snmp->readRequest(diagRequestName[i]);
+                if(values.size() != diagNodes.size())
                 {
                     throw SNMPconnectorException(dataAcquisitionFailed);
                 }
 
-                statusMsg << " detailed status: " << std::endl
-                          << "lqFilterSummary: " << StatesText[convertToValue<int32_t>(values[0])] << std::endl
-                          << "lqSensorsSummary: " << StatesText[convertToValue<int32_t>(values[1])] << std::endl
-                          << "lqSiteWarning: " << StatesText[convertToValue<int32_t>(values[2])] << std::endl
-                          << "lqSiteFault: " << StatesText[convertToValue<int32_t>(values[3])] << std::endl;
+                {
+                    RF_TRACE_SPAN("format status", &componentName);
+                    statusBuffer += " detailed status: \n";
+                    for(size_t j = 0; j < diagNodes.size(); j++)
+                    {
+                        statusBuffer += diagNodes[j];
+                        statusBuffer += ": ";
+                        statusBuffer += StatesText[convertToValue<int32_t>(values[j])];
+                        statusBuffer += '\n';
+                    }
+                }
 
             }
             catch(const SNMPconnectorException& e)
             {
                 states[i] = static_cast<int32_t>(States::UNKNOWN);
-                statusMsg << " :" << e.what() << std::endl;
+                statusBuffer += " :";
+                statusBuffer += e.what();
+                statusBuffer += '\n';
             }
         }
         else
         {
-            statusMsg << ": OK" << std::endl;
+            statusBuffer += ": OK\n";
         }
     }
 
     /// TODO: Check this at actual hardware.
-    int32_t stateValue = (states[0] <= states[1]) ? states[0] : states[1]; // Always chose the lowest state (worse).
+    // Always chose the lowest state (worse).
+    int32_t stateValue = SummaryEvaluator::evaluate(states.data(), states.size()).worstState;
 
     // Update status and state.
-    setStateAndStatus(static_cast<States>(stateValue), statusMsg.str());
+    setStateAndStatus(static_cast<States>(stateValue), statusBuffer);
 }
 
-void LiquidCooling::updateReadParameters()
+SNMPerror LiquidCooling::tryUpdateReadParameters()
 {
-    try
-    {
-        std::vector<std::string> values = snmp->readRequest(upadateParamsName);
-
-        if(values.size() != inTemp.size() + outTemp.size())
-        {
-            throw SNMPconnectorException(dataAcquisitionFailed);
-        }
+    RF_TRACE_SPAN("updateReadParameters", &componentName);
 
-        for(size_t i = 0; i < values.size()/2; i++)
-        {
-            inTemp[i] = convertToValue<int32_t>(values[i]);
-            outTemp[i] = convertToValue<int32_t>(values[i+2]);
-        }
-        dataValid = true;
+    // One missing sensor only invalidates its own temperature.
+    SNMPerror error = readParameters<int32_t>(upadateParamsName);
+    if(error.failed())
+    {
+        return error;
     }
-    catch(const SNMPconnectorException& e)
+
+    // Publish. First half are inlet, second half outlet temperatures.
+    const size_t noDevices = inTemp.size();
+    for(size_t i = 0; i < noDevices; i++)
     {
-        dataValid = false;
-        throw e;
+        inTemp[i].store(static_cast<int32_t>(parameterValues[i]), std::memory_order_relaxed);
+        outTemp[i].store(static_cast<int32_t>(parameterValues[i + noDevices]), std::memory_order_relaxed);
     }
+    notifyParameters();
+    return error;
 }
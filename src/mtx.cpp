@@ -1,7 +1,7 @@
 #include "mtx.h"
 
-MTx::MTx(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW)
-    : RFcomponent(oids[OIDS::MTX_SUMMARY], "MTx", snmp), snmpW(snmpW)
+MTx::MTx(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology)
+    : RFcomponent(topology, MTX, snmp), snmpW(snmpW), resetOid(topology.getOid(OIDS::MTX_RESET))
 {}
 
 void MTx::diagnose(const std::vector<std::string>& summaryValues)
@@ -11,20 +11,42 @@ void MTx::diagnose(const std::vector<std::string>& summaryValues)
 
 void MTx::updateStateAndStatus()
 {    
+    RF_TRACE_SPAN("updateStateAndStatus", &componentName);
+
+    // An unreachable agent is reported without exceptions.
+    SNMPexpected<SNMPresult> read = readState();
+    if(!read.hasValue())
+    {
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, read.getError().message);
+        }
+        return;
+    }
+
     try
     {
-        std::vector<std::string> values = snmp->readRequest(componentName);
+        const std::vector<std::string>& values = read.value().values;
         int32_t statesValue = convertToValue<int32_t>(values.at(0));
 
         // Update the state accordingly.
-        setStateAndStatus(static_cast<States>(statesValue), StatesText[statesValue]);
+        if(filterState(static_cast<States>(statesValue)))
+        {
+            setStateAndStatus(static_cast<States>(statesValue), StatesText[statesValue]);
+        }
     }
     catch(const SNMPconnectorException& e)
     {
-        setStateAndStatus(States::UNKNOWN, e.what());
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, e.what());
+        }
     }
     catch(const std::out_of_range&)
     {
-        setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        }
     }
 }
@@ -2,15 +2,17 @@
 
 const std::string OutStage::upadateParamsName = "OSupdate";
 
-OutStage::OutStage(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW)
-    : RFcomponent(oids[OIDS::OSTAGE_SUMMARY], "OutStage", snmp), snmpW(snmpW)
+OutStage::OutStage(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology)
+    : RFcomponent(topology, OUT_STAGE, snmp), snmpW(snmpW), powerOid(topology.getOid(OIDS::OUT_POWER))
 {
     // Register updateParams request.
     std::vector<std::string> oid;
-    oid.push_back(oids[OIDS::OUT_POWER]);
+    oid.push_back(powerOid);
     snmpW->createRequest(upadateParamsName, oid); // Only for writing.
     snmp->createRequest(upadateParamsName, oid); // Only for reading by thread.
     power = 0;
+
+    setParameterNames(std::vector<std::string>(1, "power"));
 }
 
 OutStage::~OutStage()
@@ -19,47 +21,63 @@ OutStage::~OutStage()
     snmp->removeRequest(upadateParamsName);
 }
 
-void OutStage::updateReadParameters()
-{    
-    try
-    {
-        std::vector<std::string> values = snmp->readRequest(upadateParamsName);
+SNMPerror OutStage::tryUpdateReadParameters()
+{
+    RF_TRACE_SPAN("updateReadParameters", &componentName);
 
-        // Atomic assigment.
-        power = convertToValue<uint32_t>(values.at(0));
-        dataValid = true;
-    }
-    catch(const std::out_of_range&)
+    SNMPerror error = readParameters<uint32_t>(upadateParamsName);
+    if(error.failed())
     {
-        dataValid = false;
-        throw SNMPconnectorException(dataAcquisitionFailed);
-    }
-    catch(const SNMPconnectorException& e)
-    {
-        dataValid = false;
-        throw e;
+        return error;
     }
+
+    // Atomic assigment.
+    power = parameterValues[0];
+    notifyParameters();
+    return error;
 }
 
 void OutStage::updateStateAndStatus()
 {    
+    RF_TRACE_SPAN("updateStateAndStatus", &componentName);
+
+    // An unreachable agent is reported without exceptions.
+    SNMPexpected<SNMPresult> read = readState();
+    if(!read.hasValue())
+    {
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, read.getError().message);
+        }
+        return;
+    }
+
     try
     {
-        std::vector<std::string> values = snmp->readRequest(componentName);
+        const std::vector<std::string>& values = read.value().values;
 
         // Convert value to int.
         int32_t stateValue = convertToValue<int32_t>(values.at(0));
 
         // Update the state accordingly.
-        setStateAndStatus(static_cast<States>(stateValue), StatesText[stateValue]);
+        if(filterState(static_cast<States>(stateValue)))
+        {
+            setStateAndStatus(static_cast<States>(stateValue), StatesText[stateValue]);
+        }
     }
     catch(const std::out_of_range&)
     {
-        setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, dataAcquisitionFailed);
+        }
     }
     catch(const SNMPconnectorException& e)
     {
-        setStateAndStatus(States::UNKNOWN, e.what());
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, e.what());
+        }
     }
 
 }
@@ -1,5 +1,8 @@
 #include "rfcomponent.h"
+#include "summaryevaluator.h"
 #include <sstream>
+#include <algorithm>
+#include <time.h>
 
 RFcomponent::RFcomponent(const std::vector<std::string>& summaryNodes, const std::string& componentName, const std::shared_ptr<SNMPconnector> snmp)
     : componentName(componentName), snmp(snmp)
@@ -9,22 +12,51 @@ RFcomponent::RFcomponent(const std::vector<std::string>& summaryNodes, const std
         throw RfComponentException("No summary nodes provided for component: " + componentName);
     }
 
-    snmp->createRequest(componentName, summaryNodes);
+    snmp->createRequest(componentName, summaryNodes, SNMP_PRIORITY_STATE);
     numberOfSummaries = summaryNodes.size();
+    summaryStates.resize(numberOfSummaries);
 
     // Initialize values
     state = States::UNKNOWN;
+    hasListeners = false;
+    listenerFailures = 0;
     dataValid = false;
+    stateTime = 0;
+    parametersTime = 0;
 }
 
 RFcomponent::RFcomponent(const std::string& summaryNode, const std::string& componentName, const std::shared_ptr<SNMPconnector> snmp)
     : componentName(componentName), snmp(snmp)
 {
-    snmp->createRequest(componentName, std::vector<std::string>(1, summaryNode));
+    snmp->createRequest(componentName, std::vector<std::string>(1, summaryNode), SNMP_PRIORITY_STATE);
     numberOfSummaries = 1;
+    summaryStates.resize(numberOfSummaries);
 
     // Initialize values
     state = States::UNKNOWN;
+    hasListeners = false;
+    listenerFailures = 0;
+    dataValid = false;
+    stateTime = 0;
+    parametersTime = 0;
+}
+
+RFcomponent::RFcomponent(const TransmitterTopology& topology, const ComponentTypes type, const std::shared_ptr<SNMPconnector> snmp)
+    : componentName(topology.getComponent(type).name), snmp(snmp)
+{
+    std::vector<std::string> summaryNodes = topology.getSummaryOids(type);
+
+    snmp->createRequest(componentName, summaryNodes, SNMP_PRIORITY_STATE);
+    numberOfSummaries = summaryNodes.size();
+    summaryStates.resize(numberOfSummaries);
+
+    // Initialize values
+    state = States::UNKNOWN;
+    hasListeners = false;
+    listenerFailures = 0;
+    dataValid = false;
+    stateTime = 0;
+    parametersTime = 0;
 }
 
 RFcomponent::~RFcomponent()
@@ -34,27 +66,47 @@ RFcomponent::~RFcomponent()
 
 void RFcomponent::updateStateAndStatus()
 {
+    RF_TRACE_SPAN("updateStateAndStatus", &componentName);
+
+    // An unreachable agent is reported without exceptions, it is polled every cycle.
+    SNMPexpected<SNMPresult> read = readState();
+    if(!read.hasValue())
+    {
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, read.getError().message);
+        }
+        return;
+    }
+
     try
     {
-        std::vector<std::string> values = snmp->readRequest(componentName);
+        const SNMPresult& result = read.value();
 
-        if(values.size() != numberOfSummaries)
+        if(result.values.size() != numberOfSummaries)
         {
             throw SNMPconnectorException(dataAcquisitionFailed);
         }
 
-        // Check for errors.
-        for(size_t i = 0; i < values.size(); i++)
+        // Convert values to int. A summary the agent did not return only makes its own device UNKNOWN.
+        for(size_t i = 0; i < result.values.size(); i++)
         {
-            // Convert value to uint.
-            int32_t value = convertToValue<int32_t>(values[i]);
+            summaryStates[i] = result.isValid(i) ? convertToValue<int32_t>(result.values[i]) : static_cast<int32_t>(States::UNKNOWN);
+        }
 
-            // At least one component is bad.
-            if(value % States::OK != 0)
-            {
-                diagnose(values); // Do more deep investigation.
-                return; // Diagnose is in charge of state and status in this case.
-            }
+        SummaryEvaluation evaluation = SummaryEvaluator::evaluate(summaryStates.data(), summaryStates.size());
+
+        // Glitches are dropped before they cost a diagnosis.
+        if(!filterState(evaluation.anyNotOk ? static_cast<States>(evaluation.worstState) : States::OK))
+        {
+            return;
+        }
+
+        // At least one component is bad.
+        if(evaluation.anyNotOk)
+        {
+            diagnose(result.values); // Do more deep investigation.
+            return; // Diagnose is in charge of state and status in this case.
         }
 
         // If we get here everything is fine.
@@ -64,15 +116,159 @@ void RFcomponent::updateStateAndStatus()
     catch(const SNMPconnectorException& e)
     {
         // Problem with SNMP.
-        setStateAndStatus(States::UNKNOWN, e.what());
+        if(filterState(States::UNKNOWN))
+        {
+            setStateAndStatus(States::UNKNOWN, e.what());
+        }
     }
 }
 
-void RFcomponent::setStateAndStatus(const States newState, const std::string& newStatus)
+SNMPexpected<SNMPresult> RFcomponent::readState()
+{
+    SNMPexpected<SNMPresult> read = snmp->tryReadResult(componentName);
+    stateTime.store(read.hasValue() ? read.value().receivedTime : 0, std::memory_order_relaxed);
+    return read;
+}
+
+bool RFcomponent::filterState(const States newState)
+{
+    uint64_t now = monotonicMicroseconds();
+
+    std::unique_lock<std::mutex> l(lock);
+    return stateFilter.accept(newState, now);
+}
+
+void RFcomponent::setStateFilter(const uint16_t required, const uint16_t window, const uint32_t minDwell)
+{
+    std::unique_lock<std::mutex> l(lock);
+    if(!stateFilter.configure(required, window, minDwell))
+    {
+        throw RfComponentException("Invalid state filter. Required 0 < N <= M <= 32.");
+    }
+}
+
+uint64_t RFcomponent::getSuppressedTransitions()
 {
     std::unique_lock<std::mutex> l(lock);
-    state = newState;
-    status = componentName + ": " + newStatus + "\n";
+    return stateFilter.getSuppressed();
+}
+
+void RFcomponent::updateReadParameters()
+{
+    SNMPerror error = tryUpdateReadParameters();
+    if(error.failed())
+    {
+        throw SNMPconnectorException(error.message);
+    }
+}
+
+void RFcomponent::setStateAndStatus(const States newState, const std::string& newStatus)
+{
+    setStateAndStatus(newState, newStatus.c_str());
+}
+
+void RFcomponent::setStateAndStatus(const States newState, const char* newStatus)
+{
+    RF_TRACE_SPAN("setStateAndStatus", &componentName);
+
+    uint64_t now = monotonicMicroseconds();
+    States oldState;
+    {
+        std::unique_lock<std::mutex> l(lock, std::defer_lock);
+        {
+            RF_TRACE_SPAN("lock wait", &componentName);
+            l.lock();
+        }
+        oldState = state;
+        state = newState;
+        // Diagnose may take another state than the summaries showed, later reads are filtered against this one.
+        stateFilter.applied(newState, now);
+        // Assigned in place so the status keeps its capacity.
+        status.assign(componentName);
+        status += ": ";
+        status += newStatus;
+        status += '\n';
+    }
+
+    // Report transitions outside of the state lock.
+    if(oldState != newState && hasListeners.load(std::memory_order_acquire))
+    {
+        uint64_t time = stateTime.load(std::memory_order_relaxed);
+        if(time == 0)
+        {
+            time = wallClock();
+        }
+        const std::string reported(newStatus);
+        std::unique_lock<std::mutex> l(listenersLock);
+        for(size_t i = 0; i < listeners.size(); i++)
+        {
+            // A failing listener must neither break the exception-free polling nor starve the others.
+            try
+            {
+                listeners[i]->stateChanged(*this, time, oldState, newState, reported);
+            }
+            catch(const std::exception&)
+            {
+                listenerFailures++;
+            }
+        }
+    }
+}
+
+void RFcomponent::setParameterNames(const std::vector<std::string>& names)
+{
+    parameterNames = names;
+    parameterValues.assign(names.size(), 0);
+    std::vector<std::atomic<bool> >(names.size()).swap(parameterValid);
+    for(size_t i = 0; i < parameterValid.size(); i++)
+    {
+        parameterValid[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+void RFcomponent::notifyParameters()
+{
+    if(!hasListeners.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    uint64_t time = parametersTime.load(std::memory_order_relaxed);
+    if(time == 0)
+    {
+        time = wallClock();
+    }
+    std::unique_lock<std::mutex> l(listenersLock);
+    for(size_t i = 0; i < listeners.size(); i++)
+    {
+        try
+        {
+            listeners[i]->parametersUpdated(*this, time, parameterValues);
+        }
+        catch(const std::exception&)
+        {
+            listenerFailures++;
+        }
+    }
+}
+
+void RFcomponent::addListener(const std::shared_ptr<ComponentListener>& listener)
+{
+    std::unique_lock<std::mutex> l(listenersLock);
+    listeners.push_back(listener);
+    hasListeners.store(true, std::memory_order_release);
+}
+
+void RFcomponent::removeListener(const std::shared_ptr<ComponentListener>& listener)
+{
+    std::unique_lock<std::mutex> l(listenersLock);
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+    hasListeners.store(!listeners.empty(), std::memory_order_release);
+}
+
+uint64_t RFcomponent::wallClock()
+{
+    return wallClockNanoseconds();
 }
 
 std::vector<std::string> RFcomponent::transformToOids(const std::string& baseOid, const std::vector<uint16_t>& indexList)
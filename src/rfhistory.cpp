@@ -0,0 +1,254 @@
+#include "rfhistory.h"
+
+namespace
+{
+    const uint64_t second = 1000000000ull; //!< 1 s in ns.
+
+    /// 1 s for an hour, 1 min for a day, 1 h for 30 days. A bit more each, so the last hour or day fits into its tier.
+    std::vector<HistoryTier> defaultTiers()
+    {
+        HistoryTier tiers[] = { { second, 3660 }, { 60 * second, 1500 }, { 3600 * second, 744 } };
+        return std::vector<HistoryTier>(tiers, tiers + sizeof(tiers) / sizeof(tiers[0]));
+    }
+}
+
+RFhistory::RFhistory() : tiers(defaultTiers())
+{
+}
+
+RFhistory::RFhistory(const std::vector<HistoryTier>& tiers) : tiers(tiers)
+{
+    if(tiers.empty())
+    {
+        throw RfComponentException("At least one history tier is needed.");
+    }
+
+    for(size_t i = 0; i < tiers.size(); i++)
+    {
+        if(tiers[i].resolution == 0 || tiers[i].points == 0)
+        {
+            throw RfComponentException("History tiers need a resolution and at least one point.");
+        }
+        if(i > 0 && tiers[i].resolution <= tiers[i - 1].resolution)
+        {
+            throw RfComponentException("History tiers must go from the finest to the coarsest resolution.");
+        }
+    }
+}
+
+void RFhistory::parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    Series& current = getSeries(component);
+    const size_t parameters = current.parameterNames.size();
+    if(values.size() != parameters)
+    {
+        return;
+    }
+
+    for(size_t t = 0; t < tiers.size(); t++)
+    {
+        Ring& ring = current.rings[t];
+        const uint64_t start = time - time % tiers[t].resolution;
+        const size_t slot = (time / tiers[t].resolution) % tiers[t].points;
+
+        if(ring.starts[slot] != start)
+        {
+            // A sample older than what the slot holds already fell out of this tier.
+            if(start < ring.starts[slot])
+            {
+                continue;
+            }
+
+            ring.starts[slot] = start;
+            for(size_t p = 0; p < parameters; p++)
+            {
+                ring.rollups[slot * parameters + p].samples = 0;
+            }
+        }
+
+        Rollup* rollups = &ring.rollups[slot * parameters];
+        for(size_t p = 0; p < parameters; p++)
+        {
+            // Invalid parameters are not sampled, so they do not add to the rollup of the slot.
+            if(!component.isParameterValid(p))
+            {
+                continue;
+            }
+
+            Rollup& rollup = rollups[p];
+            const int64_t value = values[p];
+            if(rollup.samples == 0)
+            {
+                rollup.min = value;
+                rollup.max = value;
+                rollup.sum = 0.0;
+            }
+            else
+            {
+                rollup.min = (value < rollup.min) ? value : rollup.min;
+                rollup.max = (value > rollup.max) ? value : rollup.max;
+            }
+            rollup.sum += static_cast<double>(value);
+            rollup.last = value;
+            rollup.samples++;
+        }
+    }
+
+    if(time > current.latest)
+    {
+        current.latest = time;
+    }
+}
+
+void RFhistory::stateChanged(const RFcomponent&, const uint64_t, const States, const States, const std::string&)
+{
+    // Only parameters are kept.
+}
+
+int32_t RFhistory::query(const std::string& componentName, const std::string& parameterName, const uint64_t from, const uint64_t to,
+                         std::vector<HistoryPoint>& points)
+{
+    points.clear();
+    std::unique_lock<std::mutex> l(lock);
+
+    size_t parameter;
+    const Series* found = findSeries(componentName, parameterName, parameter);
+    if(found == 0)
+    {
+        return -1;
+    }
+
+    // The finest tier whose ring still holds the interval with the start of the range, otherwise the coarsest.
+    size_t tier = tiers.size() - 1;
+    for(size_t t = 0; t < tiers.size(); t++)
+    {
+        const uint64_t resolution = tiers[t].resolution;
+        const uint64_t span = resolution * (tiers[t].points - 1);
+        if(from - from % resolution + span >= found->latest - found->latest % resolution)
+        {
+            tier = t;
+            break;
+        }
+    }
+
+    copyPoints(*found, parameter, tier, from, to, points);
+    return static_cast<int32_t>(tier);
+}
+
+bool RFhistory::query(const std::string& componentName, const std::string& parameterName, const size_t tier, const uint64_t from,
+                      const uint64_t to, std::vector<HistoryPoint>& points)
+{
+    points.clear();
+    if(tier >= tiers.size())
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> l(lock);
+
+    size_t parameter;
+    const Series* found = findSeries(componentName, parameterName, parameter);
+    if(found == 0)
+    {
+        return false;
+    }
+
+    copyPoints(*found, parameter, tier, from, to, points);
+    return true;
+}
+
+RFhistory::Series& RFhistory::getSeries(const RFcomponent& component)
+{
+    Series& current = series[&component];
+
+    // A component destroyed and another created at the same address starts over.
+    if(current.componentName == component.getName() && current.parameterNames == component.getParameterNames())
+    {
+        return current;
+    }
+
+    current.componentName = component.getName();
+    current.parameterNames = component.getParameterNames();
+    current.latest = 0;
+    current.rings.resize(tiers.size());
+
+    Rollup empty = { 0, 0, 0, 0.0, 0 };
+    for(size_t t = 0; t < tiers.size(); t++)
+    {
+        current.rings[t].starts.assign(tiers[t].points, 0);
+        current.rings[t].rollups.assign(static_cast<size_t>(tiers[t].points) * current.parameterNames.size(), empty);
+    }
+
+    return current;
+}
+
+const RFhistory::Series* RFhistory::findSeries(const std::string& componentName, const std::string& parameterName, size_t& parameter) const
+{
+    for(std::unordered_map<const RFcomponent*, Series>::const_iterator it = series.begin(); it != series.end(); ++it)
+    {
+        if(it->second.componentName != componentName)
+        {
+            continue;
+        }
+
+        const std::vector<std::string>& names = it->second.parameterNames;
+        for(size_t i = 0; i < names.size(); i++)
+        {
+            if(names[i] == parameterName)
+            {
+                parameter = i;
+                return &it->second;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void RFhistory::copyPoints(const Series& found, const size_t parameter, const size_t tier, const uint64_t from, const uint64_t to,
+                           std::vector<HistoryPoint>& points) const
+{
+    const uint64_t resolution = tiers[tier].resolution;
+    const uint32_t slots = tiers[tier].points;
+    const Ring& ring = found.rings[tier];
+    const size_t parameters = found.parameterNames.size();
+
+    if(to < from)
+    {
+        return;
+    }
+
+    // Never more intervals than the ring holds, counted back from the newest sample.
+    const uint64_t end = (to < found.latest) ? to : found.latest;
+    uint64_t first = from - from % resolution;
+    const uint64_t last = end - end % resolution;
+    if(last < first)
+    {
+        return;
+    }
+    if(last - first >= resolution * slots)
+    {
+        first = last - resolution * (slots - 1);
+    }
+
+    for(uint64_t start = first; start <= last; start += resolution)
+    {
+        const size_t slot = (start / resolution) % slots;
+        const Rollup& rollup = ring.rollups[slot * parameters + parameter];
+        if(ring.starts[slot] != start || rollup.samples == 0)
+        {
+            continue;
+        }
+
+        HistoryPoint point;
+        point.time = start;
+        point.min = rollup.min;
+        point.max = rollup.max;
+        point.last = rollup.last;
+        point.mean = rollup.sum / rollup.samples;
+        point.samples = rollup.samples;
+        points.push_back(point);
+    }
+}
@@ -0,0 +1,198 @@
+#include "rfmetrics.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+    /// Index of the parameter with the given name, -1 if there is none.
+    int32_t findParameter(const std::vector<std::string>& names, const std::string& name)
+    {
+        for(size_t i = 0; i < names.size(); i++)
+        {
+            if(names[i] == name)
+            {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    const double undefined = std::numeric_limits<double>::quiet_NaN(); //!< Value of metrics that cannot be derived.
+}
+
+RFmetrics::RFmetrics(const double smoothing) : smoothing(smoothing)
+{
+    if(!(smoothing > 0.0 && smoothing <= 1.0))
+    {
+        throw RfComponentException("EWMA smoothing must be in (0, 1].");
+    }
+}
+
+void RFmetrics::parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    Stage& stage = getStage(component);
+    std::vector<double>& metrics = stage.metrics.values;
+    if(metrics.empty() || values.size() != component.getParameterNames().size())
+    {
+        return;
+    }
+
+    size_t next = 0;
+
+    // Metrics with an invalid input are NaN, EWMAs keep their value until the input is valid again.
+    if(stage.forward >= 0 && stage.reflected >= 0)
+    {
+        const bool forwardValid = component.isParameterValid(stage.forward);
+        const bool reflectedValid = component.isParameterValid(stage.reflected);
+        const double forward = static_cast<double>(values[stage.forward]);
+        const double reflected = static_cast<double>(values[stage.reflected]);
+
+        // Without forward power there is nothing to reflect.
+        double gamma = (forwardValid && reflectedValid && forward > 0.0 && reflected >= 0.0) ? std::sqrt(reflected / forward) : undefined;
+        metrics[next++] = gamma;
+        metrics[next++] = (gamma >= 1.0) ? std::numeric_limits<double>::infinity() : (1.0 + gamma) / (1.0 - gamma);
+        metrics[next++] = (gamma > 0.0) ? -20.0 * std::log10(gamma) : ((gamma == 0.0) ? std::numeric_limits<double>::infinity() : undefined);
+        if(forwardValid)
+        {
+            metrics[next] = ewma(metrics[next], forward);
+        }
+        next++;
+        if(reflectedValid)
+        {
+            metrics[next] = ewma(metrics[next], reflected);
+        }
+        next++;
+
+        if(stage.efficiency >= 0)
+        {
+            if(component.isParameterValid(stage.efficiency))
+            {
+                metrics[next] = ewma(metrics[next], static_cast<double>(values[stage.efficiency]));
+            }
+            next++;
+        }
+    }
+
+    if(!stage.temperatures.empty())
+    {
+        double maxDelta = undefined;
+        for(size_t i = 0; i < stage.temperatures.size(); i++)
+        {
+            if(!component.isParameterValid(stage.temperatures[i].first) || !component.isParameterValid(stage.temperatures[i].second))
+            {
+                metrics[next++] = undefined;
+                next++;
+                continue;
+            }
+
+            double delta = static_cast<double>(values[stage.temperatures[i].second] - values[stage.temperatures[i].first]);
+            metrics[next++] = delta;
+            metrics[next] = ewma(metrics[next], delta);
+            next++;
+            maxDelta = std::isnan(maxDelta) ? delta : std::max(maxDelta, delta);
+        }
+        metrics[next++] = maxDelta;
+    }
+
+    stage.metrics.time = time;
+    stage.metrics.samples++;
+}
+
+void RFmetrics::stateChanged(const RFcomponent&, const uint64_t, const States, const States, const std::string&)
+{
+    // Metrics only depend on parameters.
+}
+
+DerivedMetrics RFmetrics::get(const std::string& componentName)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    for(std::unordered_map<const RFcomponent*, Stage>::const_iterator it = stages.begin(); it != stages.end(); ++it)
+    {
+        if(it->second.componentName == componentName && !it->second.metrics.names.empty())
+        {
+            return it->second.metrics;
+        }
+    }
+
+    return DerivedMetrics();
+}
+
+std::map<std::string, DerivedMetrics> RFmetrics::getAll()
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    std::map<std::string, DerivedMetrics> toReturn;
+    for(std::unordered_map<const RFcomponent*, Stage>::const_iterator it = stages.begin(); it != stages.end(); ++it)
+    {
+        if(!it->second.metrics.names.empty())
+        {
+            toReturn[it->second.componentName] = it->second.metrics;
+        }
+    }
+
+    return toReturn;
+}
+
+RFmetrics::Stage& RFmetrics::getStage(const RFcomponent& component)
+{
+    Stage& stage = stages[&component];
+
+    // A component destroyed and another created at the same address starts over.
+    if(stage.componentName == component.getName())
+    {
+        return stage;
+    }
+
+    const std::vector<std::string>& names = component.getParameterNames();
+    stage = Stage();
+    stage.componentName = component.getName();
+    stage.forward = findParameter(names, "forwardPower");
+    stage.reflected = findParameter(names, "reflectedPower");
+    stage.efficiency = findParameter(names, "paEfficiency");
+
+    std::vector<std::string>& metricNames = stage.metrics.names;
+    if(stage.forward >= 0 && stage.reflected >= 0)
+    {
+        metricNames.push_back("reflectionCoefficient");
+        metricNames.push_back("vswr");
+        metricNames.push_back("returnLoss");
+        metricNames.push_back(names[stage.forward] + "Ewma");
+        metricNames.push_back(names[stage.reflected] + "Ewma");
+        if(stage.efficiency >= 0)
+        {
+            metricNames.push_back("paEfficiencyEwma");
+        }
+    }
+
+    // Inlet and outlet of a device have the same number.
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        if(names[i].compare(0, 6, "inTemp") == 0)
+        {
+            std::string device = names[i].substr(6);
+            int32_t outlet = findParameter(names, "outTemp" + device);
+            if(outlet >= 0)
+            {
+                stage.temperatures.push_back(std::make_pair(i, static_cast<size_t>(outlet)));
+                metricNames.push_back("deltaT" + device);
+                metricNames.push_back("deltaT" + device + "Ewma");
+            }
+        }
+    }
+    if(!stage.temperatures.empty())
+    {
+        metricNames.push_back("maxDeltaT");
+    }
+
+    stage.metrics.values.assign(metricNames.size(), undefined);
+    return stage;
+}
+
+double RFmetrics::ewma(const double previous, const double sample) const
+{
+    return std::isnan(previous) ? sample : previous + smoothing * (sample - previous);
+}
@@ -0,0 +1,213 @@
+#include "rfpowermonitor.h"
+#include "rfcomponent.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace
+{
+    /// Parses a value without throwing, the monitor must keep running on garbage.
+    bool parse(const SNMPvarbind& varbind, uint32_t& value)
+    {
+        try
+        {
+            value = convertToValue<uint32_t>(varbind.value);
+            return true;
+        }
+        catch(const SNMPconnectorException&)
+        {
+            return false;
+        }
+    }
+
+    bool parse(const SNMPvarbind& varbind, int32_t& value)
+    {
+        try
+        {
+            value = convertToValue<int32_t>(varbind.value);
+            return true;
+        }
+        catch(const SNMPconnectorException&)
+        {
+            return false;
+        }
+    }
+}
+
+RFpowerMonitor::RFpowerMonitor(const std::shared_ptr<SNMPtransport>& transport, const TransmitterTopology& topology,
+                               const PowerMonitorSettings& settings, const std::shared_ptr<PowerTripHandler>& handler)
+    : transport(transport), settings(settings), handler(handler), running(false), realtime(false), tripped(false), cycles(0), trips(0)
+{
+    if(!transport || !handler)
+    {
+        throw SNMPconnectorException("Power monitor needs a transport and a handler.");
+    }
+
+    // Smallest possible request, prepared once.
+    SNMPrequestSpec spec;
+    spec.operation = SNMP_GET;
+    spec.maxRepetitions = 0;
+    spec.priority = SNMP_PRIORITY_STATE;
+    spec.varbinds.resize(3);
+    spec.varbinds[0].oid = topology.getOid(OIDS::TRANS_FP);
+    spec.varbinds[1].oid = topology.getOid(OIDS::TRANS_RP);
+    spec.varbinds[2].oid = topology.getOid(OIDS::RF_LINK);
+    for(size_t i = 0; i < spec.varbinds.size(); i++)
+    {
+        spec.varbinds[i].syntax = sNMP_SYNTAX_NULL;
+    }
+
+    request = transport->prepare(spec);
+}
+
+RFpowerMonitor::~RFpowerMonitor()
+{
+    stop();
+}
+
+void RFpowerMonitor::start()
+{
+    if(running)
+    {
+        return;
+    }
+
+    running = true;
+    thread = std::thread(run, this);
+}
+
+void RFpowerMonitor::stop()
+{
+    if(!running)
+    {
+        return;
+    }
+
+    running = false;
+    thread.join();
+}
+
+void RFpowerMonitor::run(RFpowerMonitor* monitor)
+{
+    monitor->realtime = monitor->setupThread();
+
+    SNMPresponse response;
+    response.varbinds.reserve(3);
+    uint16_t missed = 0;
+
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while(monitor->running)
+    {
+        uint64_t sent = monotonicNanoseconds();
+        int32_t status = monitor->transport->execute(*monitor->request, response);
+        uint64_t received = monotonicNanoseconds();
+        monitor->roundTrip.record((received - sent) / 1000);
+
+        monitor->check(status, response, received, missed);
+        monitor->cycles++;
+
+        // Absolute deadlines, so the period does not drift with the round trip.
+        next.tv_nsec += static_cast<long>(monitor->settings.period) * 1000;
+        while(next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+
+        // After an overrun the next cycle starts right away instead of catching up with a burst.
+        uint64_t deadline = static_cast<uint64_t>(next.tv_sec) * 1000000000 + next.tv_nsec;
+        if(deadline < received)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &next);
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+    }
+}
+
+bool RFpowerMonitor::setupThread()
+{
+    bool applied = true;
+
+    if(settings.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(settings.cpu, &cpus);
+        applied = (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0) && applied;
+    }
+
+    if(settings.priority > 0)
+    {
+        sched_param parameters;
+        parameters.sched_priority = settings.priority;
+        applied = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) == 0) && applied;
+    }
+
+    return applied;
+}
+
+void RFpowerMonitor::check(const int32_t status, const SNMPresponse& response, const uint64_t received, uint16_t& missed)
+{
+    PowerTrip event;
+    event.forwardPower = 0;
+    event.reflectedPower = 0;
+    event.link = States::UNKNOWN;
+    event.received = received;
+
+    if(status != SNMP_CLASS_SUCCESS || response.varbinds.size() != 3 ||
+       !parse(response.varbinds[0], event.forwardPower) || !parse(response.varbinds[1], event.reflectedPower) ||
+       !parse(response.varbinds[2], event.link))
+    {
+        // Fail safe: losing sight of the transmitter trips as well.
+        if(missed < settings.missedResponses)
+        {
+            missed++;
+        }
+        if(settings.missedResponses > 0 && missed == settings.missedResponses)
+        {
+            event.forwardPower = 0;
+            event.reflectedPower = 0;
+            event.link = States::UNKNOWN;
+            event.reason = NO_RESPONSE;
+            trip(event);
+        }
+        return;
+    }
+    missed = 0;
+
+    if(settings.maxReflectedPower > 0 && event.reflectedPower > settings.maxReflectedPower)
+    {
+        event.reason = REFLECTED_POWER_HIGH;
+    }
+    else if(settings.maxReflectionRatio > 0.0 && event.reflectedPower > settings.maxReflectionRatio * event.forwardPower)
+    {
+        event.reason = REFLECTION_RATIO_HIGH;
+    }
+    else if(event.link != States::OK)
+    {
+        event.reason = RF_LINK_DOWN;
+    }
+    else
+    {
+        // Everything within limits.
+        tripped = false;
+        return;
+    }
+
+    trip(event);
+}
+
+void RFpowerMonitor::trip(PowerTrip& event)
+{
+    if(tripped)
+    {
+        return;
+    }
+
+    tripped = true;
+    trips++;
+    reaction.record(monotonicNanoseconds() - event.received);
+    handler->tripped(event);
+}
@@ -0,0 +1,500 @@
+#include "rfrecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <sstream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+    const char segmentMagic[8] = "RFREC01"; //!< Identifies segment files.
+    const size_t pageSize = 4096; //!< Sections of a segment are page aligned.
+
+    /// Rounds up to a whole page.
+    size_t pageAlign(const size_t size)
+    {
+        return (size + pageSize - 1) / pageSize * pageSize;
+    }
+
+    /**
+     * @brief The SegmentLayout struct Offsets of the sections of a segment.
+     */
+    struct SegmentLayout
+    {
+        size_t channels; //!< Offset of the channel table.
+        size_t index; //!< Offset of the index block.
+        size_t records; //!< Offset of the records.
+        size_t size; //!< Size of the file.
+    };
+
+    SegmentLayout layout(const uint64_t capacity, const uint64_t indexInterval, const uint64_t maxChannels, const uint32_t channelNameLength)
+    {
+        SegmentLayout toReturn;
+        toReturn.channels = pageAlign(sizeof(RecordSegmentHeader));
+        toReturn.index = toReturn.channels + pageAlign(maxChannels * channelNameLength);
+        toReturn.records = toReturn.index + pageAlign((capacity + indexInterval - 1) / indexInterval * sizeof(uint64_t));
+        toReturn.size = toReturn.records + pageAlign(capacity * sizeof(Record));
+        return toReturn;
+    }
+
+    /// Does the file exist?
+    bool exists(const std::string& fileName)
+    {
+        struct stat info;
+        return stat(fileName.c_str(), &info) == 0;
+    }
+
+    std::string systemError(const std::string& what, const std::string& fileName)
+    {
+        return what + " " + fileName + ": " + std::strerror(errno);
+    }
+}
+
+RFrecorder::RFrecorder(const std::string& prefix, const uint64_t recordsPerSegment)
+    : prefix(prefix), capacity(recordsPerSegment), sequence(0), segment(0), segmentSize(0), header(0), index(0), records(0), lastTime(0),
+      dropped(0)
+{
+    if(capacity == 0)
+    {
+        throw RfRecorderException("Segment needs at least 1 record.");
+    }
+
+    // Never touch segments of earlier recordings.
+    while(exists(segmentName(prefix, sequence)))
+    {
+        sequence++;
+    }
+
+    std::unique_lock<std::mutex> l(lock);
+    openSegment(sequence);
+}
+
+RFrecorder::~RFrecorder()
+{
+    std::unique_lock<std::mutex> l(lock);
+    closeSegment();
+}
+
+std::string RFrecorder::segmentName(const std::string& prefix, const uint32_t sequence)
+{
+    std::stringstream name;
+    name << prefix << '.' << std::setw(6) << std::setfill('0') << sequence << ".rfrec";
+    return name.str();
+}
+
+void RFrecorder::openSegment(const uint32_t number)
+{
+    std::string fileName = segmentName(prefix, number);
+    SegmentLayout sections = layout(capacity, indexInterval, maxChannels, channelNameLength);
+
+    int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0)
+    {
+        throw RfRecorderException(systemError("Failed to create segment", fileName));
+    }
+
+    // Reserve the blocks now so that writing through the mapping can not fail with SIGBUS on a full disk.
+    if(posix_fallocate(fd, 0, sections.size) != 0)
+    {
+        close(fd);
+        unlink(fileName.c_str());
+        throw RfRecorderException("Failed to allocate segment " + fileName);
+    }
+
+    void* map = mmap(0, sections.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        unlink(fileName.c_str());
+        throw RfRecorderException(systemError("Failed to map segment", fileName));
+    }
+
+    // The previous segment stays mapped until the new one is ready.
+    closeSegment();
+    sequence = number;
+    segment = static_cast<char*>(map);
+    segmentSize = sections.size;
+    header = reinterpret_cast<RecordSegmentHeader*>(segment);
+    index = reinterpret_cast<uint64_t*>(segment + sections.index);
+    records = reinterpret_cast<Record*>(segment + sections.records);
+
+    std::memcpy(header->magic, segmentMagic, sizeof(segmentMagic));
+    header->recordSize = sizeof(Record);
+    header->channelNameLength = channelNameLength;
+    header->capacity = capacity;
+    header->indexInterval = indexInterval;
+    header->maxChannels = maxChannels;
+    header->count = 0;
+    header->firstTime = 0;
+    header->lastTime = 0;
+
+    // Every segment carries all channels so it can be read on its own.
+    for(size_t i = 0; i < channelNames.size(); i++)
+    {
+        std::strncpy(segment + sections.channels + i * channelNameLength, channelNames[i].c_str(), channelNameLength - 1);
+    }
+    header->channels = channelNames.size();
+}
+
+void RFrecorder::closeSegment()
+{
+    if(segment != 0)
+    {
+        msync(segment, segmentSize, MS_SYNC);
+        munmap(segment, segmentSize);
+        segment = 0;
+        segmentSize = 0;
+        header = 0;
+        index = 0;
+        records = 0;
+    }
+}
+
+uint32_t RFrecorder::addChannel(const std::string& name)
+{
+    if(channelNames.size() >= maxChannels)
+    {
+        throw RfRecorderException("Too many channels in the recording.");
+    }
+
+    std::string truncated = name.substr(0, channelNameLength - 1);
+    channelNames.push_back(truncated);
+
+    // Add to the current segment. Readers only look at entries below channels. The next segment gets it anyway.
+    if(segment == 0)
+    {
+        return channelNames.size() - 1;
+    }
+    char* table = segment + layout(capacity, indexInterval, maxChannels, channelNameLength).channels;
+    std::strncpy(table + (channelNames.size() - 1) * channelNameLength, truncated.c_str(), channelNameLength - 1);
+    __sync_synchronize();
+    header->channels = channelNames.size();
+
+    return channelNames.size() - 1;
+}
+
+uint32_t RFrecorder::channel(const std::string& name)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    std::string truncated = name.substr(0, channelNameLength - 1);
+    for(size_t i = 0; i < channelNames.size(); i++)
+    {
+        if(channelNames[i] == truncated)
+        {
+            return i;
+        }
+    }
+
+    return addChannel(truncated);
+}
+
+const RFrecorder::ComponentChannels& RFrecorder::componentChannels(const RFcomponent& component)
+{
+    std::map<const RFcomponent*, ComponentChannels>::iterator found = components.find(&component);
+    if(found != components.end())
+    {
+        return found->second;
+    }
+
+    // First time we see the component. Channels of one component are consecutive.
+    ComponentChannels channels;
+    channels.state = addChannel(component.getName() + ".state");
+    channels.parameters = channels.state + 1;
+
+    const std::vector<std::string>& names = component.getParameterNames();
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        addChannel(component.getName() + "." + names[i]);
+    }
+
+    return components.insert(std::make_pair(&component, channels)).first->second;
+}
+
+void RFrecorder::append(const uint32_t channel, const uint64_t time, const RecordTypes type, const int64_t value, const int64_t previous)
+{
+    std::unique_lock<std::mutex> l(lock);
+    write(channel, time, type, value, previous);
+}
+
+void RFrecorder::write(const uint32_t channel, const uint64_t time, const RecordTypes type, const int64_t value, const int64_t previous)
+{
+    if(segment == 0)
+    {
+        dropped++;
+        return;
+    }
+
+    if(header->count == capacity)
+    {
+        // Skip names taken by someone else, a gap in the numbering would end the recording for readers.
+        uint32_t next = sequence + 1;
+        while(exists(segmentName(prefix, next)))
+        {
+            next++;
+        }
+
+        try
+        {
+            openSegment(next);
+        }
+        catch(const RfRecorderException&)
+        {
+            // The full segment stays mapped, the next record tries again. Polling must go on.
+            dropped++;
+            return;
+        }
+    }
+
+    // Keep time ordered even if the wall clock steps back, otherwise seeking would break.
+    lastTime = (time > lastTime) ? time : lastTime;
+
+    uint64_t position = header->count;
+    Record& record = records[position];
+    record.time = lastTime;
+    record.channel = channel;
+    record.type = type;
+    record.value = value;
+    record.previous = previous;
+
+    if(position % indexInterval == 0)
+    {
+        index[position / indexInterval] = lastTime;
+    }
+
+    if(position == 0)
+    {
+        header->firstTime = lastTime;
+    }
+    header->lastTime = lastTime;
+
+    // Publish the record to readers mapping the same file.
+    __sync_synchronize();
+    header->count = position + 1;
+}
+
+void RFrecorder::flush()
+{
+    std::unique_lock<std::mutex> l(lock);
+    if(segment != 0)
+    {
+        msync(segment, segmentSize, MS_ASYNC);
+    }
+}
+
+uint64_t RFrecorder::getDropped()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return dropped;
+}
+
+void RFrecorder::parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values)
+{
+    std::unique_lock<std::mutex> l(lock);
+    uint32_t first = componentChannels(component).parameters;
+
+    // Invalid parameters only repeat their last value, so they are not recorded.
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        if(component.isParameterValid(i))
+        {
+            write(first + i, time, PARAMETER_SAMPLE, values[i], 0);
+        }
+    }
+}
+
+void RFrecorder::stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string&)
+{
+    std::unique_lock<std::mutex> l(lock);
+    write(componentChannels(component).state, time, STATE_TRANSITION, newState, oldState);
+}
+
+RFrecordReader::RFrecordReader(const std::string& prefix)
+    : total(0)
+{
+    for(uint32_t sequence = 0; exists(RFrecorder::segmentName(prefix, sequence)); sequence++)
+    {
+        std::string fileName = RFrecorder::segmentName(prefix, sequence);
+
+        int fd = open(fileName.c_str(), O_RDONLY);
+        struct stat info;
+        if(fd < 0 || fstat(fd, &info) != 0)
+        {
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+            throw RfRecorderException(systemError("Failed to open segment", fileName));
+        }
+
+        void* map = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED)
+        {
+            throw RfRecorderException(systemError("Failed to map segment", fileName));
+        }
+
+        Segment segment;
+        segment.map = static_cast<char*>(map);
+        segment.length = info.st_size;
+        segment.header = reinterpret_cast<const RecordSegmentHeader*>(segment.map);
+
+        const RecordSegmentHeader& header = *segment.header;
+        if(static_cast<size_t>(info.st_size) < sizeof(RecordSegmentHeader) || std::memcmp(header.magic, segmentMagic, sizeof(segmentMagic)) != 0 ||
+           header.recordSize != sizeof(Record) || header.indexInterval == 0 || header.count > header.capacity ||
+           header.capacity > segment.length / sizeof(Record) || header.channels > header.maxChannels ||
+           header.channelNameLength == 0 || header.maxChannels > segment.length / header.channelNameLength ||
+           layout(header.capacity, header.indexInterval, header.maxChannels, header.channelNameLength).size > segment.length)
+        {
+            munmap(map, info.st_size);
+            throw RfRecorderException("Not a valid segment: " + fileName);
+        }
+
+        SegmentLayout sections = layout(header.capacity, header.indexInterval, header.maxChannels, header.channelNameLength);
+        segment.channels = segment.map + sections.channels;
+        segment.index = reinterpret_cast<const uint64_t*>(segment.map + sections.index);
+        segment.records = reinterpret_cast<const Record*>(segment.map + sections.records);
+        segment.count = header.count;
+        __sync_synchronize(); // Records below count are complete.
+        segment.first = total;
+
+        if(segment.count == 0)
+        {
+            munmap(map, info.st_size);
+            continue;
+        }
+
+        total += segment.count;
+        segments.push_back(segment);
+    }
+}
+
+RFrecordReader::~RFrecordReader()
+{
+    for(size_t i = 0; i < segments.size(); i++)
+    {
+        munmap(segments[i].map, segments[i].length);
+    }
+}
+
+uint64_t RFrecordReader::size() const
+{
+    return total;
+}
+
+uint64_t RFrecordReader::seek(const uint64_t time) const
+{
+    // Segment that can hold the time: first one whose last record is not before it.
+    size_t low = 0;
+    size_t high = segments.size();
+    while(low < high)
+    {
+        size_t middle = (low + high) / 2;
+        const Segment& segment = segments[middle];
+        if(segment.records[segment.count - 1].time < time)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if(low == segments.size())
+    {
+        return total;
+    }
+
+    const Segment& segment = segments[low];
+    uint64_t interval = segment.header->indexInterval;
+
+    // Last index block starting before the time, then the first record inside that block.
+    uint64_t blocks = (segment.count + interval - 1) / interval;
+    uint64_t block = std::lower_bound(segment.index, segment.index + blocks, time) - segment.index;
+    block = (block > 0) ? block - 1 : 0;
+
+    uint64_t begin = block * interval;
+    uint64_t end = std::min(segment.count, begin + 2 * interval);
+
+    uint64_t position = begin;
+    uint64_t count = end - begin;
+    while(count > 0)
+    {
+        uint64_t step = count / 2;
+        if(segment.records[position + step].time < time)
+        {
+            position += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    return segment.first + position;
+}
+
+RFrecordReader::Sample RFrecordReader::at(const uint64_t position) const
+{
+    if(position >= total)
+    {
+        throw std::out_of_range("Record position out of range.");
+    }
+
+    // Segment holding the position: last one starting at or before it.
+    size_t low = 0;
+    size_t high = segments.size() - 1;
+    while(low < high)
+    {
+        size_t middle = (low + high + 1) / 2;
+        if(segments[middle].first <= position)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    const Segment& segment = segments[low];
+    const Record& record = segment.records[position - segment.first];
+
+    Sample toReturn;
+    toReturn.time = record.time;
+    toReturn.type = static_cast<RecordTypes>(record.type);
+    toReturn.value = record.value;
+    toReturn.previous = record.previous;
+
+    if(record.channel < segment.header->channels)
+    {
+        const char* name = segment.channels + record.channel * segment.header->channelNameLength;
+        toReturn.channel.assign(name, strnlen(name, segment.header->channelNameLength));
+    }
+
+    return toReturn;
+}
+
+std::vector<RFrecordReader::Sample> RFrecordReader::read(const uint64_t from, const uint64_t to) const
+{
+    std::vector<Sample> toReturn;
+
+    for(uint64_t position = seek(from); position < total; position++)
+    {
+        Sample sample = at(position);
+        if(sample.time >= to)
+        {
+            break;
+        }
+        toReturn.push_back(sample);
+    }
+
+    return toReturn;
+}
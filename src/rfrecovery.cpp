@@ -0,0 +1,299 @@
+#include "rfrecovery.h"
+#include <time.h>
+#include <thread>
+#include <exception>
+
+namespace
+{
+    const char* stepNames[RECOVERY_STEPS] = { "idle", "MTx reset", "transmitter reset", "power switch", "nominal power", "ramp", "done", "aborted" };
+
+    /// Sleeps until the absolute deadline, then moves it one period on. After an overrun it restarts from now.
+    void waitPeriod(timespec& next, const uint32_t period)
+    {
+        next.tv_nsec += static_cast<long>(period) * 1000;
+        while(next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+
+        uint64_t deadline = static_cast<uint64_t>(next.tv_sec) * 1000000000 + next.tv_nsec;
+        if(deadline < monotonicNanoseconds())
+        {
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            return;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+    }
+}
+
+RFrecoverySequencer::RFrecoverySequencer(Transmitter& transmitter, MTx& mtx, OutStage& outStage, const RecoverySettings& settings)
+    : transmitter(transmitter), mtx(mtx), outStage(outStage), settings(settings), writeValue(0)
+{
+    if(settings.targetPower == 0 || settings.period == 0 || settings.stepTimeout == 0)
+    {
+        throw RfComponentException("Recovery needs a target power, a period and a step timeout.");
+    }
+
+    step = RECOVERY_IDLE;
+    aborted = false;
+    writeDone = false;
+}
+
+RecoveryResult RFrecoverySequencer::run()
+{
+    RecoveryResult result;
+    aborted = false;
+    uint64_t start = monotonicMicroseconds();
+
+    bool ok = true;
+    if(settings.resetMtx)
+    {
+        ok = execute(RECOVERY_RESET_MTX, 0, result);
+    }
+    ok = ok && execute(RECOVERY_RESET_TRANSMITTER, 0, result);
+    ok = ok && execute(RECOVERY_SWITCH_ON, Transmitter::ON, result);
+    ok = ok && execute(RECOVERY_NOMINAL_POWER, settings.targetPower, result);
+
+    // Output stage power in steps, the last one lands exactly on the target.
+    uint32_t power = 0;
+    while(ok && power < settings.targetPower)
+    {
+        if(settings.powerStep == 0 || settings.targetPower - power <= settings.powerStep)
+        {
+            power = settings.targetPower;
+        }
+        else
+        {
+            power += settings.powerStep;
+        }
+
+        ok = execute(RECOVERY_RAMP, power, result);
+        if(ok)
+        {
+            result.power = power;
+        }
+    }
+
+    if(ok)
+    {
+        result.step = RECOVERY_DONE;
+    }
+    else if(result.step >= RECOVERY_SWITCH_ON)
+    {
+        safeState(result);
+    }
+
+    step = ok ? RECOVERY_DONE : RECOVERY_ABORTED;
+    result.duration = monotonicMicroseconds() - start;
+    return result;
+}
+
+void RFrecoverySequencer::safeState(RecoveryResult& result)
+{
+    // Best effort, whatever stopped the recovery should not meet power. The switch on may have reached the agent even if
+    // its step failed, so the power is switched off again after every abort from that step on.
+    try
+    {
+        outStage.setPower(0);
+    }
+    catch(const std::exception& e)
+    {
+        result.reason += std::string(" Output stage power not set to 0: ") + e.what();
+    }
+
+    try
+    {
+        transmitter.powerSwitch(Transmitter::OFF);
+    }
+    catch(const std::exception& e)
+    {
+        result.reason += std::string(" Power not switched off: ") + e.what();
+    }
+}
+
+bool RFrecoverySequencer::execute(const RecoverySteps current, const uint32_t value, RecoveryResult& result)
+{
+    step = current;
+    writeValue = value;
+    writeError.clear();
+    writeDone = false;
+
+    uint64_t start = monotonicMicroseconds();
+    uint64_t deadline = start + settings.stepTimeout * 1000ull;
+
+    // The write goes out while the verification reads already run, the agent answers both in parallel.
+    std::thread writer(write, this);
+
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    bool done = false;
+    std::string reason;
+    while(true)
+    {
+        if(aborted)
+        {
+            reason = "Aborted.";
+            break;
+        }
+
+        // Only reads started after the write returned can show its effect.
+        bool written = writeDone;
+        if(written && !writeError.empty())
+        {
+            reason = "Write failed: " + writeError;
+            break;
+        }
+
+        result.reads++;
+        bool verified = verify(current, value, reason);
+        if(!reason.empty())
+        {
+            break;
+        }
+        if(written && verified)
+        {
+            done = true;
+            break;
+        }
+
+        if(monotonicMicroseconds() >= deadline)
+        {
+            reason = "Timeout.";
+            break;
+        }
+        waitPeriod(next, settings.period);
+    }
+
+    writer.join();
+
+    uint64_t duration = monotonicMicroseconds() - start;
+    result.stepDuration[current] += duration;
+    stepTimes.record(duration);
+
+    if(!done)
+    {
+        result.step = current;
+        result.reason = std::string(stepNames[current]) + ": " + reason;
+    }
+    return done;
+}
+
+bool RFrecoverySequencer::verify(const RecoverySteps current, const uint32_t value, std::string& reason)
+{
+    switch(current)
+    {
+    case RECOVERY_RESET_MTX:
+        mtx.updateStateAndStatus();
+        return mtx.getState() == States::OK;
+
+    case RECOVERY_RESET_TRANSMITTER:
+    {
+        // After the reset the transmitter may well be off, it only must not be faulty any more.
+        transmitter.updateStateAndStatus();
+        States state = transmitter.getState();
+        return state == States::OFF || state == States::WARNING || state == States::OK;
+    }
+
+    case RECOVERY_SWITCH_ON:
+    case RECOVERY_NOMINAL_POWER:
+    case RECOVERY_RAMP:
+    {
+        transmitter.updateStateAndStatus();
+        if(transmitter.getState() == States::FAULT)
+        {
+            reason = "Transmitter fault: " + transmitter.getStatus();
+            return false;
+        }
+
+        if(transmitter.tryUpdateReadParameters().failed())
+        {
+            return false;
+        }
+        if(reflectionTooHigh(reason))
+        {
+            return false;
+        }
+
+        if(current == RECOVERY_SWITCH_ON)
+        {
+            return transmitter.getSwitchOn() == Transmitter::ON;
+        }
+        if(current == RECOVERY_NOMINAL_POWER)
+        {
+            return transmitter.getNominalPower() == value;
+        }
+
+        outStage.updateStateAndStatus();
+        if(outStage.getState() == States::FAULT)
+        {
+            reason = "Output stage fault: " + outStage.getStatus();
+            return false;
+        }
+        if(outStage.tryUpdateReadParameters().failed() || outStage.getPower() != value)
+        {
+            return false;
+        }
+
+        double deviation = static_cast<double>(transmitter.getForwardPower()) - value;
+        return deviation <= settings.tolerance * value && -deviation <= settings.tolerance * value;
+    }
+
+    default:
+        return true;
+    }
+}
+
+bool RFrecoverySequencer::reflectionTooHigh(std::string& reason)
+{
+    uint32_t forward = transmitter.getForwardPower();
+    uint32_t reflected = transmitter.getReflectedPower();
+
+    if(settings.maxReflectedPower > 0 && reflected > settings.maxReflectedPower)
+    {
+        reason = "Reflected power too high.";
+    }
+    else if(settings.maxReflectionRatio > 0.0 && reflected > settings.maxReflectionRatio * forward)
+    {
+        reason = "Reflection ratio too high.";
+    }
+    return !reason.empty();
+}
+
+void RFrecoverySequencer::write(RFrecoverySequencer* sequencer)
+{
+    try
+    {
+        switch(sequencer->getStep())
+        {
+        case RECOVERY_RESET_MTX:
+            sequencer->mtx.reset();
+            break;
+        case RECOVERY_RESET_TRANSMITTER:
+            sequencer->transmitter.reset();
+            break;
+        case RECOVERY_SWITCH_ON:
+            sequencer->transmitter.powerSwitch(static_cast<int32_t>(sequencer->writeValue));
+            break;
+        case RECOVERY_NOMINAL_POWER:
+            sequencer->transmitter.setNominalPower(sequencer->writeValue);
+            break;
+        case RECOVERY_RAMP:
+            sequencer->outStage.setPower(sequencer->writeValue);
+            break;
+        default:
+            break;
+        }
+    }
+    catch(const std::exception& e)
+    {
+        sequencer->writeError = e.what();
+        if(sequencer->writeError.empty())
+        {
+            sequencer->writeError = "Unknown error.";
+        }
+    }
+
+    sequencer->writeDone = true;
+}
@@ -1,23 +1,25 @@
 #include "rfsensor.h"
-#include <sstream>
 
 const std::string RFsensor::diagRequestName = "diagRFS";
 const std::string RFsensor::upadateParamsName = "RFSsupdate";
 
-RFsensor::RFsensor(const std::shared_ptr<SNMPconnector> snmp) :
-    RFcomponent(oids[OIDS::RF_LINK], "RFsensor", snmp)
+RFsensor::RFsensor(const std::shared_ptr<SNMPconnector> snmp, const TransmitterTopology& topology) :
+    RFcomponent(topology, RF_SENSOR, snmp), diagNodes(topology.getComponent(RF_SENSOR).diagNodes)
 {
     // Register updateParams request.
     std::vector<std::string> variablesOids;
-    variablesOids.push_back(oids[OIDS::RFS_FORWARD]);
-    variablesOids.push_back(oids[OIDS::RFS_REFLECTED]);
+    variablesOids.push_back(topology.getOid(OIDS::RFS_FORWARD));
+    variablesOids.push_back(topology.getOid(OIDS::RFS_REFLECTED));
     snmp->createRequest(upadateParamsName, variablesOids);
 
     // Register DIAG request.
-    snmp->createBulkRequest(diagRequestName, oids[OIDS::RF_LINK], noDiagNodes);
+    snmp->createBulkRequest(diagRequestName, topology.getOid(topology.getComponent(RF_SENSOR).summary), diagNodes.size());
 
     forwardSt = 0;
     reflectedSt = 0;
+
+    const char* names[] = {"forwardSt", "reflectedSt"};
+    setParameterNames(std::vector<std::string>(names, names + 2));
 }
 
 RFsensor::~RFsensor()
@@ -28,17 +30,25 @@ RFsensor::~RFsensor()
 
 void RFsensor::diagnose(const std::vector<std::string>& summaryValues)
 {
+    RF_TRACE_SPAN("diagnose", &componentName);
+
     try
     {
         int32_t stateValue = convertToValue<int32_t>(summaryValues[0]);
 
         // Get other information about the transmitter.
-        std::vector<std::string> values = snmp->readRequest(diagRequestName);
+        const std::vector<std::string>& values = snmp->readRequest(diagRequestName);
 
         // Construct the status.
-        std::stringstream statusMsg;
-        statusMsg << "detailed status:" << std::endl << "txRfSensorCalibrated: " << StatesText[convertToValue<int32_t>(values.at(0))] << std::endl;
-        setStateAndStatus(static_cast<States>(stateValue), statusMsg.str());
+        statusBuffer.assign("detailed status:\n");
+        for(size_t i = 0; i < diagNodes.size(); i++)
+        {
+            statusBuffer += diagNodes[i];
+            statusBuffer += ": ";
+            statusBuffer += StatesText[convertToValue<int32_t>(values.at(i))];
+            statusBuffer += '\n';
+        }
+        setStateAndStatus(static_cast<States>(stateValue), statusBuffer);
     }
     catch(const std::out_of_range&)
     {
@@ -50,26 +60,19 @@ void RFsensor::diagnose(const std::vector<std::string>& summaryValues)
     }
 }
 
-void RFsensor::updateReadParameters()
+SNMPerror RFsensor::tryUpdateReadParameters()
 {
-    try
-    {
-        // Read the values.
-        std::vector<std::string> values = snmp->readRequest(upadateParamsName);
+    RF_TRACE_SPAN("updateReadParameters", &componentName);
 
-        // Convert to appropriate type and update.
-        forwardSt = convertToValue<uint32_t>(values.at(0));
-        reflectedSt = convertToValue<uint32_t>(values.at(1));
-        dataValid = true;
-    }
-    catch(const std::out_of_range&)
+    // Read the values. Invalid ones keep their last value.
+    SNMPerror error = readParameters<uint32_t>(upadateParamsName);
+    if(error.failed())
     {
-        dataValid = false;
-        throw SNMPconnectorException(dataAcquisitionFailed);
-    }
-    catch(const SNMPconnectorException& e)
-    {
-        dataValid = false;
-        throw e;
+        return error;
     }
+
+    forwardSt = parameterValues[0];
+    reflectedSt = parameterValues[1];
+    notifyParameters();
+    return error;
 }
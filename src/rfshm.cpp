@@ -0,0 +1,324 @@
+#include "rfshm.h"
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+    const char shmMagic[8] = "RFSHM02"; //!< Magic of the segment.
+
+    std::string systemError(const std::string& what, const std::string& name)
+    {
+        return what + " " + name + ": " + std::strerror(errno);
+    }
+
+    /// Copies a string into a fixed field, truncated and terminated.
+    void copyString(char* field, const size_t length, const std::string& value)
+    {
+        size_t size = std::min(value.size(), static_cast<size_t>(length - 1));
+        std::memcpy(field, value.data(), size);
+        field[size] = '\0';
+    }
+
+    /// Size of a segment with all slots.
+    size_t segmentBytes(const uint32_t maxComponents)
+    {
+        return sizeof(ShmHeader) + static_cast<size_t>(maxComponents) * sizeof(ShmSlot);
+    }
+}
+
+const uint32_t ShmSlot::nameLength;
+const uint32_t ShmSlot::statusLength;
+const uint32_t ShmSlot::maxParameters;
+const uint32_t RFshmPublisher::maxComponents;
+const uint32_t RFshmReader::maxAttempts;
+
+RFshmPublisher::RFshmPublisher(const std::string& name)
+    : name(name), segment(0), segmentSize(segmentBytes(maxComponents)), header(0), slots(0)
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        throw RfShmException(systemError("Failed to open shared memory", name));
+    }
+
+    if(ftruncate(fd, segmentSize) != 0)
+    {
+        close(fd);
+        throw RfShmException(systemError("Failed to size shared memory", name));
+    }
+
+    void* map = mmap(0, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        throw RfShmException(systemError("Failed to map shared memory", name));
+    }
+
+    segment = static_cast<char*>(map);
+    header = reinterpret_cast<ShmHeader*>(segment);
+    slots = reinterpret_cast<ShmSlot*>(segment + sizeof(ShmHeader));
+
+    // A segment of a previous writer is cleared. Readers see no magic until it is set up again.
+    std::memset(header->magic, 0, sizeof(header->magic));
+    __sync_synchronize();
+    std::memset(segment + sizeof(header->magic), 0, segmentSize - sizeof(header->magic));
+    header->slotSize = sizeof(ShmSlot);
+    header->maxComponents = maxComponents;
+    header->writerPid = getpid();
+    header->components = 0;
+    __sync_synchronize();
+    std::memcpy(header->magic, shmMagic, sizeof(shmMagic));
+}
+
+RFshmPublisher::~RFshmPublisher()
+{
+    munmap(segment, segmentSize);
+    shm_unlink(name.c_str());
+}
+
+void RFshmPublisher::parametersUpdated(const RFcomponent& component, const uint64_t time, const std::vector<int64_t>& values)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    ShmSlot* slot = getSlot(component);
+    if(slot == 0)
+    {
+        return;
+    }
+
+    uint32_t count = std::min(values.size(), static_cast<size_t>(ShmSlot::maxParameters));
+    const std::vector<std::string>& names = component.getParameterNames();
+    uint64_t valid = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(component.isParameterValid(i))
+        {
+            valid |= static_cast<uint64_t>(1) << i;
+        }
+    }
+
+    slot->sequence++;
+    __sync_synchronize();
+
+    // Names only change with the topology, so they are written when the count changes.
+    if(slot->parameters != count)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            copyString(slot->parameterNames[i], ShmSlot::nameLength, (i < names.size()) ? names[i] : std::string());
+        }
+        slot->parameters = count;
+    }
+    std::memcpy(slot->values, values.data(), count * sizeof(int64_t));
+    slot->valid = valid;
+    slot->parametersTime = time;
+
+    __sync_synchronize();
+    slot->sequence++;
+}
+
+void RFshmPublisher::stateChanged(const RFcomponent& component, const uint64_t time, const States oldState, const States newState, const std::string& status)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    ShmSlot* slot = getSlot(component);
+    if(slot != 0)
+    {
+        writeState(*slot, time, newState, status);
+    }
+}
+
+void RFshmPublisher::publish(RFcomponent& component)
+{
+    States state = component.getState();
+    std::string status = component.getStatus();
+    uint64_t time = RFcomponent::wallClock();
+
+    // Same status as listeners get, without the component name and line break of getStatus.
+    const std::string& componentName = component.getName();
+    if(status.compare(0, componentName.size() + 2, componentName + ": ") == 0)
+    {
+        status.erase(0, componentName.size() + 2);
+    }
+    if(!status.empty() && status[status.size() - 1] == '\n')
+    {
+        status.erase(status.size() - 1);
+    }
+
+    std::unique_lock<std::mutex> l(lock);
+
+    ShmSlot* slot = getSlot(component);
+    if(slot != 0)
+    {
+        writeState(*slot, time, state, status);
+    }
+}
+
+ShmSlot* RFshmPublisher::getSlot(const RFcomponent& component)
+{
+    std::unordered_map<const RFcomponent*, ShmSlot*>::const_iterator found = assigned.find(&component);
+    if(found != assigned.end())
+    {
+        return found->second;
+    }
+
+    // Further components are not published.
+    if(header->components == maxComponents)
+    {
+        return 0;
+    }
+
+    ShmSlot* slot = &slots[header->components];
+    copyString(slot->name, ShmSlot::nameLength, component.getName());
+    slot->state = States::UNKNOWN;
+
+    // Readers only look at slots below components.
+    __sync_synchronize();
+    header->components++;
+
+    assigned[&component] = slot;
+    return slot;
+}
+
+void RFshmPublisher::writeState(ShmSlot& slot, const uint64_t time, const States state, const std::string& status)
+{
+    slot.sequence++;
+    __sync_synchronize();
+
+    slot.state = state;
+    slot.stateTime = time;
+    copyString(slot.status, ShmSlot::statusLength, status);
+
+    __sync_synchronize();
+    slot.sequence++;
+}
+
+RFshmReader::RFshmReader(const std::string& name) : segment(0), segmentSize(segmentBytes(RFshmPublisher::maxComponents)), header(0), slots(0)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+    {
+        throw RfShmException(systemError("Failed to open shared memory", name));
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < segmentSize)
+    {
+        close(fd);
+        throw RfShmException("Shared memory " + name + " is not an RF transmitter segment.");
+    }
+
+    void* map = mmap(0, segmentSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        throw RfShmException(systemError("Failed to map shared memory", name));
+    }
+
+    segment = static_cast<const char*>(map);
+    header = reinterpret_cast<const ShmHeader*>(segment);
+    slots = reinterpret_cast<const ShmSlot*>(segment + sizeof(ShmHeader));
+
+    if(std::memcmp(header->magic, shmMagic, sizeof(shmMagic)) != 0 || header->slotSize != sizeof(ShmSlot) ||
+       header->maxComponents != RFshmPublisher::maxComponents)
+    {
+        munmap(const_cast<char*>(segment), segmentSize);
+        throw RfShmException("Shared memory " + name + " has an unknown layout.");
+    }
+}
+
+RFshmReader::~RFshmReader()
+{
+    munmap(const_cast<char*>(segment), segmentSize);
+}
+
+size_t RFshmReader::getComponents() const
+{
+    size_t components = *static_cast<const volatile uint32_t*>(&header->components);
+    __sync_synchronize(); // Slots below components are set up.
+    return components;
+}
+
+int32_t RFshmReader::getWriterPid() const
+{
+    return header->writerPid;
+}
+
+bool RFshmReader::read(const size_t index, ComponentSnapshot& snapshot)
+{
+    if(!copySlot(index))
+    {
+        return false;
+    }
+
+    snapshot.name.assign(copy.name);
+    snapshot.state = static_cast<States>(copy.state);
+    snapshot.status.assign(copy.status);
+    snapshot.stateTime = copy.stateTime;
+    snapshot.parametersTime = copy.parametersTime;
+
+    uint32_t count = std::min(copy.parameters, ShmSlot::maxParameters);
+    snapshot.parameterNames.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        snapshot.parameterNames[i].assign(copy.parameterNames[i]);
+    }
+    snapshot.values.assign(copy.values, copy.values + count);
+    snapshot.valid.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        snapshot.valid[i] = (copy.valid >> i) & 1;
+    }
+    return true;
+}
+
+bool RFshmReader::read(const std::string& componentName, ComponentSnapshot& snapshot)
+{
+    // Names are written before a slot is counted and never change.
+    size_t components = getComponents();
+    for(size_t i = 0; i < components; i++)
+    {
+        if(componentName.compare(slots[i].name) == 0)
+        {
+            return read(i, snapshot);
+        }
+    }
+
+    return false;
+}
+
+bool RFshmReader::copySlot(const size_t index)
+{
+    if(index >= getComponents())
+    {
+        return false;
+    }
+
+    const ShmSlot& slot = slots[index];
+    for(uint32_t attempt = 0; attempt < maxAttempts; attempt++)
+    {
+        uint64_t before = slot.sequence;
+        __sync_synchronize();
+        if(before & 1)
+        {
+            continue; // Being written.
+        }
+
+        std::memcpy(&copy, &slot, sizeof(ShmSlot));
+        copy.name[ShmSlot::nameLength - 1] = '\0';
+        copy.status[ShmSlot::statusLength - 1] = '\0';
+
+        __sync_synchronize();
+        if(slot.sequence == before)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,510 @@
+#include "rftopology.h"
+#include "rfcomponent.h"
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <cstdlib>
+
+const std::string TransmitterTopology::componentKeys[COMPONENT_TYPES_LENGTH] =
+{
+    "amplifiers",
+    "liquidCooling",
+    "transmitter",
+    "rfSensor",
+    "outStage",
+    "mtx"
+};
+
+namespace
+{
+    /**
+     * @brief The JsonValue struct Parsed JSON value. Only what is needed for topology files.
+     */
+    struct JsonValue
+    {
+        enum Type
+        {
+            NUL = 0,
+            BOOLEAN,
+            NUMBER,
+            STRING,
+            ARRAY,
+            OBJECT
+        };
+
+        Type type; //!< Type of the value.
+        bool boolean; //!< Value of booleans.
+        double number; //!< Value of numbers.
+        std::string text; //!< Value of strings.
+        std::vector<std::string> keys; //!< Object keys. Same order as items.
+        std::vector<std::shared_ptr<JsonValue> > items; //!< Array items or object values.
+
+        JsonValue() : type(NUL), boolean(false), number(0) {}
+
+        /// Returns the object member or NULL if it does not exist.
+        const JsonValue* find(const std::string& key) const
+        {
+            for(size_t i = 0; i < keys.size(); i++)
+            {
+                if(keys[i] == key)
+                {
+                    return items[i].get();
+                }
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * @brief The JsonParser class Recursive descent JSON parser.
+     */
+    class JsonParser
+    {
+    public:
+        JsonParser(const std::string& text) : text(text), pos(0) {}
+
+        std::shared_ptr<JsonValue> parseDocument()
+        {
+            std::shared_ptr<JsonValue> value = parseValue();
+            skipWhitespace();
+            if(pos != text.size())
+            {
+                error("Unexpected data after the end of the document");
+            }
+            return value;
+        }
+
+    private:
+        const std::string& text; //!< Text being parsed.
+        size_t pos; //!< Current position.
+
+        void error(const std::string& message)
+        {
+            // Report line number since topology files are edited by hand.
+            size_t line = 1;
+            for(size_t i = 0; i < pos && i < text.size(); i++)
+            {
+                line += (text[i] == '\n') ? 1 : 0;
+            }
+
+            std::stringstream msg;
+            msg << "Topology parse error on line " << line << ": " << message << ".";
+            throw RfTopologyException(msg.str());
+        }
+
+        void skipWhitespace()
+        {
+            while(pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+            {
+                pos++;
+            }
+        }
+
+        void expect(const char c)
+        {
+            skipWhitespace();
+            if(pos >= text.size() || text[pos] != c)
+            {
+                error(std::string("Expected '") + c + "'");
+            }
+            pos++;
+        }
+
+        /// Skips the comma between items. Returns false if there is none.
+        bool separator()
+        {
+            skipWhitespace();
+            if(pos < text.size() && text[pos] == ',')
+            {
+                pos++;
+                return true;
+            }
+            return false;
+        }
+
+        bool consume(const std::string& literal)
+        {
+            if(text.compare(pos, literal.size(), literal) == 0)
+            {
+                pos += literal.size();
+                return true;
+            }
+            return false;
+        }
+
+        std::shared_ptr<JsonValue> parseValue()
+        {
+            skipWhitespace();
+            if(pos >= text.size())
+            {
+                error("Unexpected end of the document");
+            }
+
+            std::shared_ptr<JsonValue> value(new JsonValue);
+
+            switch(text[pos])
+            {
+            case '{':
+                value->type = JsonValue::OBJECT;
+                pos++;
+                skipWhitespace();
+                if(pos < text.size() && text[pos] == '}')
+                {
+                    pos++;
+                    break;
+                }
+                while(true)
+                {
+                    skipWhitespace();
+                    value->keys.push_back(parseString());
+                    expect(':');
+                    value->items.push_back(parseValue());
+                    if(!separator())
+                    {
+                        break;
+                    }
+                }
+                expect('}');
+                break;
+            case '[':
+                value->type = JsonValue::ARRAY;
+                pos++;
+                skipWhitespace();
+                if(pos < text.size() && text[pos] == ']')
+                {
+                    pos++;
+                    break;
+                }
+                while(true)
+                {
+                    value->items.push_back(parseValue());
+                    if(!separator())
+                    {
+                        break;
+                    }
+                }
+                expect(']');
+                break;
+            case '"':
+                value->type = JsonValue::STRING;
+                value->text = parseString();
+                break;
+            default:
+                if(consume("true"))
+                {
+                    value->type = JsonValue::BOOLEAN;
+                    value->boolean = true;
+                }
+                else if(consume("false"))
+                {
+                    value->type = JsonValue::BOOLEAN;
+                }
+                else if(consume("null"))
+                {
+                    value->type = JsonValue::NUL;
+                }
+                else
+                {
+                    const char* begin = text.c_str() + pos;
+                    char* end;
+                    value->type = JsonValue::NUMBER;
+                    value->number = std::strtod(begin, &end);
+                    if(end == begin)
+                    {
+                        error("Unexpected character");
+                    }
+                    pos += end - begin;
+                }
+                break;
+            }
+
+            return value;
+        }
+
+        std::string parseString()
+        {
+            if(pos >= text.size() || text[pos] != '"')
+            {
+                error("Expected string");
+            }
+            pos++;
+
+            std::string toReturn;
+            while(pos < text.size() && text[pos] != '"')
+            {
+                if(text[pos] == '\\')
+                {
+                    pos++;
+                    if(pos >= text.size())
+                    {
+                        break;
+                    }
+
+                    switch(text[pos])
+                    {
+                    case 'n': toReturn += '\n'; break;
+                    case 't': toReturn += '\t'; break;
+                    case 'r': toReturn += '\r'; break;
+                    case 'b': toReturn += '\b'; break;
+                    case 'f': toReturn += '\f'; break;
+                    case 'u': error("Unicode escapes are not supported"); break;
+                    default: toReturn += text[pos]; break; // Quote, backslash and slash.
+                    }
+                }
+                else
+                {
+                    toReturn += text[pos];
+                }
+                pos++;
+            }
+
+            if(pos >= text.size())
+            {
+                error("Unterminated string");
+            }
+            pos++; // Closing quote.
+
+            return toReturn;
+        }
+    };
+
+    /// Converts JSON string array.
+    std::vector<std::string> toStrings(const JsonValue& value, const std::string& what)
+    {
+        if(value.type != JsonValue::ARRAY)
+        {
+            throw RfTopologyException(what + " must be an array of strings.");
+        }
+
+        std::vector<std::string> toReturn;
+        for(size_t i = 0; i < value.items.size(); i++)
+        {
+            if(value.items[i]->type != JsonValue::STRING)
+            {
+                throw RfTopologyException(what + " must be an array of strings.");
+            }
+            toReturn.push_back(value.items[i]->text);
+        }
+        return toReturn;
+    }
+
+    /// Converts JSON index array.
+    std::vector<uint16_t> toIndices(const JsonValue& value, const std::string& what)
+    {
+        if(value.type != JsonValue::ARRAY)
+        {
+            throw RfTopologyException(what + " must be an array of indices.");
+        }
+
+        std::vector<uint16_t> toReturn;
+        for(size_t i = 0; i < value.items.size(); i++)
+        {
+            double index = value.items[i]->number;
+            if(value.items[i]->type != JsonValue::NUMBER || index < 0 || index > 65535 || index != static_cast<uint16_t>(index))
+            {
+                throw RfTopologyException(what + " must be an array of indices.");
+            }
+            toReturn.push_back(static_cast<uint16_t>(index));
+        }
+        return toReturn;
+    }
+
+    /// Finds the OID by its name.
+    OIDS toOid(const std::string& name)
+    {
+        for(size_t i = 0; i < OIDS_LENGTH; i++)
+        {
+            if(oidNames[i] == name)
+            {
+                return static_cast<OIDS>(i);
+            }
+        }
+        throw RfTopologyException("Unknown OID name in topology: " + name);
+    }
+}
+
+TransmitterTopology::TransmitterTopology()
+    : oidTable(oids, oids + OIDS_LENGTH), components(COMPONENT_TYPES_LENGTH)
+{
+    // Solaris transmitter.
+    static const uint16_t ampIndices[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    static const uint16_t lqIndices[] = {1, 2};
+    static const char* ampDiag[] = {"txAmpRfPowerFail", "txAmpReflection", "txAmpSupplyFail", "txAmpRfInFail", "txAmpMute",
+                                    "txAmpTemperatureFail", "txAmpTransistorFail", "txAmpRegulationFail", "txAmpAcFail", "txAmpDcFail",
+                                    "txAmpLink", "txAmpBiasFail", "txAmpInitFail", "txAmpAbsorberFail", "txAmpOn"};
+    static const char* lqDiag[] = {"lqFilterSummary", "lqSensorsSummary", "lqSiteWarning", "lqSiteFault"};
+    static const char* transDiag[] = {"txRF", "txReflection", "txRfSensorSummary", "txLocal"};
+    static const char* rfsDiag[] = {"txRfSensorCalibrated"};
+
+    components[AMPLIFIERS].name = "AMPs";
+    components[AMPLIFIERS].summary = OIDS::AMP_SUMMARY;
+    components[AMPLIFIERS].indices.assign(ampIndices, ampIndices + sizeof(ampIndices)/sizeof(ampIndices[0]));
+    components[AMPLIFIERS].diagNodes.assign(ampDiag, ampDiag + sizeof(ampDiag)/sizeof(ampDiag[0]));
+
+    components[LIQUID_COOLING].name = "LiquidCooling";
+    components[LIQUID_COOLING].summary = OIDS::LQC_SUMMARY;
+    components[LIQUID_COOLING].indices.assign(lqIndices, lqIndices + sizeof(lqIndices)/sizeof(lqIndices[0]));
+    components[LIQUID_COOLING].diagNodes.assign(lqDiag, lqDiag + sizeof(lqDiag)/sizeof(lqDiag[0]));
+
+    components[TRANSMITTER].name = "Transmitter";
+    components[TRANSMITTER].summary = OIDS::TRANS_SUMMARY;
+    components[TRANSMITTER].diagNodes.assign(transDiag, transDiag + sizeof(transDiag)/sizeof(transDiag[0]));
+
+    components[RF_SENSOR].name = "RFsensor";
+    components[RF_SENSOR].summary = OIDS::RF_LINK;
+    components[RF_SENSOR].diagNodes.assign(rfsDiag, rfsDiag + sizeof(rfsDiag)/sizeof(rfsDiag[0]));
+
+    components[OUT_STAGE].name = "OutStage";
+    components[OUT_STAGE].summary = OIDS::OSTAGE_SUMMARY;
+
+    components[MTX].name = "MTx";
+    components[MTX].summary = OIDS::MTX_SUMMARY;
+}
+
+TransmitterTopology TransmitterTopology::load(const std::string& fileName)
+{
+    std::ifstream file(fileName.c_str());
+    if(!file)
+    {
+        throw RfTopologyException("Failed to open topology file: " + fileName);
+    }
+
+    std::stringstream content;
+    content << file.rdbuf();
+    return parse(content.str());
+}
+
+TransmitterTopology TransmitterTopology::parse(const std::string& json)
+{
+    JsonParser parser(json);
+    std::shared_ptr<JsonValue> root = parser.parseDocument();
+
+    if(root->type != JsonValue::OBJECT)
+    {
+        throw RfTopologyException("Topology must be a JSON object.");
+    }
+
+    TransmitterTopology topology;
+
+    // OID table overrides.
+    const JsonValue* oidsValue = root->find("oids");
+    if(oidsValue != 0)
+    {
+        for(size_t i = 0; i < oidsValue->keys.size(); i++)
+        {
+            if(oidsValue->items[i]->type != JsonValue::STRING)
+            {
+                throw RfTopologyException("OID " + oidsValue->keys[i] + " must be a string.");
+            }
+            topology.oidTable[toOid(oidsValue->keys[i])] = oidsValue->items[i]->text;
+        }
+    }
+
+    // Component overrides.
+    const JsonValue* componentsValue = root->find("components");
+    if(componentsValue != 0)
+    {
+        for(size_t i = 0; i < componentsValue->keys.size(); i++)
+        {
+            size_t type = 0;
+            while(type < COMPONENT_TYPES_LENGTH && componentKeys[type] != componentsValue->keys[i])
+            {
+                type++;
+            }
+
+            if(type == COMPONENT_TYPES_LENGTH)
+            {
+                throw RfTopologyException("Unknown component in topology: " + componentsValue->keys[i]);
+            }
+
+            const JsonValue& description = *componentsValue->items[i];
+            ComponentTopology& component = topology.components[type];
+            const std::string& key = componentKeys[type];
+
+            if(description.find("name") != 0)
+            {
+                component.name = description.find("name")->text;
+            }
+            if(description.find("summary") != 0)
+            {
+                component.summary = toOid(description.find("summary")->text);
+            }
+            if(description.find("indices") != 0)
+            {
+                component.indices = toIndices(*description.find("indices"), key + ".indices");
+            }
+            if(description.find("diagNodes") != 0)
+            {
+                component.diagNodes = toStrings(*description.find("diagNodes"), key + ".diagNodes");
+            }
+        }
+    }
+
+    topology.validate();
+    return topology;
+}
+
+void TransmitterTopology::setOid(const OIDS oid, const std::string& value)
+{
+    oidTable.at(oid) = value;
+    validate();
+}
+
+void TransmitterTopology::setIndices(const ComponentTypes type, const std::vector<uint16_t>& indices)
+{
+    components.at(type).indices = indices;
+    validate();
+}
+
+std::vector<std::string> TransmitterTopology::expand(const OIDS oid, const ComponentTypes type) const
+{
+    if(getComponent(type).indices.empty())
+    {
+        return std::vector<std::string>(1, getOid(oid));
+    }
+
+    return RFcomponent::transformToOids(getOid(oid), getComponent(type).indices);
+}
+
+void TransmitterTopology::validate() const
+{
+    // OID templates used with device indices.
+    static const OIDS amplifierOids[] = {OIDS::AMP_ON};
+    static const OIDS liquidCoolingOids[] = {OIDS::LQ_TIN, OIDS::LQ_TOUT};
+
+    for(size_t i = 0; i < COMPONENT_TYPES_LENGTH; i++)
+    {
+        const ComponentTopology& component = components[i];
+
+        if(component.name.empty())
+        {
+            throw RfTopologyException("Component " + componentKeys[i] + " needs a name.");
+        }
+
+        // These components read their diagnostics with a bulk request that needs at least one node.
+        if((i == AMPLIFIERS || i == LIQUID_COOLING || i == TRANSMITTER || i == RF_SENSOR) && component.diagNodes.empty())
+        {
+            throw RfTopologyException("Component " + componentKeys[i] + " needs at least one diagnostics node.");
+        }
+
+        std::vector<OIDS> templates(1, component.summary);
+        if(i == AMPLIFIERS)
+        {
+            templates.insert(templates.end(), amplifierOids, amplifierOids + 1);
+        }
+        else if(i == LIQUID_COOLING)
+        {
+            templates.insert(templates.end(), liquidCoolingOids, liquidCoolingOids + 2);
+        }
+
+        for(size_t j = 0; j < templates.size(); j++)
+        {
+            bool isTemplate = getOid(templates[j]).find('X') != std::string::npos;
+            if(isTemplate != !component.indices.empty())
+            {
+                throw RfTopologyException("OID " + oidNames[templates[j]] + " of component " + componentKeys[i] +
+                                          (isTemplate ? " needs device indices." : " has no X to replace with device indices."));
+            }
+        }
+    }
+}
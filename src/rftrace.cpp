@@ -0,0 +1,176 @@
+#include "rftrace.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+std::atomic<bool> RFtrace::enabled(false);
+
+namespace
+{
+    /**
+     * @brief The ThreadBuffer struct Ring buffer of one thread. Only the owning thread writes, the lock is taken uncontended except while dumping.
+     */
+    struct ThreadBuffer
+    {
+        std::mutex lock; //!< Guards the events against dumping.
+        std::vector<RFtrace::Event> events; //!< Preallocated events.
+        uint64_t written; //!< Number of events written since the last enable. Next slot is written % size.
+        long tid; //!< Kernel thread ID.
+    };
+
+    std::mutex registryLock; //!< Guards the registry and the capacity.
+    std::vector<std::shared_ptr<ThreadBuffer> > registry; //!< Buffers of all threads that ever recorded. Kept after the thread exits.
+    size_t capacity = RFtrace::defaultEventsPerThread; //!< Size of new buffers.
+
+    __thread ThreadBuffer* threadBuffer = 0; //!< Buffer of the calling thread.
+
+    ThreadBuffer* createThreadBuffer()
+    {
+        std::shared_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+        buffer->written = 0;
+        buffer->tid = syscall(SYS_gettid);
+
+        std::unique_lock<std::mutex> l(registryLock);
+        buffer->events.resize(capacity);
+        registry.push_back(buffer);
+        return buffer.get();
+    }
+
+    /// Writes the string as JSON string content.
+    void writeEscaped(std::ostream& out, const char* text)
+    {
+        for(; *text != '\0'; text++)
+        {
+            if(*text == '"' || *text == '\\')
+            {
+                out << '\\' << *text;
+            }
+            else if(static_cast<unsigned char>(*text) >= 0x20)
+            {
+                out << *text;
+            }
+        }
+    }
+}
+
+void RFtrace::enable(const size_t eventsPerThread)
+{
+    if(eventsPerThread == 0)
+    {
+        throw std::invalid_argument("Trace buffer needs at least 1 event.");
+    }
+
+    std::unique_lock<std::mutex> l(registryLock);
+    capacity = eventsPerThread;
+
+    // Reallocate now so that recording never allocates.
+    for(size_t i = 0; i < registry.size(); i++)
+    {
+        std::unique_lock<std::mutex> bl(registry[i]->lock);
+        registry[i]->events.assign(capacity, Event());
+        registry[i]->written = 0;
+    }
+
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void RFtrace::disable()
+{
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+uint64_t RFtrace::now()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void RFtrace::record(const char* name, const std::string* detail, const uint64_t start, const uint64_t end)
+{
+    if(threadBuffer == 0)
+    {
+        threadBuffer = createThreadBuffer();
+    }
+
+    std::unique_lock<std::mutex> l(threadBuffer->lock);
+
+    Event& event = threadBuffer->events[threadBuffer->written % threadBuffer->events.size()];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+
+    if(detail != 0)
+    {
+        size_t length = std::min(detail->size(), detailLength - 1);
+        std::memcpy(event.detail, detail->data(), length);
+        event.detail[length] = '\0';
+    }
+    else
+    {
+        event.detail[0] = '\0';
+    }
+
+    threadBuffer->written++;
+}
+
+void RFtrace::writeChromeTrace(std::ostream& out)
+{
+    std::unique_lock<std::mutex> l(registryLock);
+
+    pid_t pid = getpid();
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for(size_t i = 0; i < registry.size(); i++)
+    {
+        ThreadBuffer& buffer = *registry[i];
+        std::unique_lock<std::mutex> bl(buffer.lock);
+
+        // Oldest event first. Only the last size() events survive in the ring.
+        uint64_t size = buffer.events.size();
+        uint64_t begin = (buffer.written > size) ? buffer.written - size : 0;
+
+        for(uint64_t j = begin; j < buffer.written; j++)
+        {
+            const Event& event = buffer.events[j % size];
+
+            out << (first ? "" : ",") << std::endl << "{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"cat\":\"rf\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer.tid
+                << ",\"ts\":" << event.start / 1000 << '.' << (event.start % 1000) / 100 << (event.start % 100) / 10 << event.start % 10
+                << ",\"dur\":" << event.duration / 1000 << '.' << (event.duration % 1000) / 100 << (event.duration % 100) / 10 << event.duration % 10;
+
+            if(event.detail[0] != '\0')
+            {
+                out << ",\"args\":{\"detail\":\"";
+                writeEscaped(out, event.detail);
+                out << "\"}";
+            }
+
+            out << "}";
+            first = false;
+        }
+    }
+
+    out << std::endl << "]}" << std::endl;
+}
+
+void RFtrace::writeChromeTrace(const std::string& fileName)
+{
+    std::ofstream out(fileName.c_str());
+    if(!out)
+    {
+        throw std::runtime_error("Failed to open trace file: " + fileName);
+    }
+
+    writeChromeTrace(out);
+}
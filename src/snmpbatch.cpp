@@ -0,0 +1,364 @@
+#include "snmpbatch.h"
+#include "snmpconnector.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+
+namespace
+{
+    /**
+     * @brief The BatchRequest class Request with its varbind list encoded in advance and the agent it goes to.
+     */
+    class BatchRequest : public SNMPpreparedRequest
+    {
+    public:
+        BatchRequest(const SNMPrequestSpec& spec, const sockaddr_in& address, const std::string& community)
+            : SNMPpreparedRequest(spec), address(address), community(community), pduType(sNMP_PDU_GET), errorIndex(0) {}
+
+        const sockaddr_in address; //!< Agent.
+        const std::string community; //!< Community string.
+        std::string varbinds; //!< Encoded varbind list.
+        uint8_t pduType; //!< PDU tag.
+        int32_t errorIndex; //!< Error index field, max-repetitions for GETBULK.
+    };
+
+    const size_t maxDatagram = 65535; //!< Largest UDP payload.
+    const int receiveBufferSize = 4 * 1024 * 1024; //!< Socket receive buffer wanted for the responses of many agents at once.
+}
+
+/**
+ * @brief The SNMPbatchTransport class Transport of one agent of a SNMPudpBatch.
+ */
+class SNMPbatchTransport : public SNMPtransport
+{
+public:
+    SNMPbatchTransport(const std::shared_ptr<SNMPudpBatch>& batch, const sockaddr_in& address, const std::string& community)
+        : batch(batch), address(address), community(community) {}
+
+    std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec)
+    {
+        std::shared_ptr<BatchRequest> request(new BatchRequest(spec, address, community));
+
+        switch(spec.operation)
+        {
+        case SNMP_GETBULK:
+            request->pduType = sNMP_PDU_GETBULK;
+            request->errorIndex = spec.maxRepetitions;
+            break;
+        case SNMP_SET:
+            request->pduType = sNMP_PDU_SET;
+            break;
+        default:
+            request->pduType = sNMP_PDU_GET;
+            break;
+        }
+
+        SNMPber::encodeVarbinds(spec.varbinds, request->varbinds);
+        return request;
+    }
+
+    int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response)
+    {
+        return batch->execute(request, response);
+    }
+
+private:
+    std::shared_ptr<SNMPudpBatch> batch; //!< Batch sending the requests.
+    const sockaddr_in address; //!< Agent.
+    const std::string community; //!< Community string.
+};
+
+SNMPudpBatch::SNMPudpBatch(const uint16_t timeout)
+    : timeout(timeout), socketFd(-1), requestId(static_cast<int32_t>(getpid() & 0xFFFF) << 12), sendCalls(0), receiveCalls(0),
+      datagrams(0), receiveBuffers(receiveBatch, std::vector<uint8_t>(maxDatagram)), receiveHeaders(receiveBatch),
+      receiveVectors(receiveBatch), receiveAddresses(receiveBatch), exchanging(false)
+{
+    socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(socketFd < 0)
+    {
+        throw SNMPconnectorException(std::string("Failed to open UDP socket: ") + std::strerror(errno));
+    }
+
+    // Best effort, the responses of a large batch arrive nearly at once. The kernel caps it at rmem_max.
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+    SNMPudpTransport::enableTimestamps(socketFd);
+
+    for(size_t i = 0; i < receiveBatch; i++)
+    {
+        receiveVectors[i].iov_base = &receiveBuffers[i][0];
+        receiveVectors[i].iov_len = maxDatagram;
+        std::memset(&receiveHeaders[i], 0, sizeof(mmsghdr));
+        receiveHeaders[i].msg_hdr.msg_iov = &receiveVectors[i];
+        receiveHeaders[i].msg_hdr.msg_iovlen = 1;
+        receiveHeaders[i].msg_hdr.msg_name = &receiveAddresses[i];
+        receiveHeaders[i].msg_hdr.msg_control = receiveControl[i];
+    }
+}
+
+SNMPudpBatch::~SNMPudpBatch()
+{
+    close(socketFd);
+}
+
+std::shared_ptr<SNMPtransport> SNMPudpBatch::addTarget(const std::shared_ptr<SNMPudpBatch>& batch, const std::string& ip,
+                                                       const std::string& community, const uint16_t port)
+{
+    if(!batch)
+    {
+        throw SNMPconnectorException("No batch provided.");
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if(inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1)
+    {
+        throw SNMPconnectorException("Not an IPv4 address: " + ip);
+    }
+
+    return std::shared_ptr<SNMPtransport>(new SNMPbatchTransport(batch, address, community));
+}
+
+void SNMPudpBatch::queue(SNMPpreparedRequest& request, SNMPresponse& response, int32_t& status)
+{
+    Pending pending = { &request, &response, &status, 0, 0, false };
+
+    std::unique_lock<std::mutex> l(lock);
+    queued.push_back(pending);
+}
+
+size_t SNMPudpBatch::exchange()
+{
+    std::unique_lock<std::mutex> l(lock);
+    while(exchanging)
+    {
+        exchanged.wait(l);
+    }
+
+    return lead(l);
+}
+
+int32_t SNMPudpBatch::execute(SNMPpreparedRequest& request, SNMPresponse& response)
+{
+    int32_t status = SNMP_CLASS_TIMEOUT;
+    bool done = false;
+    Pending pending = { &request, &response, &status, &done, 0, false };
+
+    std::unique_lock<std::mutex> l(lock);
+    queued.push_back(pending);
+
+    // Group commit: requests queued while an exchange runs go together with the next one.
+    while(!done)
+    {
+        if(exchanging)
+        {
+            exchanged.wait(l);
+        }
+        else
+        {
+            lead(l);
+        }
+    }
+
+    return status;
+}
+
+size_t SNMPudpBatch::lead(std::unique_lock<std::mutex>& l)
+{
+    sending.swap(queued);
+    queued.clear();
+    exchanging = true;
+    l.unlock();
+
+    size_t answered = 0;
+    if(!sending.empty())
+    {
+        send();
+        answered = receive();
+    }
+
+    l.lock();
+    for(size_t i = 0; i < sending.size(); i++)
+    {
+        if(sending[i].done != 0)
+        {
+            *sending[i].done = true;
+        }
+    }
+    sending.clear();
+    exchanging = false;
+    l.unlock();
+
+    exchanged.notify_all();
+    l.lock();
+    return answered;
+}
+
+void SNMPudpBatch::send()
+{
+    size_t count = sending.size();
+    if(messages.size() < count)
+    {
+        messages.resize(count);
+    }
+    sendHeaders.resize(count);
+    sendVectors.resize(count);
+    byRequestId.clear();
+
+    for(size_t i = 0; i < count; i++)
+    {
+        Pending& pending = sending[i];
+        BatchRequest& request = static_cast<BatchRequest&>(*pending.request);
+
+        requestId = (requestId + 1) & 0x7FFFFFFF;
+        pending.requestId = requestId;
+        pending.answered = false;
+        *pending.status = SNMP_CLASS_TIMEOUT;
+        byRequestId[requestId] = i;
+
+        SNMPber::encodeMessage(SNMPber::version2c, request.community, request.pduType, requestId, 0, request.errorIndex,
+                               request.varbinds, messages[i]);
+
+        pending.response->requestSize = messages[i].size();
+        pending.response->responseSize = 0;
+        pending.response->varbinds.clear();
+
+        sendVectors[i].iov_base = const_cast<char*>(messages[i].data());
+        sendVectors[i].iov_len = messages[i].size();
+        std::memset(&sendHeaders[i], 0, sizeof(mmsghdr));
+        sendHeaders[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&request.address);
+        sendHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        sendHeaders[i].msg_hdr.msg_iov = &sendVectors[i];
+        sendHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // One send call for all, they leave within microseconds of each other.
+    uint64_t sentTime = wallClockNanoseconds();
+    for(size_t i = 0; i < count; i++)
+    {
+        sending[i].response->sentTime = sentTime;
+    }
+
+    size_t sent = 0;
+    while(sent < count)
+    {
+        int result = sendmmsg(socketFd, &sendHeaders[sent], count - sent, 0);
+        sendCalls++;
+        if(result > 0)
+        {
+            sent += static_cast<size_t>(result);
+            continue;
+        }
+        if(result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // The first remaining datagram can not be sent. It fails alone, the rest goes on.
+        *sending[sent].status = SNMP_CLASS_TL_FAILED;
+        sending[sent].answered = true;
+        sent++;
+    }
+    datagrams += count;
+}
+
+size_t SNMPudpBatch::receive()
+{
+    size_t open = 0;
+    for(size_t i = 0; i < sending.size(); i++)
+    {
+        if(!sending[i].answered)
+        {
+            open++;
+        }
+    }
+
+    size_t answered = 0;
+    uint64_t deadline = monotonicMicroseconds() + timeout * 1000ull;
+    while(answered < open)
+    {
+        uint64_t now = monotonicMicroseconds();
+        if(now >= deadline)
+        {
+            break;
+        }
+
+        pollfd descriptor;
+        descriptor.fd = socketFd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+
+        int ready = poll(&descriptor, 1, static_cast<int>((deadline - now + 999) / 1000));
+        if(ready <= 0)
+        {
+            if(ready < 0 && errno != EINTR)
+            {
+                break;
+            }
+            continue;
+        }
+
+        for(size_t i = 0; i < receiveBatch; i++)
+        {
+            receiveHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            receiveHeaders[i].msg_hdr.msg_controllen = SNMPudpTransport::controlSize;
+        }
+
+        int received = recvmmsg(socketFd, &receiveHeaders[0], receiveBatch, MSG_DONTWAIT, 0);
+        if(received <= 0)
+        {
+            continue;
+        }
+
+        receiveCalls++;
+        for(int i = 0; i < received; i++)
+        {
+            if(dispatch(&receiveBuffers[i][0], receiveHeaders[i].msg_len, receiveAddresses[i],
+                        SNMPudpTransport::receiveTime(receiveHeaders[i].msg_hdr)))
+            {
+                answered++;
+            }
+        }
+    }
+
+    return answered;
+}
+
+bool SNMPudpBatch::dispatch(const uint8_t* data, const size_t length, const sockaddr_in& from, const uint64_t time)
+{
+    // Late answers to earlier exchanges and garbage are dropped.
+    if(!SNMPber::decodeMessage(data, length, decoded) || decoded.pduType != sNMP_PDU_RESPONSE)
+    {
+        return false;
+    }
+
+    std::unordered_map<int32_t, size_t>::const_iterator found = byRequestId.find(decoded.requestId);
+    if(found == byRequestId.end())
+    {
+        return false;
+    }
+
+    Pending& pending = sending[found->second];
+    const sockaddr_in& address = static_cast<BatchRequest&>(*pending.request).address;
+    if(pending.answered || from.sin_addr.s_addr != address.sin_addr.s_addr || from.sin_port != address.sin_port)
+    {
+        return false;
+    }
+
+    pending.answered = true;
+    pending.response->responseSize = length;
+    pending.response->receivedTime = time;
+    if(decoded.errorStatus != 0)
+    {
+        *pending.status = decoded.errorStatus;
+        return true;
+    }
+
+    // Swap so both vectors keep their capacity for the next exchange.
+    pending.response->varbinds.swap(decoded.varbinds);
+    *pending.status = SNMP_CLASS_SUCCESS;
+    return true;
+}
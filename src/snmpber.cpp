@@ -0,0 +1,513 @@
+#include "snmpber.h"
+#include <cstdlib>
+
+namespace
+{
+    const uint8_t tagInteger = 0x02;
+    const uint8_t tagOctets = 0x04;
+    const uint8_t tagNull = 0x05;
+    const uint8_t tagOid = 0x06;
+    const uint8_t tagSequence = 0x30;
+
+    /// Number of octets needed for the length field.
+    size_t lengthSize(const size_t length)
+    {
+        size_t toReturn = 1;
+        for(size_t rest = length; rest >= 0x80 || (toReturn > 1 && rest > 0); rest >>= 8)
+        {
+            toReturn++;
+        }
+        return (length < 0x80) ? 1 : toReturn;
+    }
+
+    void appendLength(std::string& out, const size_t length)
+    {
+        if(length < 0x80)
+        {
+            out += static_cast<char>(length);
+            return;
+        }
+
+        size_t octets = lengthSize(length) - 1;
+        out += static_cast<char>(0x80 | octets);
+        for(size_t i = octets; i > 0; i--)
+        {
+            out += static_cast<char>((length >> (8 * (i - 1))) & 0xFF);
+        }
+    }
+
+    /// Minimal two's complement content octets. Returns the number of octets written to the end of the buffer.
+    size_t integerContent(const int64_t value, uint8_t (&octets)[9])
+    {
+        uint64_t bits = static_cast<uint64_t>(value);
+        for(size_t i = 0; i < 8; i++)
+        {
+            octets[8 - i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+
+        // Drop leading octets that only repeat the sign.
+        size_t start = 1;
+        while(start < 8 && ((octets[start] == 0x00 && !(octets[start + 1] & 0x80)) || (octets[start] == 0xFF && (octets[start + 1] & 0x80))))
+        {
+            start++;
+        }
+        return 9 - start;
+    }
+
+    /// Unsigned values get a leading zero if the top bit is set.
+    size_t unsignedContent(const uint64_t value, uint8_t (&octets)[9])
+    {
+        octets[0] = 0;
+        for(size_t i = 0; i < 8; i++)
+        {
+            octets[8 - i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+
+        size_t start = 0;
+        while(start < 8 && octets[start] == 0x00 && !(octets[start + 1] & 0x80))
+        {
+            start++;
+        }
+        return 9 - start;
+    }
+
+    size_t integerSize(const int64_t value)
+    {
+        uint8_t octets[9];
+        return 2 + integerContent(value, octets);
+    }
+
+    void appendContent(std::string& out, const uint8_t tag, const uint8_t (&octets)[9], const size_t length)
+    {
+        out += static_cast<char>(tag);
+        out += static_cast<char>(length);
+        out.append(reinterpret_cast<const char*>(octets + 9 - length), length);
+    }
+
+    void appendInteger(std::string& out, const uint8_t tag, const int64_t value)
+    {
+        uint8_t octets[9];
+        appendContent(out, tag, octets, integerContent(value, octets));
+    }
+
+    void appendUnsigned(std::string& out, const uint8_t tag, const uint64_t value)
+    {
+        uint8_t octets[9];
+        appendContent(out, tag, octets, unsignedContent(value, octets));
+    }
+
+    void appendTlv(std::string& out, const uint8_t tag, const std::string& content)
+    {
+        out += static_cast<char>(tag);
+        appendLength(out, content.size());
+        out += content;
+    }
+
+    /// Appends the number in decimal without going through a stream.
+    void appendDecimal(std::string& out, uint64_t value, const bool negative = false)
+    {
+        char digits[24];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while(value > 0);
+
+        if(negative)
+        {
+            out += '-';
+        }
+        while(count > 0)
+        {
+            out += digits[--count];
+        }
+    }
+
+    void appendSigned(std::string& out, const int64_t value)
+    {
+        appendDecimal(out, (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), value < 0);
+    }
+
+    /**
+     * @brief The Reader struct Cursor over a BER buffer.
+     */
+    struct Reader
+    {
+        const uint8_t* position; //!< Next octet.
+        const uint8_t* end; //!< End of the current constructed value.
+
+        /// Reads tag and length. Only single octet tags are used by SNMP.
+        bool header(uint8_t& tag, size_t& length)
+        {
+            if(end - position < 2)
+            {
+                return false;
+            }
+
+            tag = *position++;
+            length = *position++;
+
+            if(length & 0x80)
+            {
+                size_t octets = length & 0x7F;
+                if(octets == 0 || octets > 4 || static_cast<size_t>(end - position) < octets)
+                {
+                    return false;
+                }
+
+                length = 0;
+                for(size_t i = 0; i < octets; i++)
+                {
+                    length = (length << 8) | *position++;
+                }
+            }
+
+            return length <= static_cast<size_t>(end - position);
+        }
+
+        bool expect(const uint8_t expected, size_t& length)
+        {
+            uint8_t tag;
+            return header(tag, length) && tag == expected;
+        }
+
+        bool integer(int64_t& value)
+        {
+            size_t length;
+            if(!expect(tagInteger, length) || length < 1 || length > 8)
+            {
+                return false;
+            }
+
+            value = (*position & 0x80) ? -1 : 0;
+            for(size_t i = 0; i < length; i++)
+            {
+                value = static_cast<int64_t>((static_cast<uint64_t>(value) << 8) | *position++);
+            }
+            return true;
+        }
+
+        bool integer32(int32_t& value)
+        {
+            int64_t wide;
+            if(!integer(wide))
+            {
+                return false;
+            }
+            value = static_cast<int32_t>(wide);
+            return true;
+        }
+    };
+
+    /// Decodes OID content octets to dotted format.
+    bool decodeOid(const uint8_t* data, const size_t length, std::string& out)
+    {
+        out.clear();
+        uint64_t subIdentifier = 0;
+        bool first = true;
+
+        for(size_t i = 0; i < length; i++)
+        {
+            subIdentifier = (subIdentifier << 7) | (data[i] & 0x7F);
+            if(subIdentifier > 0xFFFFFFFFu)
+            {
+                return false;
+            }
+
+            if(!(data[i] & 0x80))
+            {
+                if(first)
+                {
+                    uint64_t arc = (subIdentifier < 80) ? subIdentifier / 40 : 2;
+                    appendDecimal(out, arc);
+                    out += '.';
+                    appendDecimal(out, subIdentifier - 40 * arc);
+                    first = false;
+                }
+                else
+                {
+                    out += '.';
+                    appendDecimal(out, subIdentifier);
+                }
+                subIdentifier = 0;
+            }
+        }
+
+        return !first && (length == 0 || !(data[length - 1] & 0x80));
+    }
+
+    /// Decodes the value to printable format.
+    bool decodeValue(const uint8_t tag, const uint8_t* data, const size_t length, std::string& out)
+    {
+        out.clear();
+
+        switch(tag)
+        {
+        case sNMP_SYNTAX_INT:
+        {
+            if(length < 1 || length > 8)
+            {
+                return false;
+            }
+            int64_t value = (data[0] & 0x80) ? -1 : 0;
+            for(size_t i = 0; i < length; i++)
+            {
+                value = static_cast<int64_t>((static_cast<uint64_t>(value) << 8) | data[i]);
+            }
+            appendSigned(out, value);
+            return true;
+        }
+        case sNMP_SYNTAX_CNTR32:
+        case sNMP_SYNTAX_GAUGE32:
+        case sNMP_SYNTAX_TIMETICKS:
+        case sNMP_SYNTAX_CNTR64:
+        {
+            if(length < 1 || length > 9)
+            {
+                return false;
+            }
+            uint64_t value = 0;
+            for(size_t i = 0; i < length; i++)
+            {
+                value = (value << 8) | data[i];
+            }
+            appendDecimal(out, value);
+            return true;
+        }
+        case sNMP_SYNTAX_OID:
+            return decodeOid(data, length, out);
+        case sNMP_SYNTAX_IPADDR:
+        {
+            for(size_t i = 0; i < length; i++)
+            {
+                if(i > 0)
+                {
+                    out += '.';
+                }
+                appendDecimal(out, data[i]);
+            }
+            return true;
+        }
+        default:
+            // Octets, opaque, NULL and the exceptions are taken as they are.
+            out.assign(reinterpret_cast<const char*>(data), length);
+            return true;
+        }
+    }
+}
+
+const int32_t SNMPber::version2c;
+
+bool SNMPber::encodeOid(const std::string& oid, std::string& out)
+{
+    // Parse the arcs.
+    uint32_t arcs[128];
+    size_t count = 0;
+    const char* position = oid.c_str();
+    if(*position == '.')
+    {
+        position++;
+    }
+
+    while(*position != '\0')
+    {
+        char* end;
+        unsigned long arc = std::strtoul(position, &end, 10);
+        if(end == position || count == 128 || arc > 0xFFFFFFFFul || (*end != '.' && *end != '\0'))
+        {
+            return false;
+        }
+        arcs[count++] = static_cast<uint32_t>(arc);
+        position = (*end == '.') ? end + 1 : end;
+    }
+
+    if(count < 2 || arcs[0] > 2 || (arcs[0] < 2 && arcs[1] >= 40))
+    {
+        return false;
+    }
+
+    // First two arcs share one sub-identifier.
+    arcs[1] += 40 * arcs[0];
+    for(size_t i = 1; i < count; i++)
+    {
+        uint8_t octets[5];
+        size_t length = 0;
+        uint32_t value = arcs[i];
+        do
+        {
+            octets[4 - length] = static_cast<uint8_t>((value & 0x7F) | (length > 0 ? 0x80 : 0));
+            value >>= 7;
+            length++;
+        } while(value > 0);
+
+        out.append(reinterpret_cast<const char*>(octets + 5 - length), length);
+    }
+
+    return true;
+}
+
+void SNMPber::encodeVarbinds(const std::vector<SNMPvarbind>& varbinds, std::string& out)
+{
+    std::string list;
+
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        const SNMPvarbind& varbind = varbinds[i];
+        std::string content;
+
+        std::string oid;
+        if(!encodeOid(varbind.oid, oid))
+        {
+            oid.clear(); // Encoded as an empty OID, the agent will answer with an error.
+        }
+        appendTlv(content, tagOid, oid);
+
+        switch(varbind.syntax)
+        {
+        case sNMP_SYNTAX_INT:
+            appendInteger(content, tagInteger, std::strtoll(varbind.value.c_str(), 0, 10));
+            break;
+        case sNMP_SYNTAX_CNTR32:
+        case sNMP_SYNTAX_GAUGE32:
+        case sNMP_SYNTAX_TIMETICKS:
+        case sNMP_SYNTAX_CNTR64:
+            appendUnsigned(content, static_cast<uint8_t>(varbind.syntax), std::strtoull(varbind.value.c_str(), 0, 10));
+            break;
+        case sNMP_SYNTAX_OCTETS:
+        case sNMP_SYNTAX_OPAQUE:
+            appendTlv(content, static_cast<uint8_t>(varbind.syntax), varbind.value);
+            break;
+        case sNMP_SYNTAX_OID:
+        {
+            std::string value;
+            encodeOid(varbind.value, value);
+            appendTlv(content, tagOid, value);
+            break;
+        }
+        case sNMP_SYNTAX_IPADDR:
+        {
+            std::string value;
+            const char* position = varbind.value.c_str();
+            for(size_t j = 0; j < 4; j++)
+            {
+                char* end;
+                value += static_cast<char>(std::strtoul(position, &end, 10));
+                position = (*end == '.') ? end + 1 : end;
+            }
+            appendTlv(content, static_cast<uint8_t>(sNMP_SYNTAX_IPADDR), value);
+            break;
+        }
+        case sNMP_SYNTAX_NOSUCHOBJECT:
+        case sNMP_SYNTAX_NOSUCHINSTANCE:
+        case sNMP_SYNTAX_ENDOFMIBVIEW:
+            content += static_cast<char>(varbind.syntax);
+            content += '\0';
+            break;
+        default:
+            content += static_cast<char>(tagNull);
+            content += '\0';
+            break;
+        }
+
+        appendTlv(list, tagSequence, content);
+    }
+
+    appendTlv(out, tagSequence, list);
+}
+
+void SNMPber::encodeMessage(const int32_t version, const std::string& community, const uint8_t pduType, const int32_t requestId,
+                            const int32_t errorStatus, const int32_t errorIndex, const std::string& varbinds, std::string& out)
+{
+    // Sizes are computed first so the message is written front to back in one pass.
+    size_t pduBody = integerSize(requestId) + integerSize(errorStatus) + integerSize(errorIndex) + varbinds.size();
+    size_t pdu = 1 + lengthSize(pduBody) + pduBody;
+    size_t messageBody = integerSize(version) + 1 + lengthSize(community.size()) + community.size() + pdu;
+
+    out.clear();
+    out += static_cast<char>(tagSequence);
+    appendLength(out, messageBody);
+    appendInteger(out, tagInteger, version);
+    out += static_cast<char>(tagOctets);
+    appendLength(out, community.size());
+    out += community;
+    out += static_cast<char>(pduType);
+    appendLength(out, pduBody);
+    appendInteger(out, tagInteger, requestId);
+    appendInteger(out, tagInteger, errorStatus);
+    appendInteger(out, tagInteger, errorIndex);
+    out += varbinds;
+}
+
+bool SNMPber::decodeMessage(const uint8_t* data, const size_t length, SNMPmessage& message)
+{
+    Reader reader;
+    reader.position = data;
+    reader.end = data + length;
+
+    size_t size;
+    if(!reader.expect(tagSequence, size))
+    {
+        return false;
+    }
+    reader.end = reader.position + size;
+
+    if(!reader.integer32(message.version) || !reader.expect(tagOctets, size))
+    {
+        return false;
+    }
+    message.community.assign(reinterpret_cast<const char*>(reader.position), size);
+    reader.position += size;
+
+    // PDU.
+    uint8_t tag;
+    if(!reader.header(tag, size) || (tag & 0xF0) != 0xA0)
+    {
+        return false;
+    }
+    message.pduType = tag;
+    reader.end = reader.position + size;
+
+    if(!reader.integer32(message.requestId) || !reader.integer32(message.errorStatus) || !reader.integer32(message.errorIndex) ||
+       !reader.expect(tagSequence, size))
+    {
+        return false;
+    }
+    reader.end = reader.position + size;
+
+    // Varbinds. Existing entries are reused so their strings keep the capacity.
+    size_t count = 0;
+    while(reader.position < reader.end)
+    {
+        if(!reader.expect(tagSequence, size))
+        {
+            return false;
+        }
+
+        Reader varbind;
+        varbind.position = reader.position;
+        varbind.end = reader.position + size;
+        reader.position = varbind.end;
+
+        if(count == message.varbinds.size())
+        {
+            message.varbinds.push_back(SNMPvarbind());
+        }
+        SNMPvarbind& out = message.varbinds[count++];
+
+        if(!varbind.expect(tagOid, size) || !decodeOid(varbind.position, size, out.oid))
+        {
+            return false;
+        }
+        varbind.position += size;
+
+        if(!varbind.header(tag, size) || !decodeValue(tag, varbind.position, size, out.value))
+        {
+            return false;
+        }
+        out.syntax = tag;
+    }
+    message.varbinds.resize(count);
+
+    return true;
+}
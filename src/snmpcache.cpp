@@ -0,0 +1,271 @@
+#include "snmpcache.h"
+#include "snmpconnector.h"
+#include "snmpstatistics.h"
+
+namespace
+{
+    /**
+     * @brief The CachedRequest class Request with the prepared requests of the agent transport.
+     */
+    class CachedRequest : public SNMPpreparedRequest
+    {
+    public:
+        explicit CachedRequest(const SNMPrequestSpec& spec) : SNMPpreparedRequest(spec) {}
+
+        std::shared_ptr<SNMPpreparedRequest> full; //!< The whole request.
+        std::map<uint64_t, std::shared_ptr<SNMPpreparedRequest> > partial; //!< GETs of some of the OIDs, keyed by bit mask of the varbinds.
+        std::vector<std::string> bulkOids; //!< Objects the bulk read returned last time. Empty if it can not be answered from the cache.
+        std::vector<size_t> missing; //!< Varbinds not found in the cache.
+        SNMPresponse partialResponse; //!< Response buffer of the partial GETs.
+    };
+
+    const size_t maxPartial = 64; //!< Largest GET that is split into cached and missing OIDs.
+
+    bool isException(const int32_t syntax)
+    {
+        return (syntax == sNMP_SYNTAX_NOSUCHOBJECT) || (syntax == sNMP_SYNTAX_NOSUCHINSTANCE) || (syntax == sNMP_SYNTAX_ENDOFMIBVIEW);
+    }
+}
+
+SNMPcachingTransport::SNMPcachingTransport(const std::shared_ptr<SNMPtransport>& transport, const uint32_t freshness)
+    : transport(transport), freshness(static_cast<uint64_t>(freshness) * 1000), hits(0), misses(0)
+{
+    if(!transport)
+    {
+        throw SNMPconnectorException("No transport provided.");
+    }
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPcachingTransport::prepare(const SNMPrequestSpec& spec)
+{
+    std::shared_ptr<CachedRequest> request(new CachedRequest(spec));
+    request->full = transport->prepare(spec);
+    return request;
+}
+
+int32_t SNMPcachingTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    CachedRequest& request = static_cast<CachedRequest&>(preparedRequest);
+    const SNMPrequestSpec& spec = request.spec;
+    uint64_t now = monotonicMicroseconds();
+
+    if(spec.operation == SNMP_SET)
+    {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            for(size_t i = 0; i < spec.varbinds.size(); i++)
+            {
+                cache.erase(spec.varbinds[i].oid);
+            }
+        }
+        return transport->execute(*request.full, response);
+    }
+
+    if(spec.operation == SNMP_GETBULK)
+    {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            bool fresh = !request.bulkOids.empty();
+            response.varbinds.resize(request.bulkOids.size());
+            response.sentTime = 0;
+            response.receivedTime = 0;
+            for(size_t i = 0; fresh && i < request.bulkOids.size(); i++)
+            {
+                fresh = lookup(request.bulkOids[i], now, response.varbinds[i], response);
+            }
+
+            if(fresh)
+            {
+                hits += request.bulkOids.size();
+                response.requestSize = 0;
+                response.responseSize = 0;
+                return SNMP_CLASS_SUCCESS;
+            }
+        }
+
+        uint64_t sent = wallClockNanoseconds();
+        response.sentTime = 0;
+        response.receivedTime = 0;
+        int32_t status = transport->execute(*request.full, response);
+        if(status == SNMP_CLASS_SUCCESS)
+        {
+            stamp(response, sent);
+
+            // Only complete answers can be repeated from the cache.
+            request.bulkOids.resize(response.varbinds.size());
+            for(size_t i = 0; i < response.varbinds.size(); i++)
+            {
+                request.bulkOids[i].assign(response.varbinds[i].oid);
+                if(isException(response.varbinds[i].syntax))
+                {
+                    request.bulkOids.clear();
+                    break;
+                }
+            }
+            store(response.varbinds, monotonicMicroseconds(), response);
+        }
+        return status;
+    }
+
+    // GET. Find out what is missing.
+    uint64_t mask = 0;
+    request.missing.clear();
+    {
+        std::unique_lock<std::mutex> l(lock);
+        response.varbinds.resize(spec.varbinds.size());
+        response.sentTime = 0;
+        response.receivedTime = 0;
+        for(size_t i = 0; i < spec.varbinds.size(); i++)
+        {
+            if(!lookup(spec.varbinds[i].oid, now, response.varbinds[i], response))
+            {
+                request.missing.push_back(i);
+                mask |= (i < maxPartial) ? (static_cast<uint64_t>(1) << i) : 0;
+            }
+        }
+        hits += spec.varbinds.size() - request.missing.size();
+    }
+
+    if(request.missing.empty())
+    {
+        response.requestSize = 0;
+        response.responseSize = 0;
+        return SNMP_CLASS_SUCCESS;
+    }
+
+    int32_t status;
+    uint64_t sent = wallClockNanoseconds();
+    if(request.missing.size() == spec.varbinds.size() || spec.varbinds.size() > maxPartial)
+    {
+        response.sentTime = 0;
+        response.receivedTime = 0;
+        status = transport->execute(*request.full, response);
+        if(status == SNMP_CLASS_SUCCESS)
+        {
+            stamp(response, sent);
+            store(response.varbinds, monotonicMicroseconds(), response);
+        }
+        return status;
+    }
+
+    // One GET of the missing OIDs only, prepared once per combination.
+    std::shared_ptr<SNMPpreparedRequest>& partial = request.partial[mask];
+    if(!partial)
+    {
+        SNMPrequestSpec missingSpec;
+        missingSpec.operation = SNMP_GET;
+        missingSpec.maxRepetitions = 0;
+        missingSpec.priority = spec.priority;
+        for(size_t i = 0; i < request.missing.size(); i++)
+        {
+            missingSpec.varbinds.push_back(spec.varbinds[request.missing[i]]);
+        }
+        partial = transport->prepare(missingSpec);
+    }
+
+    SNMPresponse& fetched = request.partialResponse;
+    fetched.sentTime = 0;
+    fetched.receivedTime = 0;
+    status = transport->execute(*partial, fetched);
+    response.requestSize = fetched.requestSize;
+    response.responseSize = fetched.responseSize;
+    if(status != SNMP_CLASS_SUCCESS)
+    {
+        return status;
+    }
+
+    if(fetched.varbinds.size() != request.missing.size())
+    {
+        return SNMP_CLASS_ERROR;
+    }
+
+    for(size_t i = 0; i < request.missing.size(); i++)
+    {
+        SNMPvarbind& out = response.varbinds[request.missing[i]];
+        out.oid.assign(fetched.varbinds[i].oid);
+        out.value.assign(fetched.varbinds[i].value);
+        out.syntax = fetched.varbinds[i].syntax;
+    }
+    stamp(fetched, sent);
+    age(response, fetched.sentTime, fetched.receivedTime);
+    store(fetched.varbinds, monotonicMicroseconds(), fetched);
+    return status;
+}
+
+void SNMPcachingTransport::invalidate()
+{
+    std::unique_lock<std::mutex> l(lock);
+    cache.clear();
+}
+
+uint64_t SNMPcachingTransport::getHits()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return hits;
+}
+
+uint64_t SNMPcachingTransport::getMisses()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return misses;
+}
+
+bool SNMPcachingTransport::lookup(const std::string& oid, const uint64_t now, SNMPvarbind& out, SNMPresponse& response)
+{
+    std::unordered_map<std::string, Entry>::const_iterator found = cache.find(oid);
+    if(found == cache.end() || now - found->second.time >= freshness)
+    {
+        return false;
+    }
+
+    out.oid.assign(oid);
+    out.value.assign(found->second.value);
+    out.syntax = found->second.syntax;
+    age(response, found->second.sentTime, found->second.receivedTime);
+    return true;
+}
+
+void SNMPcachingTransport::store(const std::vector<SNMPvarbind>& varbinds, const uint64_t now, const SNMPresponse& times)
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    misses += varbinds.size();
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        if(isException(varbinds[i].syntax))
+        {
+            continue;
+        }
+
+        Entry& entry = cache[varbinds[i].oid];
+        entry.value.assign(varbinds[i].value);
+        entry.syntax = varbinds[i].syntax;
+        entry.time = now;
+        entry.sentTime = times.sentTime;
+        entry.receivedTime = times.receivedTime;
+    }
+}
+
+void SNMPcachingTransport::stamp(SNMPresponse& response, const uint64_t sent)
+{
+    if(response.sentTime == 0)
+    {
+        response.sentTime = sent;
+    }
+    if(response.receivedTime == 0)
+    {
+        response.receivedTime = wallClockNanoseconds();
+    }
+}
+
+void SNMPcachingTransport::age(SNMPresponse& response, const uint64_t sentTime, const uint64_t receivedTime)
+{
+    if(response.sentTime == 0 || sentTime < response.sentTime)
+    {
+        response.sentTime = sentTime;
+    }
+    if(response.receivedTime == 0 || receivedTime < response.receivedTime)
+    {
+        response.receivedTime = receivedTime;
+    }
+}
@@ -0,0 +1,281 @@
+#include "snmpcapture.h"
+#include "snmpconnector.h"
+#include <sstream>
+#include <unistd.h>
+
+namespace
+{
+    /**
+     * @brief The CaptureRequest class Request of the wrapped transport.
+     */
+    class CaptureRequest : public SNMPpreparedRequest
+    {
+    public:
+        CaptureRequest(const SNMPrequestSpec& spec, const std::shared_ptr<SNMPpreparedRequest>& request) : SNMPpreparedRequest(spec), request(request) {}
+
+        std::shared_ptr<SNMPpreparedRequest> request; //!< Request of the wrapped transport.
+    };
+
+    /**
+     * @brief The ReplayRequest class Request bound to its recorded exchanges.
+     */
+    class ReplayRequest : public SNMPpreparedRequest
+    {
+    public:
+        ReplayRequest(const SNMPrequestSpec& spec, const std::string& key) : SNMPpreparedRequest(spec), key(key) {}
+
+        const std::string key; //!< Key of the channel.
+    };
+
+    void writeVarbinds(std::ostream& out, const char tag, const std::vector<SNMPvarbind>& varbinds)
+    {
+        for(size_t i = 0; i < varbinds.size(); i++)
+        {
+            out << tag << ' ' << varbinds[i].syntax << ' ' << varbinds[i].oid << ' ';
+
+            const std::string& value = varbinds[i].value;
+            for(size_t j = 0; j < value.size(); j++)
+            {
+                switch(value[j])
+                {
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\r': out << "\\r"; break;
+                default: out << value[j]; break;
+                }
+            }
+            out << '\n';
+        }
+    }
+
+    SNMPvarbind readVarbind(std::istream& in, const char tag)
+    {
+        std::string line;
+        if(!std::getline(in, line) || line.size() < 2 || line[0] != tag)
+        {
+            throw SNMPconnectorException("Corrupted capture file.");
+        }
+
+        SNMPvarbind toReturn;
+        std::istringstream fields(line.substr(2));
+        if(!(fields >> toReturn.syntax >> toReturn.oid))
+        {
+            throw SNMPconnectorException("Corrupted capture file.");
+        }
+
+        // Value is the rest of the line after one space.
+        std::string value;
+        fields.get();
+        std::getline(fields, value);
+
+        for(size_t i = 0; i < value.size(); i++)
+        {
+            if(value[i] == '\\' && i + 1 < value.size())
+            {
+                i++;
+                toReturn.value += (value[i] == 'n') ? '\n' : ((value[i] == 'r') ? '\r' : value[i]);
+            }
+            else
+            {
+                toReturn.value += value[i];
+            }
+        }
+
+        return toReturn;
+    }
+}
+
+SNMPcaptureTransport::SNMPcaptureTransport(const std::shared_ptr<SNMPtransport>& transport, const std::string& fileName)
+    : transport(transport), out(fileName.c_str()), start(monotonicMicroseconds())
+{
+    if(!transport)
+    {
+        throw SNMPconnectorException("No transport provided.");
+    }
+
+    if(!out)
+    {
+        throw SNMPconnectorException("Failed to open capture file: " + fileName);
+    }
+
+    out << "RFCAP 1" << std::endl;
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPcaptureTransport::prepare(const SNMPrequestSpec& spec)
+{
+    return std::shared_ptr<SNMPpreparedRequest>(new CaptureRequest(spec, transport->prepare(spec)));
+}
+
+int32_t SNMPcaptureTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    CaptureRequest& request = static_cast<CaptureRequest&>(preparedRequest);
+
+    uint64_t time = monotonicMicroseconds() - start;
+    int32_t status = transport->execute(*request.request, response);
+
+    SNMPexchange exchange;
+    exchange.time = time;
+    exchange.operation = request.spec.operation;
+    exchange.maxRepetitions = request.spec.maxRepetitions;
+    exchange.status = status;
+    exchange.requestSize = response.requestSize;
+    exchange.responseSize = response.responseSize;
+    exchange.request = request.spec.varbinds;
+    exchange.response = response.varbinds;
+
+    std::unique_lock<std::mutex> l(lock);
+    writeExchange(out, exchange);
+    out.flush(); // Keep the capture usable if the process dies during a trip.
+
+    return status;
+}
+
+void SNMPcaptureTransport::writeExchange(std::ostream& out, const SNMPexchange& exchange)
+{
+    out << "X " << exchange.time << ' ' << exchange.operation << ' ' << exchange.maxRepetitions << ' ' << exchange.status << ' '
+        << exchange.requestSize << ' ' << exchange.responseSize << ' ' << exchange.request.size() << ' ' << exchange.response.size() << '\n';
+    writeVarbinds(out, 'Q', exchange.request);
+    writeVarbinds(out, 'R', exchange.response);
+}
+
+std::vector<SNMPexchange> SNMPcaptureTransport::readCapture(const std::string& fileName)
+{
+    std::ifstream in(fileName.c_str());
+    std::string line;
+
+    if(!in || !std::getline(in, line) || line != "RFCAP 1")
+    {
+        throw SNMPconnectorException("Not a capture file: " + fileName);
+    }
+
+    std::vector<SNMPexchange> toReturn;
+    while(std::getline(in, line))
+    {
+        if(line.empty())
+        {
+            continue;
+        }
+
+        SNMPexchange exchange;
+        int32_t operation;
+        size_t requestCount;
+        size_t responseCount;
+
+        std::istringstream fields(line);
+        std::string tag;
+        if(!(fields >> tag >> exchange.time >> operation >> exchange.maxRepetitions >> exchange.status >> exchange.requestSize
+             >> exchange.responseSize >> requestCount >> responseCount) || tag != "X" || operation < SNMP_GET || operation > SNMP_SET)
+        {
+            throw SNMPconnectorException("Corrupted capture file: " + fileName);
+        }
+        exchange.operation = static_cast<SNMPoperations>(operation);
+
+        for(size_t i = 0; i < requestCount; i++)
+        {
+            exchange.request.push_back(readVarbind(in, 'Q'));
+        }
+        for(size_t i = 0; i < responseCount; i++)
+        {
+            exchange.response.push_back(readVarbind(in, 'R'));
+        }
+
+        toReturn.push_back(exchange);
+    }
+
+    return toReturn;
+}
+
+SNMPreplayTransport::SNMPreplayTransport(const std::string& fileName, const double speed, const bool loop)
+    : capture(SNMPcaptureTransport::readCapture(fileName)), speed(speed), loop(loop), duration(0), start(monotonicMicroseconds()), replayed(0)
+{
+    for(size_t i = 0; i < capture.size(); i++)
+    {
+        Channel& channel = channels[key(capture[i].operation, capture[i].request)];
+        channel.exchanges.push_back(i);
+        channel.next = 0;
+        channel.loops = 0;
+    }
+
+    if(!capture.empty())
+    {
+        duration = capture.back().time - capture.front().time + 1;
+    }
+}
+
+std::string SNMPreplayTransport::key(const SNMPoperations operation, const std::vector<SNMPvarbind>& varbinds)
+{
+    // Written values do not identify the request, only the OIDs do.
+    std::string toReturn(1, static_cast<char>('0' + operation));
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        toReturn += ' ';
+        toReturn += varbinds[i].oid;
+    }
+    return toReturn;
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPreplayTransport::prepare(const SNMPrequestSpec& spec)
+{
+    return std::shared_ptr<SNMPpreparedRequest>(new ReplayRequest(spec, key(spec.operation, spec.varbinds)));
+}
+
+int32_t SNMPreplayTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    ReplayRequest& request = static_cast<ReplayRequest&>(preparedRequest);
+    const SNMPexchange* exchange = 0;
+    uint64_t due = 0;
+
+    {
+        std::unique_lock<std::mutex> l(lock);
+
+        std::map<std::string, Channel>::iterator found = channels.find(request.key);
+        if(found != channels.end())
+        {
+            Channel& channel = found->second;
+            if(channel.next == channel.exchanges.size() && loop)
+            {
+                channel.next = 0;
+                channel.loops++;
+            }
+
+            if(channel.next < channel.exchanges.size())
+            {
+                exchange = &capture[channel.exchanges[channel.next++]];
+                due = channel.loops * duration + exchange->time - capture.front().time;
+                replayed++;
+            }
+        }
+    }
+
+    response.requestSize = 0;
+    response.responseSize = 0;
+    response.varbinds.clear();
+
+    if(exchange == 0)
+    {
+        return SNMP_CLASS_TIMEOUT;
+    }
+
+    // Keep the recorded pace, scaled by speed.
+    if(speed > 0)
+    {
+        uint64_t wakeUp = start + static_cast<uint64_t>(due / speed);
+        uint64_t now = monotonicMicroseconds();
+        if(wakeUp > now)
+        {
+            usleep(wakeUp - now);
+        }
+    }
+
+    response.varbinds.assign(exchange->response.begin(), exchange->response.end());
+    response.requestSize = exchange->requestSize;
+    response.responseSize = exchange->responseSize;
+
+    return exchange->status;
+}
+
+uint64_t SNMPreplayTransport::getReplayed()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return replayed;
+}
@@ -4,51 +4,29 @@
 
 
 SNMPconnector::SNMPconnector(const std::string& ip, const std::string& community, const uint16_t port, const uint16_t timeout, const uint16_t retries)
+    : transport(new SNMPppTransport(ip, community, port, timeout)), retries(retries)
 {
-    // Start the socket resource acquisition.
-    //Snmp_pp::Snmp::socket_startup(); WIN Only
-
-    // Set IP and port.
-    Snmp_pp::UdpAddress address(ip.c_str());
-    address.set_port(port);
-
-    // We have the same community for READ and WRITE.
-    Snmp_pp::OctetStr comm(community.c_str());
-
-    int32_t status;
+}
 
-    // Start SNMP session. Use IPv6 if needed.
-    snmpSession.reset(new Snmp_pp::Snmp(status, 0, (address.get_ip_version() == Snmp_pp::Address::version_ipv6)));
+SNMPconnector::SNMPconnector(const std::string& ip, const SNMPv3credentials& credentials, const uint16_t port, const uint16_t timeout, const uint16_t retries)
+    : transport(new SNMPppTransport(ip, credentials, port, timeout)), retries(retries)
+{
+}
 
-    if (status != SNMP_CLASS_SUCCESS) // Any ERRORs?
+SNMPconnector::SNMPconnector(const std::shared_ptr<SNMPtransport>& transport, const uint16_t retries)
+    : transport(transport), retries(retries)
+{
+    if(!transport)
     {
-        throw SNMPconnectorException(snmpSession->error_msg(status));
+        throw SNMPconnectorException("No transport provided.");
     }
-
-    // Create a target for SNMP requests.
-    cTarget.reset(new Snmp_pp::CTarget(address));
-
-    cTarget->set_version(version);
-    cTarget->set_retry(retries);
-    cTarget->set_timeout(timeout/10); // Timeout goes in 10ms increments. So for 1000ms we actually write 100.
-    cTarget->set_readcommunity(comm);
-    cTarget->set_writecommunity(comm);
-
-    // Log only errors and warrnings.
-    Snmp_pp::DefaultLog::log()->set_filter(ERROR_LOG, 2);
-    Snmp_pp::DefaultLog::log()->set_filter(WARNING_LOG, 1);
-    Snmp_pp::DefaultLog::log()->set_filter(EVENT_LOG, 0);
-    Snmp_pp::DefaultLog::log()->set_filter(INFO_LOG, 0);
-    Snmp_pp::DefaultLog::log()->set_filter(DEBUG_LOG, 0);
 }
 
 SNMPconnector::~SNMPconnector()
 {
-    // Clean the socket.
-    //Snmp_pp::Snmp::socket_cleanup(); WIN Only
 }
 
-void SNMPconnector::createRequest(const std::string& name, const std::vector<std::string>& oids)
+void SNMPconnector::createRequest(const std::string& name, const std::vector<std::string>& oids, const SNMPpriorities priority)
 {
     // Check if at least one OID is specified.
     if(oids.size() < 1)
@@ -56,67 +34,264 @@ void SNMPconnector::createRequest(const std::string& name, const std::vector<std
         throw SNMPconnectorException("At least 1 oid needs to be specified.");
     }
 
-    addToMap(name);
-
-    std::vector<Snmp_pp::Vb> VBs;
-    VBs.reserve(oids.size()); // We know the number of VBs in advance.
+    SNMPrequestSpec spec;
+    spec.operation = SNMP_GET;
+    spec.maxRepetitions = 0;
+    spec.priority = priority;
+    spec.varbinds.resize(oids.size());
 
     // Each OID gets its own VB.
     for(size_t i = 0; i < oids.size(); i++)
     {
-        VBs.push_back(Snmp_pp::Vb(Snmp_pp::Oid(oids[i].c_str())));
+        spec.varbinds[i].oid = oids[i];
+        spec.varbinds[i].syntax = sNMP_SYNTAX_NULL;
     }
 
-    if(0 == requests.at(name).first->set_vblist(&VBs.at(0), VBs.size())) // Add whole list at once to PDU. Check for success.
+    addToMap(name, spec);
+}
+
+void SNMPconnector::createBulkRequest(const std::string& name, const std::string& oid, const uint16_t elements, const SNMPpriorities priority)
+{
+    SNMPrequestSpec spec;
+    spec.operation = SNMP_GETBULK;
+    spec.maxRepetitions = elements;
+    spec.priority = priority;
+    spec.varbinds.resize(1);
+    spec.varbinds[0].oid = oid;
+    spec.varbinds[0].syntax = sNMP_SYNTAX_NULL;
+
+    addToMap(name, spec);
+}
+
+namespace
+{
+    const char* const requestNotFound = "Request with this name does not exist."; //!< Error of reads of unknown requests.
+    const char* const prepareFailed = "Failed to prepare request."; //!< Error of reads the transport can not build.
+}
+
+const std::vector<std::string>& SNMPconnector::readRequest(const std::string& name, const bool ignoreSyntaxErrors)
+{
+    Request* request;
+    SNMPerror error = read(name, false, request);
+    if(error.failed())
+    {
+        throw SNMPconnectorException(error.message);
+    }
+
+    if(request->result.invalid > 0 && !ignoreSyntaxErrors)
     {
-        requests.erase(name);
-        throw SNMPconnectorException("Failed to add VBs to PDU.");
+        // Only built when something failed.
+        const SNMPresponse& response = request->response;
+        std::stringstream errorMsg;
+        for(size_t i = 0; i < response.varbinds.size(); i++)
+        {
+            if(toStatus(response.varbinds[i]) != SNMP_VARBIND_OK)
+            {
+                errorMsg << "On VB with OID: " << response.varbinds[i].oid << " error occured: " << response.varbinds[i].syntax << std::endl;
+            }
+        }
+
+        throw SNMPconnectorException(errorMsg.str());
     }
+
+    return request->result.values;
+}
+
+const SNMPresult& SNMPconnector::readResult(const std::string& name)
+{
+    return tryReadResult(name).value();
 }
 
-void SNMPconnector::createBulkRequest(const std::string& name, const std::string& oid, const uint16_t elements)
+SNMPexpected<SNMPresult> SNMPconnector::tryReadResult(const std::string& name)
 {
-    addToMap(name, elements);
+    Request* request;
+    SNMPerror error = read(name, true, request);
+    if(error.failed())
+    {
+        return error;
+    }
 
-    // Add VB to PDU.
-    *requests.at(name).first += Snmp_pp::Vb(Snmp_pp::Oid(oid.c_str()));
+    return request->result;
 }
 
-std::vector<std::string> SNMPconnector::readRequest(const std::string& name, const bool ignoreSyntaxErrors)
+SNMPerror SNMPconnector::read(const std::string& name, const bool pad, Request*& request)
 {
     // Check if the request exists.
-    if(requests.find(name) == requests.end())
+    std::unordered_map<std::string, Request>::iterator found = requests.find(name);
+    if(found == requests.end())
     {
-        throw SNMPconnectorException("Request with this name does not exist.");
+        return SNMPerror(SNMP_CLASS_ERROR, requestNotFound);
     }
+    request = &found->second;
 
-    std::vector<std::string> toReturn;
-
-    // Bulk request?
-    if(requests.at(name).second > 0)
+    // Prepared on first use. Requests that are never read, e.g. diagnostics of healthy devices, cost nothing.
+    if(!request->prepared)
     {
-        Snmp_pp::Vb tempVB;
-        requests.at(name).first->get_vb(tempVB, 0); // Remember the base.
+        try
+        {
+            request->prepared = transport->prepare(request->spec);
+        }
+        catch(const SNMPconnectorException&)
+        {
+            return SNMPerror(SNMP_CLASS_ERROR, prepareFailed);
+        }
+        std::vector<SNMPvarbind>().swap(request->spec.varbinds); // The prepared request keeps its own copy.
+    }
 
-        toReturn = extractData(snmpSession->get_bulk(*requests.at(name).first, *cTarget, 0, requests.at(name).second), *requests.at(name).first, ignoreSyntaxErrors);
+    RequestStatistics& stats = *request->statistics;
+    SNMPresponse& response = request->response;
+    const SNMPrequestSpec& spec = request->prepared->spec;
+    size_t expected = pad ? ((spec.operation == SNMP_GETBULK) ? spec.maxRepetitions : spec.varbinds.size()) : 0;
 
-        requests.at(name).first->clear(); // Clear all the returns.
-        *requests.at(name).first += tempVB; // Make a single base again.
-    }
-    else
-    {        
-        toReturn = extractData(snmpSession->get(*requests.at(name).first, *cTarget), *requests.at(name).first, ignoreSyntaxErrors);
+    int32_t status = execute(name, *request->prepared, response, stats);
+    if(status != SNMP_CLASS_SUCCESS) // Any ERRORs?
+    {
+        return SNMPerror(status, Snmp_pp::Snmp::error_msg(status));
     }
 
-    return toReturn;
+    extractData(name, response, expected, stats, request->result);
+    return SNMPerror();
 }
 
 void SNMPconnector::removeRequest(const std::string& name)
 {
     requests.erase(name);
+
+    std::unique_lock<std::mutex> l(statisticsLock);
+    statistics.erase(name);
+}
+
+void SNMPconnector::setRateLimiter(const std::shared_ptr<SNMPrateLimiter>& limiter)
+{
+    this->limiter = limiter;
+}
+
+std::map<std::string, RequestStatisticsSnapshot> SNMPconnector::getStatistics()
+{
+    std::unique_lock<std::mutex> l(statisticsLock);
+
+    std::map<std::string, RequestStatisticsSnapshot> toReturn;
+    for(std::unordered_map<std::string, std::shared_ptr<RequestStatistics> >::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+    {
+        toReturn.insert(std::make_pair(it->first, it->second->snapshot(it->first)));
+    }
+
+    return toReturn;
+}
+
+void SNMPconnector::resetStatistics()
+{
+    std::unique_lock<std::mutex> l(statisticsLock);
+
+    for(std::unordered_map<std::string, std::shared_ptr<RequestStatistics> >::iterator it = statistics.begin(); it != statistics.end(); ++it)
+    {
+        it->second->reset();
+    }
 }
 
-void SNMPconnector::addToMap(const std::string& name, const uint16_t noElements)
+std::shared_ptr<RequestStatistics> SNMPconnector::getStatisticsEntry(const std::string& name)
+{
+    std::unique_lock<std::mutex> l(statisticsLock);
+
+    std::shared_ptr<RequestStatistics>& entry = statistics[name];
+    if(!entry)
+    {
+        entry.reset(new RequestStatistics);
+    }
+
+    return entry;
+}
+
+int32_t SNMPconnector::execute(const std::string& name, SNMPpreparedRequest& request, SNMPresponse& response, RequestStatistics& stats)
+{
+    uint64_t start = monotonicMicroseconds();
+    int32_t status = SNMP_CLASS_TIMEOUT;
+    uint32_t varbinds = (request.spec.operation == SNMP_GETBULK) ? request.spec.maxRepetitions : request.spec.varbinds.size();
+
+    // Resend only on timeouts. Transports leave the request untouched in that case so it can be sent again as it is.
+    for(uint16_t attempt = 0; (attempt <= retries) && (status == SNMP_CLASS_TIMEOUT); attempt++)
+    {
+        if(attempt > 0)
+        {
+            RequestStatistics::add(stats.retries, 1);
+        }
+
+        if(limiter)
+        {
+            uint64_t waited = limiter->acquire(varbinds);
+            if(waited > 0)
+            {
+                RequestStatistics::add(stats.rateLimited, 1);
+                RequestStatistics::add(stats.rateLimitWait, waited);
+            }
+        }
+
+        // Transports without timestamps get them from here, only a little later than the real ones.
+        uint64_t sent = wallClockNanoseconds();
+        response.sentTime = 0;
+        response.receivedTime = 0;
+
+        switch(request.spec.operation)
+        {
+        case SNMP_GETBULK:
+        {
+            RF_TRACE_SPAN("SNMP getbulk", &name);
+            status = transport->execute(request, response);
+            break;
+        }
+        case SNMP_SET:
+        {
+            RF_TRACE_SPAN("SNMP set", &name);
+            status = transport->execute(request, response);
+            break;
+        }
+        default:
+        {
+            RF_TRACE_SPAN("SNMP get", &name);
+            status = transport->execute(request, response);
+            break;
+        }
+        }
+
+        RequestStatistics::add(stats.bytesSent, response.requestSize);
+        if(response.sentTime == 0)
+        {
+            response.sentTime = sent;
+        }
+        if(response.receivedTime == 0 && status != SNMP_CLASS_TIMEOUT)
+        {
+            response.receivedTime = wallClockNanoseconds();
+        }
+    }
+
+    stats.latency.record(monotonicMicroseconds() - start);
+    RequestStatistics::add(stats.requests, 1);
+    RequestStatistics::add(stats.bytesReceived, response.responseSize);
+
+    // Answers from a cache did not go over the wire in this request.
+    if(response.responseSize > 0 && response.receivedTime > response.sentTime)
+    {
+        stats.roundTrip.record((response.receivedTime - response.sentTime) / 1000);
+    }
+
+    if(status == SNMP_CLASS_TIMEOUT)
+    {
+        RequestStatistics::add(stats.timeouts, 1);
+    }
+    else if(status > SNMP_CLASS_SUCCESS)
+    {
+        // Agent responded with error-status.
+        RequestStatistics::add(stats.errorStatus, 1);
+    }
+    else if(status < SNMP_CLASS_SUCCESS)
+    {
+        RequestStatistics::add(stats.transportErrors, 1);
+    }
+
+    return status;
+}
+
+void SNMPconnector::addToMap(const std::string& name, const SNMPrequestSpec& spec)
 {
     // Check if the same reqeust already exists.
     if(requests.find(name) != requests.end())
@@ -124,63 +299,156 @@ void SNMPconnector::addToMap(const std::string& name, const uint16_t noElements)
         throw SNMPconnectorException("Request with this name is already registered.");
     }
 
+    // Prepared lazily, so bad OIDs are caught here where the request is made and not on the first poll.
+    if(spec.varbinds.empty())
+    {
+        throw SNMPconnectorException("Request without OIDs.");
+    }
+    for(size_t i = 0; i < spec.varbinds.size(); i++)
+    {
+        if(!SNMPoidPool::get(spec.varbinds[i].oid).valid())
+        {
+            throw SNMPconnectorException("Not a valid OID: " + spec.varbinds[i].oid);
+        }
+    }
+
+    Request request;
+    request.spec = spec;
+    request.statistics = getStatisticsEntry(name);
+    request.response.requestSize = 0;
+    request.response.responseSize = 0;
+    request.response.sentTime = 0;
+    request.response.receivedTime = 0;
+
     // Add to collection of request with a given name.
-    requests.insert(std::pair<std::string, std::pair<std::shared_ptr<Snmp_pp::Pdu>, uint16_t> >
-                    (name, std::pair<std::shared_ptr<Snmp_pp::Pdu>, uint16_t>(std::shared_ptr<Snmp_pp::Pdu>(new Snmp_pp::Pdu), noElements)));
+    requests.insert(std::pair<std::string, Request>(name, request));
 }
 
-std::vector<std::string> SNMPconnector::extractData(const int32_t status, const Snmp_pp::Pdu& pdu, const bool ignoreSyntaxErrors)
+SNMPvarbindStatus SNMPconnector::toStatus(const SNMPvarbind& varbind)
 {
-    if(status != SNMP_CLASS_SUCCESS) // Any ERRORs?
+    switch(varbind.syntax)
     {
-        throw SNMPconnectorException(snmpSession->error_msg(status));
+    case sNMP_SYNTAX_NOSUCHOBJECT:
+        return SNMP_VARBIND_NO_SUCH_OBJECT;
+    case sNMP_SYNTAX_NOSUCHINSTANCE:
+        return SNMP_VARBIND_NO_SUCH_INSTANCE;
+    case sNMP_SYNTAX_ENDOFMIBVIEW:
+        return SNMP_VARBIND_END_OF_MIB_VIEW;
+    default:
+        return SNMP_VARBIND_OK;
     }
+}
 
-    // Create return vector of strings.
-    std::vector<std::string> toReturn;
-    std::stringstream errorMsg;
-
-    // Go through all VBs in PDU, check for error msg and extract data if possible.
-    for(size_t i = 0; i < static_cast<size_t>(pdu.get_vb_count()); i++)
+void SNMPconnector::extractData(const std::string& name, const SNMPresponse& response, const size_t expected, RequestStatistics& stats,
+                                SNMPresult& result)
+{
+    RF_TRACE_SPAN("SNMP extract", &name);
+
+    // Strings are assigned in place so they keep their capacity from the previous read.
+    const size_t received = response.varbinds.size();
+    const size_t size = (received > expected) ? received : expected;
+    result.values.resize(size);
+    result.status.resize(size);
+    result.invalid = 0;
+    result.sentTime = response.sentTime;
+    result.receivedTime = response.receivedTime;
+
+    // Go through all VBs, check for error msg and extract data if possible.
+    for(size_t i = 0; i < received; i++)
     {
-        Snmp_pp::Vb tempVB;
-        pdu.get_vb(tempVB, i);
+        const SNMPvarbind& varbind = response.varbinds[i];
 
-        toReturn.push_back(tempVB.get_printable_value());
+        result.values[i].assign(varbind.value);
+        result.status[i] = toStatus(varbind);
 
-        if(!ignoreSyntaxErrors && ((tempVB.get_syntax() == sNMP_SYNTAX_ENDOFMIBVIEW) ||
-            (tempVB.get_syntax() == sNMP_SYNTAX_NOSUCHINSTANCE) ||
-            (tempVB.get_syntax() == sNMP_SYNTAX_NOSUCHOBJECT)))
+        if(result.status[i] != SNMP_VARBIND_OK)
         {
-            errorMsg << "On VB with OID: " << tempVB.get_printable_oid() << " error occured: " << tempVB.get_syntax() << std::endl;
+            RequestStatistics::add(stats.syntaxErrors, 1);
+            result.invalid++;
         }
     }
 
-    if(errorMsg.str().length() > 0)
+    // Whatever the agent left out is reported per value as well. Only readResult asks for that.
+    for(size_t i = received; i < size; i++)
     {
-        throw SNMPconnectorException(errorMsg.str());
+        result.values[i].clear();
+        result.status[i] = SNMP_VARBIND_MISSING;
+        result.invalid++;
+    }
+}
+
+namespace
+{
+    /// Varbinds for the 3 supported value types.
+    SNMPvarbind toVarbind(const std::string& oid, const char* value)
+    {
+        SNMPvarbind toReturn;
+        toReturn.oid = oid;
+        toReturn.value = value;
+        toReturn.syntax = sNMP_SYNTAX_OCTETS;
+        return toReturn;
     }
 
-    return toReturn;
+    template<typename T> SNMPvarbind toVarbind(const std::string& oid, T value, const int32_t syntax)
+    {
+        std::stringstream converted;
+        converted << value;
+
+        SNMPvarbind toReturn;
+        toReturn.oid = oid;
+        toReturn.value = converted.str();
+        toReturn.syntax = syntax;
+        return toReturn;
+    }
+
+    SNMPvarbind toVarbind(const std::string& oid, int32_t value) { return toVarbind(oid, value, sNMP_SYNTAX_INT); }
+    SNMPvarbind toVarbind(const std::string& oid, uint32_t value) { return toVarbind(oid, value, sNMP_SYNTAX_UINT32); }
 }
 
 template<typename T>
 void SNMPconnector::setValue(const std::string& oid, T value)
 {
-    // Create PDU and VB.
-    Snmp_pp::Pdu pdu;
-    Snmp_pp::Vb vb;
-    vb.set_oid(oid.c_str());
+    SNMPrequestSpec spec;
+    spec.operation = SNMP_SET;
+    spec.maxRepetitions = 0;
+    spec.priority = SNMP_PRIORITY_WRITE;
+    spec.varbinds.push_back(toVarbind(oid, value));
+
+    std::unique_lock<std::mutex> l(setLock);
+
+    // Prepared once per OID and syntax, later writes only replace the value.
+    std::vector<PreparedSet>& prepared = sets[oid];
+    PreparedSet* set = 0;
+    for(size_t i = 0; i < prepared.size(); i++)
+    {
+        if(prepared[i].syntax == spec.varbinds[0].syntax)
+        {
+            set = &prepared[i];
+            break;
+        }
+    }
 
-    vb.set_value(value);
-    pdu += vb;
+    if(set == 0)
+    {
+        PreparedSet created;
+        created.name = "set:" + oid;
+        created.syntax = spec.varbinds[0].syntax;
+        created.request = transport->prepare(spec);
+        created.statistics = getStatisticsEntry(created.name);
+        prepared.push_back(created);
+        set = &prepared.back();
+    }
+    else if(!transport->updateValues(*set->request, spec.varbinds))
+    {
+        set->request = transport->prepare(spec);
+    }
 
-    int32_t status = snmpSession->set(pdu, *cTarget); // Set value. We need the status variable for error_msg extraction.
+    SNMPresponse response;
+    int32_t status = execute(set->name, *set->request, response, *set->statistics); // Set value. We need the status variable for error_msg extraction.
     if(status != SNMP_CLASS_SUCCESS) // Any ERRORs?
     {
-        throw SNMPconnectorException(snmpSession->error_msg(status));
+        throw SNMPconnectorException(Snmp_pp::Snmp::error_msg(status));
     }
-
 }
 // Only allow these 3 types.
 template void SNMPconnector::setValue<const char*>(const std::string& oid, const char* value);
@@ -0,0 +1,241 @@
+#include "snmpfake.h"
+#include "snmpber.h"
+#include "snmpconnector.h"
+#include <cstdlib>
+#include <unistd.h>
+
+namespace
+{
+    /**
+     * @brief The FakeRequest class Request with its OIDs parsed once.
+     */
+    class FakeRequest : public SNMPpreparedRequest
+    {
+    public:
+        explicit FakeRequest(const SNMPrequestSpec& spec) : SNMPpreparedRequest(spec), requestSize(0) {}
+
+        std::vector<std::vector<uint32_t> > oids; //!< Parsed OIDs of the varbinds.
+        uint64_t requestSize; //!< Size the request would have on the wire.
+    };
+
+    const int32_t noCreation = 11; //!< SNMPv2 error-status for writes to objects that do not exist.
+
+    void assign(SNMPvarbind& out, const SNMPvarbind& from)
+    {
+        out.oid = from.oid;
+        out.value = from.value;
+        out.syntax = from.syntax;
+    }
+
+    void assignException(SNMPvarbind& out, const std::string& oid, const int32_t syntax)
+    {
+        out.oid = oid;
+        out.value.clear();
+        out.syntax = syntax;
+    }
+}
+
+SNMPfakeTransport::SNMPfakeTransport() : offline(false), latency(0), requests(0)
+{
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPfakeTransport::prepare(const SNMPrequestSpec& spec)
+{
+    std::shared_ptr<FakeRequest> request(new FakeRequest(spec));
+
+    for(size_t i = 0; i < spec.varbinds.size(); i++)
+    {
+        request->oids.push_back(toArcs(spec.varbinds[i].oid));
+    }
+
+    // Size of the same request on the wire so the statistics look like the real thing.
+    std::string varbinds;
+    std::string message;
+    SNMPber::encodeVarbinds(spec.varbinds, varbinds);
+    SNMPber::encodeMessage(SNMPber::version2c, "public", sNMP_PDU_GET, 0, 0, 0, varbinds, message);
+    request->requestSize = message.size();
+
+    return request;
+}
+
+int32_t SNMPfakeTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    FakeRequest& request = static_cast<FakeRequest&>(preparedRequest);
+    uint32_t delay;
+
+    response.requestSize = request.requestSize;
+    response.responseSize = 0;
+
+    {
+        std::unique_lock<std::mutex> l(lock);
+        requests++;
+        delay = latency;
+    }
+
+    if(delay > 0)
+    {
+        usleep(delay);
+    }
+
+    std::unique_lock<std::mutex> l(lock);
+
+    if(offline)
+    {
+        response.varbinds.clear();
+        return SNMP_CLASS_TIMEOUT;
+    }
+
+    int32_t status = SNMP_CLASS_SUCCESS;
+    size_t count = 0;
+
+    switch(request.spec.operation)
+    {
+    case SNMP_GETBULK:
+    {
+        // Successors of the base OID, like GETNEXT repeated.
+        std::map<std::vector<uint32_t>, SNMPvarbind>::const_iterator next = mib.upper_bound(request.oids[0]);
+        response.varbinds.resize(request.spec.maxRepetitions);
+        while(count < request.spec.maxRepetitions)
+        {
+            if(next == mib.end())
+            {
+                assignException(response.varbinds[count++], request.spec.varbinds[0].oid, sNMP_SYNTAX_ENDOFMIBVIEW);
+                break;
+            }
+            assign(response.varbinds[count++], next->second);
+            ++next;
+        }
+        break;
+    }
+    case SNMP_SET:
+    {
+        // All or nothing, like a real agent.
+        for(size_t i = 0; i < request.oids.size(); i++)
+        {
+            if(mib.find(request.oids[i]) == mib.end())
+            {
+                response.varbinds.clear();
+                return noCreation;
+            }
+        }
+
+        response.varbinds.resize(request.oids.size());
+        for(size_t i = 0; i < request.oids.size(); i++)
+        {
+            SNMPvarbind& object = mib[request.oids[i]];
+            object.value = request.spec.varbinds[i].value;
+            object.syntax = request.spec.varbinds[i].syntax;
+            assign(response.varbinds[count++], object);
+        }
+        break;
+    }
+    default:
+    {
+        response.varbinds.resize(request.oids.size());
+        for(size_t i = 0; i < request.oids.size(); i++)
+        {
+            std::map<std::vector<uint32_t>, SNMPvarbind>::const_iterator found = mib.find(request.oids[i]);
+            if(found == mib.end())
+            {
+                assignException(response.varbinds[count++], request.spec.varbinds[i].oid, sNMP_SYNTAX_NOSUCHOBJECT);
+            }
+            else
+            {
+                assign(response.varbinds[count++], found->second);
+            }
+        }
+        break;
+    }
+    }
+
+    response.varbinds.resize(count);
+
+    // The response carries the same envelope plus the values.
+    response.responseSize = request.requestSize;
+    for(size_t i = 0; i < count; i++)
+    {
+        response.responseSize += response.varbinds[i].value.size();
+    }
+
+    return status;
+}
+
+void SNMPfakeTransport::set(const std::string& oid, const std::string& value, const int32_t syntax)
+{
+    std::vector<uint32_t> arcs = toArcs(oid);
+
+    std::unique_lock<std::mutex> l(lock);
+    SNMPvarbind& object = mib[arcs];
+    object.oid = oid;
+    object.value = value;
+    object.syntax = syntax;
+}
+
+std::string SNMPfakeTransport::get(const std::string& oid)
+{
+    std::vector<uint32_t> arcs = toArcs(oid);
+
+    std::unique_lock<std::mutex> l(lock);
+    std::map<std::vector<uint32_t>, SNMPvarbind>::const_iterator found = mib.find(arcs);
+    return (found == mib.end()) ? std::string() : found->second.value;
+}
+
+void SNMPfakeTransport::remove(const std::string& oid)
+{
+    std::vector<uint32_t> arcs = toArcs(oid);
+
+    std::unique_lock<std::mutex> l(lock);
+    mib.erase(arcs);
+}
+
+void SNMPfakeTransport::setOffline(const bool offline)
+{
+    std::unique_lock<std::mutex> l(lock);
+    this->offline = offline;
+}
+
+void SNMPfakeTransport::setLatency(const uint32_t latency)
+{
+    std::unique_lock<std::mutex> l(lock);
+    this->latency = latency;
+}
+
+uint64_t SNMPfakeTransport::getRequests()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return requests;
+}
+
+bool SNMPfakeTransport::parseOid(const std::string& oid, std::vector<uint32_t>& arcs)
+{
+    arcs.clear();
+    const char* position = oid.c_str();
+    if(*position == '.')
+    {
+        position++;
+    }
+
+    while(*position != '\0')
+    {
+        char* end;
+        unsigned long arc = std::strtoul(position, &end, 10);
+        if(end == position || arc > 0xFFFFFFFFul || (*end != '.' && *end != '\0'))
+        {
+            return false;
+        }
+        arcs.push_back(static_cast<uint32_t>(arc));
+        position = (*end == '.') ? end + 1 : end;
+    }
+
+    return !arcs.empty();
+}
+
+std::vector<uint32_t> SNMPfakeTransport::toArcs(const std::string& oid)
+{
+    std::vector<uint32_t> toReturn;
+    if(!parseOid(oid, toReturn))
+    {
+        throw SNMPconnectorException("Invalid OID: " + oid);
+    }
+    return toReturn;
+}
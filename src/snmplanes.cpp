@@ -0,0 +1,130 @@
+#include "snmplanes.h"
+#include "snmpconnector.h"
+
+SNMPlaneTransport::SNMPlaneTransport(const std::shared_ptr<SNMPtransport>& transport, const SNMPlaneLimits& limits)
+    : transport(transport), limits(limits), inFlight(0)
+{
+    if(!transport)
+    {
+        throw SNMPconnectorException("No transport provided.");
+    }
+
+    if(limits.maxInFlight == 0)
+    {
+        throw SNMPconnectorException("At least 1 request needs to be allowed in flight.");
+    }
+
+    for(size_t i = 0; i < SNMP_PRIORITIES; i++)
+    {
+        if(limits.lanes[i] == 0)
+        {
+            throw SNMPconnectorException("At least 1 request per lane needs to be allowed in flight.");
+        }
+
+        laneInFlight[i] = 0;
+        waiting[i] = 0;
+        deferred[i] = 0;
+    }
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPlaneTransport::prepare(const SNMPrequestSpec& spec)
+{
+    // The prepared request of the agent transport keeps the spec and with it the lane.
+    return transport->prepare(spec);
+}
+
+int32_t SNMPlaneTransport::execute(SNMPpreparedRequest& request, SNMPresponse& response)
+{
+    SNMPpriorities priority = request.spec.priority;
+    if(priority >= SNMP_PRIORITIES)
+    {
+        priority = SNMP_PRIORITY_DIAGNOSTICS;
+    }
+
+    acquire(priority);
+
+    int32_t status;
+    try
+    {
+        status = transport->execute(request, response);
+    }
+    catch(...)
+    {
+        release(priority);
+        throw;
+    }
+
+    release(priority);
+    return status;
+}
+
+LatencyHistogram::Snapshot SNMPlaneTransport::getQueueDelay(const SNMPpriorities priority) const
+{
+    return queueDelay[priority].snapshot();
+}
+
+uint64_t SNMPlaneTransport::getDeferred(const SNMPpriorities priority)
+{
+    std::unique_lock<std::mutex> l(lock);
+    return deferred[priority];
+}
+
+uint16_t SNMPlaneTransport::getInFlight()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return inFlight;
+}
+
+bool SNMPlaneTransport::canRun(const SNMPpriorities priority) const
+{
+    if(inFlight >= limits.maxInFlight || laneInFlight[priority] >= limits.lanes[priority])
+    {
+        return false;
+    }
+
+    // A more important request that could start goes first.
+    for(size_t i = 0; i < static_cast<size_t>(priority); i++)
+    {
+        if(waiting[i] > 0 && laneInFlight[i] < limits.lanes[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SNMPlaneTransport::acquire(const SNMPpriorities priority)
+{
+    uint64_t start = monotonicMicroseconds();
+    {
+        std::unique_lock<std::mutex> l(lock);
+
+        if(!canRun(priority))
+        {
+            deferred[priority]++;
+            waiting[priority]++;
+            while(!canRun(priority))
+            {
+                released.wait(l);
+            }
+            waiting[priority]--;
+        }
+
+        inFlight++;
+        laneInFlight[priority]++;
+    }
+    queueDelay[priority].record(monotonicMicroseconds() - start);
+}
+
+void SNMPlaneTransport::release(const SNMPpriorities priority)
+{
+    {
+        std::unique_lock<std::mutex> l(lock);
+        inFlight--;
+        laneInFlight[priority]--;
+    }
+
+    // Waiters of different lanes wait for different conditions.
+    released.notify_all();
+}
@@ -0,0 +1,99 @@
+#include "snmpratelimiter.h"
+#include "snmpconnector.h"
+#include <algorithm>
+#include <unistd.h>
+
+SNMPrateLimiter::SNMPrateLimiter(const double requestRate, const double varbindRate, const double burst)
+    : refilled(monotonicMicroseconds()), requests(0), delayed(0), queued(0)
+{
+    if(requestRate < 0.0 || varbindRate < 0.0 || burst <= 0.0)
+    {
+        throw SNMPconnectorException("Rates can not be negative and the burst needs to be positive.");
+    }
+
+    setup(requestBucket, requestRate, burst);
+    setup(varbindBucket, varbindRate, burst);
+}
+
+uint64_t SNMPrateLimiter::acquire(const uint32_t varbinds)
+{
+    uint64_t delay;
+    {
+        std::unique_lock<std::mutex> l(lock);
+
+        uint64_t now = monotonicMicroseconds();
+        refill(requestBucket, now - refilled);
+        refill(varbindBucket, now - refilled);
+        refilled = now;
+
+        delay = std::max(take(requestBucket, 1.0), take(varbindBucket, varbinds));
+        requests++;
+        if(delay == 0)
+        {
+            return 0;
+        }
+
+        delayed++;
+        queued++;
+    }
+
+    // The tokens are reserved, nobody else can take them meanwhile.
+    usleep(delay);
+    wait.record(delay);
+
+    std::unique_lock<std::mutex> l(lock);
+    queued--;
+    return delay;
+}
+
+uint64_t SNMPrateLimiter::getRequests()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return requests;
+}
+
+uint64_t SNMPrateLimiter::getDelayed()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return delayed;
+}
+
+uint32_t SNMPrateLimiter::getQueued()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return queued;
+}
+
+void SNMPrateLimiter::setup(Bucket& bucket, const double rate, const double burst)
+{
+    bucket.rate = rate / 1000000.0;
+    bucket.size = std::max(1.0, rate * burst);
+    bucket.tokens = bucket.size;
+}
+
+void SNMPrateLimiter::refill(Bucket& bucket, const uint64_t elapsed)
+{
+    if(bucket.rate > 0.0)
+    {
+        bucket.tokens = std::min(bucket.size, bucket.tokens + bucket.rate * elapsed);
+    }
+}
+
+uint64_t SNMPrateLimiter::take(Bucket& bucket, const double tokens)
+{
+    if(bucket.rate <= 0.0)
+    {
+        return 0;
+    }
+
+    // Requests larger than the bucket only need it full.
+    double needed = std::min(tokens, bucket.size);
+    uint64_t delay = 0;
+    if(bucket.tokens < needed)
+    {
+        delay = static_cast<uint64_t>((needed - bucket.tokens) / bucket.rate) + 1;
+    }
+
+    bucket.tokens -= tokens;
+    return delay;
+}
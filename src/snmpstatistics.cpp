@@ -0,0 +1,187 @@
+#include "snmpstatistics.h"
+#include <time.h>
+#include <limits>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+uint16_t LatencyHistogram::bucketIndex(const uint64_t microseconds)
+{
+    // Small values have their own buckets.
+    if(microseconds < subBuckets)
+    {
+        return static_cast<uint16_t>(microseconds);
+    }
+
+    uint16_t magnitude = 63 - __builtin_clzll(microseconds); // Position of the highest bit.
+    if(magnitude > maxMagnitude)
+    {
+        return noBuckets - 1; // Everything too big goes to the last bucket.
+    }
+
+    // Bits right after the highest one select the linear sub-bucket.
+    uint16_t subBucket = static_cast<uint16_t>((microseconds >> (magnitude - subBucketBits)) & (subBuckets - 1));
+    return ((magnitude - subBucketBits + 1) << subBucketBits) + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(const uint16_t index)
+{
+    if(index < subBuckets)
+    {
+        return index;
+    }
+
+    uint16_t magnitude = (index >> subBucketBits) + subBucketBits - 1;
+    uint64_t subBucket = index & (subBuckets - 1);
+    uint64_t width = static_cast<uint64_t>(1) << (magnitude - subBucketBits);
+
+    return ((subBuckets + subBucket) << (magnitude - subBucketBits)) + width - 1;
+}
+
+void LatencyHistogram::record(const uint64_t microseconds)
+{
+    buckets[bucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(microseconds, std::memory_order_relaxed);
+
+    // Min and max only change rarely so the loops almost never spin.
+    uint64_t current = min.load(std::memory_order_relaxed);
+    while(microseconds < current && !min.compare_exchange_weak(current, microseconds, std::memory_order_relaxed)) {}
+
+    current = max.load(std::memory_order_relaxed);
+    while(microseconds > current && !max.compare_exchange_weak(current, microseconds, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot toReturn;
+    toReturn.counts.resize(noBuckets);
+
+    for(size_t i = 0; i < noBuckets; i++)
+    {
+        toReturn.counts[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+
+    toReturn.count = count.load(std::memory_order_relaxed);
+    toReturn.sum = sum.load(std::memory_order_relaxed);
+    toReturn.min = (toReturn.count > 0) ? min.load(std::memory_order_relaxed) : 0;
+    toReturn.max = max.load(std::memory_order_relaxed);
+
+    return toReturn;
+}
+
+void LatencyHistogram::reset()
+{
+    for(size_t i = 0; i < noBuckets; i++)
+    {
+        buckets[i] = 0;
+    }
+
+    count = 0;
+    sum = 0;
+    min = std::numeric_limits<uint64_t>::max();
+    max = 0;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(const double percent) const
+{
+    // Sum the buckets instead of using count. They might differ slightly since the snapshot is not atomic.
+    uint64_t total = 0;
+    for(size_t i = 0; i < counts.size(); i++)
+    {
+        total += counts[i];
+    }
+
+    if(total == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the sample we are looking for.
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    rank = (rank < 1) ? 1 : ((rank > total) ? total : rank);
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if(seen >= rank)
+        {
+            // Do not report more than the biggest sample seen.
+            uint64_t bound = bucketUpperBound(i);
+            return (bound < max) ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+double LatencyHistogram::Snapshot::mean() const
+{
+    return (count > 0) ? static_cast<double>(sum) / count : 0.0;
+}
+
+RequestStatistics::RequestStatistics()
+{
+    reset();
+}
+
+RequestStatisticsSnapshot RequestStatistics::snapshot(const std::string& name) const
+{
+    RequestStatisticsSnapshot toReturn;
+
+    toReturn.name = name;
+    toReturn.requests = requests.load(std::memory_order_relaxed);
+    toReturn.timeouts = timeouts.load(std::memory_order_relaxed);
+    toReturn.retries = retries.load(std::memory_order_relaxed);
+    toReturn.errorStatus = errorStatus.load(std::memory_order_relaxed);
+    toReturn.transportErrors = transportErrors.load(std::memory_order_relaxed);
+    toReturn.syntaxErrors = syntaxErrors.load(std::memory_order_relaxed);
+    toReturn.bytesSent = bytesSent.load(std::memory_order_relaxed);
+    toReturn.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+    toReturn.rateLimited = rateLimited.load(std::memory_order_relaxed);
+    toReturn.rateLimitWait = rateLimitWait.load(std::memory_order_relaxed);
+    toReturn.latency = latency.snapshot();
+    toReturn.roundTrip = roundTrip.snapshot();
+
+    return toReturn;
+}
+
+void RequestStatistics::reset()
+{
+    requests = 0;
+    timeouts = 0;
+    retries = 0;
+    errorStatus = 0;
+    transportErrors = 0;
+    syntaxErrors = 0;
+    bytesSent = 0;
+    bytesReceived = 0;
+    rateLimited = 0;
+    rateLimitWait = 0;
+    latency.reset();
+    roundTrip.reset();
+}
+
+uint64_t monotonicMicroseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+uint64_t monotonicNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+uint64_t wallClockNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
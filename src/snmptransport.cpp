@@ -0,0 +1,328 @@
+#include "snmptransport.h"
+#include "snmp_pp/snmpmsg.h"
+#include "snmpconnector.h"
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    /**
+     * @brief The SNMPppRequest class Request with its SNMP++ PDU built in advance.
+     */
+    class SNMPppRequest : public SNMPpreparedRequest
+    {
+    public:
+        explicit SNMPppRequest(const SNMPrequestSpec& spec) : SNMPpreparedRequest(spec), requestSize(0), responseSize(0) {}
+
+        Snmp_pp::Pdu pdu; //!< PDU with the OIDs to read or values to write.
+        Snmp_pp::Vb base; //!< First VB of bulk requests. SNMP++ replaces the PDU content with the response.
+        uint64_t requestSize; //!< Size of the request as SNMPv2c message.
+        uint64_t responseSize; //!< Size of a response with the same varbinds as SNMPv2c message, without the returned values.
+    };
+
+    std::mutex oidPoolLock; //!< Guards the OID pool.
+    std::once_flag logConfigured; //!< SNMP++ log filters are set once per process.
+
+    /// Pool of parsed OIDs. Elements of an unordered map keep their address when it grows.
+    std::unordered_map<std::string, Snmp_pp::Oid>& oidPool()
+    {
+        static std::unordered_map<std::string, Snmp_pp::Oid> pool;
+        return pool;
+    }
+
+    /// Log only errors and warrnings.
+    void configureLog()
+    {
+        Snmp_pp::DefaultLog::log()->set_filter(ERROR_LOG, 2);
+        Snmp_pp::DefaultLog::log()->set_filter(WARNING_LOG, 1);
+        Snmp_pp::DefaultLog::log()->set_filter(EVENT_LOG, 0);
+        Snmp_pp::DefaultLog::log()->set_filter(INFO_LOG, 0);
+        Snmp_pp::DefaultLog::log()->set_filter(DEBUG_LOG, 0);
+    }
+
+    /// Converts the varbind to SNMP++ format.
+    Snmp_pp::Vb toVb(const SNMPvarbind& varbind)
+    {
+        Snmp_pp::Vb vb(SNMPoidPool::get(varbind.oid));
+
+        switch(varbind.syntax)
+        {
+        case sNMP_SYNTAX_INT:
+            vb.set_value(static_cast<int32_t>(std::strtol(varbind.value.c_str(), 0, 10)));
+            break;
+        case sNMP_SYNTAX_UINT32:
+            vb.set_value(static_cast<uint32_t>(std::strtoul(varbind.value.c_str(), 0, 10)));
+            break;
+        case sNMP_SYNTAX_OCTETS:
+            vb.set_value(varbind.value.c_str());
+            break;
+        default:
+            break; // Reads go out with NULL values.
+        }
+
+        return vb;
+    }
+
+    /// Appends the OID in dotted format. Unlike Oid::get_printable it does not allocate once the string has its capacity.
+    void formatOid(const Snmp_pp::Oid& oid, std::string& out)
+    {
+        out.clear();
+        char digits[20];
+        for(unsigned int i = 0; i < oid.len(); i++)
+        {
+            if(i > 0)
+            {
+                out += '.';
+            }
+
+            unsigned long arc = oid[i];
+            size_t count = 0;
+            do
+            {
+                digits[count++] = static_cast<char>('0' + arc % 10);
+                arc /= 10;
+            }
+            while(arc > 0);
+
+            while(count > 0)
+            {
+                out += digits[--count];
+            }
+        }
+    }
+}
+
+const Snmp_pp::Oid& SNMPoidPool::get(const std::string& oid)
+{
+    std::unique_lock<std::mutex> l(oidPoolLock);
+
+    std::unordered_map<std::string, Snmp_pp::Oid>& pool = oidPool();
+    std::unordered_map<std::string, Snmp_pp::Oid>::iterator found = pool.find(oid);
+    if(found == pool.end())
+    {
+        found = pool.insert(std::make_pair(oid, Snmp_pp::Oid(oid.c_str()))).first;
+    }
+
+    return found->second;
+}
+
+size_t SNMPoidPool::size()
+{
+    std::unique_lock<std::mutex> l(oidPoolLock);
+    return oidPool().size();
+}
+
+SNMPppTransport::SNMPppTransport(const std::string& ip, const std::string& community, const uint16_t port, const uint16_t timeout)
+    : version(Snmp_pp::version2c), v3(false), timeout(timeout), community(community.c_str())
+{
+    openSession(ip, port);
+
+    // Create a target for SNMP requests.
+    Snmp_pp::CTarget* cTarget = new Snmp_pp::CTarget(address);
+    target.reset(cTarget);
+
+    // We have the same community for READ and WRITE.
+    cTarget->set_readcommunity(this->community);
+    cTarget->set_writecommunity(this->community);
+
+    target->set_version(version);
+    target->set_retry(0); // Retries are done by the connector so they can be counted.
+    target->set_timeout(timeout/10); // Timeout goes in 10ms increments. So for 1000ms we actually write 100.
+}
+
+SNMPppTransport::SNMPppTransport(const std::string& ip, const SNMPv3credentials& credentials, const uint16_t port, const uint16_t timeout)
+    : version(Snmp_pp::version2c), v3(true), timeout(timeout), community("public"), credentials(credentials)
+{
+    // Message processing model has to exist before the session.
+    SNMPusm::instance();
+
+    openSession(ip, port);
+
+#ifdef _SNMPv3
+    version = Snmp_pp::version3;
+    Snmp_pp::UTarget* uTarget = new Snmp_pp::UTarget(address);
+    target.reset(uTarget);
+
+    uTarget->set_security_name(credentials.securityName.c_str());
+    uTarget->set_security_model(SNMP_SECURITY_MODEL_USM);
+#endif
+
+    target->set_version(version);
+    target->set_retry(0); // Retries are done by the connector so they can be counted.
+    target->set_timeout(timeout/10); // Timeout goes in 10ms increments. So for 1000ms we actually write 100.
+}
+
+void SNMPppTransport::openSession(const std::string& ip, const uint16_t port)
+{
+    // Start the socket resource acquisition.
+    //Snmp_pp::Snmp::socket_startup(); WIN Only
+
+    // Set IP and port.
+    address = Snmp_pp::UdpAddress(ip.c_str());
+    address.set_port(port);
+
+    int32_t status;
+
+    // Start SNMP session. Use IPv6 if needed.
+    snmpSession.reset(new Snmp_pp::Snmp(status, 0, (address.get_ip_version() == Snmp_pp::Address::version_ipv6)));
+
+    if (status != SNMP_CLASS_SUCCESS) // Any ERRORs?
+    {
+        throw SNMPconnectorException(snmpSession->error_msg(status));
+    }
+
+    std::call_once(logConfigured, configureLog);
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPppTransport::prepare(const SNMPrequestSpec& spec)
+{
+    std::shared_ptr<SNMPppRequest> request(new SNMPppRequest(spec));
+
+    std::vector<Snmp_pp::Vb> VBs;
+    VBs.reserve(spec.varbinds.size()); // We know the number of VBs in advance.
+
+    // Each OID gets its own VB.
+    for(size_t i = 0; i < spec.varbinds.size(); i++)
+    {
+        VBs.push_back(toVb(spec.varbinds[i]));
+    }
+
+    if(VBs.empty() || 0 == request->pdu.set_vblist(&VBs.at(0), VBs.size())) // Add whole list at once to PDU. Check for success.
+    {
+        throw SNMPconnectorException("Failed to add VBs to PDU.");
+    }
+
+    request->base = VBs[0];
+
+#ifdef _SNMPv3
+    if(v3)
+    {
+        request->pdu.set_security_level(credentials.securityLevel());
+    }
+#endif
+
+    int32_t pduType = (spec.operation == SNMP_GETBULK) ? sNMP_PDU_GETBULK : ((spec.operation == SNMP_SET) ? sNMP_PDU_SET : sNMP_PDU_GET);
+    // SNMP++ does not report what went over the wire. Both sizes are estimated once here, never per exchange.
+    request->requestSize = encodedSize(request->pdu, pduType);
+    request->responseSize = encodedSize(request->pdu, sNMP_PDU_RESPONSE);
+
+    return request;
+}
+
+int32_t SNMPppTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    SNMPppRequest& request = static_cast<SNMPppRequest&>(preparedRequest);
+    Snmp_pp::Pdu& pdu = request.pdu;
+    int32_t status;
+
+    response.requestSize = request.requestSize;
+    response.responseSize = 0;
+
+    // Engine ID is discovered once. Engine boots and time are then synchronized by SNMP++ with the first request.
+    if(v3 && engineId.len() == 0)
+    {
+        status = discoverEngine();
+        if(status != SNMP_CLASS_SUCCESS)
+        {
+            response.varbinds.clear();
+            return status;
+        }
+    }
+
+    switch(request.spec.operation)
+    {
+    case SNMP_GETBULK:
+        status = snmpSession->get_bulk(pdu, *target, 0, request.spec.maxRepetitions);
+        break;
+    case SNMP_SET:
+        status = snmpSession->set(pdu, *target);
+        break;
+    default:
+        status = snmpSession->get(pdu, *target);
+        break;
+    }
+
+    // The agent answered, possibly with an error-status.
+    if(status >= SNMP_CLASS_SUCCESS)
+    {
+        response.responseSize = request.responseSize;
+    }
+
+    // Copy out the returned VBs.
+    size_t count = (status == SNMP_CLASS_SUCCESS) ? static_cast<size_t>(pdu.get_vb_count()) : 0;
+    response.varbinds.resize(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        // Read in place, a copied Vb would clone its OID and value. Numbers are printed into a buffer of the value.
+        const Snmp_pp::Vb& vb = pdu.get_vb(i);
+
+        formatOid(vb.get_oid(), response.varbinds[i].oid);
+        response.varbinds[i].value.assign(vb.get_printable_value());
+        response.varbinds[i].syntax = vb.get_syntax();
+    }
+
+    if(request.spec.operation == SNMP_GETBULK)
+    {
+        pdu.clear(); // Clear all the returns.
+        pdu += request.base; // Make a single base again, otherwise the next read would continue from the returned values.
+    }
+
+    return status;
+}
+
+bool SNMPppTransport::updateValues(SNMPpreparedRequest& preparedRequest, const std::vector<SNMPvarbind>& varbinds)
+{
+    SNMPppRequest& request = static_cast<SNMPppRequest&>(preparedRequest);
+    if(request.spec.operation != SNMP_SET || static_cast<size_t>(request.pdu.get_vb_count()) != varbinds.size())
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        request.pdu.set_vb(toVb(varbinds[i]), i);
+    }
+    return true;
+}
+
+std::string SNMPppTransport::getEngineId()
+{
+    return (engineId.len() == 0) ? std::string() : engineId.get_printable_hex();
+}
+
+int32_t SNMPppTransport::discoverEngine()
+{
+#ifdef _SNMPv3
+    Snmp_pp::OctetStr discovered;
+    int32_t status = snmpSession->engine_id_discovery(discovered, (timeout + 999) / 1000, address);
+
+    if(status != SNMP_CLASS_SUCCESS || discovered.len() == 0)
+    {
+        return (status == SNMP_CLASS_SUCCESS) ? SNMP_CLASS_TIMEOUT : status;
+    }
+
+    SNMPusm::instance().localize(credentials, discovered);
+    static_cast<Snmp_pp::UTarget&>(*target).set_engine_id(discovered);
+    engineId = discovered;
+
+    return SNMP_CLASS_SUCCESS;
+#else
+    return SNMP_CLASS_INTERNAL_ERROR;
+#endif
+}
+
+uint64_t SNMPppTransport::encodedSize(const Snmp_pp::Pdu& pdu, const int32_t pduType)
+{
+    // Encode a copy since the type of the registered PDUs is only set by SNMP++ when sending.
+    Snmp_pp::Pdu typed(pdu);
+    typed.set_type(pduType);
+
+    Snmp_pp::SnmpMessage message;
+    if(message.load(typed, community, Snmp_pp::version2c) != SNMP_CLASS_SUCCESS)
+    {
+        return 0;
+    }
+
+    return message.len();
+}
@@ -0,0 +1,216 @@
+#include "snmpudp.h"
+#include "snmpconnector.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+namespace
+{
+    /**
+     * @brief The UdpRequest class Request with its varbind list encoded in advance.
+     */
+    class UdpRequest : public SNMPpreparedRequest
+    {
+    public:
+        explicit UdpRequest(const SNMPrequestSpec& spec) : SNMPpreparedRequest(spec), pduType(sNMP_PDU_GET), errorIndex(0) {}
+
+        std::string varbinds; //!< Encoded varbind list.
+        uint8_t pduType; //!< PDU tag.
+        int32_t errorIndex; //!< Error index field, max-repetitions for GETBULK.
+    };
+
+    const size_t maxDatagram = 65535; //!< Largest UDP payload.
+}
+
+SNMPudpTransport::SNMPudpTransport(const std::string& ip, const std::string& community, const uint16_t port, const uint16_t timeout)
+    : community(community), timeout(timeout), socketFd(-1), requestId(static_cast<int32_t>(getpid() & 0xFFFF) << 12), datagram(maxDatagram)
+{
+    char service[8];
+    std::snprintf(service, sizeof(service), "%u", port);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    addrinfo* addresses = 0;
+    int status = getaddrinfo(ip.c_str(), service, &hints, &addresses);
+    if(status != 0)
+    {
+        throw SNMPconnectorException("Failed to resolve " + ip + ": " + gai_strerror(status));
+    }
+
+    for(addrinfo* address = addresses; address != 0 && socketFd < 0; address = address->ai_next)
+    {
+        socketFd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(socketFd >= 0 && connect(socketFd, address->ai_addr, address->ai_addrlen) != 0)
+        {
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if(socketFd < 0)
+    {
+        throw SNMPconnectorException("Failed to open UDP socket to " + ip + ": " + std::strerror(errno));
+    }
+
+    enableTimestamps(socketFd);
+}
+
+SNMPudpTransport::~SNMPudpTransport()
+{
+    close(socketFd);
+}
+
+std::shared_ptr<SNMPpreparedRequest> SNMPudpTransport::prepare(const SNMPrequestSpec& spec)
+{
+    std::shared_ptr<UdpRequest> request(new UdpRequest(spec));
+
+    switch(spec.operation)
+    {
+    case SNMP_GETBULK:
+        request->pduType = sNMP_PDU_GETBULK;
+        request->errorIndex = spec.maxRepetitions;
+        break;
+    case SNMP_SET:
+        request->pduType = sNMP_PDU_SET;
+        break;
+    default:
+        request->pduType = sNMP_PDU_GET;
+        break;
+    }
+
+    SNMPber::encodeVarbinds(spec.varbinds, request->varbinds);
+    return request;
+}
+
+bool SNMPudpTransport::updateValues(SNMPpreparedRequest& preparedRequest, const std::vector<SNMPvarbind>& varbinds)
+{
+    UdpRequest& request = static_cast<UdpRequest&>(preparedRequest);
+    if(request.pduType != sNMP_PDU_SET)
+    {
+        return false;
+    }
+
+    request.varbinds.clear(); // The encoder appends.
+    SNMPber::encodeVarbinds(varbinds, request.varbinds);
+    return true;
+}
+
+int32_t SNMPudpTransport::execute(SNMPpreparedRequest& preparedRequest, SNMPresponse& response)
+{
+    UdpRequest& request = static_cast<UdpRequest&>(preparedRequest);
+    std::unique_lock<std::mutex> l(lock);
+
+    requestId = (requestId + 1) & 0x7FFFFFFF;
+    SNMPber::encodeMessage(SNMPber::version2c, community, request.pduType, requestId, 0, request.errorIndex, request.varbinds, message);
+
+    response.requestSize = message.size();
+    response.responseSize = 0;
+
+    response.sentTime = wallClockNanoseconds();
+    if(send(socketFd, message.data(), message.size(), 0) != static_cast<ssize_t>(message.size()))
+    {
+        response.varbinds.clear();
+        return (errno == ECONNREFUSED) ? SNMP_CLASS_TIMEOUT : SNMP_CLASS_TL_FAILED;
+    }
+
+    uint64_t deadline = monotonicMicroseconds() + timeout * 1000ull;
+    for(;;)
+    {
+        uint64_t now = monotonicMicroseconds();
+        if(now >= deadline)
+        {
+            response.varbinds.clear();
+            return SNMP_CLASS_TIMEOUT;
+        }
+
+        pollfd descriptor;
+        descriptor.fd = socketFd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+
+        int ready = poll(&descriptor, 1, static_cast<int>((deadline - now + 999) / 1000));
+        if(ready == 0 || (ready < 0 && errno == EINTR))
+        {
+            continue;
+        }
+        if(ready < 0)
+        {
+            response.varbinds.clear();
+            return SNMP_CLASS_TL_FAILED;
+        }
+
+        iovec buffer;
+        buffer.iov_base = &datagram[0];
+        buffer.iov_len = datagram.size();
+        msghdr header;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_iov = &buffer;
+        header.msg_iovlen = 1;
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(socketFd, &header, 0);
+        if(received < 0)
+        {
+            // Port unreachable from an earlier send. The agent is not there, which looks like a timeout from outside.
+            if(errno == ECONNREFUSED || errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            response.varbinds.clear();
+            return SNMP_CLASS_TL_FAILED;
+        }
+
+        // Decoded into the varbinds of the response, which still hold the strings of the last exchange of this request,
+        // so a request answered with the same OIDs as before does not allocate.
+        decoded.varbinds.swap(response.varbinds);
+        bool valid = SNMPber::decodeMessage(&datagram[0], static_cast<size_t>(received), decoded);
+        decoded.varbinds.swap(response.varbinds);
+
+        // Late answers to earlier requests and garbage are dropped.
+        if(!valid || decoded.pduType != sNMP_PDU_RESPONSE || decoded.requestId != requestId)
+        {
+            continue;
+        }
+
+        response.responseSize = static_cast<uint64_t>(received);
+        response.receivedTime = receiveTime(header);
+        if(decoded.errorStatus != 0)
+        {
+            response.varbinds.clear();
+            return decoded.errorStatus;
+        }
+        return SNMP_CLASS_SUCCESS;
+    }
+}
+
+void SNMPudpTransport::enableTimestamps(const int socketFd)
+{
+    // Best effort, without it the connector takes the time after the exchange.
+    int enable = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+}
+
+uint64_t SNMPudpTransport::receiveTime(const msghdr& message)
+{
+    for(cmsghdr* control = CMSG_FIRSTHDR(&message); control != 0; control = CMSG_NXTHDR(const_cast<msghdr*>(&message), control))
+    {
+        if(control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec stamp;
+            std::memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+            return static_cast<uint64_t>(stamp.tv_sec) * 1000000000 + stamp.tv_nsec;
+        }
+    }
+    return 0;
+}
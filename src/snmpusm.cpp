@@ -0,0 +1,121 @@
+#include "snmpusm.h"
+#include "snmpconnector.h"
+#include "snmp_pp/auth_priv.h"
+#include <sstream>
+#include <functional>
+#include <unistd.h>
+
+int32_t SNMPv3credentials::securityLevel() const
+{
+#ifdef _SNMPv3
+    if(authProtocol == SNMPv3_AUTH_NONE)
+    {
+        return SNMP_SECURITY_LEVEL_NOAUTH_NOPRIV;
+    }
+
+    return (privProtocol == SNMPv3_PRIV_NONE) ? SNMP_SECURITY_LEVEL_AUTH_NOPRIV : SNMP_SECURITY_LEVEL_AUTH_PRIV;
+#else
+    return 0;
+#endif
+}
+
+SNMPusm::SNMPusm() : localizations(0)
+{
+#ifdef _SNMPv3
+    // The device server may have set up SNMPv3 itself.
+    if(Snmp_pp::v3MP::I != 0)
+    {
+        return;
+    }
+
+    // Local engine ID only has to be unique, we are never the authoritative engine.
+    char host[64] = "";
+    gethostname(host, sizeof(host) - 1);
+    std::stringstream engineId;
+    engineId << "RFtx" << getpid() << host;
+
+    int status;
+    new Snmp_pp::v3MP(Snmp_pp::OctetStr(engineId.str().substr(0, 32).c_str()), 1, status); // Lives until exit, registered as v3MP::I.
+
+    if(status != SNMPv3_MP_OK)
+    {
+        throw SNMPconnectorException("Failed to initialize SNMPv3.");
+    }
+#else
+    throw SNMPconnectorException("SNMP++ was built without SNMPv3 support.");
+#endif
+}
+
+SNMPusm& SNMPusm::instance()
+{
+    static SNMPusm usm;
+    return usm;
+}
+
+bool SNMPusm::localize(const SNMPv3credentials& credentials, const Snmp_pp::OctetStr& engineId)
+{
+#ifdef _SNMPv3
+    // The USM holds one entry per engine and user. Only a hash of the passwords is kept, the passwords would stay in
+    // memory for the lifetime of the process.
+    std::string user = std::string(reinterpret_cast<const char*>(engineId.data()), engineId.len()) + '\0' + credentials.securityName;
+    std::stringstream fingerprint;
+    fingerprint << credentials.authProtocol << ':' << credentials.privProtocol << ':'
+                << std::hash<std::string>()(credentials.authPassword + '\0' + credentials.privPassword);
+
+    // Held while hashing, so a second transport to the same agent waits for the keys instead of deriving them again.
+    std::unique_lock<std::mutex> l(lock);
+
+    std::map<std::string, std::string>::const_iterator found = localized.find(user);
+    if(found != localized.end() && found->second == fingerprint.str())
+    {
+        return false;
+    }
+
+    unsigned char authKey[SNMPv3_USM_MAX_KEY_LEN];
+    unsigned char privKey[SNMPv3_USM_MAX_KEY_LEN];
+    unsigned int authKeyLength = sizeof(authKey);
+    unsigned int privKeyLength = sizeof(privKey);
+
+    Snmp_pp::USM* usm = Snmp_pp::v3MP::I->get_usm();
+    int status = usm->build_localized_keys(engineId, credentials.authProtocol, credentials.privProtocol,
+                                           reinterpret_cast<const unsigned char*>(credentials.authPassword.data()), credentials.authPassword.size(),
+                                           reinterpret_cast<const unsigned char*>(credentials.privPassword.data()), credentials.privPassword.size(),
+                                           authKey, &authKeyLength, privKey, &privKeyLength);
+
+    if(status == SNMPv3_USM_OK)
+    {
+        Snmp_pp::OctetStr name(credentials.securityName.c_str());
+        status = usm->add_localized_user(engineId, name, name, credentials.authProtocol, Snmp_pp::OctetStr(authKey, authKeyLength),
+                                         credentials.privProtocol, Snmp_pp::OctetStr(privKey, privKeyLength));
+    }
+
+    if(status != SNMPv3_USM_OK)
+    {
+        throw SNMPconnectorException("Failed to localize keys of SNMPv3 user " + credentials.securityName + ".");
+    }
+
+    // The USM replaced keys of the user it had for the engine.
+    localized[user] = fingerprint.str();
+    localizations++;
+    return true;
+#else
+    (void)credentials;
+    (void)engineId;
+    throw SNMPconnectorException("SNMP++ was built without SNMPv3 support.");
+#endif
+}
+
+uint64_t SNMPusm::getLocalizations()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return localizations;
+}
+
+bool SNMPusm::isSupported()
+{
+#ifdef _SNMPv3
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,80 @@
+#include "statefilter.h"
+
+const size_t StateFilter::maxWindow;
+
+StateFilter::StateFilter() : required(1), window(1), minDwell(0), samples(maxWindow), next(0), count(0), state(-1), sample(-1), since(0),
+      suppressed(0)
+{
+}
+
+bool StateFilter::configure(const uint16_t required, const uint16_t window, const uint32_t minDwell)
+{
+    if(required == 0 || required > window || window > maxWindow)
+    {
+        return false;
+    }
+
+    this->required = required;
+    this->window = window;
+    this->minDwell = static_cast<uint64_t>(minDwell) * 1000;
+    next = 0;
+    count = 0;
+    return true;
+}
+
+bool StateFilter::accept(const int32_t state, const uint64_t now)
+{
+    // Nothing to filter against yet.
+    if(this->state < 0)
+    {
+        this->state = state;
+        sample = state;
+        since = now;
+        return true;
+    }
+
+    samples[next] = state;
+    next = (next + 1) % window;
+    if(count < window)
+    {
+        count++;
+    }
+
+    // The component keeps the state it took from the same sample.
+    if(state == this->state || state == sample)
+    {
+        return true;
+    }
+
+    size_t differing = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(samples[i] != this->state && samples[i] != sample)
+        {
+            differing++;
+        }
+    }
+
+    if(differing < required || now - since < minDwell)
+    {
+        suppressed++;
+        return false;
+    }
+
+    // Start counting again for the new state.
+    this->state = state;
+    sample = state;
+    since = now;
+    count = 0;
+    next = 0;
+    return true;
+}
+
+void StateFilter::applied(const int32_t state, const uint64_t now)
+{
+    if(state != this->state)
+    {
+        this->state = state;
+        since = now;
+    }
+}
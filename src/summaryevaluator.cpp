@@ -0,0 +1,184 @@
+#include "summaryevaluator.h"
+#include "rfcomponent.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    /// Merges the evaluation of the tail into the result of the vector part.
+    void merge(SummaryEvaluation& result, const SummaryEvaluation& tail)
+    {
+        result.anyNotOk = result.anyNotOk || tail.anyNotOk;
+        result.worstState = (tail.worstState < result.worstState) ? tail.worstState : result.worstState;
+        result.worstProblem = (tail.worstProblem < result.worstProblem) ? tail.worstProblem : result.worstProblem;
+    }
+
+    /// Lowest of the lanes stored in the array.
+    int32_t lowest(const int32_t* lanes, const size_t count)
+    {
+        int32_t toReturn = lanes[0];
+        for(size_t i = 1; i < count; i++)
+        {
+            toReturn = (lanes[i] < toReturn) ? lanes[i] : toReturn;
+        }
+        return toReturn;
+    }
+}
+
+SummaryEvaluation SummaryEvaluator::evaluateScalar(const int32_t* states, const size_t count, int32_t* problemMask)
+{
+    int32_t notOk = 0;
+    int32_t worstState = States::END_OF_STATE;
+    int32_t worstProblem = States::END_OF_STATE;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        int32_t value = states[i];
+        int32_t problem = (value < States::OK) & (value != States::OFF);
+        int32_t candidate = problem ? value : static_cast<int32_t>(States::END_OF_STATE);
+
+        notOk |= (value != States::OK) & (value != States::NOT_POSSIBLE);
+        worstState = (value < worstState) ? value : worstState;
+        worstProblem = (candidate < worstProblem) ? candidate : worstProblem;
+
+        if(problemMask != 0)
+        {
+            problemMask[i] = problem;
+        }
+    }
+
+    SummaryEvaluation toReturn;
+    toReturn.anyNotOk = (notOk != 0);
+    toReturn.worstState = worstState;
+    toReturn.worstProblem = worstProblem;
+    return toReturn;
+}
+
+#if defined(__AVX2__)
+
+SummaryEvaluation SummaryEvaluator::evaluate(const int32_t* states, const size_t count, int32_t* problemMask)
+{
+    const __m256i ok = _mm256_set1_epi32(States::OK);
+    const __m256i off = _mm256_set1_epi32(States::OFF);
+    const __m256i notPossible = _mm256_set1_epi32(States::NOT_POSSIBLE);
+    const __m256i end = _mm256_set1_epi32(States::END_OF_STATE);
+    const __m256i ones = _mm256_set1_epi32(-1);
+
+    __m256i notOk = _mm256_setzero_si256();
+    __m256i worstState = end;
+    __m256i worstProblem = end;
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + i));
+
+        // Lanes are all ones where the condition holds.
+        __m256i fine = _mm256_or_si256(_mm256_cmpeq_epi32(value, ok), _mm256_cmpeq_epi32(value, notPossible));
+        __m256i problem = _mm256_andnot_si256(_mm256_cmpeq_epi32(value, off), _mm256_cmpgt_epi32(ok, value));
+
+        notOk = _mm256_or_si256(notOk, _mm256_andnot_si256(fine, ones));
+        worstState = _mm256_min_epi32(worstState, value);
+        worstProblem = _mm256_min_epi32(worstProblem, _mm256_blendv_epi8(end, value, problem));
+
+        if(problemMask != 0)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(problemMask + i), _mm256_srli_epi32(problem, 31));
+        }
+    }
+
+    int32_t lanes[8];
+    SummaryEvaluation toReturn;
+    toReturn.anyNotOk = !_mm256_testz_si256(notOk, notOk);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), worstState);
+    toReturn.worstState = lowest(lanes, 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), worstProblem);
+    toReturn.worstProblem = lowest(lanes, 8);
+
+    merge(toReturn, evaluateScalar(states + i, count - i, (problemMask != 0) ? problemMask + i : 0));
+    return toReturn;
+}
+
+const char* SummaryEvaluator::implementation()
+{
+    return "AVX2";
+}
+
+#elif defined(__SSE2__)
+
+namespace
+{
+    /// Lane-wise minimum. SSE2 has no _mm_min_epi32 so select with a compare.
+    inline __m128i minimum(const __m128i a, const __m128i b)
+    {
+        __m128i greater = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+    }
+}
+
+SummaryEvaluation SummaryEvaluator::evaluate(const int32_t* states, const size_t count, int32_t* problemMask)
+{
+    const __m128i ok = _mm_set1_epi32(States::OK);
+    const __m128i off = _mm_set1_epi32(States::OFF);
+    const __m128i notPossible = _mm_set1_epi32(States::NOT_POSSIBLE);
+    const __m128i end = _mm_set1_epi32(States::END_OF_STATE);
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    __m128i notOk = _mm_setzero_si128();
+    __m128i worstState = end;
+    __m128i worstProblem = end;
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states + i));
+
+        // Lanes are all ones where the condition holds.
+        __m128i fine = _mm_or_si128(_mm_cmpeq_epi32(value, ok), _mm_cmpeq_epi32(value, notPossible));
+        __m128i problem = _mm_andnot_si128(_mm_cmpeq_epi32(value, off), _mm_cmplt_epi32(value, ok));
+        __m128i candidate = _mm_or_si128(_mm_and_si128(problem, value), _mm_andnot_si128(problem, end));
+
+        notOk = _mm_or_si128(notOk, _mm_andnot_si128(fine, ones));
+        worstState = minimum(worstState, value);
+        worstProblem = minimum(worstProblem, candidate);
+
+        if(problemMask != 0)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(problemMask + i), _mm_srli_epi32(problem, 31));
+        }
+    }
+
+    int32_t lanes[4];
+    SummaryEvaluation toReturn;
+    toReturn.anyNotOk = (_mm_movemask_epi8(notOk) != 0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), worstState);
+    toReturn.worstState = lowest(lanes, 4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), worstProblem);
+    toReturn.worstProblem = lowest(lanes, 4);
+
+    merge(toReturn, evaluateScalar(states + i, count - i, (problemMask != 0) ? problemMask + i : 0));
+    return toReturn;
+}
+
+const char* SummaryEvaluator::implementation()
+{
+    return "SSE2";
+}
+
+#else
+
+SummaryEvaluation SummaryEvaluator::evaluate(const int32_t* states, const size_t count, int32_t* problemMask)
+{
+    return evaluateScalar(states, count, problemMask);
+}
+
+const char* SummaryEvaluator::implementation()
+{
+    return "scalar";
+}
+
+#endif
@@ -1,25 +1,27 @@
 #include "transmitter.h"
-#include <sstream>
 
 const std::string Transmitter::upadateParamsName = "TRANSsupdate";
 const std::string Transmitter::diagRequestName = "diagTrans";
 
-Transmitter::Transmitter(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW)
-    : RFcomponent(oids[OIDS::TRANS_SUMMARY], "Transmitter", snmp), snmpW(snmpW)
+Transmitter::Transmitter(const std::shared_ptr<SNMPconnector> snmp, const std::shared_ptr<SNMPconnector> snmpW, const TransmitterTopology& topology)
+    : RFcomponent(topology, TRANSMITTER, snmp), snmpW(snmpW), resetOid(topology.getOid(OIDS::TRANS_RESET)),
+      powerSwitchOid(topology.getOid(OIDS::TRANS_ON)), nominalPowerOid(topology.getOid(OIDS::NOMINAL_POWER)),
+      diagNodes(topology.getComponent(TRANSMITTER).diagNodes)
 {
     // Register diagnose request.
-    snmp->createBulkRequest(diagRequestName, oids[OIDS::TRANS_SUMMARY], noDiagNodes);
+    snmp->createBulkRequest(diagRequestName, topology.getOid(topology.getComponent(TRANSMITTER).summary), diagNodes.size());
 
     // Register updateVariables request.
     // Create a vector with all oids.
     std::vector<std::string> variablesOids;
-    variablesOids.push_back(oids[OIDS::TRANS_FP]);
-    variablesOids.push_back(oids[OIDS::TRANS_RP]);
-    variablesOids.push_back(oids[OIDS::TRANS_PAE]);
-    variablesOids.push_back(oids[OIDS::TRANS_ON]);
-    variablesOids.push_back(oids[OIDS::NOMINAL_POWER]);
+    variablesOids.push_back(topology.getOid(OIDS::TRANS_FP));
+    variablesOids.push_back(topology.getOid(OIDS::TRANS_RP));
+    variablesOids.push_back(topology.getOid(OIDS::TRANS_PAE));
+    variablesOids.push_back(topology.getOid(OIDS::TRANS_ON));
+    variablesOids.push_back(topology.getOid(OIDS::NOMINAL_POWER));
 
-    snmp->createRequest(upadateParamsName, variablesOids);
+    // Forward and reflected power go with the state reads.
+    snmp->createRequest(upadateParamsName, variablesOids, SNMP_PRIORITY_STATE);
 
     // Initialize values
     nominalPower = 0;
@@ -27,6 +29,9 @@ Transmitter::Transmitter(const std::shared_ptr<SNMPconnector> snmp, const std::s
     forwardPower = 0;
     reflectedPower = 0;
     paEfficiency = 0;
+
+    const char* names[] = {"forwardPower", "reflectedPower", "paEfficiency", "on", "nominalPower"};
+    setParameterNames(std::vector<std::string>(names, names + 5));
 }
 
 Transmitter::~Transmitter()
@@ -37,29 +42,35 @@ Transmitter::~Transmitter()
 
 void Transmitter::diagnose(const std::vector<std::string>& summaryValues)
 {
+    RF_TRACE_SPAN("diagnose", &componentName);
+
     try
     {
         // There is only one summary for TX
         int32_t stateValue = convertToValue<int32_t>(summaryValues[0]);
 
         // Get other information about the transmitter.
-        std::vector<std::string> values = snmp->readRequest(diagRequestName);
+        const std::vector<std::string>& values = snmp->readRequest(diagRequestName);
 
-        if(values.size() != noDiagNodes)
+        if(values.size() != diagNodes.size())
         {
             throw SNMPconnectorException(dataAcquisitionFailed);
         }
 
         // Construct the status.
-        std::stringstream statusMsg;
-
-        statusMsg << "detailed status: " << std::endl
-                  << "txRF: " << StatesText[convertToValue<int32_t>(values[0])] << std::endl
-                  << "txReflection: " << StatesText[convertToValue<int32_t>(values[1])] << std::endl
-                  << "txRfSensorSummary: " << StatesText[convertToValue<int32_t>(values[2])] << std::endl
-                  << "txLocal: " << StatesText[convertToValue<int32_t>(values[3])] << std::endl;
+        {
+            RF_TRACE_SPAN("format status", &componentName);
+            statusBuffer.assign("detailed status: \n");
+            for(size_t i = 0; i < diagNodes.size(); i++)
+            {
+                statusBuffer += diagNodes[i];
+                statusBuffer += ": ";
+                statusBuffer += StatesText[convertToValue<int32_t>(values[i])];
+                statusBuffer += '\n';
+            }
+        }
 
-        setStateAndStatus(static_cast<States>(stateValue), statusMsg.str());
+        setStateAndStatus(static_cast<States>(stateValue), statusBuffer);
     }
     catch(const SNMPconnectorException& e)
     {
@@ -67,29 +78,22 @@ void Transmitter::diagnose(const std::vector<std::string>& summaryValues)
     }
 }
 
-void Transmitter::updateReadParameters()
+SNMPerror Transmitter::tryUpdateReadParameters()
 {
-    try
-    {
-        std::vector<std::string> values = snmp->readRequest(upadateParamsName);
+    RF_TRACE_SPAN("updateReadParameters", &componentName);
 
-        if(values.size() != 5)
-        {
-            throw SNMPconnectorException("Update parameters failed. Not enough data recieved.");
-        }
-
-        // Convert to appropriate type and update.
-        forwardPower = convertToValue<uint32_t>(values[0]);
-        reflectedPower = convertToValue<uint32_t>(values[1]);
-        paEfficiency = convertToValue<uint32_t>(values[2]);
-        on = convertToValue<uint32_t>(values[3]);
-        nominalPower = convertToValue<uint32_t>(values[4]);
-
-        dataValid = true;
-    }
-    catch(const SNMPconnectorException& e)
+    // Every value the agent returned is updated, the others keep their last value and are marked invalid.
+    SNMPerror error = readParameters<uint32_t>(upadateParamsName);
+    if(error.failed())
     {
-        dataValid = false;
-        throw e;
+        return error;
     }
+
+    forwardPower = parameterValues[0];
+    reflectedPower = parameterValues[1];
+    paEfficiency = parameterValues[2];
+    on = parameterValues[3];
+    nominalPower = parameterValues[4];
+    notifyParameters();
+    return error;
 }
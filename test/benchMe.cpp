@@ -0,0 +1,498 @@
+#include "RFinclude.h"
+#include "snmpcapture.h"
+#include "snmpusm.h"
+#include "snmpagent.h"
+#include "snmpfake.h"
+#include "snmpudp.h"
+#include "snmpbatch.h"
+#include "rfpowermonitor.h"
+#include "rfhistory.h"
+#include "snmp_pp/snmpmsg.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+
+namespace
+{
+    const uint32_t captureCycles = 100; //!< Poll cycles captured from the synthetic agent.
+    const uint32_t agentLatency = 500; //!< Simulated agent response time in us.
+    const std::string captureFile = "/tmp/rfbench.cap";
+
+    /**
+     * @brief The SyntheticAgent class Answers every read with OK and injects an amplifier fault on request.
+     */
+    class SyntheticAgent : public SNMPtransport
+    {
+    public:
+        SyntheticAgent(const std::string& faultyOid, const uint32_t latency = agentLatency) : faultyOid(faultyOid), fault(false), latency(latency) {}
+
+        std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec)
+        {
+            return std::shared_ptr<SNMPpreparedRequest>(new SNMPpreparedRequest(spec));
+        }
+
+        int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response)
+        {
+            if(latency > 0)
+            {
+                usleep(latency);
+            }
+
+            size_t count = (request.spec.operation == SNMP_GETBULK) ? request.spec.maxRepetitions : request.spec.varbinds.size();
+            response.varbinds.resize(count);
+            for(size_t i = 0; i < count; i++)
+            {
+                const std::string& oid = request.spec.varbinds[(request.spec.operation == SNMP_GETBULK) ? 0 : i].oid;
+                response.varbinds[i].oid = oid;
+                response.varbinds[i].value = (fault && oid == faultyOid) ? "3" : "5";
+                response.varbinds[i].syntax = sNMP_SYNTAX_INT;
+            }
+            response.requestSize = 40 + 20 * request.spec.varbinds.size();
+            response.responseSize = 40 + 25 * count;
+            return SNMP_CLASS_SUCCESS;
+        }
+
+        const std::string faultyOid; //!< Summary that reports the fault.
+        bool fault; //!< Is the fault active.
+        const uint32_t latency; //!< Response time in us.
+    };
+
+    /**
+     * @brief The Plant struct Full transmitter on one transport.
+     */
+    struct Plant
+    {
+        Plant(const std::shared_ptr<SNMPtransport>& transport) :
+            snmp(new SNMPconnector(transport, 0)), snmpW(new SNMPconnector(transport, 0)),
+            transmitter(snmp, snmpW), amps(TransmitterTopology(), snmp), lq(TransmitterTopology(), snmp),
+            rfSensor(snmp), outStage(snmp, snmpW), mtx(snmp, snmpW) {}
+
+        /// Checks that no component is left in UNKNOWN.
+        bool valid()
+        {
+            RFcomponent* components[] = {&transmitter, &amps, &lq, &rfSensor, &outStage, &mtx};
+            for(size_t i = 0; i < sizeof(components) / sizeof(components[0]); i++)
+            {
+                if(components[i]->getState() == States::UNKNOWN)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// One poll cycle of the device server.
+        void cycle()
+        {
+            RFcomponent* components[] = {&transmitter, &amps, &lq, &rfSensor, &outStage, &mtx};
+            for(size_t i = 0; i < sizeof(components) / sizeof(components[0]); i++)
+            {
+                components[i]->updateStateAndStatus();
+                components[i]->updateReadParameters();
+            }
+        }
+
+        std::shared_ptr<SNMPconnector> snmp;
+        std::shared_ptr<SNMPconnector> snmpW;
+        Transmitter transmitter;
+        Amplifiers amps;
+        LiquidCooling lq;
+        RFsensor rfSensor;
+        OutStage outStage;
+        MTx mtx;
+    };
+
+    void replay(const double speed)
+    {
+        std::shared_ptr<SNMPreplayTransport> transport(new SNMPreplayTransport(captureFile, speed));
+        Plant plant(transport);
+
+        uint64_t start = monotonicMicroseconds();
+        for(uint32_t i = 0; i < captureCycles; i++)
+        {
+            plant.cycle();
+        }
+        uint64_t elapsed = monotonicMicroseconds() - start;
+
+        std::stringstream label;
+        if(speed > 0)
+        {
+            label << speed << "x";
+        }
+        else
+        {
+            label << "max";
+        }
+
+        std::cout << std::setw(10) << label.str() << " "
+                  << std::setw(10) << elapsed << " us "
+                  << std::setw(10) << elapsed / captureCycles << " us/cycle "
+                  << std::setw(12) << static_cast<uint64_t>(captureCycles * 1e6 / (elapsed + 1)) << " cycles/s "
+                  << std::setw(8) << transport->getReplayed() << " exchanges" << std::endl;
+    }
+
+    /// Device server start: from the constructors until every component has a valid state, over SNMP++ and loopback UDP.
+    void coldStart(const uint16_t port, const char* label)
+    {
+        uint64_t start = monotonicMicroseconds();
+        std::shared_ptr<SNMPtransport> transport(new SNMPppTransport("127.0.0.1", "public", port, 1000));
+        Plant plant(transport);
+        uint64_t constructed = monotonicMicroseconds();
+        plant.cycle();
+        uint64_t end = monotonicMicroseconds();
+
+        std::cout << std::setw(10) << label << " "
+                  << std::setw(8) << constructed - start << " us constructors "
+                  << std::setw(8) << end - constructed << " us first cycle "
+                  << std::setw(8) << end - start << " us total" << (plant.valid() ? "" : " (NOT VALID)") << std::endl;
+    }
+
+    /**
+     * @brief The TripTimer class Measures the time from the response to the handler.
+     */
+    class TripTimer : public PowerTripHandler
+    {
+    public:
+        void tripped(const PowerTrip& trip)
+        {
+            latency.record(monotonicNanoseconds() - trip.received);
+        }
+
+        LatencyHistogram latency; //!< Response to handler in ns.
+    };
+
+    /// Reflected power trips detected by the power monitor over loopback UDP.
+    void powerTripLatency()
+    {
+        TransmitterTopology topology;
+        std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+        const std::string reflected = topology.getOid(OIDS::TRANS_RP);
+        fake->set(topology.getOid(OIDS::TRANS_FP), "1000", sNMP_SYNTAX_GAUGE32);
+        fake->set(reflected, "10", sNMP_SYNTAX_GAUGE32);
+        fake->set(topology.getOid(OIDS::RF_LINK), "5");
+        SNMPlocalAgent agent(fake);
+
+        PowerMonitorSettings settings;
+        settings.maxReflectedPower = 100;
+        settings.period = 200;
+        settings.cpu = 0;
+        std::shared_ptr<TripTimer> timer(new TripTimer);
+        RFpowerMonitor monitor(std::shared_ptr<SNMPtransport>(new SNMPudpTransport("127.0.0.1", "public", agent.getPort(), 100)), topology, settings, timer);
+        monitor.start();
+
+        const uint32_t trips = 500;
+        for(uint32_t i = 0; i < trips; i++)
+        {
+            fake->set(reflected, "500", sNMP_SYNTAX_GAUGE32);
+            while(monitor.getTrips() == i)
+            {
+                usleep(100);
+            }
+            fake->set(reflected, "10", sNMP_SYNTAX_GAUGE32);
+            while(monitor.isTripped())
+            {
+                usleep(100);
+            }
+        }
+        monitor.stop();
+
+        LatencyHistogram::Snapshot reaction = timer->latency.snapshot();
+        LatencyHistogram::Snapshot roundTrip = monitor.getRoundTrip();
+        std::cout << "Power monitor over loopback UDP" << (monitor.isRealtime() ? " (SCHED_FIFO, pinned)" : " (normal scheduling)") << ":" << std::endl;
+        std::cout << std::setw(14) << "response->trip" << " p50 " << std::setw(6) << reaction.percentile(50) << " ns  p99 "
+                  << std::setw(6) << reaction.percentile(99) << " ns  max " << reaction.max << " ns, " << reaction.count << " trips" << std::endl;
+        std::cout << std::setw(14) << "round trip" << " p50 " << std::setw(6) << roundTrip.percentile(50) << " us  p99 "
+                  << std::setw(6) << roundTrip.percentile(99) << " us, " << monitor.getCycles() << " cycles" << std::endl;
+    }
+
+    /// Poll cycle while the agent does not answer, with the throwing and the exception-free parameter update.
+    void outageCycle()
+    {
+        std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+        fake->setOffline(true);
+        Plant plant(fake);
+        RFcomponent* components[] = {&plant.transmitter, &plant.amps, &plant.lq, &plant.rfSensor, &plant.outStage, &plant.mtx};
+        const size_t noComponents = sizeof(components) / sizeof(components[0]);
+        const uint32_t cycles = 20000;
+
+        std::cout << "Cycle time with the agent unreachable:" << std::endl;
+        for(int mode = 0; mode < 2; mode++)
+        {
+            uint64_t failed = 0;
+            uint64_t start = monotonicNanoseconds();
+            for(uint32_t i = 0; i < cycles; i++)
+            {
+                for(size_t j = 0; j < noComponents; j++)
+                {
+                    components[j]->updateStateAndStatus();
+                    if(mode == 0)
+                    {
+                        try
+                        {
+                            components[j]->updateReadParameters();
+                        }
+                        catch(const SNMPconnectorException&)
+                        {
+                            failed++;
+                        }
+                    }
+                    else if(components[j]->tryUpdateReadParameters().failed())
+                    {
+                        failed++;
+                    }
+                }
+            }
+            uint64_t elapsed = monotonicNanoseconds() - start;
+
+            std::cout << std::setw(14) << ((mode == 0) ? "exceptions" : "expected") << " "
+                      << std::setw(8) << elapsed / cycles << " ns/cycle " << std::setw(8) << failed << " failed updates" << std::endl;
+        }
+    }
+
+    /// Cost of keeping the rollup tiers per sample and of reading a day of one parameter from them.
+    void historyCost()
+    {
+        Plant plant(std::shared_ptr<SNMPtransport>(new SyntheticAgent("", 0)));
+        plant.cycle();
+
+        RFhistory history;
+        const uint64_t second = 1000000000ull;
+        const uint64_t day = 86400;
+        const uint64_t begin = RFcomponent::wallClock() - day * second;
+        std::vector<int64_t> transmitterValues(plant.transmitter.getParameterNames().size(), 100);
+        std::vector<int64_t> lqValues(plant.lq.getParameterNames().size(), 20);
+
+        // A day of 1 Hz samples of the transmitter and the liquid cooling.
+        uint64_t start = monotonicNanoseconds();
+        for(uint64_t i = 0; i < day; i++)
+        {
+            transmitterValues[0] = 100 + static_cast<int64_t>(i % 7);
+            history.parametersUpdated(plant.transmitter, begin + i * second, transmitterValues);
+            history.parametersUpdated(plant.lq, begin + i * second, lqValues);
+        }
+        uint64_t perSample = (monotonicNanoseconds() - start) / (2 * day);
+
+        std::vector<HistoryPoint> points;
+        const uint32_t queries = 1000;
+        int32_t tier = -1;
+        start = monotonicNanoseconds();
+        for(uint32_t i = 0; i < queries; i++)
+        {
+            tier = history.query(plant.transmitter.getName(), "reflectedPower", begin, begin + day * second, points);
+        }
+        uint64_t perQuery = (monotonicNanoseconds() - start) / queries;
+
+        std::cout << "History tiers:" << std::endl;
+        std::cout << std::setw(14) << "sample" << " " << std::setw(8) << perSample << " ns  ("
+                  << plant.transmitter.getParameterNames().size() + plant.lq.getParameterNames().size() << " parameters, "
+                  << history.getTiers().size() << " tiers)" << std::endl;
+        std::cout << std::setw(14) << "24 h query" << " " << std::setw(8) << perQuery / 1000 << " us  ("
+                  << points.size() << " points from tier " << tier << ")" << std::endl;
+    }
+
+    /// Poll cycle of one GET per agent: one connected socket per agent, one request after the other, against one batch.
+    void batchScaling()
+    {
+        std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+        fake->set("1.3.6.1.2.1.1.3.0", "123456", sNMP_SYNTAX_TIMETICKS);
+        fake->set("1.3.6.1.2.1.1.7.0", "-72");
+
+        SNMPrequestSpec spec;
+        SNMPvarbind uptime = { "1.3.6.1.2.1.1.3.0", "", sNMP_SYNTAX_NULL };
+        SNMPvarbind level = { "1.3.6.1.2.1.1.7.0", "", sNMP_SYNTAX_NULL };
+        spec.varbinds.push_back(uptime);
+        spec.varbinds.push_back(level);
+
+        const size_t counts[] = {1, 4, 16, 64, 256};
+        const uint32_t cycles = 200;
+
+        std::cout << "Poll cycle over many agents, sequential vs batched, us/cycle and send+recv calls/cycle:" << std::endl;
+        for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            std::vector<std::shared_ptr<SNMPlocalAgent> > agents;
+            std::vector<std::shared_ptr<SNMPtransport> > sockets, targets;
+            std::vector<std::shared_ptr<SNMPpreparedRequest> > sequential, batched;
+            std::shared_ptr<SNMPudpBatch> batch(new SNMPudpBatch(1000));
+            for(size_t i = 0; i < counts[c]; i++)
+            {
+                agents.push_back(std::shared_ptr<SNMPlocalAgent>(new SNMPlocalAgent(fake)));
+                sockets.push_back(std::shared_ptr<SNMPtransport>(new SNMPudpTransport("127.0.0.1", "public", agents[i]->getPort(), 1000)));
+                targets.push_back(SNMPudpBatch::addTarget(batch, "127.0.0.1", "public", agents[i]->getPort()));
+                sequential.push_back(sockets[i]->prepare(spec));
+                batched.push_back(targets[i]->prepare(spec));
+            }
+
+            std::vector<SNMPresponse> responses(counts[c]);
+            std::vector<int32_t> status(counts[c]);
+            uint64_t failed = 0;
+
+            uint64_t start = monotonicMicroseconds();
+            for(uint32_t i = 0; i < cycles; i++)
+            {
+                for(size_t j = 0; j < counts[c]; j++)
+                {
+                    if(sockets[j]->execute(*sequential[j], responses[j]) != SNMP_CLASS_SUCCESS)
+                    {
+                        failed++;
+                    }
+                }
+            }
+            uint64_t sequentialTime = monotonicMicroseconds() - start;
+
+            start = monotonicMicroseconds();
+            for(uint32_t i = 0; i < cycles; i++)
+            {
+                for(size_t j = 0; j < counts[c]; j++)
+                {
+                    batch->queue(*batched[j], responses[j], status[j]);
+                }
+                failed += counts[c] - batch->exchange();
+            }
+            uint64_t batchedTime = monotonicMicroseconds() - start;
+
+            double batchedCalls = static_cast<double>(batch->getSendCalls() + batch->getReceiveCalls()) / cycles;
+            std::cout << std::setw(6) << counts[c] << " agents "
+                      << std::setw(8) << sequentialTime / cycles << " us " << std::setw(6) << 2 * counts[c] << " calls  "
+                      << std::setw(8) << batchedTime / cycles << " us " << std::setw(6) << batchedCalls << " calls  "
+                      << failed << " failed" << std::endl;
+        }
+    }
+
+    /// Time per message to build the request of a full poll of one component.
+    double messageCost(const Snmp_pp::Pdu& pdu, const Snmp_pp::OctetStr* engineId, const char* securityName, const uint32_t iterations)
+    {
+        Snmp_pp::SnmpMessage message;
+        Snmp_pp::OctetStr community("public");
+
+        uint64_t start = monotonicMicroseconds();
+        for(uint32_t i = 0; i < iterations; i++)
+        {
+#ifdef _SNMPv3
+            if(engineId != 0)
+            {
+                message.loadv3(pdu, *engineId, Snmp_pp::OctetStr(securityName), SNMP_SECURITY_MODEL_USM, Snmp_pp::version3);
+                continue;
+            }
+#else
+            (void)engineId;
+            (void)securityName;
+#endif
+            message.load(pdu, community, Snmp_pp::version2c);
+        }
+        return static_cast<double>(monotonicMicroseconds() - start) / iterations;
+    }
+
+    void usmCost()
+    {
+        if(!SNMPusm::isSupported())
+        {
+            std::cout << "SNMPv3: not supported by this SNMP++ build" << std::endl;
+            return;
+        }
+
+        // No session is opened here, so quiet the SNMP++ log as the transports do.
+        Snmp_pp::DefaultLog::log()->set_filter(EVENT_LOG, 0);
+        Snmp_pp::DefaultLog::log()->set_filter(INFO_LOG, 0);
+        Snmp_pp::DefaultLog::log()->set_filter(DEBUG_LOG, 0);
+
+        SNMPusm& usm = SNMPusm::instance();
+        SNMPv3credentials authPriv;
+        authPriv.securityName = "benchAuthPriv";
+        authPriv.authPassword = "authpassword";
+        authPriv.privPassword = "privpassword";
+        SNMPv3credentials authNoPriv(authPriv);
+        authNoPriv.securityName = "benchAuthNoPriv";
+        authNoPriv.privProtocol = SNMPv3_PRIV_NONE;
+
+        // Key localization, first for a new engine and then from the cache.
+        Snmp_pp::OctetStr engineId("benchEngine01");
+        uint64_t start = monotonicMicroseconds();
+        usm.localize(authPriv, engineId);
+        uint64_t miss = monotonicMicroseconds() - start;
+
+        start = monotonicMicroseconds();
+        for(uint32_t i = 0; i < 1000; i++)
+        {
+            usm.localize(authPriv, engineId);
+        }
+        double hit = static_cast<double>(monotonicMicroseconds() - start) / 1000;
+        usm.localize(authNoPriv, engineId);
+
+        std::cout << "SNMPv3 key localization: " << miss << " us per engine, " << hit << " us cached" << std::endl;
+
+        // Per request cost of encoding, HMAC and encryption for a summary read of 10 OIDs.
+        Snmp_pp::Pdu pdu;
+        for(uint32_t i = 0; i < 10; i++)
+        {
+            std::stringstream oid;
+            oid << "1.3.6.1.4.1.19324.2.1." << i + 1 << ".0";
+            Snmp_pp::Vb vb(Snmp_pp::Oid(oid.str().c_str()));
+            pdu += vb;
+        }
+        pdu.set_type(sNMP_PDU_GET);
+
+        const uint32_t iterations = 20000;
+        std::cout << "Message build cost for 10 varbinds:" << std::endl;
+        std::cout << std::setw(14) << "v2c" << " " << std::setw(8) << messageCost(pdu, 0, 0, iterations) << " us" << std::endl;
+#ifdef _SNMPv3
+        pdu.set_security_level(SNMP_SECURITY_LEVEL_AUTH_NOPRIV);
+        std::cout << std::setw(14) << "authNoPriv" << " " << std::setw(8) << messageCost(pdu, &engineId, "benchAuthNoPriv", iterations) << " us" << std::endl;
+        pdu.set_security_level(SNMP_SECURITY_LEVEL_AUTH_PRIV);
+        std::cout << std::setw(14) << "authPriv" << " " << std::setw(8) << messageCost(pdu, &engineId, "benchAuthPriv", iterations) << " us" << std::endl;
+#endif
+    }
+}
+
+int main()
+{
+    TransmitterTopology topology;
+
+    // Capture a run against the synthetic agent. Every 10th cycle amplifier 3 is faulty so the diagnose path runs too.
+    {
+        std::shared_ptr<SyntheticAgent> agent(new SyntheticAgent(topology.getSummaryOids(AMPLIFIERS).at(2)));
+        std::shared_ptr<SNMPtransport> capture(new SNMPcaptureTransport(agent, captureFile));
+        Plant plant(capture);
+
+        uint64_t start = monotonicMicroseconds();
+        for(uint32_t i = 0; i < captureCycles; i++)
+        {
+            agent->fault = (i % 10 == 9);
+            plant.cycle();
+        }
+        std::cout << "Captured " << captureCycles << " cycles in " << monotonicMicroseconds() - start << " us" << std::endl;
+    }
+
+    // Replay through the real component logic.
+    std::cout << "Replay speed, total time, time per cycle, throughput:" << std::endl;
+    replay(1.0);
+    replay(1000.0);
+    replay(0);
+
+    std::remove(captureFile.c_str());
+
+    // Cold start against a local agent that answers instantly.
+    {
+        SNMPlocalAgent agent(std::shared_ptr<SNMPtransport>(new SyntheticAgent("", 0)));
+        std::cout << "Cold start to first valid state:" << std::endl;
+        coldStart(agent.getPort(), "first");
+        coldStart(agent.getPort(), "restart");
+    }
+
+    // Outage handling without unwinding.
+    outageCycle();
+
+    // Interlock path: response received to trip handler called.
+    powerTripLatency();
+
+    // Long-term trending without scanning raw samples.
+    historyCost();
+
+    // Syscalls per poll cycle grow with the agents unless the requests of all agents are batched.
+    batchScaling();
+
+    // Crypto overhead of authenticated polling. Verifying and decrypting the response costs about the same again.
+    usmCost();
+    return 0;
+}
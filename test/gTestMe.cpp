@@ -1,9 +1,55 @@
 #include "gtest/gtest.h"
 #include "RFinclude.h"
+#include "summaryevaluator.h"
+#include "rfrecorder.h"
+#include "rfmetrics.h"
+#include "rfhistory.h"
+#include "rfshm.h"
+#include "rfpowermonitor.h"
+#include "rfrecovery.h"
+#include "snmpcapture.h"
+#include "snmpcache.h"
+#include "snmplanes.h"
+#include "snmpfake.h"
+#include "snmpudp.h"
+#include "snmpbatch.h"
+#include "snmpagent.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 std::string IP = "";
 
+namespace
+{
+    __thread bool countAllocations = false; //!< Counts global allocations of this thread while set, agent threads are not counted.
+    std::atomic<uint64_t> allocations(0); //!< Number of counted allocations.
+}
+
+// Not inlined, so the compiler does not pair malloc and free with new expressions.
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    if(countAllocations)
+    {
+        allocations++;
+    }
+
+    void* memory = std::malloc(size ? size : 1);
+    if(memory == 0)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+__attribute__((noinline)) void operator delete(void* memory) throw()
+{
+    std::free(memory);
+}
+
 // The fixture for testing class SNMPconnector.
 class SNMP : public ::testing::Test
 {
@@ -351,3 +397,1843 @@ TEST_F(OSTAGE, SetGetPower) // Dangerous so we set it to 0.
 }
 */
 
+
+TEST(STATISTICS, HistogramPercentiles)
+{
+    LatencyHistogram histogram;
+
+    for(uint64_t i = 1; i <= 1000; i++)
+    {
+        histogram.record(i);
+    }
+
+    LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.count, 1000u);
+    ASSERT_EQ(snapshot.min, 1u);
+    ASSERT_EQ(snapshot.max, 1000u);
+    ASSERT_NEAR(snapshot.mean(), 500.5, 0.001);
+
+    // Buckets are within 12.5% of the real value.
+    ASSERT_NEAR(snapshot.percentile(50), 500, 500 * 0.125);
+    ASSERT_NEAR(snapshot.percentile(99), 990, 990 * 0.125);
+    ASSERT_EQ(snapshot.percentile(100), 1000u);
+}
+
+TEST(STATISTICS, HistogramBuckets)
+{
+    for(uint64_t value = 0; value < 1000000; value = value * 3 + 1)
+    {
+        uint16_t index = LatencyHistogram::bucketIndex(value);
+        ASSERT_GE(LatencyHistogram::bucketUpperBound(index), value);
+        if(index > 0)
+        {
+            ASSERT_LT(LatencyHistogram::bucketUpperBound(index - 1), value);
+        }
+    }
+}
+
+TEST_F(SNMP, RequestStatistics)
+{
+    ASSERT_TRUE(connected);
+
+    std::vector<std::string> myOIDS;
+    myOIDS.push_back("1.3.6.1.2.1.1.1.0");
+    conn->createRequest("MyRequest", myOIDS);
+
+    try
+    {
+        conn->readRequest("MyRequest");
+    }
+    catch(const SNMPconnectorException& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+
+    std::map<std::string, RequestStatisticsSnapshot> stats = conn->getStatistics();
+    ASSERT_EQ(stats.count("MyRequest"), 1u);
+    ASSERT_EQ(stats.at("MyRequest").requests, 1u);
+    ASSERT_EQ(stats.at("MyRequest").latency.count, 1u);
+    ASSERT_GT(stats.at("MyRequest").bytesSent, 0u);
+}
+
+TEST(TRACE, ChromeTraceExport)
+{
+    std::string component("TestComponent");
+
+    RFtrace::enable(16);
+    {
+        RF_TRACE_SPAN("testSpan", &component);
+    }
+    RFtrace::disable();
+    {
+        RF_TRACE_SPAN("disabledSpan");
+    }
+
+    std::stringstream trace;
+    RFtrace::writeChromeTrace(trace);
+
+    ASSERT_NE(trace.str().find("\"name\":\"testSpan\""), std::string::npos);
+    ASSERT_NE(trace.str().find("\"detail\":\"TestComponent\""), std::string::npos);
+    ASSERT_EQ(trace.str().find("disabledSpan"), std::string::npos);
+}
+
+TEST(TOPOLOGY, Default)
+{
+    TransmitterTopology topology;
+
+    ASSERT_EQ(topology.getComponent(AMPLIFIERS).name, "AMPs");
+    ASSERT_EQ(topology.getSummaryOids(AMPLIFIERS).size(), 12u);
+    ASSERT_EQ(topology.getSummaryOids(TRANSMITTER).size(), 1u);
+    ASSERT_EQ(topology.getSummaryOids(LIQUID_COOLING).at(1), "1.3.6.1.4.1.2566.127.1.2.216.100.1.1.1.1.6.2.1");
+    ASSERT_EQ(topology.getComponent(LIQUID_COOLING).diagNodes.size(), 4u);
+}
+
+TEST(TOPOLOGY, Parse)
+{
+    TransmitterTopology topology = TransmitterTopology::parse(
+        "{ \"oids\": { \"TRANS_RESET\": \"1.2.3\" },"
+        "  \"components\": { \"amplifiers\": { \"name\": \"Amps\", \"indices\": [3, 5], \"diagNodes\": [\"a\", \"b\"] } } }");
+
+    ASSERT_EQ(topology.getOid(OIDS::TRANS_RESET), "1.2.3");
+    ASSERT_EQ(topology.getOid(OIDS::TRANS_FP), oids[OIDS::TRANS_FP]);
+    ASSERT_EQ(topology.getComponent(AMPLIFIERS).name, "Amps");
+    ASSERT_EQ(topology.getComponent(AMPLIFIERS).diagNodes.size(), 2u);
+    ASSERT_EQ(topology.expand(OIDS::AMP_ON, AMPLIFIERS).at(1), "1.3.6.1.4.1.2566.127.1.2.216.3.1.10.1.1.8.1.1.5.10016");
+
+    ASSERT_THROW(TransmitterTopology::parse("{ \"components\": { \"amplifiers\": { \"indices\": [] } } }"), RfTopologyException);
+    ASSERT_THROW(TransmitterTopology::parse("{ \"oids\": { \"UNKNOWN\": \"1.2.3\" } }"), RfTopologyException);
+    ASSERT_THROW(TransmitterTopology::parse("{ \"oids\": "), RfTopologyException);
+}
+
+TEST(TOPOLOGY, LoadFile)
+{
+    TransmitterTopology topology;
+    ASSERT_NO_THROW(topology = TransmitterTopology::load("config/solaris.json"));
+    ASSERT_EQ(topology.getSummaryOids(AMPLIFIERS), TransmitterTopology().getSummaryOids(AMPLIFIERS));
+    ASSERT_EQ(topology.getComponent(AMPLIFIERS).diagNodes, TransmitterTopology().getComponent(AMPLIFIERS).diagNodes);
+}
+
+TEST(TOPOLOGY, AnyDeviceCount)
+{
+    std::vector<uint16_t> ampIndices;
+    for(uint16_t i = 1; i <= 32; i++)
+    {
+        ampIndices.push_back(i);
+    }
+
+    TransmitterTopology topology;
+    topology.setIndices(AMPLIFIERS, ampIndices);
+    topology.setIndices(LIQUID_COOLING, std::vector<uint16_t>(3, 1));
+
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(IP, "public"));
+    Amplifiers amps(topology, conn);
+    LiquidCooling lq(topology, conn);
+
+    ASSERT_EQ(amps.getNumberOfAmplifiers(), 32u);
+    ASSERT_EQ(lq.getNumberOfDevices(), 3u);
+    ASSERT_EQ(lq.getInTemps().size(), 3u);
+    ASSERT_THROW(amps.getAmpON(32), RfComponentException);
+}
+
+TEST(SUMMARY, Evaluate)
+{
+    int32_t states[] = {States::OK, States::OK, States::OFF, States::OK, States::WARNING, States::OK, States::FAULT, States::OK, States::OK};
+    int32_t mask[9];
+
+    SummaryEvaluation result = SummaryEvaluator::evaluate(states, 9, mask);
+    ASSERT_TRUE(result.anyNotOk);
+    ASSERT_EQ(result.worstState, States::OFF);
+    ASSERT_EQ(result.worstProblem, States::FAULT);
+    ASSERT_EQ(mask[2], 0);
+    ASSERT_EQ(mask[4], 1);
+    ASSERT_EQ(mask[6], 1);
+    ASSERT_EQ(mask[8], 0);
+
+    result = SummaryEvaluator::evaluate(states, 2);
+    ASSERT_FALSE(result.anyNotOk);
+    ASSERT_EQ(result.worstProblem, States::END_OF_STATE);
+
+    result = SummaryEvaluator::evaluate(states, 0);
+    ASSERT_FALSE(result.anyNotOk);
+    ASSERT_EQ(result.worstState, States::END_OF_STATE);
+}
+
+TEST(SUMMARY, MatchesScalar)
+{
+    std::cout << "Summary evaluation: " << SummaryEvaluator::implementation() << std::endl;
+
+    std::vector<int32_t> states(67);
+    std::vector<int32_t> mask(states.size());
+    std::vector<int32_t> scalarMask(states.size());
+    srand(1);
+
+    for(int run = 0; run < 200; run++)
+    {
+        // Mostly OK values so that single problems at any position are covered.
+        for(size_t i = 0; i < states.size(); i++)
+        {
+            states[i] = (rand() % 4 == 0) ? rand() % (States::END_OF_STATE + 2) - 1 : static_cast<int32_t>(States::OK);
+        }
+
+        size_t count = run % states.size();
+        SummaryEvaluation simd = SummaryEvaluator::evaluate(states.data(), count, mask.data());
+        SummaryEvaluation scalar = SummaryEvaluator::evaluateScalar(states.data(), count, scalarMask.data());
+
+        ASSERT_EQ(simd.anyNotOk, scalar.anyNotOk);
+        ASSERT_EQ(simd.worstState, scalar.worstState);
+        ASSERT_EQ(simd.worstProblem, scalar.worstProblem);
+        ASSERT_TRUE(std::equal(mask.begin(), mask.begin() + count, scalarMask.begin()));
+    }
+}
+
+TEST(RECORDER, WriteSeekRead)
+{
+    const std::string prefix = "/tmp/rfrecorder_test";
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        std::remove(RFrecorder::segmentName(prefix, i).c_str());
+    }
+
+    {
+        // Small segments so the recording spans several of them.
+        RFrecorder recorder(prefix, 1000);
+        uint32_t power = recorder.channel("TRANS.forwardPower");
+        uint32_t state = recorder.channel("TRANS.state");
+        ASSERT_EQ(recorder.channel("TRANS.forwardPower"), power);
+
+        for(uint64_t i = 0; i < 2500; i++)
+        {
+            recorder.append(power, 1000 + i * 10, PARAMETER_SAMPLE, i);
+        }
+        recorder.append(state, 5, STATE_TRANSITION, States::FAULT, States::OK); // Clock stepped back.
+    }
+
+    RFrecordReader reader(prefix);
+    ASSERT_EQ(reader.size(), 2501u);
+    ASSERT_EQ(reader.seek(0), 0u);
+    ASSERT_EQ(reader.seek(1000 + 1500 * 10), 1500u);
+    ASSERT_EQ(reader.seek(1000 + 1500 * 10 - 5), 1500u);
+    ASSERT_EQ(reader.seek(1000000), reader.size());
+
+    std::vector<RFrecordReader::Sample> samples = reader.read(1000 + 999 * 10, 1000 + 1003 * 10);
+    ASSERT_EQ(samples.size(), 4u);
+    ASSERT_EQ(samples[0].value, 999);
+    ASSERT_EQ(samples[1].value, 1000);
+    ASSERT_EQ(samples[1].channel, "TRANS.forwardPower");
+
+    RFrecordReader::Sample last = reader.at(2500);
+    ASSERT_EQ(last.type, STATE_TRANSITION);
+    ASSERT_EQ(last.channel, "TRANS.state");
+    ASSERT_EQ(last.time, 1000u + 2499 * 10);
+    ASSERT_EQ(last.previous, States::OK);
+
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        std::remove(RFrecorder::segmentName(prefix, i).c_str());
+    }
+}
+
+TEST(RECORDER, DropsWhileRolloverFails)
+{
+    const std::string directory = "/tmp/rfrecorder_rollover";
+    const std::string moved = directory + ".moved";
+    const std::string prefix = directory + "/rec";
+    mkdir(directory.c_str(), 0755);
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        std::remove(RFrecorder::segmentName(prefix, i).c_str());
+    }
+
+    {
+        RFrecorder recorder(prefix, 10);
+        uint32_t power = recorder.channel("TRANS.forwardPower");
+        for(uint64_t i = 0; i < 10; i++)
+        {
+            recorder.append(power, 1000 + i, PARAMETER_SAMPLE, i);
+        }
+
+        // The next segment can not be created while the directory is gone. The full one stays mapped.
+        ASSERT_EQ(rename(directory.c_str(), moved.c_str()), 0);
+        for(uint64_t i = 0; i < 5; i++)
+        {
+            recorder.append(power, 2000 + i, PARAMETER_SAMPLE, i);
+        }
+        recorder.channel("TRANS.reflectedPower");
+        recorder.flush();
+        ASSERT_EQ(rename(moved.c_str(), directory.c_str()), 0);
+        ASSERT_EQ(recorder.getDropped(), 5u);
+
+        recorder.append(power, 3000, PARAMETER_SAMPLE, 42);
+    }
+
+    {
+        RFrecordReader reader(prefix);
+        ASSERT_EQ(reader.size(), 11u);
+        ASSERT_EQ(reader.at(10).value, 42);
+    }
+
+    // A count beyond the capacity is not trusted.
+    int fd = open(RFrecorder::segmentName(prefix, 1).c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    uint64_t count = 1000;
+    ASSERT_EQ(pwrite(fd, &count, sizeof(count), offsetof(RecordSegmentHeader, count)), static_cast<ssize_t>(sizeof(count)));
+    close(fd);
+    ASSERT_THROW(RFrecordReader reader(prefix), RfRecorderException);
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        std::remove(RFrecorder::segmentName(prefix, i).c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+namespace
+{
+    // Answers every read with the number of executed requests.
+    class CountingTransport : public SNMPtransport
+    {
+    public:
+        CountingTransport() : calls(0), prepared(0) {}
+
+        std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec)
+        {
+            prepared++;
+            return std::shared_ptr<SNMPpreparedRequest>(new SNMPpreparedRequest(spec));
+        }
+
+        int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response)
+        {
+            std::stringstream value;
+            value << ++calls;
+
+            size_t count = (request.spec.operation == SNMP_GETBULK) ? request.spec.maxRepetitions : request.spec.varbinds.size();
+            response.varbinds.assign(count, request.spec.varbinds[0]);
+            for(size_t i = 0; i < count; i++)
+            {
+                response.varbinds[i].value = value.str();
+                response.varbinds[i].syntax = sNMP_SYNTAX_INT;
+            }
+            response.requestSize = 10;
+            response.responseSize = 20;
+            return SNMP_CLASS_SUCCESS;
+        }
+
+        uint32_t calls;
+        uint32_t prepared;
+    };
+}
+
+TEST(REPLAY, CaptureAndReplay)
+{
+    const std::string fileName = "/tmp/rfreplay_test.cap";
+    std::vector<std::string> oids;
+    oids.push_back("1.3.6.1.2.1.1.1.0");
+    oids.push_back("1.3.6.1.2.1.1.3.0");
+
+    std::vector<std::string> first, bulk, second;
+    {
+        std::shared_ptr<SNMPtransport> capture(new SNMPcaptureTransport(std::shared_ptr<SNMPtransport>(new CountingTransport), fileName));
+        SNMPconnector conn(capture);
+        conn.createRequest("get", oids);
+        conn.createBulkRequest("bulk", "1.3.6.1.2.1.1", 3);
+
+        first = conn.readRequest("get");
+        bulk = conn.readRequest("bulk");
+        conn.setValue<const char*>("1.3.6.1.2.1.1.5.0", "line\nbreak");
+        second = conn.readRequest("get");
+    }
+
+    std::shared_ptr<SNMPreplayTransport> replay(new SNMPreplayTransport(fileName, 0));
+    SNMPconnector conn(replay, 0);
+    conn.createRequest("get", oids);
+    conn.createBulkRequest("bulk", "1.3.6.1.2.1.1", 3);
+
+    ASSERT_EQ(conn.readRequest("get"), first);
+    ASSERT_EQ(conn.readRequest("bulk"), bulk);
+    ASSERT_EQ(bulk.size(), 3u);
+    ASSERT_NO_THROW(conn.setValue<const char*>("1.3.6.1.2.1.1.5.0", "other"));
+    ASSERT_EQ(conn.readRequest("get"), second);
+    ASSERT_NE(first, second);
+
+    // Nothing more was recorded.
+    ASSERT_THROW(conn.readRequest("bulk"), SNMPconnectorException);
+    ASSERT_EQ(replay->getReplayed(), 4u);
+    ASSERT_EQ(conn.getStatistics()["get"].bytesReceived, 40u);
+
+    std::remove(fileName.c_str());
+}
+
+TEST(CACHE, MergesMissesAndServesFresh)
+{
+    const std::string x = "1.3.6.1.4.1.99999.2.1.0", y = "1.3.6.1.4.1.99999.2.2.0", z = "1.3.6.1.4.1.99999.2.3.0";
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    fake->set(x, "1");
+    fake->set(y, "2");
+    fake->set(z, "3");
+
+    std::shared_ptr<SNMPcachingTransport> cache(new SNMPcachingTransport(fake, 200));
+    SNMPconnector first(cache, 0), second(cache, 0);
+    std::vector<std::string> oids;
+    oids.push_back(x);
+    oids.push_back(y);
+    first.createRequest("a", oids);
+    oids[0] = y;
+    oids[1] = z;
+    second.createRequest("b", oids);
+
+    ASSERT_EQ(first.readRequest("a")[1], "2");
+    ASSERT_EQ(fake->getRequests(), 1u);
+
+    // Only z goes on the wire, y comes from the cache.
+    std::vector<std::string> values = second.readRequest("b");
+    ASSERT_EQ(values[0], "2");
+    ASSERT_EQ(values[1], "3");
+    ASSERT_EQ(fake->getRequests(), 2u);
+    ASSERT_EQ(cache->getHits(), 1u);
+    ASSERT_EQ(cache->getMisses(), 3u);
+
+    // Fresh values are reused even if the agent changed meanwhile.
+    fake->set(x, "7");
+    ASSERT_EQ(first.readRequest("a")[0], "1");
+    ASSERT_EQ(fake->getRequests(), 2u);
+
+    // Writes invalidate what they wrote.
+    first.setValue<int32_t>(y, 9);
+    ASSERT_EQ(fake->getRequests(), 3u);
+    values = second.readRequest("b");
+    ASSERT_EQ(values[0], "9");
+    ASSERT_EQ(values[1], "3");
+    ASSERT_EQ(fake->getRequests(), 4u);
+
+    // Stale values are read again.
+    usleep(250000);
+    ASSERT_EQ(first.readRequest("a")[0], "7");
+    ASSERT_EQ(fake->getRequests(), 5u);
+    ASSERT_EQ(cache->getMisses(), 6u);
+}
+
+namespace
+{
+    std::atomic<int> diagnosticsDone(0); //!< Diagnostic reads that returned, to check the order of completion.
+
+    void readDiagnostics(SNMPconnector* conn, const int reads)
+    {
+        for(int i = 0; i < reads; i++)
+        {
+            conn->readRequest("diag");
+            diagnosticsDone++;
+        }
+    }
+
+    /// Diagnostic reads that returned around one state read.
+    struct BurstOrder
+    {
+        uint64_t elapsed; //!< Duration of the state read in us.
+        int before; //!< Diagnostics done when the state read started.
+        int after; //!< Diagnostics done when the state read returned.
+    };
+
+    /// Runs two diagnostic bursts and one state read in between.
+    BurstOrder stateReadDuringBurst(const std::shared_ptr<SNMPlaneTransport>& lanes)
+    {
+        SNMPconnector first(lanes, 0), second(lanes, 0), state(lanes, 0);
+        first.createBulkRequest("diag", "1.3.6.1.4.1.99999.3", 3);
+        second.createBulkRequest("diag", "1.3.6.1.4.1.99999.3", 3);
+        state.createRequest("state", std::vector<std::string>(1, "1.3.6.1.4.1.99999.3.1.0"), SNMP_PRIORITY_STATE);
+
+        diagnosticsDone = 0;
+        std::thread a(readDiagnostics, &first, 5);
+        std::thread b(readDiagnostics, &second, 5);
+        usleep(10000);
+
+        BurstOrder order;
+        order.before = diagnosticsDone;
+        uint64_t start = monotonicMicroseconds();
+        state.readRequest("state");
+        order.elapsed = monotonicMicroseconds() - start;
+        order.after = diagnosticsDone;
+
+        a.join();
+        b.join();
+        return order;
+    }
+}
+
+TEST(LANES, StateReadsOvertakeDiagnostics)
+{
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    fake->set("1.3.6.1.4.1.99999.3.1.0", "5");
+    fake->set("1.3.6.1.4.1.99999.3.2.0", "5");
+    fake->set("1.3.6.1.4.1.99999.3.3.0", "5");
+    fake->setLatency(20000);
+
+    // Diagnostics are limited to their lane, a slot stays free for the state read. At most the diagnostic on the wire
+    // returns while the state read runs, the queued ones come after it.
+    SNMPlaneLimits limits;
+    limits.maxInFlight = 2;
+    std::shared_ptr<SNMPlaneTransport> lanes(new SNMPlaneTransport(fake, limits));
+    BurstOrder order = stateReadDuringBurst(lanes);
+    ASSERT_GE(order.elapsed, 20000u);
+    ASSERT_LE(order.after, order.before + 1);
+    ASSERT_EQ(lanes->getDeferred(SNMP_PRIORITY_STATE), 0u);
+    ASSERT_GE(lanes->getDeferred(SNMP_PRIORITY_DIAGNOSTICS), 1u);
+    ASSERT_EQ(lanes->getQueueDelay(SNMP_PRIORITY_DIAGNOSTICS).count, 10u);
+    ASSERT_EQ(lanes->getInFlight(), 0u);
+
+    // One request at a time: the state read waits for the one on the wire only, the queued diagnostics wait for it.
+    limits.maxInFlight = 1;
+    lanes.reset(new SNMPlaneTransport(fake, limits));
+    order = stateReadDuringBurst(lanes);
+    ASSERT_GE(order.elapsed, 20000u);
+    ASSERT_LE(order.after, order.before + 1);
+    ASSERT_EQ(lanes->getDeferred(SNMP_PRIORITY_STATE), 1u);
+    ASSERT_GE(lanes->getDeferred(SNMP_PRIORITY_DIAGNOSTICS), 2u);
+
+    limits.lanes[SNMP_PRIORITY_WRITE] = 0;
+    ASSERT_THROW(SNMPlaneTransport(fake, limits), SNMPconnectorException);
+}
+
+TEST(RATELIMIT, RequestsAndVarbindsPerSecond)
+{
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    for(int i = 1; i <= 50; i++)
+    {
+        std::stringstream oid;
+        oid << "1.3.6.1.4.1.99999.4." << i << ".0";
+        fake->set(oid.str(), "5");
+    }
+
+    // 100 requests/s with a burst of 5: 25 reads take at least 200 ms.
+    std::shared_ptr<SNMPrateLimiter> limiter(new SNMPrateLimiter(100.0, 0.0, 0.05));
+    SNMPconnector conn(fake, 0);
+    conn.setRateLimiter(limiter);
+    conn.createRequest("get", std::vector<std::string>(1, "1.3.6.1.4.1.99999.4.1.0"));
+
+    uint64_t start = monotonicMicroseconds();
+    for(int i = 0; i < 25; i++)
+    {
+        conn.readRequest("get");
+    }
+    uint64_t elapsed = monotonicMicroseconds() - start;
+    ASSERT_GE(elapsed, 195000u);
+    ASSERT_EQ(limiter->getRequests(), 25u);
+    ASSERT_GE(limiter->getDelayed(), 19u);
+    ASSERT_EQ(limiter->getQueued(), 0u);
+    ASSERT_EQ(conn.getStatistics()["get"].rateLimited, limiter->getDelayed());
+
+    // 1000 varbinds/s: bulk reads of 50 are larger than the bucket of 10 and go out every 50 ms.
+    limiter.reset(new SNMPrateLimiter(0.0, 1000.0, 0.01));
+    conn.setRateLimiter(limiter);
+    conn.createBulkRequest("bulk", "1.3.6.1.4.1.99999.4", 50);
+
+    start = monotonicMicroseconds();
+    for(int i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(conn.readRequest("bulk").size(), 50u);
+    }
+    elapsed = monotonicMicroseconds() - start;
+    ASSERT_GE(elapsed, 195000u);
+    ASSERT_EQ(limiter->getDelayed(), 4u);
+    ASSERT_EQ(limiter->getWait().count, 4u);
+    ASSERT_EQ(limiter->getRequests(), 5u);
+
+    // Unlimited again.
+    conn.setRateLimiter(std::shared_ptr<SNMPrateLimiter>());
+    conn.readRequest("bulk");
+    ASSERT_EQ(limiter->getRequests(), 5u);
+
+    ASSERT_THROW(SNMPrateLimiter(-1.0, 0.0), SNMPconnectorException);
+}
+
+namespace
+{
+    // Transport that can not build any request.
+    class RejectingTransport : public SNMPtransport
+    {
+    public:
+        std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec&)
+        {
+            throw SNMPconnectorException("Failed to add VBs to PDU.");
+        }
+
+        int32_t execute(SNMPpreparedRequest&, SNMPresponse&) { return SNMP_CLASS_ERROR; }
+    };
+}
+
+TEST(TRANSPORT, LazyPrepareAndOidPool)
+{
+    std::shared_ptr<CountingTransport> transport(new CountingTransport);
+    SNMPconnector conn(transport);
+    conn.createRequest("first", std::vector<std::string>(1, "1.3.6.1.2.1.1.1.0"));
+    conn.createRequest("second", std::vector<std::string>(2, "1.3.6.1.2.1.1.2.0"));
+    conn.createBulkRequest("bulk", "1.3.6.1.2.1.1", 4);
+    ASSERT_EQ(transport->prepared, 0u);
+
+    conn.readRequest("first");
+    conn.readRequest("first");
+    ASSERT_EQ(transport->prepared, 1u);
+    ASSERT_EQ(conn.readRequest("second").size(), 2u);
+    ASSERT_EQ(transport->prepared, 2u);
+
+    // Same OID string, same parsed object.
+    size_t before = SNMPoidPool::size();
+    const Snmp_pp::Oid& oid = SNMPoidPool::get("1.3.6.1.4.1.99999.1.0");
+    ASSERT_EQ(&oid, &SNMPoidPool::get(std::string("1.3.6.1.4.1.99999.1.0")));
+    ASSERT_EQ(SNMPoidPool::size(), before + 1);
+    ASSERT_EQ(oid.len(), 9u);
+
+    // Bad OIDs still fail where the request is made.
+    ASSERT_THROW(conn.createRequest("bad", std::vector<std::string>(1, "")), SNMPconnectorException);
+    ASSERT_THROW(conn.createRequest("bad", std::vector<std::string>()), SNMPconnectorException);
+    ASSERT_EQ(conn.tryReadResult("bad").getError().status, SNMP_CLASS_ERROR);
+
+    // A transport that can not build the request fails the read without throwing.
+    SNMPconnector failing(std::shared_ptr<SNMPtransport>(new RejectingTransport));
+    failing.createRequest("first", std::vector<std::string>(1, "1.3.6.1.2.1.1.1.0"));
+    SNMPexpected<SNMPresult> read = failing.tryReadResult("first");
+    ASSERT_FALSE(read.hasValue());
+    ASSERT_EQ(read.getError().status, SNMP_CLASS_ERROR);
+    ASSERT_THROW(failing.readRequest("first"), SNMPconnectorException);
+}
+
+TEST(BER, RoundTrip)
+{
+    std::vector<SNMPvarbind> varbinds(8);
+    const int32_t syntaxes[] = {sNMP_SYNTAX_INT, sNMP_SYNTAX_INT, sNMP_SYNTAX_OCTETS, sNMP_SYNTAX_GAUGE32,
+                                sNMP_SYNTAX_OID, sNMP_SYNTAX_IPADDR, sNMP_SYNTAX_CNTR64, sNMP_SYNTAX_NOSUCHOBJECT};
+    const char* values[] = {"-129", "300", "line\nbreak", "4294967295", "1.3.6.1.4.1.200000", "192.168.1.20", "18446744073709551615", ""};
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        std::stringstream oid;
+        oid << "1.3.6.1.2.1.1." << i + 1 << ".0";
+        varbinds[i].oid = oid.str();
+        varbinds[i].value = values[i];
+        varbinds[i].syntax = syntaxes[i];
+    }
+
+    std::string encoded, message;
+    SNMPber::encodeVarbinds(varbinds, encoded);
+    SNMPber::encodeMessage(SNMPber::version2c, "public", sNMP_PDU_RESPONSE, 0x12345678, 0, 0, encoded, message);
+
+    SNMPmessage decoded;
+    ASSERT_TRUE(SNMPber::decodeMessage(reinterpret_cast<const uint8_t*>(message.data()), message.size(), decoded));
+    ASSERT_EQ(decoded.version, SNMPber::version2c);
+    ASSERT_EQ(decoded.community, "public");
+    ASSERT_EQ(decoded.pduType, sNMP_PDU_RESPONSE);
+    ASSERT_EQ(decoded.requestId, 0x12345678);
+    ASSERT_EQ(decoded.varbinds.size(), varbinds.size());
+    for(size_t i = 0; i < varbinds.size(); i++)
+    {
+        ASSERT_EQ(decoded.varbinds[i].oid, varbinds[i].oid);
+        ASSERT_EQ(decoded.varbinds[i].value, varbinds[i].value);
+        ASSERT_EQ(decoded.varbinds[i].syntax, varbinds[i].syntax);
+    }
+
+    // Truncated messages are rejected.
+    ASSERT_FALSE(SNMPber::decodeMessage(reinterpret_cast<const uint8_t*>(message.data()), message.size() - 1, decoded));
+}
+
+TEST(FAKE, ComponentsOnFakeAgent)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+
+    std::vector<std::string> summaries = topology.getSummaryOids(AMPLIFIERS);
+    std::vector<std::string> ampOn = topology.expand(OIDS::AMP_ON, AMPLIFIERS);
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        fake->set(summaries[i], "5");
+        fake->set(ampOn[i], "5");
+    }
+
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(fake), 0));
+    Amplifiers amps(topology, conn);
+
+    amps.updateStateAndStatus();
+    amps.updateReadParameters();
+    ASSERT_EQ(amps.getState(), States::OK);
+    ASSERT_TRUE(amps.getAmpON(0));
+
+    // A faulty amplifier is diagnosed with a bulk read of the objects after its summary.
+    fake->set(summaries[2], "3");
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::FAULT);
+    ASSERT_NE(amps.getStatus().find("3 detailed status"), std::string::npos);
+
+    // Writes land in the MIB, writes to objects that do not exist are refused.
+    conn->setValue<int32_t>(ampOn[1], 2);
+    ASSERT_EQ(fake->get(ampOn[1]), "2");
+    ASSERT_THROW(conn->setValue<int32_t>("1.3.6.1.2.1.1.99.0", 0), SNMPconnectorException);
+
+    fake->setOffline(true);
+    ASSERT_THROW(amps.updateReadParameters(), SNMPconnectorException);
+    ASSERT_FALSE(amps.getDataValid());
+}
+
+namespace
+{
+    // Fake agent that creates every read object with an OK value, so a whole plant can be polled without a MIB file.
+    class DefaultingTransport : public SNMPtransport
+    {
+    public:
+        explicit DefaultingTransport(const std::shared_ptr<SNMPfakeTransport>& fake) : fake(fake) {}
+
+        std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec)
+        {
+            for(size_t i = 0; i < spec.varbinds.size(); i++)
+            {
+                if(fake->get(spec.varbinds[i].oid).empty())
+                {
+                    fake->set(spec.varbinds[i].oid, "5");
+                }
+            }
+            return fake->prepare(spec);
+        }
+
+        int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response) { return fake->execute(request, response); }
+
+        std::shared_ptr<SNMPfakeTransport> fake;
+    };
+}
+
+TEST(ALLOCATION, SteadyStatePollingDoesNotAllocate)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPtransport> transport(new DefaultingTransport(fake));
+
+    // One reading connection per component and a shared one for writing, like the device server does.
+    std::vector<std::shared_ptr<SNMPconnector> > conn;
+    for(int i = 0; i < COMPONENT_TYPES_LENGTH; i++)
+    {
+        conn.push_back(std::shared_ptr<SNMPconnector>(new SNMPconnector(transport, 0)));
+    }
+    std::shared_ptr<SNMPconnector> write(new SNMPconnector(transport, 0));
+
+    std::vector<std::shared_ptr<RFcomponent> > plant;
+    plant.push_back(std::shared_ptr<RFcomponent>(new Transmitter(conn[TRANSMITTER], write, topology)));
+    plant.push_back(std::shared_ptr<RFcomponent>(new Amplifiers(topology, conn[AMPLIFIERS])));
+    plant.push_back(std::shared_ptr<RFcomponent>(new LiquidCooling(topology, conn[LIQUID_COOLING])));
+    plant.push_back(std::shared_ptr<RFcomponent>(new RFsensor(conn[RF_SENSOR], topology)));
+    plant.push_back(std::shared_ptr<RFcomponent>(new OutStage(conn[OUT_STAGE], write, topology)));
+    plant.push_back(std::shared_ptr<RFcomponent>(new MTx(conn[MTX], write, topology)));
+
+    // Learn the OIDs, then make some components need a diagnosis.
+    for(size_t i = 0; i < plant.size(); i++)
+    {
+        plant[i]->updateStateAndStatus();
+    }
+    fake->set(topology.getSummaryOids(TRANSMITTER)[0], "4");
+    fake->set(topology.getSummaryOids(AMPLIFIERS)[1], "3");
+    fake->set(topology.getSummaryOids(AMPLIFIERS)[2], "2");
+    fake->set(topology.getSummaryOids(LIQUID_COOLING)[0], "3");
+    fake->set(topology.getSummaryOids(RF_SENSOR)[0], "4");
+
+    // Warm up, buffers grow to their final size.
+    for(int cycle = 0; cycle < 3; cycle++)
+    {
+        for(size_t i = 0; i < plant.size(); i++)
+        {
+            plant[i]->updateStateAndStatus();
+            ASSERT_NO_THROW(plant[i]->updateReadParameters());
+        }
+    }
+    ASSERT_EQ(plant[0]->getState(), States::WARNING);
+    ASSERT_EQ(plant[1]->getState(), States::FAULT);
+    ASSERT_EQ(plant[2]->getState(), States::FAULT);
+
+    allocations = 0;
+    countAllocations = true;
+    for(int cycle = 0; cycle < 100; cycle++)
+    {
+        for(size_t i = 0; i < plant.size(); i++)
+        {
+            plant[i]->updateStateAndStatus();
+            plant[i]->updateReadParameters();
+        }
+    }
+    countAllocations = false;
+
+    ASSERT_EQ(allocations, 0u);
+    ASSERT_NE(plant[1]->getStatus().find("2 detailed status"), std::string::npos);
+}
+
+TEST(ALLOCATION, UdpPollingDoesNotAllocate)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    SNMPlocalAgent agent(std::shared_ptr<SNMPtransport>(new DefaultingTransport(fake)));
+
+    std::shared_ptr<SNMPtransport> udp(new SNMPudpTransport("127.0.0.1", "public", agent.getPort(), 1000));
+    std::shared_ptr<SNMPconnector> read(new SNMPconnector(udp, 0));
+    std::shared_ptr<SNMPconnector> write(new SNMPconnector(udp, 0));
+    Transmitter transmitter(read, write, topology);
+
+    // The local agent creates the objects on the first reads.
+    for(int cycle = 0; cycle < 3; cycle++)
+    {
+        transmitter.updateStateAndStatus();
+        ASSERT_NO_THROW(transmitter.updateReadParameters());
+    }
+
+    allocations = 0;
+    countAllocations = true;
+    for(int cycle = 0; cycle < 100; cycle++)
+    {
+        transmitter.updateStateAndStatus();
+        transmitter.updateReadParameters();
+    }
+    countAllocations = false;
+    ASSERT_EQ(allocations, 0u);
+
+    // Repeated writes of the same OID reuse the prepared SET with the new value.
+    transmitter.setNominalPower(1000);
+    transmitter.setNominalPower(2000);
+    transmitter.updateReadParameters();
+    ASSERT_EQ(transmitter.getNominalPower(), 2000u);
+    ASSERT_EQ(write->getStatistics().size(), 1u);
+}
+
+TEST(STATEFILTER, NofMAndDwell)
+{
+    StateFilter filter;
+    ASSERT_FALSE(filter.configure(0, 3, 0));
+    ASSERT_FALSE(filter.configure(4, 3, 0));
+    ASSERT_FALSE(filter.configure(1, StateFilter::maxWindow + 1, 0));
+    ASSERT_TRUE(filter.configure(2, 3, 10));
+
+    // First sample is taken as it is.
+    ASSERT_TRUE(filter.accept(States::OK, 0));
+
+    // Single glitches are suppressed.
+    ASSERT_FALSE(filter.accept(States::WARNING, 20000));
+    ASSERT_TRUE(filter.accept(States::OK, 30000));
+    ASSERT_TRUE(filter.accept(States::OK, 40000));
+    ASSERT_FALSE(filter.accept(States::WARNING, 50000));
+    ASSERT_EQ(filter.getState(), States::OK);
+
+    // Second of three changes it.
+    ASSERT_TRUE(filter.accept(States::FAULT, 60000));
+    ASSERT_EQ(filter.getState(), States::FAULT);
+
+    // Dwell time holds the new state even when N of M want back.
+    ASSERT_FALSE(filter.accept(States::OK, 61000));
+    ASSERT_FALSE(filter.accept(States::OK, 62000));
+    ASSERT_TRUE(filter.accept(States::OK, 70000));
+    ASSERT_EQ(filter.getSuppressed(), 4u);
+}
+
+TEST(STATEFILTER, GlitchesSkipDiagnosis)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::vector<std::string> summaries = topology.getSummaryOids(AMPLIFIERS);
+    std::vector<std::string> ampOn = topology.expand(OIDS::AMP_ON, AMPLIFIERS);
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        fake->set(summaries[i], "5");
+        fake->set(ampOn[i], "5");
+    }
+
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(fake), 0));
+    Amplifiers amps(topology, conn);
+    amps.setStateFilter(2, 3);
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::OK);
+
+    // One bad read: no diagnosis, state stays.
+    uint64_t before = fake->getRequests();
+    fake->set(summaries[0], "4");
+    amps.updateStateAndStatus();
+    fake->set(summaries[0], "5");
+    amps.updateStateAndStatus();
+    amps.updateStateAndStatus();
+    ASSERT_EQ(fake->getRequests(), before + 3);
+    ASSERT_EQ(amps.getState(), States::OK);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 1u);
+
+    // A lasting problem gets through on the second read and is diagnosed.
+    fake->set(summaries[0], "4");
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::OK);
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::WARNING);
+    ASSERT_EQ(fake->getRequests(), before + 6);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 2u);
+
+    ASSERT_THROW(amps.setStateFilter(3, 2), RfComponentException);
+}
+
+TEST(STATEFILTER, FiltersAgainstDiagnosedState)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(new DefaultingTransport(fake)), 0));
+    std::vector<std::string> summaries = topology.getSummaryOids(AMPLIFIERS);
+    Amplifiers amps(topology, conn);
+    amps.setStateFilter(2, 3);
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::OK);
+
+    // The summaries show OFF as the worst state. The details of the warning can not be read, so the diagnosis takes UNKNOWN.
+    fake->set(summaries[0], "2");
+    fake->set(summaries[1], "4");
+    amps.updateStateAndStatus();
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::UNKNOWN);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 1u);
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::UNKNOWN);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 1u);
+
+    // Summaries showing the state the component took pass right away and are diagnosed.
+    uint64_t before = fake->getRequests();
+    fake->set(summaries[0], "5");
+    fake->set(summaries[1], "1");
+    amps.updateStateAndStatus();
+    ASSERT_EQ(fake->getRequests(), before + 2);
+    ASSERT_EQ(amps.getState(), States::UNKNOWN);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 1u);
+
+    // A single OK read is still a glitch.
+    fake->set(summaries[1], "5");
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::UNKNOWN);
+    ASSERT_EQ(amps.getSuppressedTransitions(), 2u);
+}
+
+TEST(METRICS, DerivedOncePerSample)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPtransport> transport(new DefaultingTransport(fake));
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(transport, 0));
+    std::shared_ptr<SNMPconnector> lqConn(new SNMPconnector(transport, 0));
+
+    Transmitter transmitter(conn, conn, topology);
+    LiquidCooling lq(topology, lqConn);
+    std::shared_ptr<RFmetrics> metrics(new RFmetrics(0.5));
+    transmitter.addListener(metrics);
+    lq.addListener(metrics);
+
+    // Learn the OIDs of the update requests, then give them values. Forward 100, reflected 25.
+    transmitter.updateReadParameters();
+    lq.updateReadParameters();
+    fake->set(topology.getOid(OIDS::TRANS_FP), "100");
+    fake->set(topology.getOid(OIDS::TRANS_RP), "25");
+    std::vector<std::string> inlet = topology.expand(OIDS::LQ_TIN, LIQUID_COOLING);
+    std::vector<std::string> outlet = topology.expand(OIDS::LQ_TOUT, LIQUID_COOLING);
+    for(size_t i = 0; i < inlet.size(); i++)
+    {
+        fake->set(inlet[i], "20");
+        fake->set(outlet[i], (i == 1) ? "30" : "24");
+    }
+
+    transmitter.updateReadParameters();
+    lq.updateReadParameters();
+
+    DerivedMetrics rf = metrics->get(transmitter.getName());
+    ASSERT_EQ(rf.samples, 2u);
+    ASSERT_EQ(rf.names[0], "reflectionCoefficient");
+    ASSERT_DOUBLE_EQ(rf.values[0], 0.5);
+    ASSERT_DOUBLE_EQ(rf.values[1], 3.0);
+    ASSERT_NEAR(rf.values[2], 6.0206, 1e-4);
+    ASSERT_EQ(rf.names[3], "forwardPowerEwma");
+    ASSERT_DOUBLE_EQ(rf.values[3], 52.5); // Seeded with 5, then half way to 100.
+
+    DerivedMetrics cooling = metrics->get(lq.getName());
+    ASSERT_EQ(cooling.names.size(), 2 * inlet.size() + 1);
+    ASSERT_EQ(cooling.names[2], "deltaT2");
+    ASSERT_DOUBLE_EQ(cooling.values[0], 4.0);
+    ASSERT_DOUBLE_EQ(cooling.values[2], 10.0);
+    ASSERT_DOUBLE_EQ(cooling.values.back(), 10.0);
+    ASSERT_EQ(metrics->getAll().size(), 2u);
+
+    // No forward power, no reflection.
+    fake->set(topology.getOid(OIDS::TRANS_FP), "0");
+    transmitter.updateReadParameters();
+    ASSERT_TRUE(std::isnan(metrics->get(transmitter.getName()).values[1]));
+
+    // Invalid inputs are not used. The reflected power EWMA keeps its value, the forward one goes on.
+    double reflectedEwma = metrics->get(transmitter.getName()).values[4];
+    fake->set(topology.getOid(OIDS::TRANS_FP), "100");
+    fake->remove(topology.getOid(OIDS::TRANS_RP));
+    transmitter.updateReadParameters();
+    rf = metrics->get(transmitter.getName());
+    ASSERT_TRUE(std::isnan(rf.values[0]));
+    ASSERT_TRUE(std::isnan(rf.values[2]));
+    ASSERT_DOUBLE_EQ(rf.values[4], reflectedEwma);
+    ASSERT_DOUBLE_EQ(rf.values[3], 63.125); // 52.5, 26.25 after the 0, then half way to 100.
+
+    fake->remove(outlet[1]);
+    lq.updateReadParameters();
+    cooling = metrics->get(lq.getName());
+    ASSERT_TRUE(std::isnan(cooling.values[2]));
+    ASSERT_DOUBLE_EQ(cooling.values[3], 5.0); // Seeded with 0, then half way to 10.
+    ASSERT_DOUBLE_EQ(cooling.values.back(), 4.0);
+
+    // The RF sensor reports power states, not powers, so nothing is derived from them.
+    std::shared_ptr<SNMPconnector> sensorConn(new SNMPconnector(transport, 0));
+    RFsensor sensor(sensorConn, topology);
+    sensor.addListener(metrics);
+    sensor.updateReadParameters();
+    ASSERT_TRUE(metrics->get(sensor.getName()).names.empty());
+    ASSERT_EQ(metrics->getAll().size(), 2u);
+}
+
+TEST(PARTIAL, MissingVarbindsOnlyInvalidateThemselves)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPtransport> transport(new DefaultingTransport(fake));
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(transport, 0));
+    std::shared_ptr<SNMPconnector> lqConn(new SNMPconnector(transport, 0));
+
+    Transmitter transmitter(conn, conn, topology);
+    LiquidCooling lq(topology, lqConn);
+    transmitter.updateReadParameters();
+    lq.updateReadParameters();
+    ASSERT_TRUE(transmitter.getDataValid());
+    ASSERT_TRUE(lq.isParameterValid(0));
+    std::vector<std::string> oids;
+    oids.push_back(topology.getOid(OIDS::TRANS_FP));
+    oids.push_back(topology.getOid(OIDS::TRANS_RP));
+    conn->createRequest("power", oids);
+    ASSERT_EQ(conn->readResult("power").invalid, 0u);
+
+    // Reflected power and the first inlet sensor disappear, the rest changes.
+    std::vector<std::string> inlet = topology.expand(OIDS::LQ_TIN, LIQUID_COOLING);
+    fake->remove(topology.getOid(OIDS::TRANS_RP));
+    fake->set(topology.getOid(OIDS::TRANS_FP), "100");
+    fake->remove(inlet[0]);
+    fake->set(inlet[1], "21");
+
+    ASSERT_NO_THROW(transmitter.updateReadParameters());
+    ASSERT_NO_THROW(lq.updateReadParameters());
+    ASSERT_FALSE(transmitter.getDataValid());
+    ASSERT_EQ(transmitter.getForwardPower(), 100u);
+    ASSERT_TRUE(transmitter.isParameterValid(0));
+    ASSERT_FALSE(transmitter.isParameterValid(1));
+    ASSERT_FALSE(lq.isParameterValid(0));
+    ASSERT_TRUE(lq.isParameterValid(1));
+    ASSERT_EQ(lq.getInTemps()[0], 5); // Last good value.
+    ASSERT_EQ(lq.getInTemps()[1], 21);
+
+    // The connector reports the status per varbind.
+    const SNMPresult& result = conn->readResult("power");
+    ASSERT_EQ(result.values.size(), 2u);
+    ASSERT_EQ(result.invalid, 1u);
+    ASSERT_EQ(result.values[0], "100");
+    ASSERT_EQ(result.status[1], SNMP_VARBIND_NO_SUCH_OBJECT);
+    ASSERT_THROW(conn->readRequest("power", false), SNMPconnectorException);
+
+    // A missing summary makes only its own device UNKNOWN, the others are still diagnosed.
+    lq.updateStateAndStatus();
+    ASSERT_EQ(lq.getState(), States::OK);
+    std::vector<std::string> summaries = topology.getSummaryOids(LIQUID_COOLING);
+    fake->remove(summaries[0]);
+    lq.updateStateAndStatus();
+    ASSERT_EQ(lq.getState(), States::UNKNOWN);
+    ASSERT_NE(lq.getStatus().find("\n1: OK"), std::string::npos);
+
+    // Nothing valid at all still fails.
+    fake->setOffline(true);
+    ASSERT_THROW(lq.updateReadParameters(), SNMPconnectorException);
+    ASSERT_FALSE(lq.getDataValid());
+}
+
+namespace
+{
+    // Agent that leaves out the last varbind of every response.
+    class TruncatingTransport : public SNMPtransport
+    {
+    public:
+        explicit TruncatingTransport(const std::shared_ptr<SNMPtransport>& backend) : backend(backend) {}
+
+        std::shared_ptr<SNMPpreparedRequest> prepare(const SNMPrequestSpec& spec) { return backend->prepare(spec); }
+
+        int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response)
+        {
+            int32_t status = backend->execute(request, response);
+            if(!response.varbinds.empty())
+            {
+                response.varbinds.pop_back();
+            }
+            return status;
+        }
+
+        std::shared_ptr<SNMPtransport> backend;
+    };
+}
+
+TEST(PARTIAL, ShortResponsesArePaddedOnlyInResults)
+{
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    fake->set("1.3.6.1.4.1.1.1.0", "1");
+    fake->set("1.3.6.1.4.1.1.2.0", "2");
+    fake->set("1.3.6.1.4.1.1.3.0", "3");
+    SNMPconnector conn(std::shared_ptr<SNMPtransport>(new TruncatingTransport(fake)), 0);
+
+    std::vector<std::string> oids;
+    oids.push_back("1.3.6.1.4.1.1.1.0");
+    oids.push_back("1.3.6.1.4.1.1.2.0");
+    oids.push_back("1.3.6.1.4.1.1.3.0");
+    conn.createRequest("short", oids);
+
+    // readRequest gives what was received, callers see the missing value by the size.
+    const std::vector<std::string>& values = conn.readRequest("short", false);
+    ASSERT_EQ(values.size(), 2u);
+    ASSERT_EQ(values[1], "2");
+
+    const SNMPresult& result = conn.readResult("short");
+    ASSERT_EQ(result.values.size(), 3u);
+    ASSERT_EQ(result.invalid, 1u);
+    ASSERT_EQ(result.status[2], SNMP_VARBIND_MISSING);
+
+    ASSERT_EQ(conn.readRequest("short").size(), 2u);
+}
+
+TEST(RECORDER, SkipsInvalidParameters)
+{
+    const std::string prefix = "/tmp/rfrecorder_invalid";
+    std::remove(RFrecorder::segmentName(prefix, 0).c_str());
+
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(new DefaultingTransport(fake)), 0));
+    LiquidCooling lq(topology, conn);
+    size_t parameters = lq.getParameterNames().size();
+
+    {
+        std::shared_ptr<RFrecorder> recorder(new RFrecorder(prefix));
+        lq.addListener(recorder);
+        lq.updateReadParameters();
+
+        // The first inlet sensor disappears and keeps its last value.
+        fake->remove(topology.expand(OIDS::LQ_TIN, LIQUID_COOLING)[0]);
+        lq.updateReadParameters();
+        lq.removeListener(recorder);
+    }
+
+    std::string missing;
+    for(size_t i = 0; i < parameters; i++)
+    {
+        if(!lq.isParameterValid(i))
+        {
+            missing = lq.getName() + "." + lq.getParameterNames()[i];
+        }
+    }
+    ASSERT_FALSE(missing.empty());
+
+    RFrecordReader reader(prefix);
+    ASSERT_EQ(reader.size(), 2 * parameters - 1);
+    for(uint64_t position = parameters; position < reader.size(); position++)
+    {
+        ASSERT_NE(reader.at(position).channel, missing);
+    }
+
+    std::remove(RFrecorder::segmentName(prefix, 0).c_str());
+}
+
+namespace
+{
+    // Listener that fails like a recorder on a full disk, or counts the calls.
+    class ThrowingListener : public ComponentListener
+    {
+    public:
+        explicit ThrowingListener(const bool throws) : throws(throws), calls(0) {}
+
+        void parametersUpdated(const RFcomponent&, const uint64_t, const std::vector<int64_t>&) { call(); }
+        void stateChanged(const RFcomponent&, const uint64_t, const States, const States, const std::string&) { call(); }
+
+        void call()
+        {
+            calls++;
+            if(throws)
+            {
+                throw RfRecorderException("Failed to create segment.");
+            }
+        }
+
+        const bool throws;
+        uint32_t calls;
+    };
+}
+
+TEST(EXPECTED, OutageWithoutExceptions)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPtransport> transport(new DefaultingTransport(fake));
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(transport, 0));
+    std::shared_ptr<SNMPconnector> lqConn(new SNMPconnector(transport, 0));
+
+    Transmitter transmitter(conn, conn, topology);
+    LiquidCooling lq(topology, lqConn);
+    std::shared_ptr<ThrowingListener> failing(new ThrowingListener(true));
+    std::shared_ptr<ThrowingListener> counting(new ThrowingListener(false));
+    transmitter.addListener(failing);
+    transmitter.addListener(counting);
+
+    // A throwing listener is counted, the next one is still called.
+    ASSERT_NO_THROW(transmitter.updateStateAndStatus());
+    ASSERT_FALSE(transmitter.tryUpdateReadParameters().failed());
+    ASSERT_TRUE(lqConn->tryReadResult("LQupdate").hasValue());
+    ASSERT_EQ(counting->calls, 2u);
+    ASSERT_EQ(transmitter.getListenerFailures(), 2u);
+    transmitter.removeListener(failing);
+    transmitter.removeListener(counting);
+
+    fake->setOffline(true);
+    SNMPexpected<SNMPresult> read = lqConn->tryReadResult("LQupdate");
+    ASSERT_FALSE(read.hasValue());
+    ASSERT_EQ(read.getError().status, SNMP_CLASS_TIMEOUT);
+    ASSERT_THROW(read.value(), SNMPconnectorException);
+    ASSERT_EQ(lqConn->tryReadResult("unknown").getError().status, SNMP_CLASS_ERROR);
+
+    // The throwing wrappers report the same error.
+    ASSERT_EQ(transmitter.tryUpdateReadParameters().status, SNMP_CLASS_TIMEOUT);
+    ASSERT_FALSE(transmitter.getDataValid());
+    ASSERT_FALSE(transmitter.isParameterValid(0));
+    ASSERT_THROW(transmitter.updateReadParameters(), SNMPconnectorException);
+    ASSERT_THROW(lqConn->readResult("LQupdate"), SNMPconnectorException);
+
+    // Once the status has its capacity, polling the unreachable agent does not allocate.
+    transmitter.updateStateAndStatus();
+    lq.updateStateAndStatus();
+    lq.tryUpdateReadParameters();
+    allocations = 0;
+    countAllocations = true;
+    for(int i = 0; i < 10; i++)
+    {
+        transmitter.updateStateAndStatus();
+        transmitter.tryUpdateReadParameters();
+        lq.updateStateAndStatus();
+        lq.tryUpdateReadParameters();
+    }
+    countAllocations = false;
+    ASSERT_EQ(allocations, 0u);
+    ASSERT_EQ(transmitter.getState(), States::UNKNOWN);
+    ASSERT_NE(transmitter.getStatus().find(Snmp_pp::Snmp::error_msg(SNMP_CLASS_TIMEOUT)), std::string::npos);
+}
+
+namespace
+{
+    // Publishes samples with all values equal until stopped.
+    void publishSamples(RFshmPublisher* publisher, const RFcomponent* component, std::atomic<bool>* stop)
+    {
+        std::vector<int64_t> values(component->getParameterNames().size());
+        for(int64_t sample = 0; !*stop; sample++)
+        {
+            values.assign(values.size(), sample);
+            publisher->parametersUpdated(*component, 0, values);
+        }
+    }
+}
+
+TEST(HISTORY, RollupTiers)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::vector<std::string> summaries = topology.getSummaryOids(AMPLIFIERS);
+    std::vector<std::string> ampOn = topology.expand(OIDS::AMP_ON, AMPLIFIERS);
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        fake->set(summaries[i], "5");
+        fake->set(ampOn[i], "5");
+    }
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(fake), 0));
+    Amplifiers amps(topology, conn);
+    amps.updateReadParameters();
+
+    // 1 s for 10 s and 10 s for a minute.
+    const uint64_t second = 1000000000ull;
+    HistoryTier tiers[] = { { second, 10 }, { 10 * second, 6 } };
+    std::shared_ptr<RFhistory> history(new RFhistory(std::vector<HistoryTier>(tiers, tiers + 2)));
+    ASSERT_THROW(RFhistory(std::vector<HistoryTier>(1, HistoryTier())), RfComponentException);
+
+    // 4 samples per second for 30 s, the value counts up.
+    const std::string parameter = amps.getParameterNames().at(0);
+    const uint64_t begin = 1000 * second;
+    std::vector<int64_t> values(amps.getParameterNames().size(), 0);
+    for(int64_t i = 0; i < 120; i++)
+    {
+        values[0] = i;
+        history->parametersUpdated(amps, begin + i * second / 4, values);
+    }
+    const uint64_t end = begin + 30 * second;
+
+    std::vector<HistoryPoint> points;
+    ASSERT_EQ(history->query(amps.getName(), "nothing", begin, end, points), -1);
+
+    // The last 5 s are in the fine tier.
+    ASSERT_EQ(history->query(amps.getName(), parameter, end - 5 * second, end, points), 0);
+    ASSERT_EQ(points.size(), 5u);
+    ASSERT_EQ(points[0].time, begin + 25 * second);
+    ASSERT_EQ(points[0].min, 100);
+    ASSERT_EQ(points[0].max, 103);
+    ASSERT_EQ(points[0].last, 103);
+    ASSERT_DOUBLE_EQ(points[0].mean, 101.5);
+    ASSERT_EQ(points[0].samples, 4u);
+
+    // The whole run only fits into the coarse tier. Older fine points were overwritten.
+    ASSERT_EQ(history->query(amps.getName(), parameter, begin, end, points), 1);
+    ASSERT_EQ(points.size(), 3u);
+    ASSERT_EQ(points[2].time, begin + 20 * second);
+    ASSERT_EQ(points[2].min, 80);
+    ASSERT_EQ(points[2].max, 119);
+    ASSERT_EQ(points[2].samples, 40u);
+    ASSERT_TRUE(history->query(amps.getName(), parameter, 0, begin, end, points));
+    ASSERT_EQ(points.size(), 10u);
+    ASSERT_EQ(points[0].time, begin + 20 * second);
+
+    // Invalid parameters are not sampled, late samples do not reopen overwritten points.
+    fake->setOffline(true);
+    ASSERT_THROW(amps.updateReadParameters(), SNMPconnectorException);
+    values[0] = 1000;
+    history->parametersUpdated(amps, end, values);
+    history->parametersUpdated(amps, begin, values);
+    ASSERT_EQ(history->query(amps.getName(), parameter, end, end, points), 0);
+    ASSERT_TRUE(points.empty());
+    ASSERT_TRUE(history->query(amps.getName(), parameter, 0, begin, begin, points));
+    ASSERT_TRUE(points.empty());
+}
+
+TEST(SHM, PublishAndRead)
+{
+    const std::string name = "/rftransmitter_test";
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(std::shared_ptr<SNMPtransport>(new DefaultingTransport(fake)), 0));
+    std::shared_ptr<RFshmPublisher> publisher(new RFshmPublisher(name));
+
+    LiquidCooling lq(topology, conn);
+    lq.addListener(publisher);
+    publisher->publish(lq);
+
+    RFshmReader reader(name);
+    ComponentSnapshot snapshot;
+    ASSERT_EQ(reader.getComponents(), 1u);
+    ASSERT_EQ(reader.getWriterPid(), getpid());
+    ASSERT_TRUE(reader.read(lq.getName(), snapshot));
+    ASSERT_EQ(snapshot.state, States::UNKNOWN);
+    ASSERT_FALSE(reader.read("nothing", snapshot));
+    ASSERT_FALSE(reader.read(1, snapshot));
+
+    lq.updateStateAndStatus();
+    lq.updateReadParameters();
+    ASSERT_TRUE(reader.read(0, snapshot));
+    ASSERT_EQ(snapshot.name, lq.getName());
+    ASSERT_EQ(snapshot.state, States::OK);
+    ASSERT_EQ(snapshot.status, "OK");
+    publisher->publish(lq);
+    ASSERT_TRUE(reader.read(0, snapshot));
+    ASSERT_EQ(snapshot.status, "OK");
+    ASSERT_EQ(snapshot.parameterNames, lq.getParameterNames());
+    ASSERT_EQ(snapshot.values, std::vector<int64_t>(lq.getParameterNames().size(), 5));
+    ASSERT_EQ(snapshot.valid, std::vector<bool>(lq.getParameterNames().size(), true));
+
+    // A parameter that fails to read is flagged and keeps its last value.
+    std::vector<std::string> inlet = topology.expand(OIDS::LQ_TIN, LIQUID_COOLING);
+    fake->remove(inlet[0]);
+    lq.updateReadParameters();
+    ASSERT_TRUE(reader.read(0, snapshot));
+    ASSERT_EQ(std::count(snapshot.valid.begin(), snapshot.valid.end(), false), 1);
+    for(size_t i = 0; i < snapshot.valid.size(); i++)
+    {
+        ASSERT_EQ(snapshot.valid[i], lq.isParameterValid(i));
+    }
+    ASSERT_EQ(snapshot.values, std::vector<int64_t>(lq.getParameterNames().size(), 5));
+
+    // Concurrent samples are never seen torn.
+    std::atomic<bool> stop(false);
+    std::thread writer(publishSamples, publisher.get(), &lq, &stop);
+    for(int i = 0; i < 100000; i++)
+    {
+        if(reader.read(0, snapshot))
+        {
+            ASSERT_EQ(std::count(snapshot.values.begin(), snapshot.values.end(), snapshot.values[0]),
+                      static_cast<ptrdiff_t>(snapshot.values.size()));
+        }
+    }
+    stop = true;
+    writer.join();
+
+    lq.removeListener(publisher);
+    publisher.reset();
+    ASSERT_THROW(RFshmReader other(name), RfShmException);
+}
+
+namespace
+{
+    // Remembers the last trip.
+    class TripRecorder : public PowerTripHandler
+    {
+    public:
+        TripRecorder() : trips(0), reason(0) {}
+
+        void tripped(const PowerTrip& trip)
+        {
+            reason = trip.reason;
+            trips++;
+        }
+
+        std::atomic<uint32_t> trips;
+        std::atomic<int32_t> reason;
+    };
+
+    // Waits up to a second for the number of trips.
+    bool waitForTrips(const TripRecorder& recorder, const uint32_t trips)
+    {
+        for(int i = 0; i < 1000 && recorder.trips < trips; i++)
+        {
+            usleep(1000);
+        }
+        return recorder.trips == trips;
+    }
+}
+
+TEST(POWERMONITOR, TripsAndRearms)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    fake->set(topology.getOid(OIDS::TRANS_FP), "1000", sNMP_SYNTAX_GAUGE32);
+    fake->set(topology.getOid(OIDS::TRANS_RP), "10", sNMP_SYNTAX_GAUGE32);
+    fake->set(topology.getOid(OIDS::RF_LINK), "5");
+
+    PowerMonitorSettings settings;
+    settings.maxReflectedPower = 200;
+    settings.maxReflectionRatio = 0.1;
+    settings.period = 500;
+    settings.priority = 0;
+    std::shared_ptr<TripRecorder> recorder(new TripRecorder);
+    RFpowerMonitor monitor(fake, topology, settings, recorder);
+    monitor.start();
+
+    // Within limits.
+    usleep(10000);
+    ASSERT_GT(monitor.getCycles(), 0u);
+    ASSERT_EQ(recorder->trips, 0u);
+
+    // Ratio above 0.1 trips once while it lasts.
+    fake->set(topology.getOid(OIDS::TRANS_RP), "150", sNMP_SYNTAX_GAUGE32);
+    ASSERT_TRUE(waitForTrips(*recorder, 1));
+    ASSERT_EQ(recorder->reason, REFLECTION_RATIO_HIGH);
+    usleep(5000);
+    ASSERT_EQ(recorder->trips, 1u);
+    ASSERT_TRUE(monitor.isTripped());
+
+    // Re-armed by a good cycle, then the absolute limit.
+    fake->set(topology.getOid(OIDS::TRANS_RP), "10", sNMP_SYNTAX_GAUGE32);
+    usleep(5000);
+    ASSERT_FALSE(monitor.isTripped());
+    fake->set(topology.getOid(OIDS::TRANS_RP), "250", sNMP_SYNTAX_GAUGE32);
+    fake->set(topology.getOid(OIDS::TRANS_FP), "5000", sNMP_SYNTAX_GAUGE32);
+    ASSERT_TRUE(waitForTrips(*recorder, 2));
+    ASSERT_EQ(recorder->reason, REFLECTED_POWER_HIGH);
+
+    // Losing the agent is a trip too.
+    fake->set(topology.getOid(OIDS::TRANS_RP), "10", sNMP_SYNTAX_GAUGE32);
+    usleep(5000);
+    fake->setOffline(true);
+    ASSERT_TRUE(waitForTrips(*recorder, 3));
+    ASSERT_EQ(recorder->reason, NO_RESPONSE);
+
+    monitor.stop();
+    ASSERT_EQ(monitor.getReaction().count, 3u);
+}
+
+namespace
+{
+    // Fake transmitter that reacts to the recovery writes: resets clear the faults, output stage power shows up as forward power.
+    class RecoveringPlant : public DefaultingTransport
+    {
+    public:
+        RecoveringPlant(const std::shared_ptr<SNMPfakeTransport>& fake, const TransmitterTopology& topology)
+            : DefaultingTransport(fake), topology(topology), reflectedPercent(1), stuck(false), faultOnSwitch(false) {}
+
+        int32_t execute(SNMPpreparedRequest& request, SNMPresponse& response)
+        {
+            int32_t status = fake->execute(request, response);
+            if(status != SNMP_CLASS_SUCCESS || request.spec.operation != SNMP_SET || stuck)
+            {
+                return status;
+            }
+
+            const SNMPvarbind& written = request.spec.varbinds[0];
+            if(written.oid == topology.getOid(OIDS::MTX_RESET))
+            {
+                setAll(topology.getSummaryOids(MTX), "5");
+            }
+            else if(written.oid == topology.getOid(OIDS::TRANS_RESET))
+            {
+                setAll(topology.getSummaryOids(TRANSMITTER), "5");
+            }
+            else if(written.oid == topology.getOid(OIDS::TRANS_ON) && faultOnSwitch)
+            {
+                setAll(topology.getSummaryOids(TRANSMITTER), "3");
+            }
+            else if(written.oid == topology.getOid(OIDS::OUT_POWER))
+            {
+                uint32_t power = convertToValue<uint32_t>(written.value);
+                fake->set(topology.getOid(OIDS::TRANS_FP), written.value, sNMP_SYNTAX_GAUGE32);
+                fake->set(topology.getOid(OIDS::TRANS_RP), std::to_string(static_cast<long long>(power * reflectedPercent / 100)), sNMP_SYNTAX_GAUGE32);
+            }
+            return status;
+        }
+
+        void setAll(const std::vector<std::string>& oids, const std::string& value)
+        {
+            for(size_t i = 0; i < oids.size(); i++)
+            {
+                fake->set(oids[i], value);
+            }
+        }
+
+        const TransmitterTopology topology;
+        uint32_t reflectedPercent;
+        bool stuck; //!< Ignore the writes.
+        bool faultOnSwitch; //!< Switching on faults the transmitter.
+    };
+}
+
+TEST(RECOVERY, RampsAndAborts)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::shared_ptr<RecoveringPlant> plant(new RecoveringPlant(fake, topology));
+    std::shared_ptr<SNMPconnector> txConn(new SNMPconnector(plant, 0));
+    std::shared_ptr<SNMPconnector> mtxConn(new SNMPconnector(plant, 0));
+    std::shared_ptr<SNMPconnector> osConn(new SNMPconnector(plant, 0));
+    std::shared_ptr<SNMPconnector> write(new SNMPconnector(plant, 0));
+
+    Transmitter transmitter(txConn, write, topology);
+    MTx mtx(mtxConn, write, topology);
+    OutStage outStage(osConn, write, topology);
+
+    // Learn the OIDs, then trip.
+    transmitter.updateStateAndStatus();
+    transmitter.updateReadParameters();
+    mtx.updateStateAndStatus();
+    outStage.updateStateAndStatus();
+    outStage.updateReadParameters();
+    for(int i = 1; i <= 4; i++)
+    {
+        // Diagnostic nodes of the faulty transmitter, they follow the summary in the MIB.
+        fake->set(topology.getSummaryOids(TRANSMITTER)[0] + "." + std::to_string(static_cast<long long>(i)), "5");
+    }
+    plant->setAll(topology.getSummaryOids(TRANSMITTER), "3");
+    plant->setAll(topology.getSummaryOids(MTX), "3");
+    fake->set(topology.getOid(OIDS::TRANS_ON), "2");
+    fake->set(topology.getOid(OIDS::OUT_POWER), "0", sNMP_SYNTAX_GAUGE32);
+    fake->set(topology.getOid(OIDS::TRANS_FP), "0", sNMP_SYNTAX_GAUGE32);
+    fake->set(topology.getOid(OIDS::TRANS_RP), "0", sNMP_SYNTAX_GAUGE32);
+
+    RecoverySettings settings;
+    ASSERT_THROW(RFrecoverySequencer(transmitter, mtx, outStage, settings), RfComponentException);
+    settings.targetPower = 1000;
+    settings.powerStep = 300;
+    settings.maxReflectedPower = 100;
+    settings.maxReflectionRatio = 0.05;
+    settings.period = 200;
+    settings.stepTimeout = 1000;
+
+    RFrecoverySequencer sequencer(transmitter, mtx, outStage, settings);
+    ASSERT_EQ(sequencer.getStep(), RECOVERY_IDLE);
+    RecoveryResult result = sequencer.run();
+    ASSERT_EQ(result.step, RECOVERY_DONE) << result.reason;
+    ASSERT_TRUE(result.reason.empty());
+    ASSERT_EQ(result.power, 1000u);
+    ASSERT_EQ(sequencer.getStep(), RECOVERY_DONE);
+    ASSERT_EQ(mtx.getState(), States::OK);
+    ASSERT_EQ(transmitter.getSwitchOn(), static_cast<int32_t>(Transmitter::ON));
+    ASSERT_EQ(transmitter.getNominalPower(), 1000u);
+    ASSERT_EQ(outStage.getPower(), 1000u);
+    ASSERT_GT(result.stepDuration[RECOVERY_RAMP], 0u);
+    ASSERT_GE(result.reads, 8u);
+    ASSERT_EQ(sequencer.getStepTimes().count, 8u); // 4 steps and the ramp 300, 600, 900, 1000.
+
+    // Reflection above 5 % stops the ramp at its first step and takes the power back.
+    fake->set(topology.getOid(OIDS::OUT_POWER), "0", sNMP_SYNTAX_GAUGE32);
+    plant->reflectedPercent = 20;
+    settings.resetMtx = false;
+    RFrecoverySequencer failing(transmitter, mtx, outStage, settings);
+    result = failing.run();
+    ASSERT_EQ(result.step, RECOVERY_RAMP);
+    ASSERT_EQ(failing.getStep(), RECOVERY_ABORTED);
+    ASSERT_NE(result.reason.find("Reflection ratio"), std::string::npos);
+    ASSERT_EQ(result.power, 0u);
+    ASSERT_EQ(result.stepDuration[RECOVERY_RESET_MTX], 0u);
+    ASSERT_EQ(fake->get(topology.getOid(OIDS::OUT_POWER)), "0");
+    ASSERT_EQ(fake->get(topology.getOid(OIDS::TRANS_ON)), "2");
+
+    // A fault right after the switch on also ends in the safe state.
+    plant->reflectedPercent = 1;
+    plant->faultOnSwitch = true;
+    fake->set(topology.getOid(OIDS::OUT_POWER), "300", sNMP_SYNTAX_GAUGE32);
+    RFrecoverySequencer faulting(transmitter, mtx, outStage, settings);
+    result = faulting.run();
+    ASSERT_EQ(result.step, RECOVERY_SWITCH_ON);
+    ASSERT_NE(result.reason.find("Transmitter fault"), std::string::npos);
+    ASSERT_EQ(fake->get(topology.getOid(OIDS::OUT_POWER)), "0");
+    ASSERT_EQ(fake->get(topology.getOid(OIDS::TRANS_ON)), "2");
+    plant->faultOnSwitch = false;
+
+    // A reset that does not clear the fault runs into the timeout.
+    plant->setAll(topology.getSummaryOids(TRANSMITTER), "3");
+    fake->set(topology.getOid(OIDS::TRANS_ON), "1");
+    plant->stuck = true;
+    settings.stepTimeout = 20;
+    RFrecoverySequencer stuck(transmitter, mtx, outStage, settings);
+    result = stuck.run();
+    ASSERT_EQ(result.step, RECOVERY_RESET_TRANSMITTER);
+    ASSERT_EQ(result.reason, "transmitter reset: Timeout.");
+    ASSERT_EQ(fake->get(topology.getOid(OIDS::TRANS_ON)), "1"); // Nothing is switched during the resets.
+}
+
+TEST(UDP, AgainstLocalAgent)
+{
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    fake->set("1.3.6.1.2.1.1.1.0", "RF transmitter", sNMP_SYNTAX_OCTETS);
+    fake->set("1.3.6.1.2.1.1.3.0", "123456", sNMP_SYNTAX_TIMETICKS);
+    fake->set("1.3.6.1.2.1.1.7.0", "-72");
+    SNMPlocalAgent agent(fake);
+
+    SNMPconnector conn(std::shared_ptr<SNMPtransport>(new SNMPudpTransport("127.0.0.1", "public", agent.getPort(), 100)), 0);
+
+    std::vector<std::string> oids;
+    oids.push_back("1.3.6.1.2.1.1.1.0");
+    oids.push_back("1.3.6.1.2.1.1.7.0");
+    conn.createRequest("get", oids);
+    conn.createBulkRequest("bulk", "1.3.6.1.2.1.1", 2);
+
+    std::vector<std::string> values = conn.readRequest("get");
+    ASSERT_EQ(values.size(), 2u);
+    ASSERT_EQ(values[0], "RF transmitter");
+    ASSERT_EQ(values[1], "-72");
+
+    values = conn.readRequest("bulk");
+    ASSERT_EQ(values.size(), 2u);
+    ASSERT_EQ(values[1], "123456");
+
+    conn.setValue<int32_t>("1.3.6.1.2.1.1.7.0", 1000);
+    ASSERT_EQ(fake->get("1.3.6.1.2.1.1.7.0"), "1000");
+    ASSERT_THROW(conn.setValue<int32_t>("1.3.6.1.2.1.1.8.0", 1), SNMPconnectorException);
+
+    fake->setOffline(true);
+    ASSERT_THROW(conn.readRequest("get"), SNMPconnectorException);
+    ASSERT_EQ(conn.getStatistics()["get"].timeouts, 1u);
+    ASSERT_EQ(agent.getAnswered(), 4u);
+}
+
+namespace
+{
+    /// Keeps the times of the last notifications.
+    class TimeListener : public ComponentListener
+    {
+    public:
+        TimeListener() : parametersTime(0), stateTime(0) {}
+
+        void parametersUpdated(const RFcomponent&, const uint64_t time, const std::vector<int64_t>&) { parametersTime = time; }
+        void stateChanged(const RFcomponent&, const uint64_t time, const States, const States, const std::string&) { stateTime = time; }
+
+        uint64_t parametersTime;
+        uint64_t stateTime;
+    };
+}
+
+TEST(TIMESTAMP, KernelReceiveTimes)
+{
+    TransmitterTopology topology;
+    std::shared_ptr<SNMPfakeTransport> fake(new SNMPfakeTransport());
+    std::vector<std::string> summaries = topology.getSummaryOids(AMPLIFIERS);
+    std::vector<std::string> ampOn = topology.expand(OIDS::AMP_ON, AMPLIFIERS);
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        fake->set(summaries[i], "5");
+        fake->set(ampOn[i], "5");
+    }
+    SNMPlocalAgent agent(fake);
+
+    // The UDP transport stamps the response itself, with the arrival time the kernel recorded.
+    std::shared_ptr<SNMPtransport> udp(new SNMPudpTransport("127.0.0.1", "public", agent.getPort(), 100));
+    SNMPrequestSpec spec;
+    SNMPvarbind varbind = { summaries[0], "", sNMP_SYNTAX_NULL };
+    spec.varbinds.push_back(varbind);
+    std::shared_ptr<SNMPpreparedRequest> prepared = udp->prepare(spec);
+    SNMPresponse response;
+    response.sentTime = 0;
+    response.receivedTime = 0;
+    uint64_t before = wallClockNanoseconds();
+    ASSERT_EQ(udp->execute(*prepared, response), SNMP_CLASS_SUCCESS);
+    uint64_t after = wallClockNanoseconds();
+    ASSERT_LE(before, response.sentTime);
+    ASSERT_LT(response.sentTime, response.receivedTime);
+    ASSERT_LE(response.receivedTime, after);
+
+    // Results and component notifications carry the receive time of their read.
+    std::shared_ptr<SNMPconnector> conn(new SNMPconnector(udp, 0));
+    Amplifiers amps(topology, conn);
+    std::shared_ptr<TimeListener> listener(new TimeListener());
+    amps.addListener(listener);
+
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getState(), States::OK);
+    ASSERT_NE(amps.getStateTime(), 0u);
+    ASSERT_EQ(listener->stateTime, amps.getStateTime());
+
+    amps.updateReadParameters();
+    ASSERT_GT(amps.getParametersTime(), amps.getStateTime());
+    ASSERT_EQ(listener->parametersTime, amps.getParametersTime());
+    ASSERT_LT(amps.getParametersTime(), wallClockNanoseconds());
+
+    const std::map<std::string, RequestStatisticsSnapshot> stats = conn->getStatistics();
+    ASSERT_EQ(stats.at(amps.getName()).roundTrip.count, 1u);
+
+    // Values served from a cache keep the time they were received, not the time they were handed out.
+    std::shared_ptr<SNMPconnector> cached(new SNMPconnector(std::shared_ptr<SNMPtransport>(new SNMPcachingTransport(udp, 1000)), 0));
+    cached->createRequest("first", std::vector<std::string>(1, summaries[0]));
+    cached->createRequest("both", std::vector<std::string>(summaries.begin(), summaries.begin() + 2));
+    uint64_t received = cached->readResult("first").receivedTime;
+    const SNMPresult& both = cached->readResult("both");
+    ASSERT_EQ(both.receivedTime, received);
+    ASSERT_LT(both.sentTime, both.receivedTime);
+    ASSERT_EQ(cached->readResult("first").receivedTime, received);
+    ASSERT_EQ(cached->getStatistics()["first"].roundTrip.count, 1u);
+
+    fake->setOffline(true);
+    amps.updateStateAndStatus();
+    ASSERT_EQ(amps.getStateTime(), 0u);
+    ASSERT_GT(listener->stateTime, received);
+}
+
+namespace
+{
+    void readBatched(SNMPconnector* conn, const int reads)
+    {
+        for(int i = 0; i < reads; i++)
+        {
+            conn->readRequest("get");
+        }
+    }
+}
+
+TEST(BATCH, OneSendmmsgForManyAgents)
+{
+    const size_t agents = 4;
+    std::vector<std::shared_ptr<SNMPfakeTransport> > fakes;
+    std::vector<std::shared_ptr<SNMPlocalAgent> > locals;
+    std::shared_ptr<SNMPudpBatch> batch(new SNMPudpBatch(100));
+    std::vector<std::shared_ptr<SNMPtransport> > targets;
+    for(size_t i = 0; i < agents; i++)
+    {
+        fakes.push_back(std::shared_ptr<SNMPfakeTransport>(new SNMPfakeTransport()));
+        fakes[i]->set("1.3.6.1.2.1.1.7.0", std::to_string(static_cast<long long>(i)));
+        locals.push_back(std::shared_ptr<SNMPlocalAgent>(new SNMPlocalAgent(fakes[i])));
+        targets.push_back(SNMPudpBatch::addTarget(batch, "127.0.0.1", "public", locals[i]->getPort()));
+    }
+    ASSERT_THROW(SNMPudpBatch::addTarget(batch, "localhost"), SNMPconnectorException);
+
+    // Explicit poll cycle: every agent in one send call, answers matched by request ID.
+    SNMPrequestSpec spec;
+    SNMPvarbind varbind = { "1.3.6.1.2.1.1.7.0", "", sNMP_SYNTAX_NULL };
+    spec.varbinds.push_back(varbind);
+
+    fakes[2]->setOffline(true);
+    std::vector<std::shared_ptr<SNMPpreparedRequest> > requests;
+    std::vector<SNMPresponse> responses(agents);
+    std::vector<int32_t> status(agents);
+    for(size_t i = 0; i < agents; i++)
+    {
+        requests.push_back(targets[i]->prepare(spec));
+        batch->queue(*requests[i], responses[i], status[i]);
+    }
+
+    ASSERT_EQ(batch->exchange(), agents - 1);
+    ASSERT_EQ(batch->getSendCalls(), 1u);
+    ASSERT_EQ(batch->getDatagrams(), agents);
+    for(size_t i = 0; i < agents; i++)
+    {
+        if(i == 2)
+        {
+            ASSERT_EQ(status[i], SNMP_CLASS_TIMEOUT);
+            ASSERT_EQ(responses[i].responseSize, 0u);
+            continue;
+        }
+        ASSERT_EQ(status[i], SNMP_CLASS_SUCCESS);
+        ASSERT_EQ(responses[i].varbinds.size(), 1u);
+        ASSERT_EQ(responses[i].varbinds[0].value, std::to_string(static_cast<long long>(i)));
+    }
+    fakes[2]->setOffline(false);
+
+    // Connectors on the target transports polling concurrently share exchanges.
+    std::vector<std::shared_ptr<SNMPconnector> > connectors;
+    for(size_t i = 0; i < agents; i++)
+    {
+        connectors.push_back(std::shared_ptr<SNMPconnector>(new SNMPconnector(targets[i], 0)));
+        connectors[i]->createRequest("get", std::vector<std::string>(1, "1.3.6.1.2.1.1.7.0"));
+    }
+
+    uint64_t sendCalls = batch->getSendCalls();
+    std::vector<std::shared_ptr<std::thread> > threads;
+    for(size_t i = 0; i < agents; i++)
+    {
+        threads.push_back(std::shared_ptr<std::thread>(new std::thread(readBatched, connectors[i].get(), 20)));
+    }
+    for(size_t i = 0; i < agents; i++)
+    {
+        threads[i]->join();
+    }
+
+    ASSERT_EQ(batch->getDatagrams(), agents + agents * 20);
+    ASSERT_LE(batch->getSendCalls() - sendCalls, agents * 20);
+    for(size_t i = 0; i < agents; i++)
+    {
+        ASSERT_EQ(connectors[i]->readRequest("get")[0], std::to_string(static_cast<long long>(i)));
+        ASSERT_EQ(connectors[i]->getStatistics()["get"].timeouts, 0u);
+    }
+}
+
+TEST(USM, KeysLocalizedOncePerEngine)
+{
+    SNMPv3credentials credentials;
+    credentials.securityName = "rfmonitor";
+    credentials.authPassword = "authpassword";
+    credentials.privPassword = "privpassword";
+
+    if(!SNMPusm::isSupported())
+    {
+        ASSERT_THROW(SNMPconnector("127.0.0.1", credentials), SNMPconnectorException);
+        return;
+    }
+
+    SNMPusm& usm = SNMPusm::instance();
+    uint64_t before = usm.getLocalizations();
+
+    ASSERT_TRUE(usm.localize(credentials, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_FALSE(usm.localize(credentials, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_TRUE(usm.localize(credentials, Snmp_pp::OctetStr("engine-b-test")));
+    ASSERT_EQ(usm.getLocalizations(), before + 2);
+
+    // A changed password or protocol replaces the keys of the user, the other engine keeps its keys.
+    SNMPv3credentials changed(credentials);
+    changed.authPassword = "otherpassword";
+    ASSERT_TRUE(usm.localize(changed, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_FALSE(usm.localize(changed, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_TRUE(usm.localize(credentials, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_FALSE(usm.localize(credentials, Snmp_pp::OctetStr("engine-b-test")));
+    changed = credentials;
+    changed.privPassword = "otherpassword";
+    ASSERT_TRUE(usm.localize(changed, Snmp_pp::OctetStr("engine-a-test")));
+    changed.privProtocol = SNMPv3_PRIV_DES;
+    ASSERT_TRUE(usm.localize(changed, Snmp_pp::OctetStr("engine-a-test")));
+    ASSERT_EQ(usm.getLocalizations(), before + 6);
+
+    // Nobody answers the discovery, so the request times out and the next one tries again.
+    std::shared_ptr<SNMPppTransport> transport(new SNMPppTransport("127.0.0.1", credentials, 16161, 100));
+    SNMPconnector conn(transport, 0);
+    conn.createRequest("get", std::vector<std::string>(1, "1.3.6.1.2.1.1.1.0"));
+    ASSERT_THROW(conn.readRequest("get"), SNMPconnectorException);
+    ASSERT_EQ(conn.getStatistics()["get"].timeouts, 1u);
+    ASSERT_EQ(transport->getEngineId(), "");
+}
@@ -0,0 +1,35 @@
+"""Smoke test of the Python module, run by "make pytest". Uses the in-process fake agent, no network needed."""
+
+import numpy as np
+import rftransmitter as rf
+
+# Connector over the fake agent.
+fake = rf.SNMPfakeTransport()
+fake.set("1.3.6.1.4.1.1.1.0", "42")
+snmp = rf.SNMPconnector(fake, 0)
+snmp.createRequest("get", ["1.3.6.1.4.1.1.1.0", "1.3.6.1.4.1.1.2.0"])
+result = snmp.readResult("get")
+assert result.values[0] == "42"
+assert result.invalid == 1
+assert result.status[1] == rf.VarbindStatus.NO_SUCH_OBJECT
+
+# Components, their parameter view and the listeners.
+transmitter = rf.Transmitter(snmp, snmp)
+history = rf.RFhistory()
+metrics = rf.RFmetrics()
+transmitter.addListener(history)
+transmitter.addListener(metrics)
+
+status, message = transmitter.tryUpdateReadParameters()
+assert status != 0 and message
+parameters = transmitter.parameters
+assert parameters.dtype == np.int64
+assert len(parameters) == len(transmitter.getParameterNames()) == 5
+assert not parameters.flags.writeable
+assert transmitter.getParameterValid() == [False] * 5
+
+tier, points = history.query(transmitter.getName(), "forwardPower", 0, rf.wallClock())
+assert points.dtype.names == ("time", "min", "max", "last", "mean", "samples")
+assert len(points) == 0
+
+print("Python smoke test passed.")
@@ -0,0 +1,118 @@
+#include "snmpagent.h"
+#include "snmpber.h"
+#include "snmpconnector.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+SNMPlocalAgent::SNMPlocalAgent(const std::shared_ptr<SNMPtransport>& backend, const uint16_t port)
+    : backend(backend), socketFd(-1), port(port), stop(false), answered(0)
+{
+    if(!backend)
+    {
+        throw SNMPconnectorException("No transport provided.");
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+
+    socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(socketFd < 0 || bind(socketFd, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+       getsockname(socketFd, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+    {
+        std::string error(std::strerror(errno));
+        if(socketFd >= 0)
+        {
+            close(socketFd);
+        }
+        throw SNMPconnectorException("Failed to bind local agent: " + error);
+    }
+    this->port = ntohs(address.sin_port);
+
+    thread = std::thread(run, this);
+}
+
+SNMPlocalAgent::~SNMPlocalAgent()
+{
+    stop = true;
+    thread.join();
+    close(socketFd);
+}
+
+void SNMPlocalAgent::run(SNMPlocalAgent* agent)
+{
+    std::vector<uint8_t> datagram(65535);
+    SNMPmessage request;
+    SNMPresponse response;
+    SNMPrequestSpec spec;
+    std::string varbinds;
+    std::string message;
+
+    while(!agent->stop)
+    {
+        // Wake up regularly to notice the stop flag.
+        pollfd descriptor;
+        descriptor.fd = agent->socketFd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        if(poll(&descriptor, 1, 20) <= 0)
+        {
+            continue;
+        }
+
+        sockaddr_storage from;
+        socklen_t fromLength = sizeof(from);
+        ssize_t received = recvfrom(agent->socketFd, &datagram[0], datagram.size(), 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if(received <= 0 || !SNMPber::decodeMessage(&datagram[0], static_cast<size_t>(received), request))
+        {
+            continue;
+        }
+
+        switch(request.pduType)
+        {
+        case sNMP_PDU_GETBULK:
+            spec.operation = SNMP_GETBULK;
+            break;
+        case sNMP_PDU_SET:
+            spec.operation = SNMP_SET;
+            break;
+        default:
+            spec.operation = SNMP_GET;
+            break;
+        }
+        spec.varbinds.swap(request.varbinds);
+        spec.maxRepetitions = (spec.operation == SNMP_GETBULK) ? static_cast<uint16_t>(request.errorIndex) : 0;
+
+        int32_t status;
+        try
+        {
+            status = agent->backend->execute(*agent->backend->prepare(spec), response);
+        }
+        catch(const SNMPconnectorException&)
+        {
+            status = SNMP_CLASS_TIMEOUT; // Unparsable request. Real agents drop those too.
+        }
+
+        if(status < SNMP_CLASS_SUCCESS)
+        {
+            continue; // Backend is offline.
+        }
+
+        // Errors are answered with the request varbinds, like agents do.
+        varbinds.clear();
+        SNMPber::encodeVarbinds((status == SNMP_CLASS_SUCCESS) ? response.varbinds : spec.varbinds, varbinds);
+        SNMPber::encodeMessage(request.version, request.community, sNMP_PDU_RESPONSE, request.requestId, status,
+                               (status == SNMP_CLASS_SUCCESS) ? 0 : 1, varbinds, message);
+
+        sendto(agent->socketFd, message.data(), message.size(), 0, reinterpret_cast<sockaddr*>(&from), fromLength);
+        agent->answered++;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SNMPAGENT_H
+#define SNMPAGENT_H
+
+#include "snmptransport.h"
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <cstdatomic>
+
+/**
+ * @brief The SNMPlocalAgent class SNMPv1/v2c agent on a loopback UDP port that answers from another transport, e.g. an
+ * SNMPfakeTransport or a replay. Lets the real SNMP++ and UDP transports be tested and benchmarked without a device.
+ * Requests the backend does not answer (timeouts) are dropped. Test support, it is not built into the library.
+ */
+class SNMPlocalAgent
+{
+public:
+    /**
+     * @brief SNMPlocalAgent Binds the port and starts answering.
+     * @param backend Transport that produces the answers.
+     * @param port Port on 127.0.0.1. 0 picks a free one.
+     */
+    explicit SNMPlocalAgent(const std::shared_ptr<SNMPtransport>& backend, const uint16_t port = 0);
+    ~SNMPlocalAgent();
+
+    /**
+     * @brief getPort Returns the bound port.
+     * @return Port number.
+     */
+    inline uint16_t getPort() const { return port; }
+
+    /**
+     * @brief getAnswered Returns the number of answered requests.
+     * @return Number of responses sent.
+     */
+    inline uint64_t getAnswered() const { return answered; }
+
+private:
+    std::shared_ptr<SNMPtransport> backend; //!< Produces the answers.
+    int socketFd; //!< Bound socket.
+    uint16_t port; //!< Bound port.
+    std::atomic<bool> stop; //!< Stops the agent thread.
+    std::atomic<uint64_t> answered; //!< Number of responses sent.
+    std::thread thread; //!< Agent thread.
+
+    static void run(SNMPlocalAgent* agent); /// Agent loop.
+};
+
+#endif // SNMPAGENT_H
@@ -0,0 +1,72 @@
+#include "rfrecorder.h"
+#include <iostream>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    // Name of a recorded state, the raw value if it is not a known state.
+    std::string stateText(const int64_t state)
+    {
+        if(state < 0 || state > States::END_OF_STATE)
+        {
+            std::stringstream raw;
+            raw << state;
+            return raw.str();
+        }
+        return StatesText[state];
+    }
+}
+
+// Prints a recording made by RFrecorder as CSV.
+int main(int argc, char **argv)
+{
+    if(argc != 2 && argc != 4)
+    {
+        std::cout << "Wrong usage!" << std::endl;
+        std::cout << "Execute the program with the recording prefix and optionally a time range in ns since the epoch" << std::endl;
+        std::cout << "Example: ./rfrecdump /var/lib/rf/solaris 1500000000000000000 1500000060000000000" << std::endl;
+        return -1;
+    }
+
+    uint64_t from = 0;
+    uint64_t to = std::numeric_limits<uint64_t>::max();
+    if(argc == 4)
+    {
+        from = std::strtoull(argv[2], 0, 10);
+        to = std::strtoull(argv[3], 0, 10);
+    }
+
+    try
+    {
+        RFrecordReader reader(argv[1]);
+
+        std::cout << "time,channel,type,value,previous" << std::endl;
+        for(uint64_t position = reader.seek(from); position < reader.size(); position++)
+        {
+            RFrecordReader::Sample sample = reader.at(position);
+            if(sample.time >= to)
+            {
+                break;
+            }
+
+            std::cout << sample.time << ',' << sample.channel << ',';
+            if(sample.type == STATE_TRANSITION)
+            {
+                std::cout << "state," << stateText(sample.value) << ',' << stateText(sample.previous) << std::endl;
+            }
+            else
+            {
+                std::cout << "sample," << sample.value << ',' << std::endl;
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}